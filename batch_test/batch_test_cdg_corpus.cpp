@@ -0,0 +1,88 @@
+#include <chrono>
+#include <iostream>
+
+#include "argparse/argparse.hpp"
+#include "cdg_corpus.h"
+#include "cdg_scheduler.h"
+
+using namespace intersection_management;
+
+// writes graphs of random intersections to a corpus, or times the multi-weighted BFST over a corpus:
+// batch_test_cdg_corpus --write corpus.imcg --vehicles 30 --count 100000
+// batch_test_cdg_corpus --read corpus.imcg
+int main(int argc, char *argv[]) {
+    argparse::ArgumentParser program("batch_test_cdg_corpus");
+    program.add_argument("--write")
+        .help("corpus to generate")
+        .default_value(std::string());
+    program.add_argument("--read")
+        .help("corpus to schedule")
+        .default_value(std::string());
+    program.add_argument("--vehicles")
+        .help("vehicles per generated graph")
+        .scan<'i', int>()
+        .default_value(30);
+    program.add_argument("--count")
+        .help("graphs to generate")
+        .scan<'i', int>()
+        .default_value(1000);
+    program.add_argument("--seed")
+        .help("seed of the first graph, graph i uses seed + i")
+        .scan<'i', int>()
+        .default_value(0);
+    try {
+        program.parse_args(argc, argv);
+    }
+    catch (const std::runtime_error &err) {
+        std::cerr << err.what() << "\n" << program;
+        return 1;
+    }
+
+    auto write_file = program.get<std::string>("--write");
+    if (!write_file.empty()) {
+        CDGCorpusWriter writer(write_file);
+        for (int index = 0; index < program.get<int>("--count"); index++) {
+            Intersection intersection;
+            ConflictDirectedGraph cdg;
+            intersection.setSeed(program.get<int>("--seed") + index);
+            intersection.AddRandomVehicleNodes(program.get<int>("--vehicles"));
+            intersection.AssignCriticalResourcesToNodes();
+            intersection.AssignRoutesToNodes();
+            intersection.AssignEdgesWithSafetyOffsetToNodes();
+            cdg.GenerateGraphFromIntersection(intersection);
+            writer.Append(cdg);
+        }
+        if (!writer.Close()) {
+            return 1;
+        }
+        std::cout << "Wrote " << writer.getNumGraphs() << " graphs to " << write_file << "\n";
+    }
+
+    auto read_file = program.get<std::string>("--read");
+    if (!read_file.empty()) {
+        CDGCorpusReader reader(read_file);
+        if (!reader.isOpen()) {
+            return 1;
+        }
+        CDGScheduler scheduler;
+        CDGScheduleResult result;
+        ConflictDirectedGraph cdg;
+        double depth_sum = 0, load_us = 0, schedule_us = 0;
+        for (uint64_t index = 0; index < reader.getNumGraphs(); index++) {
+            auto t0 = std::chrono::steady_clock::now();
+            if (!reader.LoadGraph(index, cdg)) {
+                return 1;
+            }
+            auto t1 = std::chrono::steady_clock::now();
+            scheduler.ScheduleWithBfstMultiWeight(cdg, result);
+            auto t2 = std::chrono::steady_clock::now();
+            depth_sum += result.makespan_;
+            load_us += std::chrono::duration<double, std::micro>(t1 - t0).count();
+            schedule_us += std::chrono::duration<double, std::micro>(t2 - t1).count();
+        }
+        std::cout << "Graphs: " << reader.getNumGraphs() << ", MDBFST depth sum " << depth_sum << "\n";
+        std::cout << "  load:     " << load_us / reader.getNumGraphs() << " us per graph\n";
+        std::cout << "  schedule: " << schedule_us / reader.getNumGraphs() << " us per graph\n";
+    }
+    return 0;
+}
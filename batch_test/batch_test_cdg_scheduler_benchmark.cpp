@@ -0,0 +1,58 @@
+#include "cdg_scheduler.h"
+
+#include <chrono>
+
+using namespace intersection_management;
+
+// time the four spanning tree schedulers on graphs generated from random intersections
+int main() {
+    std::vector<int> num_nodes_list = {30, 60, 120};
+    int num_graphs = 20;
+    int num_repeats = 5;
+
+    for (int num_nodes : num_nodes_list) {
+        std::vector<ConflictDirectedGraph> graphs(num_graphs);
+        for (int seed = 0; seed < num_graphs; seed++) {
+            Intersection intersection;
+            intersection.setSeed(seed);
+            intersection.AddRandomVehicleNodes(num_nodes);
+            intersection.AssignCriticalResourcesToNodes();
+            intersection.AssignRoutesToNodes();
+            intersection.AssignEdgesWithSafetyOffsetToNodes();
+            graphs[seed].GenerateGraphFromIntersection(intersection);
+        }
+
+        CDGScheduler scheduler;
+        CDGScheduleResult result;
+        std::vector<double> elapsed_us(4, 0.0), depth_sum(4, 0.0);
+        for (int repeat = 0; repeat < num_repeats; repeat++) {
+            for (auto &cdg : graphs) {
+                auto t0 = std::chrono::steady_clock::now();
+                scheduler.ScheduleWithModifiedDfst(cdg, result);
+                depth_sum[0] += result.makespan_;
+                auto t1 = std::chrono::steady_clock::now();
+                scheduler.ScheduleWithBfstWeightedEdgeOnly(cdg, result);
+                depth_sum[1] += result.makespan_;
+                auto t2 = std::chrono::steady_clock::now();
+                scheduler.ScheduleWithBfstMultiWeight(cdg, result);
+                depth_sum[2] += result.makespan_;
+                auto t3 = std::chrono::steady_clock::now();
+                scheduler.ScheduleWithDfstMultiWeight(cdg, result);
+                depth_sum[3] += result.makespan_;
+                auto t4 = std::chrono::steady_clock::now();
+                elapsed_us[0] += std::chrono::duration<double, std::micro>(t1 - t0).count();
+                elapsed_us[1] += std::chrono::duration<double, std::micro>(t2 - t1).count();
+                elapsed_us[2] += std::chrono::duration<double, std::micro>(t3 - t2).count();
+                elapsed_us[3] += std::chrono::duration<double, std::micro>(t4 - t3).count();
+            }
+        }
+
+        int num_schedules = num_graphs * num_repeats;
+        std::cout << "Nodes: " << num_nodes << "\n";
+        std::cout << "  Modified DFST:  " << elapsed_us[0] / num_schedules << " us, depth sum " << depth_sum[0] << "\n";
+        std::cout << "  BFST:           " << elapsed_us[1] / num_schedules << " us, depth sum " << depth_sum[1] << "\n";
+        std::cout << "  MDBFST:         " << elapsed_us[2] / num_schedules << " us, depth sum " << depth_sum[2] << "\n";
+        std::cout << "  MDDFST:         " << elapsed_us[3] / num_schedules << " us, depth sum " << depth_sum[3] << "\n";
+    }
+    return 0;
+}
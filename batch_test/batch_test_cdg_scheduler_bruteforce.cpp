@@ -1,20 +1,30 @@
 #include "cdg_scheduler.h"
 
+#include <memory>
+
 using namespace intersection_management;
 
-int main() {
+// an optional argument names a file of proven optima, e.g. batch_test_cdg_scheduler_bruteforce optima.bin
+int main(int argc, char *argv[]) {
     ConflictDirectedGraph cdg = ConflictDirectedGraph();
 
     CDGScheduler scheduler_dfs = CDGScheduler();
     CDGScheduler scheduler_bfs = CDGScheduler();
     CDGScheduler scheduler_mdbfs = CDGScheduler();
     CDGScheduler scheduler_bruteforce = CDGScheduler();
+    std::unique_ptr<OptimalSolutionCache> optimal_solution_cache;
+    if (argc > 1) {
+        optimal_solution_cache.reset(new OptimalSolutionCache(argv[1]));
+        scheduler_bruteforce.optimal_solution_cache_ = optimal_solution_cache.get();
+    }
 
     // cdg generater parameters
     unsigned int seed = 0;
     int max_node = 1;
     double max_estimate_travel_time = 5.0;
     double min_estimate_travel_time = 2.0;
+    // graphs of GenerateRandomConnectedGraph at a random density instead, which changes the results of a seed
+    bool use_connected_graphs = false;
     // verbose flag
     bool verbose_mode_for_bfs = false;
     bool verbose_mode_for_mwbfs = false;
@@ -36,13 +46,18 @@ int main() {
 
     // seed = std::time(NULL);
     seed = 0;
-    srand(seed);
+    cdg.setSeed(seed);
     while (total_test < 1) {
         total_test++;
-        do {
-            cdg.GenerateRandomGraph(std::rand() % max_node + 5, max_estimate_travel_time - min_estimate_travel_time + 1.0, 2.0, min_estimate_travel_time, 1.0, true);
-            // cdg.GenerateRandomGraph(5, max_estimate_travel_time - min_estimate_travel_time + 1.0, 2.0, min_estimate_travel_time, 1.0, true);
-        } while (!cdg.isFullyConnected());
+        if (use_connected_graphs) {
+            cdg.GenerateRandomConnectedGraph(cdg.mt_() % max_node + 5, (cdg.mt_() % 100) * 0.01, max_estimate_travel_time - min_estimate_travel_time + 1.0, 2.0, min_estimate_travel_time, 1.0, true);
+        }
+        else {
+            do {
+                cdg.GenerateRandomGraph(cdg.mt_() % max_node + 5, max_estimate_travel_time - min_estimate_travel_time + 1.0, 2.0, min_estimate_travel_time, 1.0, true);
+                // cdg.GenerateRandomGraph(5, max_estimate_travel_time - min_estimate_travel_time + 1.0, 2.0, min_estimate_travel_time, 1.0, true);
+            } while (!cdg.isFullyConnected());
+        }
 
         // std::cout << "The CDG fully connected status is: " << cdg.isFullyConnected() << std::endl;
         auto modified_dfst = scheduler_dfs.ScheduleWithModifiedDfst(cdg);
@@ -18,6 +18,8 @@ int main() {
     int max_node = 1;
     double max_estimate_travel_time = 5.0;
     double min_estimate_travel_time = 2.0;
+    // graphs of GenerateRandomConnectedGraph at a random density instead, which changes the results of a seed
+    bool use_connected_graphs = false;
     // verbose flag
     bool verbose_mode_for_bfs = false;
     bool verbose_mode_for_mdbfs = false;
@@ -65,15 +67,20 @@ int main() {
 
     seed = std::time(NULL);
     // seed = 0;
-    srand(seed);
+    cdg.setSeed(seed);
     while (true) {
         total_test++;
         // srand(343);
         // srand(total_test);
-        do {
-            cdg.GenerateRandomGraph(std::rand() % max_node + 5, max_estimate_travel_time - min_estimate_travel_time + 1.0, 2.0, min_estimate_travel_time, 1.0, true);
-            // cdg.GenerateRandomGraph(5, max_estimate_travel_time - min_estimate_travel_time + 1.0, 2.0, min_estimate_travel_time, 1.0, true);
-        } while (!cdg.isFullyConnected());
+        if (use_connected_graphs) {
+            cdg.GenerateRandomConnectedGraph(cdg.mt_() % max_node + 5, (cdg.mt_() % 100) * 0.01, max_estimate_travel_time - min_estimate_travel_time + 1.0, 2.0, min_estimate_travel_time, 1.0, true);
+        }
+        else {
+            do {
+                cdg.GenerateRandomGraph(cdg.mt_() % max_node + 5, max_estimate_travel_time - min_estimate_travel_time + 1.0, 2.0, min_estimate_travel_time, 1.0, true);
+                // cdg.GenerateRandomGraph(5, max_estimate_travel_time - min_estimate_travel_time + 1.0, 2.0, min_estimate_travel_time, 1.0, true);
+            } while (!cdg.isFullyConnected());
+        }
 
         // std::cout << "The CDG fully connected status is: " << cdg.isFullyConnected() << std::endl;
         auto modified_dfst = scheduler_dfs.ScheduleWithModifiedDfst(cdg);
@@ -83,8 +90,8 @@ int main() {
         auto depth_vector = scheduler_bruteforce.GetDepthVectorFromOrder(best_order, cdg);
         double global_optimal = scheduler_bruteforce.GetEvacuationTimeFromOrder(best_order, cdg);
 
-        // add fairness conflicts
-        cdg.AddFairnessConflicts();
+        // add fairness conflicts, kept implicitly by the schedulers
+        cdg.AddImplicitFairnessConflicts();
         auto modified_dfst_fairness = scheduler_dfs.ScheduleWithModifiedDfst(cdg);
         auto bfst_fairness = scheduler_bfs.ScheduleWithBfstWeightedEdgeOnly(cdg);
         auto mdbfst_fairness = scheduler_mdbfs.ScheduleWithBfstMultiWeight(cdg);
@@ -0,0 +1,117 @@
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+
+#include "argparse/argparse.hpp"
+#include "plan_delta.h"
+#include "planning_pipeline.h"
+
+using namespace intersection_management;
+
+// latency and throughput of the admission knobs over the same synthetic demand, one row per combination:
+// batch_test_online_admission --batch-sizes 1 4 16 --deadlines 0.5 2 --horizon 3600
+int main(int argc, char *argv[]) {
+    argparse::ArgumentParser program("batch_test_online_admission");
+    program.add_argument("--batch-sizes")
+        .help("batch size thresholds of the sweep")
+        .nargs(argparse::nargs_pattern::at_least_one)
+        .scan<'i', int>()
+        .default_value(std::vector<int>{1, 2, 4, 8, 16});
+    program.add_argument("--deadlines")
+        .help("batch deadlines in seconds")
+        .nargs(argparse::nargs_pattern::at_least_one)
+        .scan<'g', double>()
+        .default_value(std::vector<double>{0.5, 2.0});
+    program.add_argument("--horizon")
+        .help("simulated seconds of demand")
+        .scan<'g', double>()
+        .default_value(3600.0);
+    program.add_argument("--demand")
+        .help("YAML demand profile, uniform over the configured geometry if not given")
+        .default_value(std::string());
+    program.add_argument("--arrival-interval")
+        .help("mean seconds between arrivals of the uniform demand, the configured one saturates the intersection")
+        .scan<'g', double>()
+        .default_value(4.0);
+    program.add_argument("--cold-start-period")
+        .help("every this many plans one is scheduled from scratch, the others warm start from the previous plan")
+        .scan<'i', int>()
+        .default_value(1);
+    program.add_argument("--pipeline")
+        .help("also run every combination on the three thread pipeline and report its wall time per stage")
+        .default_value(false)
+        .implicit_value(true);
+    program.add_argument("--seed")
+        .help("seed of the demand, the same for every combination")
+        .scan<'i', int>()
+        .default_value(0);
+    try {
+        program.parse_args(argc, argv);
+    }
+    catch (const std::runtime_error &err) {
+        std::cerr << err.what() << "\n" << program;
+        return 1;
+    }
+
+    Parameters local_param = param;
+    local_param.arrival_interval_avg = program.get<double>("--arrival-interval");
+    auto demand_file = program.get<std::string>("--demand");
+    auto profile = demand_file.empty() ? getUniformDemandProfile(local_param) : ReadDemandProfile(demand_file);
+    WarmStartOptions warm_start;
+    warm_start.cold_start_period_ = program.get<int>("--cold-start-period");
+    std::cout << std::setprecision(4);
+    std::cout << "batch_size deadline plans mean_batch admission_latency entry_delay mean_window plan_ms vehicles_per_cpu_s delta_bytes "
+                 "snapshot_bytes\n";
+    for (int batch_size : program.get<std::vector<int>>("--batch-sizes")) {
+        for (double deadline : program.get<std::vector<double>>("--deadlines")) {
+            DemandStream demand(local_param, profile, program.get<int>("--seed"));
+            ArrivalAdmission admission(ArrivalAdmissionOptions{batch_size, deadline});
+            // every delta is applied by a replica, which stands in for a consumer, and compared in size with
+            // the snapshot of the same plan
+            PlanReplica replica;
+            RunningStatistics snapshot_size;
+            std::vector<uint8_t> snapshot;
+            PlanPublisher publisher([&](const std::vector<uint8_t> &message) {
+                replica.Apply(message);
+                EncodePlanSnapshot(replica.getPlan(), snapshot);
+                snapshot_size.Add(snapshot.size());
+            });
+            OnlinePlanner planner(local_param, warm_start, &publisher);
+            long num_admitted = RunOnlinePlanning(demand, admission, planner, program.get<double>("--horizon"));
+            double planning_time = planner.planning_time_.mean_ * planner.planning_time_.count_;
+            std::cout << std::setw(10) << batch_size << std::setw(9) << deadline
+                      << std::setw(6) << planner.planning_time_.count_
+                      << std::setw(11) << admission.batch_size_.mean_
+                      << std::setw(18) << admission.latency_.mean_
+                      << std::setw(12) << planner.window_.entry_delay_.mean_
+                      << std::setw(12) << planner.window_size_.mean_
+                      << std::setw(9) << planner.planning_time_.mean_ * 1000
+                      << std::setw(19) << (planning_time > 0 ? num_admitted / planning_time : 0)
+                      << std::setw(12) << publisher.message_size_.mean_
+                      << std::setw(15) << snapshot_size.mean_ << "\n";
+            if (!program.get<bool>("--pipeline")) {
+                continue;
+            }
+
+            DemandStream pipeline_demand(local_param, profile, program.get<int>("--seed"));
+            PlanningPipeline pipeline(local_param, ArrivalAdmissionOptions{batch_size, deadline}, 16, warm_start);
+            std::vector<VehicleTraceRecord> arrival;
+            auto pipeline_start = std::chrono::steady_clock::now();
+            pipeline.Start([&](VehicleTraceRecord &record) {
+                arrival.clear();
+                if (pipeline_demand.NextBatch(arrival, 1, program.get<double>("--horizon")) == 0) {
+                    return false;
+                }
+                record = arrival[0];
+                return true;
+            });
+            pipeline.Join();
+            double wall_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - pipeline_start).count();
+            std::cout << "  pipeline: plans " << pipeline.getNumPlans() << ", entered " << pipeline.window_.num_entered_
+                      << ", entry_delay " << pipeline.window_.entry_delay_.mean_ << ", build_ms " << pipeline.build_time_.mean_ * 1000
+                      << ", schedule_ms " << pipeline.schedule_time_.mean_ * 1000 << ", vehicles_per_wall_s "
+                      << num_admitted / wall_time << "\n";
+        }
+    }
+    return 0;
+}
@@ -1,8 +0,0 @@
-#include "batch_test_utility.h"
-
-using namespace intersection_management;
-
-int main() {
-    BatchTest(5, 10000, 1000, 0);
-    return 0;
-}
\ No newline at end of file
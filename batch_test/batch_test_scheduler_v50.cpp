@@ -1,8 +0,0 @@
-#include "batch_test_utility.h"
-
-using namespace intersection_management;
-
-int main() {
-    BatchTest(50, 10000, 100, 0);
-    return 0;
-}
\ No newline at end of file
@@ -0,0 +1,35 @@
+#include <iostream>
+
+#include "argparse/argparse.hpp"
+#include "sumo_route_importer.h"
+
+using namespace intersection_management;
+
+// converts a SUMO route or trip file into a vehicle trace for the replay experiments:
+// batch_test_sumo_import --routes intersection.rou.xml --edge-map edges.yaml --output intersection.imvt
+int main(int argc, char *argv[]) {
+    argparse::ArgumentParser program("batch_test_sumo_import");
+    program.add_argument("--routes")
+        .help("SUMO route or trip file")
+        .required();
+    program.add_argument("--edge-map")
+        .help("YAML file mapping the incoming and outgoing edges to leg ids")
+        .required();
+    program.add_argument("--output")
+        .help("trace to write, CSV if it ends in .csv")
+        .required();
+    try {
+        program.parse_args(argc, argv);
+    }
+    catch (const std::runtime_error &err) {
+        std::cerr << err.what() << "\n" << program;
+        return 1;
+    }
+
+    SumoRouteImporter importer(param, ReadSumoEdgeMap(program.get<std::string>("--edge-map")));
+    if (!importer.ImportToTrace(program.get<std::string>("--routes"), program.get<std::string>("--output"))) {
+        return 1;
+    }
+    std::cout << "Imported " << importer.num_imported_ << " vehicles, skipped " << importer.num_skipped_ << ".\n";
+    return 0;
+}
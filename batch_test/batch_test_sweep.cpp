@@ -0,0 +1,211 @@
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <sstream>
+
+#include "argparse/argparse.hpp"
+#include "batch_test_utility.h"
+
+using namespace intersection_management;
+
+// runs the grid vehicles x geometries x travel time ranges in one process, e.g. the rows of
+// Experiments/batch_result2.txt: batch_test_sweep --vehicles 5 10 50 100 200 --geometries 2
+int main(int argc, char *argv[]) {
+    argparse::ArgumentParser program("batch_test_sweep");
+    program.add_argument("--vehicles")
+        .help("vehicle counts of the sweep")
+        .nargs(argparse::nargs_pattern::at_least_one)
+        .scan<'i', int>()
+        .default_value(std::vector<int>{5, 10, 50, 100, 200});
+    program.add_argument("--geometries")
+        .help("indices into geometryParamVec")
+        .nargs(argparse::nargs_pattern::at_least_one)
+        .scan<'i', int>()
+        .default_value(std::vector<int>{0});
+    program.add_argument("--travel-time-ranges")
+        .help("travel time ranges as min,max, the range of the geometry if not given")
+        .nargs(argparse::nargs_pattern::at_least_one)
+        .default_value(std::vector<std::string>{});
+    program.add_argument("--methods")
+        .help("methods to run: dfs bfs mdbfs global_optimal fifo mddfs, all if not given")
+        .nargs(argparse::nargs_pattern::at_least_one)
+        .default_value(std::vector<std::string>{});
+    program.add_argument("--test-count")
+        .help("samples per cell")
+        .scan<'i', int>()
+        .default_value(10000);
+    program.add_argument("--seed")
+        .help("starting seed of every cell, negative for a random one")
+        .scan<'i', int>()
+        .default_value(0);
+    program.add_argument("--ci-width")
+        .help("stop a cell once every confidence interval is narrower than this, disabled if not positive")
+        .scan<'g', double>()
+        .default_value(-1.0);
+    program.add_argument("--min-test-count")
+        .help("samples per cell before it may stop early")
+        .scan<'i', int>()
+        .default_value(100);
+    program.add_argument("--compare")
+        .help("paired differences to track as method-method, e.g. mdbfs-dfs")
+        .nargs(argparse::nargs_pattern::at_least_one)
+        .default_value(std::vector<std::string>{"mdbfs-dfs"});
+    program.add_argument("--checkpoint")
+        .help("file the sweep state is saved to, on ctrl+C and periodically")
+        .default_value(std::string());
+    program.add_argument("--checkpoint-period")
+        .help("seconds between two checkpoints")
+        .scan<'g', double>()
+        .default_value(60.0);
+    program.add_argument("--resume")
+        .help("continue the sweep from --checkpoint, with the same grid arguments")
+        .default_value(false)
+        .implicit_value(true);
+    program.add_argument("--records")
+        .help("columnar file every method of every sample is written to, see batch_record.h")
+        .default_value(std::string());
+    program.add_argument("--records-csv")
+        .help("CSV mirror of --records")
+        .default_value(std::string());
+    program.add_argument("--optimal-cache")
+        .help("file of proven global optima, reused by later runs and extended by this one")
+        .default_value(std::string());
+    program.add_argument("--threads")
+        .help("worker threads, 0 for every hardware thread")
+        .scan<'i', int>()
+        .default_value(0);
+    try {
+        program.parse_args(argc, argv);
+    }
+    catch (const std::runtime_error &err) {
+        std::cerr << err.what() << "\n" << program;
+        return 1;
+    }
+
+    if (program.get<int>("--test-count") < 0) {
+        std::cerr << "Test count " << program.get<int>("--test-count") << " is negative\n";
+        return 1;
+    }
+
+    // index 0 is the place holder of the depth vectors, not a method
+    auto findMethod = [](const std::string &name) {
+        return std::find(kBatchTestMethodNames.begin() + 1, kBatchTestMethodNames.end(), name) -
+               kBatchTestMethodNames.begin();
+    };
+    unsigned methods = kAllBatchTestMethods;
+    auto method_names = program.get<std::vector<std::string>>("--methods");
+    if (!method_names.empty()) {
+        methods = 0;
+        for (auto &name : method_names) {
+            int method = findMethod(name);
+            if (method == kNumberOfBatchTestMethods) {
+                std::cerr << "Unknown method " << name << "\n";
+                return 1;
+            }
+            methods |= 1u << method;
+        }
+    }
+
+    std::vector<BatchTestMethodPair> paired_differences;
+    for (auto &pair : program.get<std::vector<std::string>>("--compare")) {
+        auto dash = pair.find('-');
+        int first = findMethod(pair.substr(0, dash));
+        int second = dash == std::string::npos ? kNumberOfBatchTestMethods : findMethod(pair.substr(dash + 1));
+        if (first == kNumberOfBatchTestMethods || second == kNumberOfBatchTestMethods) {
+            std::cerr << "Paired difference " << pair << " is not method-method\n";
+            return 1;
+        }
+        // the default pair is only tracked when both of its methods run
+        if (!isMethodSelected(methods, static_cast<BatchTestMethod>(first)) ||
+            !isMethodSelected(methods, static_cast<BatchTestMethod>(second))) {
+            if (!program.is_used("--compare")) {
+                continue;
+            }
+            std::cerr << "Paired difference " << pair << " compares a method that is not in --methods\n";
+            return 1;
+        }
+        paired_differences.emplace_back(static_cast<BatchTestMethod>(first), static_cast<BatchTestMethod>(second));
+    }
+
+    std::vector<std::vector<int>> travel_time_ranges;
+    for (auto &range : program.get<std::vector<std::string>>("--travel-time-ranges")) {
+        std::vector<int> travel_time_range(2);
+        char comma;
+        std::istringstream range_stream(range);
+        if (!(range_stream >> travel_time_range[0] >> comma >> travel_time_range[1]) || comma != ',') {
+            std::cerr << "Travel time range " << range << " is not min,max\n";
+            return 1;
+        }
+        travel_time_ranges.push_back(travel_time_range);
+    }
+
+    // a resumed sweep appends the samples it still runs to the records of the interrupted one
+    std::unique_ptr<BatchRecordWriter> record_writer;
+    if (!program.get<std::string>("--records").empty()) {
+        record_writer.reset(new BatchRecordWriter(program.get<std::string>("--records"),
+                                                  program.get<std::string>("--records-csv"), program.get<bool>("--resume")));
+        if (!record_writer->isOpen()) {
+            return 1;
+        }
+    }
+
+    std::unique_ptr<OptimalSolutionCache> optimal_solution_cache;
+    if (!program.get<std::string>("--optimal-cache").empty()) {
+        optimal_solution_cache.reset(new OptimalSolutionCache(program.get<std::string>("--optimal-cache")));
+        if (!optimal_solution_cache->isOpen()) {
+            return 1;
+        }
+    }
+
+    std::vector<BatchTestOptions> cells;
+    for (int geometry : program.get<std::vector<int>>("--geometries")) {
+        if (geometry < 0 || geometry >= geometryParamVec.size()) {
+            std::cerr << "Geometry " << geometry << " is not in geometryParamVec\n";
+            return 1;
+        }
+        auto geometry_travel_time_ranges = travel_time_ranges;
+        if (geometry_travel_time_ranges.empty()) {
+            geometry_travel_time_ranges.push_back(geometryParamVec[geometry].travel_time_range);
+        }
+        for (auto &travel_time_range : geometry_travel_time_ranges) {
+            for (int num_nodes : program.get<std::vector<int>>("--vehicles")) {
+                BatchTestOptions cell;
+                cell.num_nodes_ = num_nodes;
+                cell.test_count_ = program.get<int>("--test-count");
+                cell.starting_seed_ = program.get<int>("--seed");
+                cell.methods_ = methods;
+                cell.ci_width_ = program.get<double>("--ci-width");
+                cell.min_test_count_ = program.get<int>("--min-test-count");
+                cell.paired_differences_ = paired_differences;
+                cell.param_ = geometryParamVec[geometry];
+                cell.param_.travel_time_range = travel_time_range;
+                cell.record_writer_ = record_writer.get();
+                cell.geometry_id_ = geometry;
+                cell.optimal_solution_cache_ = optimal_solution_cache.get();
+                cells.push_back(cell);
+            }
+        }
+    }
+
+    auto statistics = BatchSweep(cells, program.get<int>("--threads"), program.get<std::string>("--checkpoint"),
+                                 program.get<bool>("--resume"), program.get<double>("--checkpoint-period"));
+    if (record_writer) {
+        record_writer->Close();
+    }
+    if (optimal_solution_cache) {
+        std::cout << "Optimal solution cache: " << optimal_solution_cache->hits_ << " hits, "
+                  << optimal_solution_cache->misses_ << " misses, " << optimal_solution_cache->collisions_
+                  << " collisions, " << optimal_solution_cache->size() << " entries\n";
+    }
+    for (int cell = 0; cell < cells.size(); cell++) {
+        // one header per geometry and travel time range, the vehicle counts follow as in the result files
+        if (cell % program.get<std::vector<int>>("--vehicles").size() == 0) {
+            PrintBatchSweepCell(cells[cell]);
+        }
+        statistics[cell].Print(cells[cell].num_nodes_);
+        if (cells[cell].ci_width_ > 0) {
+            statistics[cell].PrintConfidenceIntervals(cells[cell].confidence_z_);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,47 @@
+#ifndef INTERSECTION_MANAGEMENT_ARRIVAL_ADMISSION_H_
+#define INTERSECTION_MANAGEMENT_ARRIVAL_ADMISSION_H_
+
+#include <limits>
+#include <vector>
+
+#include "running_statistics.h"
+#include "vehicle_trace.h"
+
+namespace intersection_management {
+
+// a batch closes once it holds max_batch_size_ vehicles or its first vehicle has waited max_batch_delay_
+// seconds, whichever comes first. A size of 1 plans on every arrival, a large size plans on a fixed period
+struct ArrivalAdmissionOptions {
+    int max_batch_size_ = 8;
+    double max_batch_delay_ = 1.0;
+};
+
+// Stage in front of the planner that gathers arrivals into micro-batches, so the graph is built and
+// scheduled once per batch instead of once per vehicle. Times are those of the vehicle records
+class ArrivalAdmission {
+public:
+    explicit ArrivalAdmission(const ArrivalAdmissionOptions &options = ArrivalAdmissionOptions());
+
+    // true if the vehicle fills the batch
+    bool Add(const VehicleTraceRecord &record);
+    // hands the open batch over as closed at time now and starts the next one
+    void CloseBatch(double now, std::vector<VehicleTraceRecord> &batch);
+
+    inline bool isEmpty() const { return batch_.empty(); }
+    // time the open batch closes at if no vehicle fills it, infinity while it is empty
+    inline double getDeadline() const {
+        return batch_.empty() ? std::numeric_limits<double>::infinity()
+                              : batch_.front().arrival_time_ + options_.max_batch_delay_;
+    }
+
+    ArrivalAdmissionOptions options_;
+    RunningStatistics batch_size_;
+    RunningStatistics latency_; // from the arrival of a vehicle to the close of its batch
+
+private:
+    std::vector<VehicleTraceRecord> batch_;
+};
+
+} // namespace intersection_management
+
+#endif // INTERSECTION_MANAGEMENT_ARRIVAL_ADMISSION_H_
@@ -0,0 +1,116 @@
+#ifndef INTERSECTION_MANAGEMENT_BATCH_RECORD_H_
+#define INTERSECTION_MANAGEMENT_BATCH_RECORD_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "mapped_file.h"
+
+namespace intersection_management {
+
+// result of one method on one sample of a batch run
+struct BatchTestRecord {
+    int32_t seed_;
+    int32_t num_nodes_;
+    int32_t geometry_; // index into geometryParamVec
+    int32_t method_; // BatchTestMethod
+    double makespan_; // as returned by BatchTestOneCase, dfs and bfs count edges only
+    double order_standard_deviation_;
+    double jain_index_;
+    double wall_time_; // seconds spent in the method
+};
+
+// Columnar record file: a 16 byte header (magic "IMBR", version, row group capacity, reserved) followed by
+// row groups. A row group is a 8 byte header (row count, reserved) and then every column of its rows
+// contiguously in the field order of BatchTestRecord, the int32 columns first so the double columns stay
+// 8 byte aligned. Row groups are appended whole, so a file cut short by a crash is readable up to its last
+// complete group.
+constexpr uint32_t kBatchRecordMagic = 0x52424d49; // "IMBR"
+constexpr uint32_t kBatchRecordVersion = 1;
+constexpr uint32_t kBatchRecordRowGroupSize = 65536;
+
+// sizes in bytes of a record file and its CSV mirror, 0 for a file not written
+struct BatchRecordPosition {
+    uint64_t size_ = 0;
+    uint64_t csv_size_ = 0;
+};
+
+// Buffers records appended from any thread and writes them on its own thread, compute threads only take
+// a lock to move their records into the current row group. An empty csv file disables the CSV mirror.
+class BatchRecordWriter {
+public:
+    BatchRecordWriter(const std::string &file, const std::string &csv_file = "", bool append = false);
+    ~BatchRecordWriter();
+
+    void Append(const std::vector<BatchTestRecord> &records);
+    // writes every record appended so far, the partly filled row group as a shorter one, and returns the
+    // sizes of the files with them. A checkpoint keeps them
+    BatchRecordPosition Flush();
+    // cuts the files back to a position Flush returned, dropping the records a run wrote after its last
+    // checkpoint. False if the files are shorter than that
+    bool Truncate(const BatchRecordPosition &position);
+    // writes the buffered records and stops the writer thread, appending afterwards is ignored
+    void Close();
+
+    inline bool isOpen() const { return is_open_; }
+
+private:
+    void WriterLoop();
+    void WriteRowGroup(const std::vector<BatchTestRecord> &records);
+
+    std::string file_;
+    std::string csv_file_;
+    std::ofstream out_;
+    std::ofstream csv_out_;
+    bool is_open_;
+    std::mutex mutex_;
+    std::condition_variable row_group_ready_;
+    std::condition_variable row_groups_written_;
+    std::vector<BatchTestRecord> current_row_group_;
+    std::vector<std::vector<BatchTestRecord>> full_row_groups_;
+    long num_queued_row_groups_;
+    long num_written_row_groups_;
+    BatchRecordPosition position_; // after the row groups written
+    bool closing_;
+    std::thread writer_thread_;
+};
+
+// Read-only view of a record file mapped into memory, the columns are used in place without parsing
+class BatchRecordReader {
+public:
+    // columns of one row group, pointing into the mapping
+    struct RowGroup {
+        uint32_t num_rows_;
+        const int32_t *seed_;
+        const int32_t *num_nodes_;
+        const int32_t *geometry_;
+        const int32_t *method_;
+        const double *makespan_;
+        const double *order_standard_deviation_;
+        const double *jain_index_;
+        const double *wall_time_;
+    };
+
+    BatchRecordReader(const std::string &file);
+
+    inline bool isOpen() const { return file_.isOpen(); }
+    inline uint64_t getNumRows() const { return num_rows_; }
+    inline const std::vector<RowGroup> &getRowGroups() const { return row_groups_; }
+    // false if row is not below getNumRows()
+    bool getRecord(uint64_t row, BatchTestRecord &record) const;
+
+private:
+    MappedFile file_;
+    uint64_t num_rows_;
+    std::vector<RowGroup> row_groups_;
+    std::vector<uint64_t> first_row_; // of every row group
+};
+
+} // namespace intersection_management
+
+#endif // INTERSECTION_MANAGEMENT_BATCH_RECORD_H_
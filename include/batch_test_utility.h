@@ -2,13 +2,211 @@
 #define INTERSECTION_MANAGEMENT_BATCH_TEST_UTILITY_H_
 
 #include <vector>
+#include <string>
+#include <utility>
+#include <istream>
+#include <ostream>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "parameters.h"
+#include "batch_record.h"
+#include "cdg_scheduler.h"
+#include "optimal_solution_cache.h"
+#include "scheduler.h"
+#include "running_statistics.h"
 
 namespace intersection_management {
+// methods compared by BatchTestOneCase, in the order of its result vector
+enum BatchTestMethod {
+    Method_Placeholder,
+    Method_ModifiedDfst,
+    Method_Bfst,
+    Method_MultiWeightBfst,
+    Method_GlobalOptimal,
+    Method_Fifo,
+    Method_MultiWeightDfst
+};
+constexpr int kNumberOfBatchTestMethods = 7;
+constexpr unsigned kAllBatchTestMethods = (1u << kNumberOfBatchTestMethods) - 1;
+// short names used in the printed statistics and on the command line
+extern const std::vector<std::string> kBatchTestMethodNames;
+
+inline bool isMethodSelected(unsigned methods, BatchTestMethod method) { return methods & (1u << method); }
+
+// depth of the first method minus the depth of the second, tracked per sample
+typedef std::pair<BatchTestMethod, BatchTestMethod> BatchTestMethodPair;
+
 std::vector<double> BatchTestOneCase(int num_nodes, bool verbose = false, int seed = -1);
+// same case with its own configuration, safe to run concurrently on different threads.
+// Methods left out of the mask are not run and report 0. With records, a record of every method that ran is
+// appended, with its geometry left 0 for the caller to fill in. With a cache, the global optimum is looked up
+// before it is searched for
+std::vector<double> BatchTestOneCase(const Parameters &local_param, int num_nodes, bool verbose = false, int seed = -1,
+                                     unsigned methods = kAllBatchTestMethods,
+                                     std::vector<BatchTestRecord> *records = nullptr,
+                                     OptimalSolutionCache *optimal_solution_cache = nullptr);
+
+// What BatchTestOneCase builds for a case, kept between cases: the intersection and the graph reuse their
+// nodes and edges, and the schedulers and results their buffers. Once it has run its largest case, a case
+// without records or optimal solution cache makes no heap allocation, unless its geometry differs from the
+// one of the case before and is rebuilt. BatchTestOneCase and BatchTest run
+// every case of a thread in the same workspace
+class BatchTestWorkspace {
+public:
+    // depth gets what BatchTestOneCase returns
+    void RunCase(const Parameters &local_param, int num_nodes, std::vector<double> &depth, bool verbose = false,
+                 int seed = -1, unsigned methods = kAllBatchTestMethods,
+                 std::vector<BatchTestRecord> *records = nullptr,
+                 OptimalSolutionCache *optimal_solution_cache = nullptr);
+
+private:
+    Intersection intersection_;
+    ConflictDirectedGraph cdg_;
+    Scheduler scheduler_;
+    CDGScheduler scheduler_dfs_;
+    CDGScheduler scheduler_bfs_;
+    CDGScheduler scheduler_mdbfs_;
+    CDGScheduler scheduler_bruteforce_;
+    CDGScheduler scheduler_mddfs_;
+    CDGScheduleResult modified_dfst_, bfst_, mdbfst_, mddfst_;
+    std::vector<int> best_order_;
+    std::vector<double> best_order_depth_;
+};
+
+// options of BatchTest, a negative test count runs until interrupted and a negative starting seed is drawn
+// from std::random_device once, then sample i uses seed starting_seed + i.
+// With a positive ci_width_ the run also stops once the confidence interval of every mean depth and every
+// paired difference is narrower than it, but not before min_test_count_ samples
+struct BatchTestOptions {
+    int num_nodes_ = 5;
+    int test_count_ = -1;
+    int print_interval_ = 1000;
+    int starting_seed_ = -1;
+    int num_threads_ = 1; // 0 uses every hardware thread
+    unsigned methods_ = kAllBatchTestMethods;
+    Parameters param_ = param;
+
+    double ci_width_ = -1;
+    double confidence_z_ = 1.96; // 95% interval
+    long min_test_count_ = 100;
+    std::vector<BatchTestMethodPair> paired_differences_ = {{Method_MultiWeightBfst, Method_ModifiedDfst}};
+
+    // with a checkpoint file the state is saved every checkpoint_period_ seconds, on ctrl+C and at the end,
+    // and resume_ continues from it with the same results as an uninterrupted run
+    std::string checkpoint_file_;
+    double checkpoint_period_ = 60;
+    bool resume_ = false;
+
+    // with a record writer every method of every sample is also written out as a BatchTestRecord,
+    // tagged with geometry_id_
+    BatchRecordWriter *record_writer_ = nullptr;
+    int geometry_id_ = 0;
+    OptimalSolutionCache *optimal_solution_cache_ = nullptr;
+};
+
+// running totals of BatchTest over the methods of BatchTestOneCase. Methods left out of methods_ add
+// nothing, print as N/A and are not compared with, and the paired differences with them are dropped
+class BatchTestStatistics {
+public:
+    BatchTestStatistics(double unit_depth_coefficient, const std::vector<BatchTestMethodPair> &paired_differences = {},
+                        unsigned methods = kAllBatchTestMethods);
+    void AddSample(const std::vector<double> &depths);
+    bool hasConverged(const BatchTestOptions &options) const;
+    void Print(int num_nodes) const;
+    void PrintConfidenceIntervals(double confidence_z) const;
+    void Write(std::ostream &out) const;
+    // false if the stream ends early or has another depth unit or other paired differences than this object
+    bool Read(std::istream &in);
+
+    double unit_depth_coefficient_;
+    unsigned methods_;
+    std::vector<double> sum_;
+    std::vector<long> better_count_;
+    std::vector<long> better_dfs_;
+    long total_test_;
+    std::vector<RunningStatistics> depth_statistics_; // per method, of the scaled depths summed in sum_
+    std::vector<BatchTestMethodPair> paired_differences_;
+    std::vector<RunningStatistics> difference_statistics_; // per paired difference
+};
+
+// state of one cell of a batch run, samples from next_sample_ on are still to be run. options_key_ is
+// GetBatchOptionsKey of the options of the cell, record_position_ the size of its record files with the
+// records of the samples before next_sample_
+struct BatchCheckpointCell {
+    int num_nodes_;
+    int starting_seed_;
+    long next_sample_;
+    bool converged_;
+    BatchTestStatistics statistics_;
+    std::string options_key_;
+    BatchRecordPosition record_position_ = BatchRecordPosition();
+};
+
+// the options that change the samples or where the batch stops, as bytes: the methods, the parameters of
+// the intersection and the schedulers, the starting seed as given and the stopping rule. The test count is
+// left out so that a finished batch can be resumed for more samples
+std::string GetBatchOptionsKey(const BatchTestOptions &options);
+
+// binary checkpoint: magic "IMCP", version, cell count, then every cell with its options key, record position
+// and statistics. A batch resumed with a record writer cuts its record files back to the record position.
+// Reading needs cells set up like the batch that wrote it and fails if any option of the key, the vehicle
+// count, the paired differences or the depth unit differ
+bool WriteBatchCheckpoint(const std::string &file, const std::vector<BatchCheckpointCell> &cells);
+bool ReadBatchCheckpoint(const std::string &file, std::vector<BatchCheckpointCell> &cells);
+
+// number of samples a worker runs between two merges of the statistics
+constexpr int kSamplesPerThreadInBlock = 64;
+
+// Threads started once and kept for every block of a batch, so each keeps its BatchTestWorkspace warm. Run
+// hands out the indices of a range from a shared counter to the workers and the calling thread, and returns
+// when every index is done
+class BatchWorkerPool {
+public:
+    // num_threads counts the calling thread, 1 runs everything on it
+    explicit BatchWorkerPool(int num_threads);
+    ~BatchWorkerPool();
+    BatchWorkerPool(const BatchWorkerPool &) = delete;
+    BatchWorkerPool &operator=(const BatchWorkerPool &) = delete;
+
+    void Run(long begin, long end, const std::function<void(long)> &task);
+
+    inline int getNumThreads() const { return workers_.size() + 1; }
+
+private:
+    void WorkerLoop();
+    void RunIndices();
+
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable start_;
+    std::condition_variable done_;
+    const std::function<void(long)> *task_;
+    std::atomic<long> next_index_;
+    long end_index_;
+    long generation_; // number of ranges handed out
+    int num_busy_workers_;
+    bool is_stopping_;
+};
+
+int getSampleSeed(int starting_seed, long sample_index);
 
 void BatchTest(int num_nodes = 5, int test_count = -1, int print_interval = 1000, int starting_seed = -1);
+BatchTestStatistics BatchTest(const BatchTestOptions &options);
+
+// runs every cell of a sweep on one pool of workers and returns the statistics of each cell, equal to
+// running BatchTest on the cell alone. Cells need a finite test count, with a negative one nothing is run.
+// The print, thread and checkpoint options of the cells are ignored in favor of the arguments
+std::vector<BatchTestStatistics> BatchSweep(const std::vector<BatchTestOptions> &cells, int num_threads = 0,
+                                            const std::string &checkpoint_file = "", bool resume = false,
+                                            double checkpoint_period = 60);
+// header of a cell in the format of Experiments/batch_result*.txt
+void PrintBatchSweepCell(const BatchTestOptions &cell);
 
 void SIGINT_signal_handler(int signal);
 } // namespace intersection_management
 
-#endif // INTERSECTION_MANAGEMENT_BATCH_TEST_UTILITY_H_
\ No newline at end of file
+#endif // INTERSECTION_MANAGEMENT_BATCH_TEST_UTILITY_H_
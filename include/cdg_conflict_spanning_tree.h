@@ -15,6 +15,10 @@ enum CDGFairnessType {
     Type_JainIndex
 };
 
+// fairness of the passing order given the depth of every node by id, node 0 is the root and skipped
+double CalculateOrderFairnessIndex(const std::vector<double> &depth_vector,
+                                   CDGFairnessType fairness_type = Type_OrderStandardDeviation);
+
 class CDGConflictSpanningTree {
 public:
     CDGConflictSpanningTree();
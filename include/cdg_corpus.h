@@ -0,0 +1,104 @@
+#ifndef INTERSECTION_MANAGEMENT_CDG_CORPUS_H_
+#define INTERSECTION_MANAGEMENT_CDG_CORPUS_H_
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "conflict_directed_graph.h"
+#include "mapped_file.h"
+
+namespace intersection_management {
+
+// Corpus of ConflictDirectedGraph instances: a 16 byte header (magic "IMCG", version, reserved), the graphs
+// one after another, an index of the byte offset of every graph, and a 24 byte footer (index offset, graph
+// count, magic, version) so the index is found from the end of the file.
+// A graph is a 16 byte header (node count, edge count, fairness threshold, reserved) and then, each array
+// padded to 8 bytes: per node the travel and arrival times and the in/out lane and leg ids, the CSR offsets
+// of the outgoing edges by source id, and per edge the weight, estimate offset, target, predecessor id and
+// flags (kCorpusEdge*). Node 0 is the root, a bidirectional conflict is stored as its two directed edges.
+constexpr uint32_t kCDGCorpusMagic = 0x47434d49; // "IMCG"
+constexpr uint32_t kCDGCorpusVersion = 1;
+
+constexpr uint32_t kCorpusEdgeBidirectional = 1u << 0;
+constexpr uint32_t kCorpusEdgeDiverging = 1u << 1;
+constexpr uint32_t kCorpusEdgeConverging = 1u << 2;
+constexpr uint32_t kCorpusEdgeCrossing = 1u << 3;
+constexpr uint32_t kCorpusEdgeCompeting = 1u << 4;
+constexpr uint32_t kCorpusEdgePrecedence = 1u << 5;
+
+// writes graphs in bulk through one buffered stream, the index is written by Close
+class CDGCorpusWriter {
+public:
+    CDGCorpusWriter(const std::string &file);
+    ~CDGCorpusWriter();
+
+    void Append(const ConflictDirectedGraph &cdg);
+    // false if anything could not be written
+    bool Close();
+
+    inline bool isOpen() const { return out_.is_open(); }
+    inline uint64_t getNumGraphs() const { return graph_offset_.size(); }
+
+private:
+    template <typename T>
+    void WriteArray(const std::vector<T> &array);
+
+    std::ofstream out_;
+    uint64_t offset_;
+    std::vector<uint64_t> graph_offset_;
+    // reused between graphs
+    std::vector<double> node_doubles_;
+    std::vector<int32_t> node_ints_;
+    std::vector<uint32_t> edge_offset_;
+    std::vector<double> edge_doubles_;
+    std::vector<int32_t> edge_ints_;
+    std::vector<uint32_t> edge_flags_;
+};
+
+// one graph of a corpus, every array points into the mapping
+struct CDGCorpusGraph {
+    uint32_t num_nodes_;
+    uint32_t num_edges_;
+    int32_t fairness_order_diff_threshold_;
+    const double *estimate_travel_time_;
+    const double *estimate_arrival_time_;
+    const int32_t *in_lane_id_;
+    const int32_t *in_leg_id_;
+    const int32_t *out_lane_id_;
+    const int32_t *out_leg_id_;
+    const uint32_t *edge_offset_; // num_nodes_ + 1 entries, edges of node i are edge_offset_[i] to edge_offset_[i + 1]
+    const double *edge_weight_;
+    const double *estimate_offset_;
+    const int32_t *edge_target_;
+    const int32_t *predecessor_id_;
+    const uint32_t *edge_flags_;
+};
+
+// Opens a corpus with mmap, getGraph only computes the pointers of a graph so iterating a corpus neither
+// allocates nor parses. LoadGraph rebuilds the graph for the schedulers. Opening checks the index and the
+// extents and CSR offsets of every graph against the file, a corpus that fails is not opened
+class CDGCorpusReader {
+public:
+    CDGCorpusReader(const std::string &file);
+
+    inline bool isOpen() const { return file_.isOpen(); }
+    inline uint64_t getNumGraphs() const { return num_graphs_; }
+    // false if index is not below getNumGraphs
+    bool getGraph(uint64_t index, CDGCorpusGraph &graph) const;
+    bool LoadGraph(uint64_t index, ConflictDirectedGraph &cdg) const;
+
+private:
+    // graph at offset ends by end
+    bool isValidGraph(uint64_t offset, uint64_t end) const;
+    CDGCorpusGraph ViewGraph(uint64_t offset) const;
+
+    MappedFile file_;
+    uint64_t num_graphs_;
+    const uint64_t *graph_offset_;
+};
+
+} // namespace intersection_management
+
+#endif // INTERSECTION_MANAGEMENT_CDG_CORPUS_H_
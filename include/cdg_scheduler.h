@@ -3,6 +3,7 @@
 
 #include "conflict_directed_graph.h"
 #include "cdg_conflict_spanning_tree.h"
+#include "optimal_solution_cache.h"
 #include <iostream>
 #include <algorithm>
 
@@ -20,18 +21,185 @@ public:
     double estimate_travel_time_;
 };
 
+// Flat result of a spanning tree schedule: tree parent and depth of every node by id, plus the makespan.
+// The schedulers write into it directly and it keeps its capacity when reused, the tree form is only
+// built on request by MaterializeTree for printing and debugging.
+class CDGScheduleResult {
+public:
+    CDGScheduleResult();
+    void reset(int num_nodes, CDGDepthType depth_type);
+    inline void UpdateDepth(int id, int parent_id, double parent_edge_weight, double depth) {
+        parent_id_[id] = parent_id;
+        parent_edge_weight_[id] = parent_edge_weight;
+        depth_[id] = depth;
+        order_.push_back(id);
+        if (depth > makespan_) {
+            makespan_ = depth;
+        }
+    }
+    CDGConflictSpanningTree MaterializeTree(const ConflictDirectedGraph &cdg) const;
+    inline double CalculateFairnessIndex(CDGFairnessType fairness_type = Type_OrderStandardDeviation) const {
+        return CalculateOrderFairnessIndex(depth_, fairness_type);
+    }
+
+    CDGDepthType depth_type_;
+    std::vector<int> parent_id_; // -1 for the root
+    std::vector<double> parent_edge_weight_;
+    std::vector<double> depth_;
+    std::vector<int> order_; // ids in the order they were scheduled
+    double makespan_;
+};
+
+// edge in the workspace adjacency, id_ is the node on the other end
+struct CDGAdjacentEdge {
+    int id_;
+    Edge *edge_;
+};
+
+// Buffers of one scheduling call, owned by the scheduler and reused across calls. reset() only clears and
+// refills them, so after the largest graph has been seen, scheduling again makes no heap allocation.
+// The graph edges are indexed by node id in CSR form: offsets_[id] to offsets_[id + 1] index the arrays.
+class CDGScheduleWorkspace {
+public:
+    void reset(const ConflictDirectedGraph &cdg);
+
+    // edge from -> to, nullptr if not connected
+    inline Edge *getEdge(int from, int to) const {
+        auto begin = children_.begin() + child_offset_[from];
+        auto end = children_.begin() + child_offset_[from + 1];
+        auto iter = std::lower_bound(begin, end, to, [](const CDGAdjacentEdge &child, int id) { return child.id_ < id; });
+        return (iter != end && iter->id_ == to) ? iter->edge_ : nullptr;
+    }
+    inline bool hasUnscheduledParent(int id) const {
+        for (int k = parent_offset_[id]; k < parent_offset_[id + 1]; k++) {
+            if (!added_to_tree_[parents_[k].id_]) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::vector<int> child_offset_;
+    std::vector<CDGAdjacentEdge> children_; // outgoing edges, sorted by target id
+    std::vector<int> parent_offset_;
+    std::vector<CDGAdjacentEdge> parents_; // incoming unidirectional edges, sorted by source id
+    std::vector<int> neighbor_offset_;
+    std::vector<CDGAdjacentEdge> neighbors_; // incoming bidirectional edges, sorted by source id
+    std::vector<int> parent_cursor_;
+    std::vector<int> neighbor_cursor_;
+
+    std::vector<bool> added_to_tree_;
+    std::vector<bool> in_ready_list_;
+    std::vector<CDGCandidate> ready_list_;
+    std::vector<CDGAdjacentEdge> bidirectional_scheduled_parent_;
+};
+
+// Order fairness that replaces the fairness edges of AddFairnessConflicts: node `to` waits until every node
+// `from <= to - threshold` is scheduled and is bounded by the deepest of them through a virtual edge of
+// weight kFairnessEdgeWeight. Like AddEdge, which doesn't add a fairness edge between nodes already in
+// conflict, nodes with an edge into `to` are left to that edge. Depths are kept in a max tree over the ids,
+// so the bound of a node with k such edges in its window takes O(k log n).
+class FairnessWindow {
+public:
+    static constexpr double kFairnessEdgeWeight = 1.0;
+
+    FairnessWindow();
+    void reset(int num_nodes, int order_diff_threshold);
+    void MarkScheduled(int id, double depth);
+
+    inline bool isActive() const { return order_diff_threshold_ > 0; }
+    inline bool isConnected(int from, int to) const {
+        return isActive() && from > 0 && to - from >= order_diff_threshold_;
+    }
+    inline bool hasReleaseParent(int id) const { return isActive() && id - order_diff_threshold_ > 0; }
+    // the edges into id are taken from workspace
+    bool isReleased(int id, const CDGScheduleWorkspace &workspace) const;
+    // deepest scheduled node id waits for, false if there is none
+    bool getReleaseParent(int id, const CDGScheduleWorkspace &workspace, int &parent, double &depth) const;
+
+    int order_diff_threshold_;
+    int scheduled_prefix_; // every node below this id is scheduled
+    std::vector<bool> scheduled_;
+    std::shared_ptr<Edge> fairness_edge_;
+
+private:
+    struct TreeEntry {
+        double depth_; // -infinity if nothing below is scheduled
+        int id_; // of the deepest, the smallest id on ties
+        int num_scheduled_;
+    };
+    static inline TreeEntry Combine(const TreeEntry &left, const TreeEntry &right) {
+        TreeEntry entry = right.depth_ > left.depth_ ? right : left;
+        entry.num_scheduled_ = left.num_scheduled_ + right.num_scheduled_;
+        return entry;
+    }
+    // over the ids in [begin, end)
+    TreeEntry Query(int begin, int end) const;
+    // nodes in [1, id - threshold] with an edge into id, ascending and without repeats, into linked_
+    void CollectLinkedNodes(int id, const CDGScheduleWorkspace &workspace) const;
+
+    int num_leaves_;
+    std::vector<TreeEntry> tree_; // leaf of id at num_leaves_ + id
+    mutable std::vector<int> linked_;
+};
+
+// Compile-time policies of CDGScheduler::ScheduleWithSpanningTree.
+// Traversal: ready list ordered by possible depth (BFS) or nodes in id order (DFS).
+struct BreadthFirstTraversal { static constexpr bool kBreadthFirst = true; };
+struct DepthFirstTraversal { static constexpr bool kBreadthFirst = false; };
+
+// Depth: which depth of the tree is built, and whether the travel time of a node adds to it.
+struct EdgeWeightedDepthPolicy {
+    static constexpr CDGDepthType kDepthType = Type_EdgeWeightedDepth;
+    static inline double getNodeWeight(const Node &) { return 0.0; }
+};
+struct EdgeNodeWeightedDepthPolicy {
+    static constexpr CDGDepthType kDepthType = Type_EdgeNodeWeightedDepth;
+    static inline double getNodeWeight(const Node &node) { return node.estimate_travel_time_; }
+};
+
+// Weight: edge weight as stored, or as seen by the multi-weighted schedulers.
+struct RawWeightPolicy {
+    static inline double getWeight(Edge &edge) { return edge.edge_weight_; }
+};
+template <bool kActivatePrecedentOffset>
+struct MultiWeightPolicy {
+    static inline double getWeight(Edge &edge) { return edge.getMultiWeight(kActivatePrecedentOffset); }
+};
+
 class CDGScheduler {
 public:
     CDGScheduler();
+    CDGScheduler(const Parameters &local_param);
+    void InitializeFromLocalParam(const Parameters &local_param);
     CDGConflictSpanningTree ScheduleWithModifiedDfst(const ConflictDirectedGraph &cdg);
     CDGConflictSpanningTree ScheduleWithBfstWeightedEdgeOnly(const ConflictDirectedGraph &cdg);
     CDGConflictSpanningTree ScheduleWithBfstMultiWeight(const ConflictDirectedGraph &cdg);
     CDGConflictSpanningTree ScheduleWithDfstMultiWeight(const ConflictDirectedGraph &cdg);
+    // consults optimal_solution_cache_ first if set, and adds the optimum it had to search for
     std::vector<int> ScheduleBruteForceSearch(const ConflictDirectedGraph &cdg);
+    void ScheduleBruteForceSearch(const ConflictDirectedGraph &cdg, std::vector<int> &best_order);
+    // key of the optimum of cdg in the cache, the canonical hash combined with the weights this scheduler uses
+    uint64_t getOptimalSolutionKey(const ConflictDirectedGraph &cdg) const;
+    // what a cached optimum has to match besides the key: the node and edge counts of cdg
+    static inline uint64_t getOptimalSolutionFingerprint(const ConflictDirectedGraph &cdg) {
+        return (static_cast<uint64_t>(cdg.num_nodes_) << 32) | cdg.edges_.size();
+    }
+    // same schedulers without building the tree
+    void ScheduleWithModifiedDfst(const ConflictDirectedGraph &cdg, CDGScheduleResult &result);
+    void ScheduleWithBfstWeightedEdgeOnly(const ConflictDirectedGraph &cdg, CDGScheduleResult &result);
+    void ScheduleWithBfstMultiWeight(const ConflictDirectedGraph &cdg, CDGScheduleResult &result);
+    void ScheduleWithDfstMultiWeight(const ConflictDirectedGraph &cdg, CDGScheduleResult &result);
+
+    // the spanning tree schedulers above are instantiations of this template, defined in cdg_scheduler.cpp
+    template <typename Traversal, typename DepthPolicy, typename WeightPolicy>
+    void ScheduleWithSpanningTree(const ConflictDirectedGraph &cdg, CDGScheduleResult &result);
+    template <typename DepthPolicy, typename WeightPolicy>
+    void BuildBreadthFirstTree(const ConflictDirectedGraph &cdg, CDGScheduleResult &result);
+    template <typename DepthPolicy, typename WeightPolicy>
+    void BuildDepthFirstTree(const ConflictDirectedGraph &cdg, CDGScheduleResult &result);
 
     void PrepareForTreeSchedule(const ConflictDirectedGraph &cdg);
-    void GenerateUniparentTable(const ConflictDirectedGraph &cdg);
-    void GenerateBineighborTable(const ConflictDirectedGraph &cdg);
 
     void SearchOrderPermutationRecursively(std::vector<int> &vehicle_order, int num_nodes,
                                            std::vector<bool> &is_in_order_list,
@@ -39,9 +207,28 @@ public:
                                            const ConflictDirectedGraph &cdg);
     double GetEvacuationTimeFromOrder(const std::vector<int> &vehicle_order,
                                       const ConflictDirectedGraph &cdg);
+    // Warm start from the order of a previous schedule. As in the multi-weighted BFST the node that exits first
+    // is placed next, but only the next kSeedLookahead nodes of seed_order compete with the nodes it doesn't
+    // have, so the new nodes are inserted by their conflicts and the seed order is kept but for local swaps.
+    // A node waits until its unidirectional parents are placed. The depths are those of
+    // GetDepthVectorFromOrder for the resulting order
+    static constexpr int kSeedLookahead = 4;
+    std::vector<double> ScheduleFromSeedOrder(const ConflictDirectedGraph &cdg, const std::vector<int> &seed_order,
+                                              std::vector<int> &order,
+                                              const std::vector<double> *fixed_depth = nullptr);
+    // needs the workspace of cdg, as left by any of the schedulers. Nodes with a non-negative fixed depth keep
+    // it, like vehicles already in the intersection, and bound the others like any scheduled node
     std::vector<double> GetDepthVectorFromOrder(const std::vector<int> &vehicle_order,
-                                                const ConflictDirectedGraph &cdg);
-    
+                                                const ConflictDirectedGraph &cdg,
+                                                const std::vector<double> *fixed_depth = nullptr);
+    // same into depth, which is left empty if the order places a node before one of its parents
+    void GetDepthVectorFromOrder(const std::vector<int> &vehicle_order, const ConflictDirectedGraph &cdg,
+                                 std::vector<double> &depth, const std::vector<double> *fixed_depth = nullptr);
+    // exit of id after the nodes order_scheduled_ marks, as GetDepthVectorFromOrder places it. False if a parent
+    // of id or the node releasing it isn't scheduled yet
+    bool getEarliestDepth(int id, const ConflictDirectedGraph &cdg, const std::vector<double> &depth,
+                          double &earliest_depth);
+
     static inline void SortReadyListAscendingly(std::vector<CDGCandidate> &ready_list) {
         std::sort(ready_list.begin(), ready_list.end(),
                   [](const CDGCandidate &a, const CDGCandidate &b) {
@@ -59,14 +246,6 @@ public:
         }
         return false;
     }
-    static inline bool StillHasUnscheduledPredecessor(std::vector<std::shared_ptr<Node>> &pre, std::vector<bool> &added_to_tree) {
-        for (auto node : pre) {
-            if (added_to_tree[node->id_] == false) {
-                return true;
-            }
-        }
-        return false;
-    }
     static void printDepthVector(std::vector<double> &depth_vector) {
         int tmp_cnt = 0;
         for (int i = 0; i < depth_vector.size(); i++) {
@@ -86,9 +265,20 @@ public:
         std::cout << std::endl;
     }
 
-    CDGConflictSpanningTree result_tree_;
-    std::vector<std::vector<std::shared_ptr<Node>>> unidirectional_parent_table_;
-    std::vector<std::vector<std::shared_ptr<Node>>> bidirectional_neighbor_table_;
+    CDGScheduleResult result_;
+    CDGScheduleWorkspace workspace_;
+    FairnessWindow fairness_window_;
+    // buffers of the order evaluation and the brute force search
+    FairnessWindow order_fairness_window_;
+    std::vector<bool> order_scheduled_;
+    std::vector<double> order_depth_;
+    std::vector<int> search_order_;
+    std::vector<bool> is_in_search_order_;
+    std::vector<int> new_node_ids_; // of ScheduleFromSeedOrder
+    // copied from the parameters at construction so that schedulers don't share state
+    bool activate_precedent_offset_;
+    // not owned, may be shared by schedulers on different threads
+    OptimalSolutionCache *optimal_solution_cache_;
 };
 
 } // namespace intersection_management
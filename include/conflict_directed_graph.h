@@ -1,6 +1,8 @@
 #ifndef INTERSECTION_MANAGEMENT_CONFLICT_DIRECTED_GRAPH_H_
 #define INTERSECTION_MANAGEMENT_CONFLICT_DIRECTED_GRAPH_H_
 
+#include <cstdint>
+
 #include "intersection_utility.h"
 #include "intersection.h"
 
@@ -8,12 +10,15 @@ namespace intersection_management {
 class ConflictDirectedGraph {
 public:
     ConflictDirectedGraph();
+    ConflictDirectedGraph(const Parameters &local_param);
 
     void reset(bool verbose = true);
 
     void AddNode(double weight = 1.0);
 
     void AddEdge(int from, int to, double weight = 1.0, bool bidirectional = false);
+    // AddEdge without the check for an existing edge, for generators that track their pairs themselves
+    void AddEdgeUnchecked(int from, int to, double weight = 1.0, bool bidirectional = false);
 
     void GenerateRandomGraph(int total_nodes,
                              double estimate_travel_time_range = 5.0,
@@ -21,12 +26,41 @@ public:
                              double estimate_travel_time_offset = 1.0,
                              double edge_weight_offset = 1.0,
                              bool int_weight_only = true);
+
+    // random graph whose conflicts connect every vehicle, with density the fraction of vehicle pairs in
+    // conflict (at least a spanning tree) and half of them bidirectional by default. Uses mt_, see setSeed
+    void GenerateRandomConnectedGraph(int total_nodes,
+                                      double density,
+                                      double estimate_travel_time_range = 5.0,
+                                      double edge_weight_range = 2.0,
+                                      double estimate_travel_time_offset = 1.0,
+                                      double edge_weight_offset = 1.0,
+                                      bool int_weight_only = true,
+                                      double bidirectional_ratio = 0.5);
     
     void GenerateGraphFromIntersection(Intersection &intersection);
     
+    int GetFairnessOrderDiffThreshold();
+
     void AddFairnessConflicts();
 
+    void AddImplicitFairnessConflicts();
+
+    int ReduceTransitiveEdges();
+
     bool isFullyConnected();
+    // whether the conflicts without the root edges connect every vehicle
+    bool isConflictConnected();
+
+    // hash of the travel times, the edges with their weights, offsets and direction, and the fairness
+    // threshold. Independent of the order edges were added in, so equal instances hash equal however built
+    uint64_t getCanonicalHash() const;
+
+    // seeds the generator of GenerateRandomGraph, negative seeds draw from std::random_device
+    inline void setSeed(int seed) {
+        if (seed < 0) { std::random_device rd; mt_.seed(rd()); }
+        else { mt_.seed(seed); }
+    }
 
     void PrintGraph();
 
@@ -34,6 +68,26 @@ public:
     std::vector<std::shared_ptr<Node>> nodes_;
     std::vector<std::shared_ptr<Edge>> edges_;
     int num_nodes_;
+    // order fairness kept implicitly by the schedulers instead of edges, 0 means disabled
+    int fairness_order_diff_threshold_;
+    bool activate_precedent_offset_;
+    std::mt19937 mt_;
+
+private:
+    std::shared_ptr<Edge> NewEdge(int from, int to, double weight, bool bidirectional);
+
+    // nodes and edges from before the last reset, see SharedObjectPool
+    SharedObjectPool<Node> node_pool_;
+    SharedObjectPool<Edge> edge_pool_;
+    // buffers of ReduceTransitiveEdges
+    std::vector<int> in_degree_;
+    std::vector<int> topological_order_;
+    std::vector<int> topological_position_;
+    std::vector<double> longest_edge_weighted_;
+    std::vector<double> longest_multi_weighted_;
+    std::vector<double> indirect_edge_weighted_;
+    std::vector<double> indirect_multi_weighted_;
+    std::vector<std::shared_ptr<Edge>> removed_edges_;
 };
 
 } // namespace intersection_management
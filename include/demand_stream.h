@@ -0,0 +1,91 @@
+#ifndef INTERSECTION_MANAGEMENT_DEMAND_STREAM_H_
+#define INTERSECTION_MANAGEMENT_DEMAND_STREAM_H_
+
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "parameters.h"
+#include "vehicle_trace.h"
+
+namespace intersection_management {
+
+// Poisson demand of one incoming lane in vehicles per second, before the time of day scale. turn_ratios_ weighs
+// the out legs by leg id, the weight of the in leg itself is ignored
+struct LaneDemand {
+    int leg_id_;
+    int lane_id_;
+    double rate_;
+    std::vector<double> turn_ratios_;
+};
+
+// every rate is scaled by rate_scale_ from start_time_ until the next step
+struct DemandProfileStep {
+    double start_time_;
+    double rate_scale_;
+};
+
+// Demand of an intersection. The time of day steps are sorted by start time and repeat every period_ when it
+// is positive, times before the first step take the scale of the last one. No steps means a constant scale of 1.
+// Scales may not be negative, and one of them has to be positive
+struct DemandProfile {
+    std::vector<LaneDemand> lanes_;
+    std::vector<DemandProfileStep> time_of_day_;
+    double period_ = 0;
+};
+
+// every in lane at the same rate, 1 / arrival_interval_avg in total, and every other leg equally likely
+DemandProfile getUniformDemandProfile(const Parameters &local_param);
+// YAML file with lanes: [{leg, lane, rate, turn_ratios}] and optionally time_of_day: {period, steps: [[start, scale]]}
+DemandProfile ReadDemandProfile(const std::string &file);
+
+// Endless synthetic arrivals, generated lazily as a non-homogeneous Poisson process by thinning the arrivals at
+// the peak rate. Only the generator state is kept, so the stream runs for any horizon in constant memory.
+// Vehicles come in arrival order with the travel time of their turn from travel_time_choice, and the same seed
+// gives the same vehicles however they are drawn, one by one or in batches
+class DemandStream {
+public:
+    DemandStream(const Parameters &local_param, const DemandProfile &profile, int seed);
+    DemandStream(const Parameters &local_param, int seed) :
+        DemandStream(local_param, getUniformDemandProfile(local_param), seed) {}
+
+    // false if the profile has no demand, or none after the last vehicle
+    bool Next(VehicleTraceRecord &record);
+    // appends the vehicles arriving before end_time, at most max_count of them, and returns how many were added
+    int NextBatch(std::vector<VehicleTraceRecord> &batch, int max_count,
+                  double end_time = std::numeric_limits<double>::infinity());
+    double getRateScale(double time) const;
+
+    inline bool hasDemand() const { return peak_rate_ > 0; }
+    inline long getNumVehicles() const { return num_vehicles_; }
+
+private:
+    bool Generate(VehicleTraceRecord &record);
+    // infinity if the scale stays 0 from time on
+    double getNextDemandTime(double time) const;
+
+    int num_legs_;
+    std::vector<int> num_lanes_out_vec_;
+    std::vector<double> travel_time_choice_;
+    std::vector<LaneDemand> lanes_;
+    std::vector<DemandProfileStep> time_of_day_;
+    double period_;
+    double peak_scale_;
+    double peak_rate_;
+
+    std::mt19937 mt_;
+    std::exponential_distribution<double> interval_dist_;
+    std::uniform_real_distribution<double> acceptance_dist_;
+    std::discrete_distribution<int> lane_dist_;
+    std::vector<std::discrete_distribution<int>> out_leg_dist_; // per lane of lanes_
+    double time_;
+    long num_vehicles_;
+    // vehicle drawn by NextBatch past its end time, handed out next
+    VehicleTraceRecord pending_;
+    bool has_pending_;
+};
+
+} // namespace intersection_management
+
+#endif // INTERSECTION_MANAGEMENT_DEMAND_STREAM_H_
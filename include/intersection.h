@@ -8,9 +8,23 @@
 #include <unordered_map>
 
 #include "parameters.h"
+#include "vehicle_trace.h"
+#include "demand_stream.h"
 
 namespace intersection_management {
 
+// route class is the (lane in, lane out) pair, conflicts between vehicles only depend on it
+struct RouteClassTable {
+    int num_lanes_ = 0;
+    int num_route_classes_ = 0;
+    std::vector<int> route_class_of_lane_pair_; // indexed by lane_in_uid * num_lanes_ + lane_out_uid, -1 for invalid pairs
+    std::vector<std::vector<int>> conflict_table_; // classes whose earlier vehicles block this class
+
+    inline int getRouteClass(const std::shared_ptr<Route> &route) const {
+        return route_class_of_lane_pair_[route->getLaneIn()->getUniqueId() * num_lanes_ + route->getLaneOut()->getUniqueId()];
+    }
+};
+
 class Intersection {
 public:
     Intersection() {
@@ -18,27 +32,49 @@ public:
         InitializeFromParam();
         AddIntersectionUtilitiesFromGeometry();
     }
-    Intersection(Parameters local_param) {
+    Intersection(const Parameters &local_param) {
         reset();
         InitializeFromLocalParam(local_param);
         AddIntersectionUtilitiesFromGeometry();
     }
 
     void reset();
+    // drops the vehicles and their edges but keeps the geometry, the nodes and edges are reused by the
+    // vehicles added next
+    void ResetVehicles();
+    // configuration of local_param with no vehicles, the geometry is only rebuilt if it changed
+    void Reconfigure(const Parameters &local_param);
     void InitializeFromParam();
-    void InitializeFromLocalParam(Parameters local_param);
+    void InitializeFromLocalParam(const Parameters &local_param);
     void AddIntersectionUtilitiesFromGeometry();
     void AddCriticalResourcesFromGeometry();
     void AddLegsAndLanesFromGeometry();
     void UpdateReferencesOfCriticalResoucesAndLegs();
     void AddNode(std::shared_ptr<Node> node);
     void AddEdge(std::shared_ptr<Edge> edge);
+    // node to add, reused from before the last reset if there is one
+    std::shared_ptr<Node> NewNode(int id, double ett, int in_leg_id, int in_lane_id, int out_leg_id, int out_lane_id,
+                                  double eat);
 
     void AddRandomVehicleNodes(int count, bool verbose = false);
     void AddRandomVehicleNodesWithTravelTime(int count, std::vector<double> travel_time_choice = {6.0, 6.5, 7.0}, bool verbose = false);
+    // appends the next vehicles of the trace, at most max_count of them, and returns how many were added.
+    // Vehicles on lanes this geometry doesn't have are skipped
+    int AddVehicleNodesFromTrace(VehicleTraceReader &trace, int max_count, bool verbose = false);
+    // appends the next count vehicles of the demand stream, which must be set up with the same geometry
+    int AddVehicleNodesFromDemand(DemandStream &demand, int count, bool verbose = false);
     void AssignRoutesToNodes();
+    // route of the lane pair, shared by every vehicle on it
+    std::shared_ptr<Route> getRoute(int in_leg_id, int in_lane_id, int out_leg_id, int out_lane_id);
     void AssignCriticalResourcesToNodes();
     void AssignEdgesWithSafetyOffsetToNodes();
+    void AssignEdgeWithSafetyOffset(int id_front, int id_back);
+    // With max_queueing_delay_ set, AssignEdgesWithSafetyOffsetToNodes leaves out the pairs that can only
+    // overlap if a vehicle waits longer than that, which no scheduler guarantees, except a vehicle and the
+    // one ahead of it in its lane. Given the exit of every vehicle in a schedule, by node id, this adds the
+    // conflicts left out between vehicles whose windows overlap and returns how many. Scheduling again until
+    // it returns 0 gives a schedule that holds on every pair
+    int AddConflictsMissedByHorizon(const std::vector<double> &exit_time);
 
     inline int getNumNodes() { return nodes_.size(); }
     inline int getNumEdges() { return edges_.size(); }
@@ -50,6 +86,9 @@ public:
         else { mt_.seed(seed); }
     }
 
+    // built on first use and kept until the geometry changes
+    const RouteClassTable &getRouteClassTable();
+
     bool isRightmostTurningRoute(std::shared_ptr<Route> route);
     bool isLeftmostTurningRoute(std::shared_ptr<Route> route);
     bool isOutermostTurningRoute(std::shared_ptr<Route> route);
@@ -59,14 +98,31 @@ public:
     std::vector<int> num_lanes_in_vec_;
     std::vector<int> num_lanes_out_vec_;
     double arrival_interval_avg_;
+    double max_queueing_delay_;
     std::vector<int> travel_time_range_;
+    bool activate_precedent_offset_;
     int num_nodes_;
     std::vector<std::shared_ptr<Node>> nodes_;
+    std::vector<int> arrival_order_; // vehicle ids sorted by estimate arrival time
+    double latest_arrival_time_; // of every vehicle so far, and at least 0
     std::vector<std::shared_ptr<Edge>> edges_;
     std::unordered_map<int, std::shared_ptr<CriticalResource>> critical_resource_map_;
     std::unordered_map<int, std::shared_ptr<Leg>> leg_map_;
     std::unordered_map<int, std::shared_ptr<Lane>> lane_map_;
     std::mt19937 mt_;
+
+private:
+    void GenerateRouteClassTable();
+    std::shared_ptr<Edge> NewEdge(std::shared_ptr<Node> &node1, std::shared_ptr<Node> &node2, double offset,
+                                  ConflictType ct, int predecessor_id);
+
+    RouteClassTable route_class_table_;
+    bool has_route_class_table_ = false;
+    std::vector<std::shared_ptr<Route>> route_of_lane_pair_; // shared by the vehicles, built as they come
+    SharedObjectPool<Node> node_pool_;
+    SharedObjectPool<Edge> edge_pool_;
+    std::vector<int> entry_order_; // of AddConflictsMissedByHorizon
+    std::vector<int> last_in_lane_; // by lane, of AssignEdgesWithSafetyOffsetToNodes
 }; // class Intersection
 
 } // namespace intersection_management
@@ -3,6 +3,7 @@
 
 #include <vector>
 #include <memory>
+#include <iterator>
 #include <cmath>
 #include <unordered_map>
 
@@ -58,6 +59,12 @@ public:
     Node(std::shared_ptr<Node> &p_node): Node(*p_node) {}
     Node(const Node &node);
 
+    // back to what the constructor with the same arguments gives, keeping the capacity of the vectors
+    void Reinitialize(int id, double ett, int in_leg_id = -1, int in_lane_id = -1, int out_leg_id = -1,
+                      int out_lane_id = -1, double eat = -1);
+    // back to a copy of node, without its edges like the copy constructor
+    void Reinitialize(const Node &node);
+
     void printWeightAndEdge();
     void printDetail();
     bool isSameAs(int id);
@@ -121,6 +128,13 @@ public:
     inline bool isBidirectional() {
         return bidirectional_;
     }
+    // weight seen by the multi-weighted schedulers, non-conflict edges don't delay time windows
+    inline double getMultiWeight(bool activate_precedent_offset) {
+        if (activate_precedent_offset && estimate_offset_ < 0) {
+            return estimate_offset_;
+        }
+        return edge_weight_ <= 1.0 ? 0.0 : edge_weight_;
+    }
     std::weak_ptr<Node> node1_;
     std::weak_ptr<Node> node2_;
     double edge_weight_;
@@ -195,6 +209,49 @@ public:
     std::weak_ptr<Leg> leg_;
 };
 
-// class 
+// travel time of a turn, travel_time_choice holds the times of [right-turn, straight, left-turn]
+inline double getTurnTravelTime(const std::vector<double> &travel_time_choice, int num_legs, int in_leg_id, int out_leg_id) {
+    if ((in_leg_id - 1 + num_legs) % num_legs == out_leg_id) {
+        return travel_time_choice[0];
+    }
+    if ((in_leg_id + 1) % num_legs == out_leg_id) {
+        return travel_time_choice[2];
+    }
+    return travel_time_choice[1];
+}
+
+// Nodes or edges of a graph that is rebuilt over and over. The graph hands them back on reset and takes them
+// out again in the same order, skipping the ones something else still holds, so a graph rebuilt at the same
+// size gets the same objects back and stops allocating. Nodes have to drop their edges before they are
+// handed back, an edge held by a node is never reused
+template <typename T>
+class SharedObjectPool {
+public:
+    SharedObjectPool() : next_(0) {}
+
+    // takes every object out of objects, which is left empty. They are taken out again before the ones that
+    // were not, so the first objects of a graph stay the same whatever the size of the graph before
+    void Release(std::vector<std::shared_ptr<T>> &objects) {
+        free_.erase(free_.begin(), free_.begin() + next_);
+        next_ = 0;
+        free_.insert(free_.begin(), std::make_move_iterator(objects.begin()), std::make_move_iterator(objects.end()));
+        objects.clear();
+    }
+    // nullptr if there is none to reuse
+    std::shared_ptr<T> Acquire() {
+        while (next_ < free_.size()) {
+            auto object = std::move(free_[next_++]);
+            if (object.use_count() == 1) {
+                return object;
+            }
+        }
+        return nullptr;
+    }
+
+private:
+    std::vector<std::shared_ptr<T>> free_;
+    int next_; // free_ before it was taken
+};
+
 } // namespace intersection_management
 #endif // INTERSECTION_MANAGEMENT_INTERSECTION_UTILITY_H_
\ No newline at end of file
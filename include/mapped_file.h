@@ -0,0 +1,62 @@
+#ifndef INTERSECTION_MANAGEMENT_MAPPED_FILE_H_
+#define INTERSECTION_MANAGEMENT_MAPPED_FILE_H_
+
+#include <cstddef>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace intersection_management {
+
+// read-only mapping of a whole file, the binary result and corpus readers use their data in place
+class MappedFile {
+public:
+    MappedFile() : data_(nullptr), size_(0) {}
+    ~MappedFile() { Close(); }
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    // false if the file can't be opened or is empty
+    inline bool Open(const std::string &file) {
+        Close();
+        int fd = open(file.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat file_status;
+        if (fstat(fd, &file_status) != 0 || file_status.st_size == 0) {
+            close(fd);
+            return false;
+        }
+        void *mapping = mmap(nullptr, file_status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (mapping == MAP_FAILED) {
+            return false;
+        }
+        data_ = static_cast<const char *>(mapping);
+        size_ = file_status.st_size;
+        return true;
+    }
+    inline void Close() {
+        if (data_ != nullptr) {
+            munmap(const_cast<char *>(data_), size_);
+            data_ = nullptr;
+            size_ = 0;
+        }
+    }
+
+    inline bool isOpen() const { return data_ != nullptr; }
+    inline const char *data() const { return data_; }
+    inline size_t size() const { return size_; }
+
+private:
+    const char *data_;
+    size_t size_;
+};
+
+} // namespace intersection_management
+
+#endif // INTERSECTION_MANAGEMENT_MAPPED_FILE_H_
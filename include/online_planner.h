@@ -0,0 +1,194 @@
+#ifndef INTERSECTION_MANAGEMENT_ONLINE_PLANNER_H_
+#define INTERSECTION_MANAGEMENT_ONLINE_PLANNER_H_
+
+#include <deque>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "arrival_admission.h"
+#include "cdg_scheduler.h"
+#include "demand_stream.h"
+#include "running_statistics.h"
+
+namespace intersection_management {
+
+class PlanPublisher;
+
+// vehicle in the planning window, vehicle ids number the vehicles in admission order and never change
+struct OnlineVehicle {
+    long vehicle_id_;
+    VehicleTraceRecord record_;
+};
+
+// time window of one vehicle in a plan
+struct PlannedVehicle {
+    long vehicle_id_;
+    double entry_time_;
+    double exit_time_;
+};
+
+// every vehicle that hasn't entered the intersection by plan_time_, by ascending vehicle id
+struct IntersectionPlan {
+    long sequence_ = 0;
+    double plan_time_ = 0;
+    std::vector<PlannedVehicle> vehicles_;
+};
+
+// graph of one planning cycle, with what the scheduler needs to turn it into a plan
+struct PlanningJob {
+    PlanningJob(const Parameters &local_param) : cdg_(local_param) {}
+
+    double now_;
+    ConflictDirectedGraph cdg_;
+    int num_inside_; // nodes 1 to num_inside_ are the vehicles in the intersection
+    std::vector<double> fixed_depth_; // by node, the exits of the vehicles inside counted from now, -1 otherwise
+    std::vector<OnlineVehicle> waiting_; // node num_inside_ + 1 + i is waiting_[i]
+};
+
+// Vehicles known to the planner. Vehicles whose planned entry has passed are in the intersection and keep
+// their time windows until they leave, the others wait and are planned again every cycle with the vehicles
+// admitted since. The window classifies the route of a vehicle against the others once, when it is admitted,
+// and keeps the conflicts until the vehicle leaves, so the graph of a cycle is put together from the conflicts
+// kept and only the new vehicles cost route comparisons
+class PlanningWindow {
+public:
+    PlanningWindow(const Parameters &local_param);
+
+    // classifies the routes of the batch against the vehicles of the window and each other, to be admitted by
+    // the next Admit. It doesn't depend on a plan and only reads the window, so AddMissedConflicts may run
+    // meanwhile
+    void Classify(const std::vector<VehicleTraceRecord> &batch);
+    // retires the vehicles whose entry in plan has passed by now, then adds the classified batch, all arrived
+    // by now. The plan may be older than the window, vehicles it doesn't have keep waiting
+    void Admit(double now, const IntersectionPlan &plan);
+    inline void Admit(const std::vector<VehicleTraceRecord> &batch, double now, const IntersectionPlan &plan) {
+        Classify(batch);
+        Admit(now, plan);
+    }
+    void BuildJob(double now, PlanningJob &job);
+    // with max_queueing_delay set, adds the conflicts the plan of job overlaps but the graph left out to the
+    // graph of job, and keeps them for the cycles to come. False if there are none, see
+    // Intersection::AddConflictsMissedByHorizon
+    bool AddMissedConflicts(const IntersectionPlan &plan, PlanningJob &job);
+
+    inline const std::vector<OnlineVehicle> &getWaitingVehicles() const { return waiting_; }
+    // vehicles in the intersection, with their windows at the same index
+    inline const std::vector<OnlineVehicle> &getEnteredVehicles() const { return entered_; }
+    inline const std::vector<PlannedVehicle> &getEnteredWindows() const { return entered_windows_; }
+
+    long num_entered_;
+    RunningStatistics entry_delay_; // from the arrival of a vehicle to its entry, once it has entered
+
+private:
+    // conflict with another vehicle of the window, kept by both vehicles
+    struct VehicleConflict {
+        long vehicle_id_;
+        ConflictType conflict_type_;
+    };
+    // what the window keeps of a vehicle from its admission until it leaves the intersection
+    struct WindowVehicle {
+        std::shared_ptr<Route> route_; // nullptr once the vehicle has left
+        int node_id_; // in the last job built
+        std::vector<VehicleConflict> conflicts_;
+    };
+
+    inline WindowVehicle &getWindowVehicle(long vehicle_id) { return vehicles_[vehicle_id - first_vehicle_id_]; }
+    // node of the vehicle in the last job built, -1 if it has left
+    int getNodeId(long vehicle_id);
+    const OnlineVehicle &getVehicleOfNode(const PlanningJob &job, int node_id) const;
+    // with max_queueing_delay set, only pairs that can overlap without a vehicle waiting longer get their
+    // conflict on admission, like in Intersection::AssignEdgesWithSafetyOffsetToNodes
+    bool isWithinHorizon(const VehicleTraceRecord &record_a, const VehicleTraceRecord &record_b) const;
+    // keeps the conflict of the pair with both vehicles, false if their routes don't conflict
+    bool AddConflict(const OnlineVehicle &vehicle_a, const OnlineVehicle &vehicle_b, ConflictType &conflict_type);
+    void AddConflictEdge(PlanningJob &job, int node_a, int node_b, ConflictType conflict_type);
+    void Retire(long vehicle_id);
+
+    Parameters local_param_;
+    Intersection intersection_; // geometry and routes
+    std::deque<WindowVehicle> vehicles_; // by vehicle id from first_vehicle_id_
+    long first_vehicle_id_;
+    std::vector<long> last_in_lane_; // by lane, the vehicle classified last on it
+    // the batch of Classify with its conflicts, those with the window are kept by the new vehicle only until
+    // Admit
+    std::vector<OnlineVehicle> arrivals_;
+    std::vector<WindowVehicle> arrival_vehicles_;
+    std::vector<std::pair<int, ConflictType>> back_conflicts_; // of BuildJob
+    std::vector<double> exit_time_; // by node, for AddMissedConflicts
+    std::vector<int> entry_order_; // of AddMissedConflicts
+    std::vector<OnlineVehicle> entered_;
+    std::vector<PlannedVehicle> entered_windows_;
+    std::vector<OnlineVehicle> waiting_; // in admission order
+    long next_vehicle_id_;
+};
+
+// Every cold_start_period_-th plan is scheduled from scratch and the others warm start from the order of the
+// previous plan, so 1 schedules every plan from scratch. A plan is also cold when more than max_new_fraction_
+// of its waiting vehicles are new to it
+struct WarmStartOptions {
+    int cold_start_period_ = 1;
+    double max_new_fraction_ = 0.5;
+};
+
+// Turns jobs into plans. From scratch the multi-weighted BFST gives the order of the waiting vehicles, warm
+// started they keep the order of their entries in the previous plan and the new vehicles go in where their
+// conflicts let them exit first, see CDGScheduler::ScheduleFromSeedOrder. Either way the depths of the order
+// are computed around the fixed windows of the vehicles inside, and the scheduler keeps its parent tables
+// between jobs
+class PlanningScheduler {
+public:
+    PlanningScheduler(const Parameters &local_param, const WarmStartOptions &warm_start = WarmStartOptions()) :
+        num_warm_starts_(0), scheduler_(local_param), warm_start_(warm_start), num_plans_since_cold_start_(0) {}
+
+    // fills every field of plan but the sequence number, previous is the plan served until now
+    void Schedule(const PlanningJob &job, const IntersectionPlan &previous, IntersectionPlan &plan);
+
+    long num_warm_starts_;
+
+private:
+    // false if the plan has to be cold
+    bool BuildSeedOrder(const PlanningJob &job, const IntersectionPlan &previous);
+
+    CDGScheduler scheduler_;
+    CDGScheduleResult result_;
+    WarmStartOptions warm_start_;
+    int num_plans_since_cold_start_;
+    std::vector<int> order_;
+    std::vector<int> seed_order_;
+    std::vector<std::pair<double, int>> previous_entries_; // entry in the previous plan and node id
+};
+
+// the window and the scheduler run one after the other on the caller's thread, see PlanningPipeline for them
+// on threads of their own. A plan that overlaps conflicts left out by max_queueing_delay is scheduled again
+// with them until it doesn't
+class OnlinePlanner {
+public:
+    OnlinePlanner(const Parameters &local_param, const WarmStartOptions &warm_start = WarmStartOptions(),
+                  PlanPublisher *publisher = nullptr);
+
+    // the vehicles of the batch have all arrived by now
+    const IntersectionPlan &Plan(const std::vector<VehicleTraceRecord> &batch, double now);
+
+    inline const IntersectionPlan &getPlan() const { return plan_; }
+    inline long getNumWarmStarts() const { return scheduler_.num_warm_starts_; }
+
+    PlanningWindow window_;
+    RunningStatistics planning_time_; // wall seconds per plan
+    RunningStatistics window_size_; // waiting vehicles per plan
+
+private:
+    PlanPublisher *publisher_; // not owned, every plan is published through it if set
+    PlanningJob job_;
+    PlanningScheduler scheduler_;
+    IntersectionPlan plan_;
+    IntersectionPlan previous_plan_;
+};
+
+// Feeds the demand into the planner through the admission stage until the arrivals reach horizon, closing a
+// batch when it fills or at its deadline, and plans the last batch. Returns the number of vehicles admitted
+long RunOnlinePlanning(DemandStream &demand, ArrivalAdmission &admission, OnlinePlanner &planner, double horizon);
+
+} // namespace intersection_management
+
+#endif // INTERSECTION_MANAGEMENT_ONLINE_PLANNER_H_
@@ -0,0 +1,55 @@
+#ifndef INTERSECTION_MANAGEMENT_OPTIMAL_SOLUTION_CACHE_H_
+#define INTERSECTION_MANAGEMENT_OPTIMAL_SOLUTION_CACHE_H_
+
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace intersection_management {
+
+// On-disk map from the key of an instance (see ConflictDirectedGraph::getCanonicalHash) to its optimal order
+// and makespan. Every entry also holds a fingerprint of its instance, which a lookup has to match, so that a
+// collision of keys misses instead of returning the optimum of another instance. The file is a 16 byte header
+// (magic "IMOC", version, reserved) followed by entries of key, fingerprint, makespan, order length and order,
+// only ever appended to. Opening reads every complete entry, a tail cut
+// short by a crash is dropped. Lookup and Insert may be called from any thread.
+constexpr uint32_t kOptimalSolutionCacheMagic = 0x434f4d49; // "IMOC"
+constexpr uint32_t kOptimalSolutionCacheVersion = 2;
+
+class OptimalSolutionCache {
+public:
+    struct Solution {
+        uint64_t fingerprint_;
+        std::vector<int> order_;
+        double makespan_;
+    };
+
+    OptimalSolutionCache(const std::string &file);
+    ~OptimalSolutionCache();
+
+    bool Lookup(uint64_t key, uint64_t fingerprint, std::vector<int> &order, double &makespan);
+    // the first solution of a key is kept
+    void Insert(uint64_t key, uint64_t fingerprint, const std::vector<int> &order, double makespan);
+    void Flush();
+
+    inline bool isOpen() const { return out_.is_open(); }
+    size_t size();
+
+    // misses are the searches the cache could not save, hits the ones it did. Collisions are the misses on a
+    // key held for an instance of another fingerprint
+    long hits_;
+    long misses_;
+    long collisions_;
+
+private:
+    std::mutex mutex_;
+    std::unordered_map<uint64_t, Solution> solutions_;
+    std::ofstream out_;
+};
+
+} // namespace intersection_management
+
+#endif // INTERSECTION_MANAGEMENT_OPTIMAL_SOLUTION_CACHE_H_
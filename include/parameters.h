@@ -8,16 +8,18 @@ namespace intersection_management {
 extern const std::string PROJECT_DIR;
 extern const std::string CONFIG_FILE;
 
+// tag of the Parameters constructor that leaves every field to the caller, used by ConfigurationRegistry
+struct UnconfiguredParametersTag {};
+
+// Parameters start as a copy of ConfigurationRegistry::getInstance(), so constructing them does no file I/O
 class Parameters {
 public:
-    Parameters() {
-        readParametersFromYaml();
-    }
+    Parameters();
+    explicit Parameters(UnconfiguredParametersTag) {}
     Parameters(int nl, std::vector<int> nliv, std::vector<int> nlov,
                std::string scf, std::vector<double> ttc = {6, 7, 8},
                double timeWindowOffset = 6.15, double aia = 2.0,
-               std::vector<int> ttr = {6, 7}) {
-        readParametersFromYaml();
+               std::vector<int> ttr = {6, 7}) : Parameters() {
         num_legs = nl;
         num_lanes_in_vec = nliv;
         num_lanes_out_vec = nlov;
@@ -28,7 +30,9 @@ public:
         kTimeWindowOffset = timeWindowOffset;
     }
 
+    // parses the file again, every key is required and values out of range throw std::invalid_argument
     void readParametersFromYaml();
+    void readParametersFromYaml(const std::string &file);
 
     // ## intersection gemotry and configurations ##
     int num_legs;
@@ -40,6 +44,8 @@ public:
     // ## scheduler configurations ##
     bool activate_precedent_offset;
     bool activate_arrival_time;
+    bool activate_transitive_reduction;
+    double max_queueing_delay; // -1 or positive, see Intersection::AddConflictsMissedByHorizon
 
     // # tiebreak strategy
     // # right/left most turns first
@@ -63,7 +69,25 @@ public:
 
 }; // class Parameters
 
+// The configuration file parsed once into an immutable snapshot: the parameters of the file, and the
+// parameters of every entry of its optional geometry_profiles list, each the file's parameters with the keys
+// the entry sets overridden. getInstance() holds CONFIG_FILE and is parsed on first use. Values out of range
+// throw std::invalid_argument.
+class ConfigurationRegistry {
+public:
+    explicit ConfigurationRegistry(const std::string &file);
+    static const ConfigurationRegistry &getInstance();
+
+    inline const Parameters &getParameters() const { return parameters_; }
+    inline const std::vector<Parameters> &getGeometryProfiles() const { return geometry_profiles_; }
+
+private:
+    Parameters parameters_;
+    std::vector<Parameters> geometry_profiles_;
+};
+
 extern Parameters param;
+// param followed by the geometry profiles of the configuration file
 extern std::vector<Parameters> geometryParamVec;
 } // namespace intersection_management
 #endif // #define INTERSECTION_MANAGEMENT_PARAMETERS_H_
\ No newline at end of file
@@ -0,0 +1,101 @@
+#ifndef INTERSECTION_MANAGEMENT_PLAN_DELTA_H_
+#define INTERSECTION_MANAGEMENT_PLAN_DELTA_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "online_planner.h"
+#include "running_statistics.h"
+
+namespace intersection_management {
+
+// Changes from the plan numbered base_sequence_ to the plan numbered sequence_, each list by ascending vehicle
+// id. Removed vehicles left the plan, mostly because they entered the intersection, retimed ones have a new
+// entry or exit time
+struct PlanDelta {
+    long sequence_ = 0;
+    long base_sequence_ = 0;
+    double plan_time_ = 0;
+    std::vector<long> removed_;
+    std::vector<PlannedVehicle> added_;
+    std::vector<PlannedVehicle> retimed_;
+
+    inline int getNumChanges() const { return removed_.size() + added_.size() + retimed_.size(); }
+};
+
+// Plan messages are a version byte and a type byte followed by varints: the sequence numbers, the plan time,
+// then the count and entries of every list of PlanDelta. Vehicle ids are coded as the gap to the id before,
+// entry times relative to the plan time and exit times relative to the entry, all in ticks of
+// kPlanTimeResolution, so most vehicles take a few bytes. A snapshot has no base sequence and lists the whole
+// plan as added. Times are rounded to the tick, and so are the retimes a delta carries
+enum PlanMessageType : uint8_t {
+    PlanMessage_Delta,
+    PlanMessage_Snapshot
+};
+constexpr uint8_t kPlanMessageVersion = 1;
+constexpr double kPlanTimeResolution = 1e-3; // seconds
+
+// time as a consumer of the messages sees it
+double RoundPlanTime(double time);
+
+// previous and plan by ascending vehicle id like every IntersectionPlan
+void ComputePlanDelta(const IntersectionPlan &previous, const IntersectionPlan &plan, PlanDelta &delta);
+void EncodePlanDelta(const PlanDelta &delta, std::vector<uint8_t> &message);
+void EncodePlanSnapshot(const IntersectionPlan &plan, std::vector<uint8_t> &message);
+// a snapshot comes back as a delta from nothing, with base sequence -1. False if the message is malformed
+bool DecodePlanMessage(const uint8_t *data, size_t size, PlanMessageType &type, PlanDelta &delta);
+
+// Planner side: turns every plan into the delta from the plan published before and hands it to send, and
+// keeps the last plan for consumers that ask for a snapshot
+class PlanPublisher {
+public:
+    PlanPublisher(std::function<void(const std::vector<uint8_t> &)> send = nullptr);
+
+    void Publish(const IntersectionPlan &plan);
+    // snapshot of the plan published last
+    const std::vector<uint8_t> &EncodeSnapshot();
+
+    inline const PlanDelta &getDelta() const { return delta_; }
+    inline const IntersectionPlan &getPublishedPlan() const { return published_; }
+
+    RunningStatistics message_size_; // bytes per delta
+    RunningStatistics num_changes_; // vehicles per delta
+
+private:
+    std::function<void(const std::vector<uint8_t> &)> send_;
+    IntersectionPlan published_;
+    PlanDelta delta_;
+    std::vector<uint8_t> message_;
+    std::vector<uint8_t> snapshot_;
+};
+
+// Consumer side: the plan rebuilt from the messages, starting from the empty plan 0 the publisher starts
+// from. A delta that doesn't start from the plan held means messages were lost, and the replica keeps the
+// plan it has until a snapshot arrives
+class PlanReplica {
+public:
+    PlanReplica();
+
+    // false if the message is malformed or was not applied because of a gap
+    bool Apply(const uint8_t *data, size_t size);
+    inline bool Apply(const std::vector<uint8_t> &message) { return Apply(message.data(), message.size()); }
+
+    inline bool needsSnapshot() const { return needs_snapshot_; }
+    inline const IntersectionPlan &getPlan() const { return plan_; }
+
+    long num_gaps_;
+
+private:
+    bool ApplyDelta();
+
+    IntersectionPlan plan_;
+    IntersectionPlan next_;
+    PlanDelta delta_;
+    bool needs_snapshot_;
+};
+
+} // namespace intersection_management
+
+#endif // INTERSECTION_MANAGEMENT_PLAN_DELTA_H_
@@ -0,0 +1,120 @@
+#ifndef INTERSECTION_MANAGEMENT_PLANNING_PIPELINE_H_
+#define INTERSECTION_MANAGEMENT_PLANNING_PIPELINE_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "online_planner.h"
+#include "spsc_queue.h"
+
+namespace intersection_management {
+
+// Latest plan for any number of reader threads and one writer thread. Readers never wait: they pin the
+// published buffer with a count and read it in place. The writer fills the other buffer and only waits for
+// readers still pinned to it from before the last publish, so a reader never sees a plan being written
+class DoubleBufferedPlan {
+public:
+    DoubleBufferedPlan() : published_(0) {
+        readers_[0] = 0;
+        readers_[1] = 0;
+    }
+
+    // calls read with the latest plan, which doesn't change during the call
+    template <typename Reader>
+    void Read(Reader &&read) const {
+        int index;
+        while (true) {
+            index = published_.load();
+            readers_[index].fetch_add(1);
+            if (published_.load() == index) {
+                break;
+            }
+            readers_[index].fetch_sub(1); // published again in between, the writer may be on this buffer
+        }
+        read(buffers_[index]);
+        readers_[index].fetch_sub(1);
+    }
+    inline IntersectionPlan getSnapshot() const {
+        IntersectionPlan plan;
+        Read([&](const IntersectionPlan &published) { plan = published; });
+        return plan;
+    }
+
+    // writer side: fill the buffer returned by BeginWrite, then Publish it
+    IntersectionPlan &BeginWrite() {
+        int back = 1 - published_.load();
+        while (readers_[back].load() > 0) {
+            std::this_thread::yield();
+        }
+        return buffers_[back];
+    }
+    inline void Publish() { published_.store(1 - published_.load()); }
+
+private:
+    IntersectionPlan buffers_[2];
+    std::atomic<int> published_;
+    mutable std::atomic<int> readers_[2];
+};
+
+// Online planning on three threads: ingest gathers arrivals into batches, build retires vehicles against the
+// latest published plan and builds the graph of the window, and schedule turns graphs into plans. The stages
+// hand batches and jobs over through SpscQueue, and used jobs go back to build to be refilled, so ingest runs
+// ahead while plan N is served from the DoubleBufferedPlan. Build classifies the routes of a batch while
+// schedule adds the conflicts its plan overlaps past max_queueing_delay through the window, then sleeps until
+// that plan is published and retires against it, so the plans are those of OnlinePlanner. With a publisher,
+// the schedule stage publishes every plan through it as well
+class PlanningPipeline {
+public:
+    PlanningPipeline(const Parameters &local_param, const ArrivalAdmissionOptions &admission_options,
+                     int queue_capacity = 16, const WarmStartOptions &warm_start = WarmStartOptions(),
+                     PlanPublisher *publisher = nullptr);
+    ~PlanningPipeline();
+
+    // starts the stages, ingest pulls vehicles in arrival order from next_vehicle until it returns false
+    void Start(std::function<bool(VehicleTraceRecord &)> next_vehicle);
+    // waits until the last vehicle is planned and the stages have stopped
+    void Join();
+
+    inline const DoubleBufferedPlan &getPlan() const { return plan_; }
+    inline long getNumPlans() const { return num_plans_.load(); }
+    // read it after Join
+    inline long getNumWarmStarts() const { return scheduler_.num_warm_starts_; }
+
+    // each owned by its stage, read them after Join. The window is build's but for the missed conflicts
+    ArrivalAdmission admission_;
+    PlanningWindow window_;
+    RunningStatistics build_time_; // wall seconds per job
+    RunningStatistics schedule_time_; // wall seconds per plan
+
+private:
+    struct AdmittedBatch {
+        std::vector<VehicleTraceRecord> vehicles_;
+        double now_ = 0;
+        bool is_last_ = false;
+    };
+
+    void Ingest(std::function<bool(VehicleTraceRecord &)> next_vehicle);
+    void Build();
+    void Schedule();
+
+    Parameters local_param_;
+    SpscQueue<AdmittedBatch> batch_queue_;
+    SpscQueue<std::unique_ptr<PlanningJob>> job_queue_; // nullptr after the last job
+    SpscQueue<std::unique_ptr<PlanningJob>> free_job_queue_;
+    PlanningScheduler scheduler_;
+    PlanPublisher *publisher_; // not owned, used by the schedule stage only
+    DoubleBufferedPlan plan_;
+    std::atomic<long> num_plans_;
+    std::mutex plans_mutex_; // of num_plans_ for plan_published_
+    std::condition_variable plan_published_;
+    std::vector<std::thread> stages_;
+};
+
+} // namespace intersection_management
+
+#endif // INTERSECTION_MANAGEMENT_PLANNING_PIPELINE_H_
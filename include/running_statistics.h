@@ -0,0 +1,39 @@
+#ifndef INTERSECTION_MANAGEMENT_RUNNING_STATISTICS_H_
+#define INTERSECTION_MANAGEMENT_RUNNING_STATISTICS_H_
+
+#include <cmath>
+#include <limits>
+
+namespace intersection_management {
+
+// mean and variance of a stream of samples with Welford's update, which stays accurate over long runs
+// where the sum of squares would cancel out
+class RunningStatistics {
+public:
+    RunningStatistics() : count_(0), mean_(0.0), m2_(0.0) {}
+
+    inline void Add(double value) {
+        count_++;
+        double delta = value - mean_;
+        mean_ += delta / count_;
+        m2_ += delta * (value - mean_);
+    }
+    // sample variance, 0 until there are two samples
+    inline double getVariance() const { return count_ > 1 ? m2_ / (count_ - 1) : 0.0; }
+    // full width of the normal confidence interval of the mean, z = 1.96 for 95%. Infinite until there are
+    // two samples, since one sample says nothing about the spread
+    inline double getConfidenceIntervalWidth(double z) const {
+        if (count_ < 2) {
+            return std::numeric_limits<double>::infinity();
+        }
+        return 2.0 * z * std::sqrt(getVariance() / count_);
+    }
+
+    long count_;
+    double mean_;
+    double m2_; // sum of squared differences from the current mean
+};
+
+} // namespace intersection_management
+
+#endif // INTERSECTION_MANAGEMENT_RUNNING_STATISTICS_H_
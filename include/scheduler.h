@@ -5,6 +5,7 @@
 #include "spanning_tree.h"
 #include <iostream>
 #include <algorithm>
+#include <cstdint>
 
 namespace intersection_management {
 
@@ -17,6 +18,7 @@ public:
         split_flexible_critical_resource_ = false;
         num_critical_resource_splitted_ = 0;
         competing_node_id_ = 0;
+        priority_key_ = id;
     }
 
     int id_;
@@ -29,19 +31,29 @@ public:
     bool split_flexible_critical_resource_;
     int num_critical_resource_splitted_;
     int competing_node_id_;
+    // tie-break priority among equal depths, smaller first. The id alone unless the candidate comes from
+    // Scheduler::MakeCandidate, which packs the enabled tie-break strategies in
+    uint64_t priority_key_;
 };
 
 class Scheduler {
 
 public:
     Scheduler();
-    SpanningTree ScheduleWithFIFO(Intersection &intersection);
+    Scheduler(const Parameters &local_param);
+    void InitializeFromLocalParam(const Parameters &local_param);
+    // the tree is result_tree_, refilled by the next call
+    const SpanningTree &ScheduleWithFIFO(Intersection &intersection);
 
     void PrepareForTreeSchedule(Intersection &intersection);
     void GenerateUniparentTable(Intersection &intersection);
     void GenerateBineighborTable(Intersection &intersection);
 
-    void SortReadyListAscendingly(std::vector<Candidate> &ready_list, Intersection &intersection);
+    // candidate for the node with id, its lanes and travel time from the intersection and its priority key
+    // computed from them, after PrepareForTreeSchedule
+    Candidate MakeCandidate(int id, double depth, int parent, Intersection &intersection, double estimate_offset = 0,
+                            bool split_flexible_critical_resource = false, int num_critical_resource_splitted = 0);
+    void SortReadyListAscendingly(std::vector<Candidate> &ready_list);
 
     static bool isInList(int id, std::vector<Candidate> &ready_list);
     static bool StillHasUnscheduledPredecessor(std::vector<std::shared_ptr<Node>> &pre, std::vector<bool> &added_to_tree);
@@ -52,6 +64,18 @@ public:
     std::vector<std::vector<std::shared_ptr<Node>>> unidirectional_parent_table_;
     std::vector<std::vector<std::shared_ptr<Node>>> bidirectional_neighbor_table_;
     std::vector<int> remaining_demand_per_lane_;
+
+    // scheduler configurations, copied from the parameters at construction so that instances don't share state
+    bool activate_arrival_time_;
+    bool tie_minimum_resource_waste_first_;
+    bool tie_high_demand_first_;
+    bool tie_consider_splitting_resource_;
+    bool tie_more_splitted_resource_first_;
+
+    std::vector<double> latest_end_per_route_class_; // of ScheduleWithFIFO, see Intersection::getRouteClassTable
+
+private:
+    void AssignPriorityKey(Candidate &candidate, Intersection &intersection);
 };
 
 } // namespace intersection_management
@@ -45,6 +45,11 @@ public:
     double depth_;
     double edge_weighted_depth_;
     double edge_node_weighted_depth_;
+
+private:
+    // copies from before the last reset, see SharedObjectPool
+    SharedObjectPool<Node> node_pool_;
+    SharedObjectPool<Edge> edge_pool_;
 };
 } // namespace intersection_management
 #endif // INTERSECTION_MANAGEMENT_SPANNING_TREE_H_
\ No newline at end of file
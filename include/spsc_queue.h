@@ -0,0 +1,57 @@
+#ifndef INTERSECTION_MANAGEMENT_SPSC_QUEUE_H_
+#define INTERSECTION_MANAGEMENT_SPSC_QUEUE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace intersection_management {
+
+// Bounded lock-free queue between exactly one producer thread and one consumer thread. The producer only
+// writes tail_ and the consumer only writes head_, each publishes its slot with a release store, and the two
+// indices live on separate cache lines so the threads don't invalidate each other's line on every item
+template <typename T>
+class SpscQueue {
+public:
+    // capacity is rounded up to a power of two
+    explicit SpscQueue(size_t capacity) : head_(0), tail_(0) {
+        size_t size = 2;
+        while (size < capacity) size <<= 1;
+        slots_.resize(size);
+        mask_ = size - 1;
+    }
+
+    // false if the queue is full, the item is left untouched then
+    bool TryPush(T &item) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) > mask_) {
+            return false;
+        }
+        slots_[tail & mask_] = std::move(item);
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+    // false if the queue is empty
+    bool TryPop(T &item) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = std::move(slots_[head & mask_]);
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+    // exact on either end, a hint anywhere else
+    inline bool isEmpty() const { return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire); }
+
+private:
+    std::vector<T> slots_;
+    size_t mask_;
+    alignas(64) std::atomic<size_t> head_; // next slot to pop
+    alignas(64) std::atomic<size_t> tail_; // next slot to push
+};
+
+} // namespace intersection_management
+
+#endif // INTERSECTION_MANAGEMENT_SPSC_QUEUE_H_
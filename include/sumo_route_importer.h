@@ -0,0 +1,72 @@
+#ifndef INTERSECTION_MANAGEMENT_SUMO_ROUTE_IMPORTER_H_
+#define INTERSECTION_MANAGEMENT_SUMO_ROUTE_IMPORTER_H_
+
+#include <functional>
+#include <istream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "parameters.h"
+#include "vehicle_trace.h"
+
+namespace intersection_management {
+
+typedef std::vector<std::pair<std::string, std::string>> XmlAttributes;
+
+// Minimal SAX style XML reader: calls start_element for every opening or empty element with its decoded
+// attributes, and end_element for every closing or empty element. Text, comments, processing instructions
+// and doctypes are skipped. The stream is read character by character, so memory doesn't grow with the file
+bool ParseXmlStream(std::istream &in,
+                    const std::function<void(const std::string &, const XmlAttributes &)> &start_element,
+                    const std::function<void(const std::string &)> &end_element);
+
+// leg of a SUMO edge of the intersection network, incoming edges end at the junction and outgoing ones start there
+struct SumoEdgeLeg {
+    int leg_id_;
+    bool in_bound_;
+};
+typedef std::unordered_map<std::string, SumoEdgeLeg> SumoEdgeMap;
+// YAML file with the maps incoming: {edge: leg} and outgoing: {edge: leg}
+SumoEdgeMap ReadSumoEdgeMap(const std::string &file);
+
+// Turns the vehicles and trips of a SUMO route file into trace records in file order. The first edge of a
+// route gives the in leg and the last one the out leg, departLane and arrivalLane give the lanes when they
+// are numbers, otherwise the lanes of a leg are used in turn. The travel time is the travel_time_choice of
+// the turn like in Intersection::AddRandomVehicleNodesWithTravelTime. Vehicles on edges that aren't mapped,
+// flows and departures that aren't times are counted as skipped
+class SumoRouteImporter {
+public:
+    SumoRouteImporter(const Parameters &local_param, const SumoEdgeMap &edge_map);
+
+    bool Import(std::istream &in, const std::function<void(const VehicleTraceRecord &)> &emit_vehicle);
+    bool Import(const std::string &route_file, const std::function<void(const VehicleTraceRecord &)> &emit_vehicle);
+    // false if the route file can't be read or the trace written
+    bool ImportToTrace(const std::string &route_file, const std::string &trace_file);
+
+    double getTravelTime(int in_leg_id, int out_leg_id) const;
+
+    long num_imported_;
+    long num_skipped_;
+
+private:
+    bool EmitVehicle(const std::string &from_edge, const std::string &to_edge, const std::string &depart,
+                     const std::string &depart_lane, const std::string &arrival_lane,
+                     const std::function<void(const VehicleTraceRecord &)> &emit_vehicle);
+    int getLane(const std::string &lane, int leg_id, bool in_bound);
+
+    int num_legs_;
+    std::vector<int> num_lanes_in_vec_;
+    std::vector<int> num_lanes_out_vec_;
+    std::vector<double> travel_time_choice_;
+    SumoEdgeMap edge_map_;
+    std::vector<int> next_lane_in_;
+    std::vector<int> next_lane_out_;
+    // first and last edge of the routes defined at the top level of the file, by route id
+    std::unordered_map<std::string, std::pair<std::string, std::string>> named_routes_;
+};
+
+} // namespace intersection_management
+
+#endif // INTERSECTION_MANAGEMENT_SUMO_ROUTE_IMPORTER_H_
@@ -27,6 +27,7 @@
 #include <functional>
 #include <cmath>
 #include <iomanip>
+#include <mutex>
 
 namespace time_profiler
 {
@@ -584,13 +585,14 @@ namespace time_profiler
     /// #define USE_PROFILER 1
     /// \endcode enables profiling again.
     ///
-    /// \note This class is not thread-safe. It is designed to be used with
-    /// single-threaded programs.
+    /// \note Checkpoints are kept per thread, so a measurement always spans two
+    /// consecutive checkpoints of the same thread. The collected measurements
+    /// are shared and guarded by a mutex.
     class TimeProfiler
     {
     private:
-        std::deque<Checkpoint> checkpoints_;
         std::map<std::size_t, MultiMeasurement> measurement_map_;
+        std::mutex mutex_;
 
     private:
         /// Default constructor.
@@ -632,6 +634,7 @@ namespace time_profiler
             // Copy the elements of the measurement map into a list
             // that can be sorted.
             std::list<MultiMeasurement> measurement_list;
+            std::lock_guard<std::mutex> lock(get_instance().mutex_);
             std::map<std::size_t, MultiMeasurement> &measurement_map = get_instance().measurement_map_;
             std::map<std::size_t, MultiMeasurement>::const_iterator mit;
             std::chrono::microseconds total_duration(0);
@@ -665,15 +668,18 @@ namespace time_profiler
         {
 
 #if USE_PROFILER
-            // Add the measurement point.
-            std::deque<Checkpoint> &checkpoints = get_instance().checkpoints_;
+            // Add the measurement point to the checkpoints of this thread.
+            static thread_local std::deque<Checkpoint> checkpoints;
             checkpoints.push_back(Checkpoint(file, line, function));
 
             if (checkpoints.size() >= 2)
             {
                 SingleMeasurement measurement(checkpoints[0], checkpoints[1]);
-                get_instance().measurement_map_[measurement.get_hash()].add(
-                    measurement);
+                {
+                    std::lock_guard<std::mutex> lock(get_instance().mutex_);
+                    get_instance().measurement_map_[measurement.get_hash()].add(
+                        measurement);
+                }
                 checkpoints.pop_front();
             }
 #endif
@@ -0,0 +1,85 @@
+#ifndef INTERSECTION_MANAGEMENT_VEHICLE_TRACE_H_
+#define INTERSECTION_MANAGEMENT_VEHICLE_TRACE_H_
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace intersection_management {
+
+// one vehicle of a recorded arrival log, lanes are numbered within their leg like Node::in_lane_id_
+struct VehicleTraceRecord {
+    double arrival_time_;
+    double travel_time_;
+    int32_t in_leg_id_;
+    int32_t in_lane_id_;
+    int32_t out_leg_id_;
+    int32_t out_lane_id_;
+};
+
+// Binary traces are a 16 byte header (magic "IMVT", version, reserved) followed by the records as laid out
+// in VehicleTraceRecord. CSV traces have one vehicle per line with the same fields in the same order and an
+// optional header line. Both hold the vehicles in arrival order.
+enum VehicleTraceFormat {
+    Format_Binary,
+    Format_Csv
+};
+constexpr uint32_t kVehicleTraceMagic = 0x54564d49; // "IMVT"
+constexpr uint32_t kVehicleTraceVersion = 1;
+// records read from a binary trace at a time
+constexpr int kVehicleTraceBufferSize = 4096;
+
+// CSV for files ending in .csv, binary otherwise
+VehicleTraceFormat getVehicleTraceFormat(const std::string &file);
+
+class VehicleTraceWriter {
+public:
+    VehicleTraceWriter(const std::string &file, VehicleTraceFormat format);
+    VehicleTraceWriter(const std::string &file) : VehicleTraceWriter(file, getVehicleTraceFormat(file)) {}
+
+    void Append(const VehicleTraceRecord &record);
+    // false if anything could not be written
+    bool Close();
+
+    inline bool isOpen() const { return out_.is_open(); }
+
+private:
+    std::ofstream out_;
+    VehicleTraceFormat format_;
+};
+
+// Streams a trace in constant memory: binary traces through a fixed buffer of records, CSV traces line by
+// line. The format is recognized from the magic, and reading stops with an error at a malformed line or a
+// vehicle arriving before the one ahead of it
+class VehicleTraceReader {
+public:
+    VehicleTraceReader(const std::string &file);
+
+    // false at the end of the trace or at an error
+    bool Next(VehicleTraceRecord &record);
+
+    inline bool isOpen() const { return in_.is_open(); }
+    inline bool hasError() const { return has_error_; }
+    inline long getNumRecords() const { return num_records_; }
+
+private:
+    bool ReadBinary(VehicleTraceRecord &record);
+    bool ReadCsv(VehicleTraceRecord &record);
+
+    std::string file_;
+    std::ifstream in_;
+    VehicleTraceFormat format_;
+    bool has_error_;
+    bool is_truncated_; // the binary trace ends in the middle of a record after the buffered ones
+    long num_records_;
+    double last_arrival_time_;
+    std::vector<VehicleTraceRecord> buffer_;
+    size_t buffer_position_;
+    std::string line_;
+    long line_number_;
+};
+
+} // namespace intersection_management
+
+#endif // INTERSECTION_MANAGEMENT_VEHICLE_TRACE_H_
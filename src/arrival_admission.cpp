@@ -0,0 +1,26 @@
+#include "arrival_admission.h"
+
+#include <utility>
+
+namespace intersection_management {
+
+ArrivalAdmission::ArrivalAdmission(const ArrivalAdmissionOptions &options) : options_(options) {
+    batch_.reserve(options_.max_batch_size_);
+}
+
+bool ArrivalAdmission::Add(const VehicleTraceRecord &record) {
+    batch_.push_back(record);
+    return static_cast<int>(batch_.size()) >= options_.max_batch_size_;
+}
+
+// the two vectors swap, so batches are handed over without copying or allocating
+void ArrivalAdmission::CloseBatch(double now, std::vector<VehicleTraceRecord> &batch) {
+    for (auto &record : batch_) {
+        latency_.Add(now - record.arrival_time_);
+    }
+    batch_size_.Add(batch_.size());
+    batch.clear();
+    std::swap(batch, batch_);
+}
+
+} // namespace intersection_management
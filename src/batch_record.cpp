@@ -0,0 +1,278 @@
+#include "batch_record.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <iostream>
+#include <limits>
+
+#include "batch_test_utility.h"
+
+namespace intersection_management {
+
+namespace {
+template <typename T>
+void WritePod(std::ostream &out, const T &value) {
+    out.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+// one column of a row group, gathered from the rows into a contiguous array
+template <typename T, typename Field>
+void WriteColumn(std::ostream &out, const std::vector<BatchTestRecord> &records, Field field, std::vector<T> &column) {
+    column.clear();
+    for (auto &record : records) {
+        column.push_back(record.*field);
+    }
+    out.write(reinterpret_cast<const char *>(column.data()), column.size() * sizeof(T));
+}
+
+const size_t kFileHeaderSize = 4 * sizeof(uint32_t);
+const size_t kRowGroupHeaderSize = 2 * sizeof(uint32_t);
+const size_t kBytesPerRow = 4 * sizeof(int32_t) + 4 * sizeof(double);
+} // namespace
+
+// appending to a file of a resumed batch only writes the headers if the file was empty
+BatchRecordWriter::BatchRecordWriter(const std::string &file, const std::string &csv_file, bool append) :
+    file_(file), csv_file_(csv_file), out_(file, std::ios::binary | (append ? std::ios::app : std::ios::trunc)),
+    is_open_(false), num_queued_row_groups_(0), num_written_row_groups_(0), closing_(false) {
+    if (!out_) {
+        std::cerr << "Record file " << file << " could not be opened.\n";
+        return;
+    }
+    out_.seekp(0, std::ios::end);
+    if (out_.tellp() == 0) {
+        WritePod(out_, kBatchRecordMagic);
+        WritePod(out_, kBatchRecordVersion);
+        WritePod(out_, kBatchRecordRowGroupSize);
+        WritePod<uint32_t>(out_, 0);
+    }
+    if (!csv_file.empty()) {
+        csv_out_.open(csv_file, append ? std::ios::app : std::ios::trunc);
+        csv_out_.seekp(0, std::ios::end);
+        // the mirror holds the same doubles as the binary file
+        csv_out_.precision(std::numeric_limits<double>::max_digits10);
+        if (!csv_out_) {
+            std::cerr << "Record file " << csv_file << " could not be opened, writing " << file << " only.\n";
+        }
+        else if (csv_out_.tellp() == 0) {
+            csv_out_ << "seed,num_nodes,geometry,method,makespan,order_standard_deviation,jain_index,wall_time\n";
+        }
+    }
+    out_.flush();
+    position_.size_ = out_.tellp();
+    if (csv_out_.is_open()) {
+        csv_out_.flush();
+        position_.csv_size_ = csv_out_.tellp();
+    }
+    current_row_group_.reserve(kBatchRecordRowGroupSize);
+    is_open_ = true;
+    writer_thread_ = std::thread(&BatchRecordWriter::WriterLoop, this);
+}
+
+BatchRecordWriter::~BatchRecordWriter() {
+    Close();
+}
+
+void BatchRecordWriter::Append(const std::vector<BatchTestRecord> &records) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!is_open_ || closing_) {
+        return;
+    }
+    for (auto &record : records) {
+        current_row_group_.push_back(record);
+        if (current_row_group_.size() == kBatchRecordRowGroupSize) {
+            full_row_groups_.push_back(std::move(current_row_group_));
+            num_queued_row_groups_++;
+            current_row_group_.clear();
+            current_row_group_.reserve(kBatchRecordRowGroupSize);
+            row_group_ready_.notify_one();
+        }
+    }
+}
+
+BatchRecordPosition BatchRecordWriter::Flush() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!is_open_ || closing_) {
+        return position_;
+    }
+    if (!current_row_group_.empty()) {
+        full_row_groups_.push_back(std::move(current_row_group_));
+        num_queued_row_groups_++;
+        current_row_group_.clear();
+        current_row_group_.reserve(kBatchRecordRowGroupSize);
+        row_group_ready_.notify_one();
+    }
+    row_groups_written_.wait(lock, [this]() { return num_written_row_groups_ == num_queued_row_groups_; });
+    return position_;
+}
+
+// once Flush returns the writer thread is done with the files until the next row group is queued, which the
+// lock holds back
+bool BatchRecordWriter::Truncate(const BatchRecordPosition &position) {
+    Flush();
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!is_open_ || closing_) {
+        return false;
+    }
+    bool has_csv = csv_out_.is_open() && position.csv_size_ > 0;
+    if (position.size_ < kFileHeaderSize || position.size_ > position_.size_ ||
+        (has_csv && position.csv_size_ > position_.csv_size_)) {
+        std::cerr << "Record file " << file_ << " of " << position_.size_ << " bytes can't be cut back to "
+                  << position.size_ << " bytes.\n";
+        return false;
+    }
+    out_.close();
+    bool is_truncated = truncate(file_.c_str(), position.size_) == 0;
+    out_.open(file_, std::ios::binary | std::ios::app);
+    position_.size_ = position.size_;
+    if (has_csv) {
+        csv_out_.close();
+        is_truncated = truncate(csv_file_.c_str(), position.csv_size_) == 0 && is_truncated;
+        csv_out_.open(csv_file_, std::ios::app);
+        position_.csv_size_ = position.csv_size_;
+    }
+    if (!is_truncated || !out_) {
+        std::cerr << "Record file " << file_ << " could not be cut back to its checkpoint.\n";
+        return false;
+    }
+    return true;
+}
+
+void BatchRecordWriter::Close() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!is_open_ || closing_) {
+            return;
+        }
+        if (!current_row_group_.empty()) {
+            full_row_groups_.push_back(std::move(current_row_group_));
+            num_queued_row_groups_++;
+            current_row_group_.clear();
+        }
+        closing_ = true;
+    }
+    row_group_ready_.notify_one();
+    writer_thread_.join();
+    out_.close();
+    if (csv_out_.is_open()) {
+        csv_out_.close();
+    }
+}
+
+// the file is only touched on this thread, the lock is held just long enough to take the full row groups
+void BatchRecordWriter::WriterLoop() {
+    std::vector<std::vector<BatchTestRecord>> row_groups;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            row_group_ready_.wait(lock, [this]() { return closing_ || !full_row_groups_.empty(); });
+            row_groups.swap(full_row_groups_);
+            if (row_groups.empty() && closing_) {
+                return;
+            }
+        }
+        for (auto &records : row_groups) {
+            WriteRowGroup(records);
+        }
+        out_.flush();
+        BatchRecordPosition position;
+        position.size_ = out_.tellp();
+        if (csv_out_.is_open()) {
+            csv_out_.flush();
+            position.csv_size_ = csv_out_.tellp();
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        num_written_row_groups_ += row_groups.size();
+        position_ = position;
+        row_groups.clear();
+        row_groups_written_.notify_all();
+    }
+}
+
+void BatchRecordWriter::WriteRowGroup(const std::vector<BatchTestRecord> &records) {
+    WritePod<uint32_t>(out_, records.size());
+    WritePod<uint32_t>(out_, 0);
+    std::vector<int32_t> int_column;
+    std::vector<double> double_column;
+    WriteColumn(out_, records, &BatchTestRecord::seed_, int_column);
+    WriteColumn(out_, records, &BatchTestRecord::num_nodes_, int_column);
+    WriteColumn(out_, records, &BatchTestRecord::geometry_, int_column);
+    WriteColumn(out_, records, &BatchTestRecord::method_, int_column);
+    WriteColumn(out_, records, &BatchTestRecord::makespan_, double_column);
+    WriteColumn(out_, records, &BatchTestRecord::order_standard_deviation_, double_column);
+    WriteColumn(out_, records, &BatchTestRecord::jain_index_, double_column);
+    WriteColumn(out_, records, &BatchTestRecord::wall_time_, double_column);
+    if (csv_out_.is_open()) {
+        for (auto &record : records) {
+            csv_out_ << record.seed_ << "," << record.num_nodes_ << "," << record.geometry_ << ","
+                     << kBatchTestMethodNames[record.method_] << "," << record.makespan_ << ","
+                     << record.order_standard_deviation_ << "," << record.jain_index_ << "," << record.wall_time_ << "\n";
+        }
+    }
+}
+
+// a row group cut short at the end of the file is left out
+BatchRecordReader::BatchRecordReader(const std::string &file) : num_rows_(0) {
+    if (!file_.Open(file) || file_.size() < kFileHeaderSize) {
+        std::cerr << "Record file " << file << " is missing or too short.\n";
+        file_.Close();
+        return;
+    }
+    auto header = reinterpret_cast<const uint32_t *>(file_.data());
+    if (header[0] != kBatchRecordMagic || header[1] != kBatchRecordVersion) {
+        std::cerr << "Record file " << file << " has an unknown format.\n";
+        file_.Close();
+        return;
+    }
+
+    const char *data = file_.data();
+    size_t size = file_.size();
+    size_t offset = kFileHeaderSize;
+    while (offset + kRowGroupHeaderSize <= size) {
+        uint32_t num_rows = *reinterpret_cast<const uint32_t *>(data + offset);
+        size_t group_size = kRowGroupHeaderSize + num_rows * kBytesPerRow;
+        if (offset + group_size > size) {
+            break;
+        }
+        const char *column = data + offset + kRowGroupHeaderSize;
+        auto next_int_column = [&]() {
+            auto begin = reinterpret_cast<const int32_t *>(column);
+            column += num_rows * sizeof(int32_t);
+            return begin;
+        };
+        auto next_double_column = [&]() {
+            auto begin = reinterpret_cast<const double *>(column);
+            column += num_rows * sizeof(double);
+            return begin;
+        };
+        RowGroup row_group;
+        row_group.num_rows_ = num_rows;
+        row_group.seed_ = next_int_column();
+        row_group.num_nodes_ = next_int_column();
+        row_group.geometry_ = next_int_column();
+        row_group.method_ = next_int_column();
+        row_group.makespan_ = next_double_column();
+        row_group.order_standard_deviation_ = next_double_column();
+        row_group.jain_index_ = next_double_column();
+        row_group.wall_time_ = next_double_column();
+        row_groups_.push_back(row_group);
+        first_row_.push_back(num_rows_);
+        num_rows_ += num_rows;
+        offset += group_size;
+    }
+}
+
+bool BatchRecordReader::getRecord(uint64_t row, BatchTestRecord &record) const {
+    if (row >= num_rows_) {
+        std::cerr << "Record " << row << " is beyond the " << num_rows_ << " records of the file.\n";
+        return false;
+    }
+    int group = std::upper_bound(first_row_.begin(), first_row_.end(), row) - first_row_.begin() - 1;
+    auto &row_group = row_groups_[group];
+    uint64_t i = row - first_row_[group];
+    record = BatchTestRecord{row_group.seed_[i], row_group.num_nodes_[i], row_group.geometry_[i], row_group.method_[i],
+                             row_group.makespan_[i], row_group.order_standard_deviation_[i], row_group.jain_index_[i],
+                             row_group.wall_time_[i]};
+    return true;
+}
+
+} // namespace intersection_management
@@ -1,6 +1,19 @@
 #include "batch_test_utility.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <utility>
 
 #include "scheduler.h"
 #include "conflict_directed_graph.h"
@@ -10,17 +23,55 @@
 
 namespace intersection_management {
 
+const std::vector<std::string> kBatchTestMethodNames = {"place_holder", "dfs", "bfs", "mdbfs", "global_optimal", "fifo", "mddfs"};
+
 std::vector<double> BatchTestOneCase(int num_nodes, bool verbose, int seed) {
-    PROFILER_HOOK();
+    return BatchTestOneCase(param, num_nodes, verbose, seed);
+}
+
+namespace {
+// every thread runs its cases in one workspace
+BatchTestWorkspace &getThreadWorkspace() {
+    static thread_local BatchTestWorkspace workspace;
+    return workspace;
+}
+} // namespace
+
+std::vector<double> BatchTestOneCase(const Parameters &local_param, int num_nodes, bool verbose, int seed,
+                                     unsigned methods, std::vector<BatchTestRecord> *records,
+                                     OptimalSolutionCache *optimal_solution_cache) {
     std::vector<double> depth;
-    Intersection intersection;
-    ConflictDirectedGraph cdg;
-    Scheduler scheduler;
-    CDGScheduler scheduler_dfs;
-    CDGScheduler scheduler_bfs;
-    CDGScheduler scheduler_mdbfs;
-    CDGScheduler scheduler_bruteforce;
-    CDGScheduler scheduler_mddfs;
+    getThreadWorkspace().RunCase(local_param, num_nodes, depth, verbose, seed, methods, records, optimal_solution_cache);
+    return depth;
+}
+
+void BatchTestWorkspace::RunCase(const Parameters &local_param, int num_nodes, std::vector<double> &depth,
+                                 bool verbose, int seed, unsigned methods, std::vector<BatchTestRecord> *records,
+                                 OptimalSolutionCache *optimal_solution_cache) {
+    PROFILER_HOOK();
+    depth.assign(kNumberOfBatchTestMethods, 0);
+    // the case refills the intersection, the graph and the schedulers of the workspace, they keep their buffers
+    auto &intersection = intersection_;
+    auto &cdg = cdg_;
+    auto &scheduler = scheduler_;
+    auto &scheduler_dfs = scheduler_dfs_;
+    auto &scheduler_bfs = scheduler_bfs_;
+    auto &scheduler_mdbfs = scheduler_mdbfs_;
+    auto &scheduler_bruteforce = scheduler_bruteforce_;
+    auto &scheduler_mddfs = scheduler_mddfs_;
+    auto &modified_dfst = modified_dfst_;
+    auto &bfst = bfst_;
+    auto &mdbfst = mdbfst_;
+    auto &mddfst = mddfst_;
+    auto &best_order = best_order_;
+    intersection.Reconfigure(local_param);
+    cdg.activate_precedent_offset_ = local_param.activate_precedent_offset;
+    cdg.reset(false);
+    scheduler.InitializeFromLocalParam(local_param);
+    for (auto cdg_scheduler : {&scheduler_dfs, &scheduler_bfs, &scheduler_mdbfs, &scheduler_bruteforce, &scheduler_mddfs}) {
+        cdg_scheduler->InitializeFromLocalParam(local_param);
+    }
+    scheduler_bruteforce.optimal_solution_cache_ = optimal_solution_cache;
 
     PROFILER_HOOK();
     intersection.setSeed(seed);
@@ -31,100 +82,793 @@ std::vector<double> BatchTestOneCase(int num_nodes, bool verbose, int seed) {
 
     PROFILER_HOOK();
     cdg.GenerateGraphFromIntersection(intersection);
+    if (local_param.activate_transitive_reduction) {
+        cdg.ReduceTransitiveEdges();
+    }
 
-    PROFILER_HOOK();
-    auto modified_dfst = scheduler_dfs.ScheduleWithModifiedDfst(cdg);
+    // the wall time of a method starts after the graph is built, and its fairness comes from the depth per node
+    auto method_start = std::chrono::steady_clock::now();
+    auto add_record = [&](BatchTestMethod method, const std::vector<double> &depth_vector) {
+        if (records == nullptr) {
+            return;
+        }
+        auto now = std::chrono::steady_clock::now();
+        records->push_back(BatchTestRecord{seed, num_nodes, 0, method, depth[method],
+                                           CalculateOrderFairnessIndex(depth_vector, Type_OrderStandardDeviation),
+                                           CalculateOrderFairnessIndex(depth_vector, Type_JainIndex),
+                                           std::chrono::duration<double>(now - method_start).count()});
+    };
 
-    PROFILER_HOOK();
-    auto bfst = scheduler_bfs.ScheduleWithBfstWeightedEdgeOnly(cdg);
+    // with a bounded horizon a schedule may overlap pairs the graph left out, those get their conflict and
+    // every method runs again until none of their schedules does, see Intersection::AddConflictsMissedByHorizon
+    size_t num_records = records != nullptr ? records->size() : 0;
+    auto run_cdg_methods = [&]() {
+        PROFILER_HOOK();
+        if (isMethodSelected(methods, Method_ModifiedDfst)) {
+            method_start = std::chrono::steady_clock::now();
+            scheduler_dfs.ScheduleWithModifiedDfst(cdg, modified_dfst);
+            depth[Method_ModifiedDfst] = modified_dfst.makespan_;
+            add_record(Method_ModifiedDfst, modified_dfst.depth_);
+        }
 
-    PROFILER_HOOK();
-    auto mdbfst = scheduler_mdbfs.ScheduleWithBfstMultiWeight(cdg);
+        PROFILER_HOOK();
+        if (isMethodSelected(methods, Method_Bfst)) {
+            method_start = std::chrono::steady_clock::now();
+            scheduler_bfs.ScheduleWithBfstWeightedEdgeOnly(cdg, bfst);
+            depth[Method_Bfst] = bfst.makespan_;
+            add_record(Method_Bfst, bfst.depth_);
+        }
 
-    PROFILER_HOOK();
-    auto mddfst = scheduler_mddfs.ScheduleWithDfstMultiWeight(cdg);
+        PROFILER_HOOK();
+        if (isMethodSelected(methods, Method_MultiWeightBfst)) {
+            method_start = std::chrono::steady_clock::now();
+            scheduler_mdbfs.ScheduleWithBfstMultiWeight(cdg, mdbfst);
+            depth[Method_MultiWeightBfst] = mdbfst.makespan_;
+            add_record(Method_MultiWeightBfst, mdbfst.depth_);
+        }
 
-    PROFILER_HOOK();
-    double global_optimal = 0;
-    if (cdg.num_nodes_ <= 5) { // only calculate global_optimal for small number of nodes
-        auto best_order = scheduler_bruteforce.ScheduleBruteForceSearch(cdg);
-        auto depth_vector = scheduler_bruteforce.GetDepthVectorFromOrder(best_order, cdg);
-        global_optimal = scheduler_bruteforce.GetEvacuationTimeFromOrder(best_order, cdg);
+        PROFILER_HOOK();
+        if (isMethodSelected(methods, Method_MultiWeightDfst)) {
+            method_start = std::chrono::steady_clock::now();
+            scheduler_mddfs.ScheduleWithDfstMultiWeight(cdg, mddfst);
+            depth[Method_MultiWeightDfst] = mddfst.makespan_;
+            add_record(Method_MultiWeightDfst, mddfst.depth_);
+        }
+
+        PROFILER_HOOK();
+        // only calculate global_optimal for small number of nodes
+        if (isMethodSelected(methods, Method_GlobalOptimal) && cdg.num_nodes_ <= 5) {
+            method_start = std::chrono::steady_clock::now();
+            scheduler_bruteforce.ScheduleBruteForceSearch(cdg, best_order);
+            depth[Method_GlobalOptimal] = scheduler_bruteforce.GetEvacuationTimeFromOrder(best_order, cdg);
+            if (records != nullptr) {
+                add_record(Method_GlobalOptimal, scheduler_bruteforce.GetDepthVectorFromOrder(best_order, cdg));
+            }
+        }
+    };
+    auto add_missed_conflicts = [&]() {
+        int num_added = 0;
+        if (isMethodSelected(methods, Method_MultiWeightBfst)) {
+            num_added += intersection.AddConflictsMissedByHorizon(mdbfst.depth_);
+        }
+        if (isMethodSelected(methods, Method_MultiWeightDfst)) {
+            num_added += intersection.AddConflictsMissedByHorizon(mddfst.depth_);
+        }
+        if (isMethodSelected(methods, Method_GlobalOptimal) && cdg.num_nodes_ <= 5) {
+            scheduler_bruteforce.GetDepthVectorFromOrder(best_order, cdg, best_order_depth_);
+            num_added += intersection.AddConflictsMissedByHorizon(best_order_depth_);
+        }
+        return num_added;
+    };
+    run_cdg_methods();
+    while (local_param.max_queueing_delay >= 0 && add_missed_conflicts() > 0) {
+        cdg.reset(false);
+        cdg.GenerateGraphFromIntersection(intersection);
+        if (local_param.activate_transitive_reduction) {
+            cdg.ReduceTransitiveEdges();
+        }
+        if (records != nullptr) {
+            records->resize(num_records);
+        }
+        run_cdg_methods();
     }
 
     PROFILER_HOOK();
-    auto fifo_tree = scheduler.ScheduleWithFIFO(intersection);
+    if (isMethodSelected(methods, Method_Fifo)) {
+        method_start = std::chrono::steady_clock::now();
+        auto &fifo = scheduler.ScheduleWithFIFO(intersection);
+        depth[Method_Fifo] = fifo.depth_;
+        if (records != nullptr) {
+            std::vector<double> depth_vector;
+            for (auto &node : fifo.nodes_) {
+                depth_vector.push_back(node->time_window_[1]);
+            }
+            add_record(Method_Fifo, depth_vector);
+        }
+    }
 
     PROFILER_HOOK();
     if (verbose) {
         std::cout << "seed: " << seed << "\n";
         std::cout << "place_holder: _ \n";
-        std::cout << "modified dfs: " << modified_dfst.edge_weighted_depth_ << "\n";
-        std::cout << "edge_weighted bfs: " << bfst.edge_weighted_depth_ << "\n";
-        std::cout << "multi_weighted bfs: " << mdbfst.edge_node_weighted_depth_ << "\n";
-        std::cout << "multi_weighted dfs: " << mddfst.edge_node_weighted_depth_ << "\n";
-        std::cout << "global_optimal: " << global_optimal << "\n";
-        std::cout << "FIFO schedule: " << fifo_tree.depth_ << "\n";
+        std::cout << "modified dfs: " << depth[Method_ModifiedDfst] << "\n";
+        std::cout << "edge_weighted bfs: " << depth[Method_Bfst] << "\n";
+        std::cout << "multi_weighted bfs: " << depth[Method_MultiWeightBfst] << "\n";
+        std::cout << "multi_weighted dfs: " << depth[Method_MultiWeightDfst] << "\n";
+        std::cout << "global_optimal: " << depth[Method_GlobalOptimal] << "\n";
+        std::cout << "FIFO schedule: " << depth[Method_Fifo] << "\n";
         std::cout << "=========================================\n";
 
     }
-    depth = std::vector<double>{0, modified_dfst.edge_weighted_depth_, bfst.edge_weighted_depth_,
-        mdbfst.edge_node_weighted_depth_, global_optimal, fifo_tree.depth_, mddfst.edge_node_weighted_depth_};
-    // for (auto &node : result_tree.nodes_)
-    //     node->printDetail();
-    return depth;
+}
+
+BatchTestStatistics::BatchTestStatistics(double unit_depth_coefficient,
+                                         const std::vector<BatchTestMethodPair> &paired_differences, unsigned methods) :
+    unit_depth_coefficient_(unit_depth_coefficient), methods_(methods),
+    sum_(kNumberOfBatchTestMethods, 0), better_count_(kNumberOfBatchTestMethods, 0), better_dfs_(kNumberOfBatchTestMethods, 0), total_test_(0),
+    depth_statistics_(kNumberOfBatchTestMethods) {
+    // a method that doesn't run reports a depth of 0, so a difference with it is left out
+    for (auto &pair : paired_differences) {
+        if (isMethodSelected(methods_, pair.first) && isMethodSelected(methods_, pair.second)) {
+            paired_differences_.push_back(pair);
+        }
+    }
+    difference_statistics_.resize(paired_differences_.size());
+}
+
+// dfs and bfs count edges only, their depths are scaled by the longest travel time to compare with the others
+void BatchTestStatistics::AddSample(const std::vector<double> &depths) {
+    double coefficient;
+    double scaled_depths[kNumberOfBatchTestMethods];
+    for (int i = 0; i < kNumberOfBatchTestMethods; i++) {
+        coefficient = 1;
+        if (i == Method_ModifiedDfst || i == Method_Bfst)
+            coefficient = unit_depth_coefficient_;
+        scaled_depths[i] = depths[i] * coefficient;
+        if (!isMethodSelected(methods_, static_cast<BatchTestMethod>(i)))
+            continue;
+        sum_[i] += depths[i] * coefficient;
+        if (isMethodSelected(methods_, Method_GlobalOptimal) && depths[i] * coefficient <= depths[Method_GlobalOptimal])
+            better_count_[i]++;
+        if (isMethodSelected(methods_, Method_ModifiedDfst) &&
+            depths[i] * coefficient <= depths[Method_ModifiedDfst] * unit_depth_coefficient_)
+            better_dfs_[i]++;
+        depth_statistics_[i].Add(scaled_depths[i]);
+    }
+    // the paired difference has a much smaller spread than either depth, so it settles first
+    for (int pair = 0; pair < paired_differences_.size(); pair++) {
+        difference_statistics_[pair].Add(scaled_depths[paired_differences_[pair].first] -
+                                         scaled_depths[paired_differences_[pair].second]);
+    }
+    total_test_++;
+}
+
+// methods that are not run never hold the run back
+bool BatchTestStatistics::hasConverged(const BatchTestOptions &options) const {
+    if (options.ci_width_ <= 0 || total_test_ < options.min_test_count_) {
+        return false;
+    }
+    for (int i = 0; i < kNumberOfBatchTestMethods; i++) {
+        if (isMethodSelected(methods_, static_cast<BatchTestMethod>(i)) &&
+            depth_statistics_[i].getConfidenceIntervalWidth(options.confidence_z_) >= options.ci_width_) {
+            return false;
+        }
+    }
+    for (auto &statistics : difference_statistics_) {
+        if (statistics.getConfidenceIntervalWidth(options.confidence_z_) >= options.ci_width_) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void BatchTestStatistics::Print(int num_nodes) const {
+    std::cout << "\n\n##################### Updated result: ##################### \n";
+    std::cout << "Total tests: " << total_test_ << ", Total node num: " << num_nodes << ". \n";
+    std::cout << "Average depths: place_holder, dfs, bfs, mdbfs, global_optimal, fifo, mddfs.\n";
+    // a ratio to a method that did not run is N/A for every method
+    auto print_row = [&](const std::vector<double> &values, bool has_reference) {
+        for (int i = 0; i < kNumberOfBatchTestMethods; i++) {
+            if (isMethodSelected(methods_, static_cast<BatchTestMethod>(i)) && has_reference) {
+                std::cout << values[i] / total_test_ << ", ";
+            }
+            else {
+                std::cout << "N/A, ";
+            }
+        }
+    };
+    print_row(sum_, true);
+    std::cout << "\n Better than Global Optimal ratio: \n";
+    print_row(std::vector<double>(better_count_.begin(), better_count_.end()), isMethodSelected(methods_, Method_GlobalOptimal));
+    std::cout << "\n Better than DFS ratio: \n";
+    print_row(std::vector<double>(better_dfs_.begin(), better_dfs_.end()), isMethodSelected(methods_, Method_ModifiedDfst));
+    std::cout << "\n";
+}
+
+void BatchTestStatistics::PrintConfidenceIntervals(double confidence_z) const {
+    std::cout << " Confidence interval width (z = " << confidence_z << "): \n";
+    for (int i = 0; i < kNumberOfBatchTestMethods; i++) {
+        if (isMethodSelected(methods_, static_cast<BatchTestMethod>(i))) {
+            std::cout << depth_statistics_[i].getConfidenceIntervalWidth(confidence_z) << ", ";
+        }
+        else {
+            std::cout << "N/A, ";
+        }
+    }
+    std::cout << "\n";
+    for (int pair = 0; pair < paired_differences_.size(); pair++) {
+        auto &statistics = difference_statistics_[pair];
+        std::cout << " " << kBatchTestMethodNames[paired_differences_[pair].first] << " - "
+                  << kBatchTestMethodNames[paired_differences_[pair].second] << ": " << statistics.mean_
+                  << " +- " << statistics.getConfidenceIntervalWidth(confidence_z) / 2 << "\n";
+    }
+}
+
+BatchWorkerPool::BatchWorkerPool(int num_threads)
+    : task_(nullptr), next_index_(0), end_index_(0), generation_(0), num_busy_workers_(0), is_stopping_(false) {
+    for (int thread_id = 1; thread_id < num_threads; thread_id++) {
+        workers_.emplace_back(&BatchWorkerPool::WorkerLoop, this);
+    }
+}
+
+BatchWorkerPool::~BatchWorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        is_stopping_ = true;
+    }
+    start_.notify_all();
+    for (auto &worker : workers_) {
+        worker.join();
+    }
+}
+
+void BatchWorkerPool::Run(long begin, long end, const std::function<void(long)> &task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        task_ = &task;
+        next_index_ = begin;
+        end_index_ = end;
+        generation_++;
+        num_busy_workers_ = workers_.size();
+    }
+    start_.notify_all();
+    RunIndices();
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [&]() { return num_busy_workers_ == 0; });
+    task_ = nullptr;
+}
+
+void BatchWorkerPool::WorkerLoop() {
+    long generation_done = 0;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        start_.wait(lock, [&]() { return is_stopping_ || generation_ != generation_done; });
+        if (is_stopping_) {
+            return;
+        }
+        generation_done = generation_;
+        lock.unlock();
+        RunIndices();
+        lock.lock();
+        if (--num_busy_workers_ == 0) {
+            done_.notify_one();
+        }
+    }
+}
+
+void BatchWorkerPool::RunIndices() {
+    for (long index = next_index_++; index < end_index_; index = next_index_++) {
+        (*task_)(index);
+    }
+}
+
+int getSampleSeed(int starting_seed, long sample_index) {
+    return static_cast<int>((static_cast<uint32_t>(starting_seed) + static_cast<uint64_t>(sample_index)) & 0x7fffffff);
 }
 
 void BatchTest(int num_nodes, int test_count, int print_interval, int starting_seed) {
+    BatchTestOptions options;
+    options.num_nodes_ = num_nodes;
+    options.test_count_ = test_count;
+    options.print_interval_ = print_interval;
+    options.starting_seed_ = starting_seed;
+    BatchTest(options);
+}
+
+namespace {
+// set by SIGINT while a batch is running, the batch stops at the next sample and keeps its checkpoint
+std::atomic<bool> batch_test_running(false);
+std::atomic<bool> batch_test_interrupted(false);
+
+const uint32_t kCheckpointMagic = 0x50434d49; // "IMCP"
+const uint32_t kCheckpointVersion = 3;
+
+template <typename T>
+void WritePod(std::ostream &out, const T &value) {
+    out.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+template <typename T>
+bool ReadPod(std::istream &in, T &value) {
+    return static_cast<bool>(in.read(reinterpret_cast<char *>(&value), sizeof(T)));
+}
+void WriteRunningStatistics(std::ostream &out, const RunningStatistics &statistics) {
+    WritePod<int64_t>(out, statistics.count_);
+    WritePod(out, statistics.mean_);
+    WritePod(out, statistics.m2_);
+}
+bool ReadRunningStatistics(std::istream &in, RunningStatistics &statistics) {
+    int64_t count;
+    if (!ReadPod(in, count) || !ReadPod(in, statistics.mean_) || !ReadPod(in, statistics.m2_)) {
+        return false;
+    }
+    statistics.count_ = count;
+    return true;
+}
+} // namespace
+
+// doubles are stored bit for bit, so a resumed run adds up to exactly the same values
+void BatchTestStatistics::Write(std::ostream &out) const {
+    WritePod<int64_t>(out, total_test_);
+    WritePod(out, unit_depth_coefficient_);
+    for (int i = 0; i < kNumberOfBatchTestMethods; i++) {
+        WritePod(out, sum_[i]);
+        WritePod<int64_t>(out, better_count_[i]);
+        WritePod<int64_t>(out, better_dfs_[i]);
+        WriteRunningStatistics(out, depth_statistics_[i]);
+    }
+    WritePod<int32_t>(out, paired_differences_.size());
+    for (int pair = 0; pair < paired_differences_.size(); pair++) {
+        WritePod<int32_t>(out, paired_differences_[pair].first);
+        WritePod<int32_t>(out, paired_differences_[pair].second);
+        WriteRunningStatistics(out, difference_statistics_[pair]);
+    }
+}
+
+bool BatchTestStatistics::Read(std::istream &in) {
+    int64_t total_test, count;
+    double unit_depth_coefficient;
+    if (!ReadPod(in, total_test) || !ReadPod(in, unit_depth_coefficient) ||
+        unit_depth_coefficient != unit_depth_coefficient_) {
+        return false;
+    }
+    total_test_ = total_test;
+    for (int i = 0; i < kNumberOfBatchTestMethods; i++) {
+        if (!ReadPod(in, sum_[i]) || !ReadPod(in, count)) {
+            return false;
+        }
+        better_count_[i] = count;
+        if (!ReadPod(in, count) || !ReadRunningStatistics(in, depth_statistics_[i])) {
+            return false;
+        }
+        better_dfs_[i] = count;
+    }
+    int32_t num_pairs, first, second;
+    if (!ReadPod(in, num_pairs) || num_pairs != paired_differences_.size()) {
+        return false;
+    }
+    for (int pair = 0; pair < num_pairs; pair++) {
+        if (!ReadPod(in, first) || !ReadPod(in, second) || first != paired_differences_[pair].first ||
+            second != paired_differences_[pair].second || !ReadRunningStatistics(in, difference_statistics_[pair])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string GetBatchOptionsKey(const BatchTestOptions &options) {
+    std::ostringstream key;
+    auto write_vector = [&](const auto &values) {
+        WritePod<uint32_t>(key, values.size());
+        for (auto value : values) {
+            WritePod(key, value);
+        }
+    };
+    auto &local_param = options.param_;
+    WritePod(key, options.methods_);
+    WritePod<int32_t>(key, local_param.num_legs);
+    write_vector(local_param.num_lanes_in_vec);
+    write_vector(local_param.num_lanes_out_vec);
+    WritePod(key, local_param.arrival_interval_avg);
+    write_vector(local_param.travel_time_range);
+    write_vector(local_param.travel_time_choice);
+    WritePod(key, local_param.kTimeWindowOffset);
+    WritePod(key, local_param.max_queueing_delay);
+    for (bool flag : {local_param.activate_precedent_offset, local_param.activate_arrival_time,
+                      local_param.activate_transitive_reduction, local_param.tie_minimum_resource_waste_first,
+                      local_param.tie_high_demand_first, local_param.tie_consider_splitting_resource,
+                      local_param.tie_more_splitted_resource_first}) {
+        WritePod<uint8_t>(key, flag);
+    }
+    WritePod<int32_t>(key, options.starting_seed_);
+    WritePod(key, options.ci_width_);
+    WritePod(key, options.confidence_z_);
+    WritePod<int64_t>(key, options.min_test_count_);
+    return key.str();
+}
+
+// written to a temporary file first and renamed, so a crash while writing keeps the previous checkpoint
+bool WriteBatchCheckpoint(const std::string &file, const std::vector<BatchCheckpointCell> &cells) {
+    std::string temporary_file = file + ".tmp";
+    {
+        std::ofstream out(temporary_file, std::ios::binary | std::ios::trunc);
+        WritePod(out, kCheckpointMagic);
+        WritePod(out, kCheckpointVersion);
+        WritePod<uint32_t>(out, cells.size());
+        for (auto &cell : cells) {
+            WritePod<int32_t>(out, cell.num_nodes_);
+            WritePod<int32_t>(out, cell.starting_seed_);
+            WritePod<int64_t>(out, cell.next_sample_);
+            WritePod<uint8_t>(out, cell.converged_);
+            WritePod<uint32_t>(out, cell.options_key_.size());
+            out.write(cell.options_key_.data(), cell.options_key_.size());
+            WritePod<uint64_t>(out, cell.record_position_.size_);
+            WritePod<uint64_t>(out, cell.record_position_.csv_size_);
+            cell.statistics_.Write(out);
+        }
+        if (!out) {
+            std::cerr << "Checkpoint " << temporary_file << " could not be written.\n";
+            return false;
+        }
+    }
+    if (std::rename(temporary_file.c_str(), file.c_str()) != 0) {
+        std::cerr << "Checkpoint " << file << " could not be replaced.\n";
+        return false;
+    }
+    return true;
+}
+
+bool ReadBatchCheckpoint(const std::string &file, std::vector<BatchCheckpointCell> &cells) {
+    std::ifstream in(file, std::ios::binary);
+    uint32_t magic, version, num_cells;
+    if (!ReadPod(in, magic) || !ReadPod(in, version) || !ReadPod(in, num_cells) ||
+        magic != kCheckpointMagic || version != kCheckpointVersion || num_cells != cells.size()) {
+        std::cerr << "Checkpoint " << file << " is missing or doesn't match the batch.\n";
+        return false;
+    }
+    for (auto &cell : cells) {
+        int32_t num_nodes, starting_seed;
+        int64_t next_sample;
+        uint8_t converged;
+        uint32_t key_size;
+        if (!ReadPod(in, num_nodes) || !ReadPod(in, starting_seed) || !ReadPod(in, next_sample) ||
+            !ReadPod(in, converged) || !ReadPod(in, key_size) || key_size != cell.options_key_.size()) {
+            std::cerr << "Checkpoint " << file << " doesn't match the batch.\n";
+            return false;
+        }
+        std::string options_key(key_size, '\0');
+        if (!in.read(&options_key[0], key_size) || options_key != cell.options_key_ || num_nodes != cell.num_nodes_ ||
+            !ReadPod(in, cell.record_position_.size_) || !ReadPod(in, cell.record_position_.csv_size_) ||
+            !cell.statistics_.Read(in)) {
+            std::cerr << "Checkpoint " << file << " was written by a batch with other options.\n";
+            return false;
+        }
+        cell.starting_seed_ = starting_seed;
+        cell.next_sample_ = next_sample;
+        cell.converged_ = converged;
+    }
+    return true;
+}
+
+// samples are run in blocks, workers take sample indices from a shared counter and write the depths into
+// the slot of the sample, then the block is added to the statistics in sample order. The seed of a sample
+// only depends on its index, so the sums are bit-identical to the single threaded run for any thread count
+BatchTestStatistics BatchTest(const BatchTestOptions &options) {
+    std::signal(SIGINT, SIGINT_signal_handler);
+    std::vector<BatchCheckpointCell> checkpoint;
+    checkpoint.push_back(BatchCheckpointCell{options.num_nodes_, options.starting_seed_, 0, false,
+        BatchTestStatistics(options.param_.travel_time_range[1], options.paired_differences_, options.methods_),
+        GetBatchOptionsKey(options)});
+    auto &statistics = checkpoint[0].statistics_;
+    if (options.resume_ && (!ReadBatchCheckpoint(options.checkpoint_file_, checkpoint) ||
+                            (options.record_writer_ && !options.record_writer_->Truncate(checkpoint[0].record_position_)))) {
+        return statistics;
+    }
+    long test_count = options.test_count_ < 0 ? INT32_MAX : options.test_count_;
+    int &starting_seed = checkpoint[0].starting_seed_;
+    if (starting_seed < 0) {
+        std::random_device rd;
+        starting_seed = rd() & 0x7fffffff;
+        std::cout << "Random starting seed: " << starting_seed << "\n";
+    }
+    int num_threads = options.num_threads_;
+    if (num_threads <= 0) {
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    long block_size = num_threads == 1 ? 1 : num_threads * kSamplesPerThreadInBlock;
+    BatchWorkerPool pool(num_threads);
+    std::vector<std::vector<double>> block_depths(block_size);
+    std::vector<std::vector<BatchTestRecord>> block_records(options.record_writer_ ? block_size : 0);
+    auto last_checkpoint = std::chrono::steady_clock::now();
+    auto save_checkpoint = [&]() {
+        if (!options.checkpoint_file_.empty()) {
+            checkpoint[0].next_sample_ = statistics.total_test_;
+            if (options.record_writer_) {
+                checkpoint[0].record_position_ = options.record_writer_->Flush();
+            }
+            WriteBatchCheckpoint(options.checkpoint_file_, checkpoint);
+            last_checkpoint = std::chrono::steady_clock::now();
+        }
+    };
+
+    // an interrupted block leaves the slots of the samples it didn't reach empty
+    std::function<void(long)> run_sample = [&](long sample_index) {
+        if (batch_test_interrupted) {
+            return;
+        }
+        std::vector<BatchTestRecord> *records = nullptr;
+        if (options.record_writer_) {
+            records = &block_records[sample_index % block_size];
+            records->clear();
+        }
+        getThreadWorkspace().RunCase(options.param_, options.num_nodes_, block_depths[sample_index % block_size], false,
+                                     getSampleSeed(starting_seed, sample_index), options.methods_, records,
+                                     options.optimal_solution_cache_);
+        if (records) {
+            for (auto &record : *records) {
+                record.geometry_ = options.geometry_id_;
+            }
+        }
+    };
+    batch_test_interrupted = false;
+    batch_test_running = true;
+    for (long block_begin = statistics.total_test_; block_begin < test_count && !checkpoint[0].converged_;
+         block_begin += block_size) {
+        long block_end = std::min(block_begin + block_size, test_count);
+        for (auto &depths : block_depths) {
+            depths.clear();
+        }
+        pool.Run(block_begin, block_end, run_sample);
+
+        // convergence is checked sample by sample in order, so the stopping sample doesn't depend on the threads
+        for (long sample_index = block_begin; sample_index < block_end; sample_index++) {
+            if (block_depths[sample_index % block_size].empty()) {
+                break;
+            }
+            statistics.AddSample(block_depths[sample_index % block_size]);
+            // records are written with the statistics, so a resumed run doesn't write a sample twice
+            if (options.record_writer_) {
+                options.record_writer_->Append(block_records[sample_index % block_size]);
+            }
+            checkpoint[0].converged_ = statistics.hasConverged(options);
+            if (options.print_interval_ > 0 &&
+                (statistics.total_test_ % options.print_interval_ == 0 || checkpoint[0].converged_)) {
+                statistics.Print(options.num_nodes_);
+                if (options.ci_width_ > 0) {
+                    statistics.PrintConfidenceIntervals(options.confidence_z_);
+                }
+            }
+            if (checkpoint[0].converged_) {
+                break;
+            }
+        }
+        if (batch_test_interrupted) {
+            std::cout << "Interrupted after " << statistics.total_test_ << " tests.\n";
+            break;
+        }
+        if (std::chrono::steady_clock::now() - last_checkpoint >= std::chrono::duration<double>(options.checkpoint_period_)) {
+            save_checkpoint();
+        }
+    }
+    batch_test_running = false;
+    save_checkpoint();
+    return statistics;
+}
+
+// the samples of every cell are cut into chunks, and the chunks of the cells with the most vehicles are handed
+// out first. A worker that is done with a chunk takes the next one from any cell, so the small cells fill the
+// gaps while the large ones are still running instead of leaving workers idle at the tail
+std::vector<BatchTestStatistics> BatchSweep(const std::vector<BatchTestOptions> &cells, int num_threads,
+                                            const std::string &checkpoint_file, bool resume, double checkpoint_period) {
     std::signal(SIGINT, SIGINT_signal_handler);
-    int number_of_methods = 7;
-    std::vector<double> sum(number_of_methods, 0);
-    std::vector<long> better_count(number_of_methods, 0);
-    std::vector<long> better_dfs(number_of_methods, 0);
-    long total_test = 0;
-    if (test_count < 0) test_count = INT32_MAX;
-    int seed_increment = 0;
-    if (starting_seed >= 0)
-        seed_increment = 1;
-
-    while (total_test < test_count) {
-        auto depths = BatchTestOneCase(num_nodes, false, starting_seed);
-        starting_seed += seed_increment;
-        double coefficient;
-        for (int i = 0; i < number_of_methods; i++) {
-            coefficient = 1;
-            if (i == 1 || i == 2)
-                coefficient = param.travel_time_range[1];
-            sum[i] += depths[i] * coefficient;
-            if (depths[i] * coefficient <= depths[4])
-                better_count[i]++;
-            if (depths[i] * coefficient <= depths[1] * param.travel_time_range[1])
-                better_dfs[i]++;
-        }
-        total_test++;
-
-        if (total_test % print_interval == 0) {
-            std::cout << "\n\n##################### Updated result: ##################### \n";
-            std::cout << "Total tests: " << total_test << ", Total node num: " << num_nodes << ". \n";
-            std::cout << "Average depths: place_holder, dfs, bfs, mdbfs, global_optimal, fifo, mddfs.\n";
-            for (int i = 0; i < number_of_methods; i++) {
-                std::cout << sum[i] / total_test << ", ";
+    if (num_threads <= 0) {
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    std::random_device rd;
+    int random_starting_seed = rd() & 0x7fffffff;
+
+    // the checkpoint holds the statistics of every cell, next_sample_ is the first sample not merged yet
+    std::vector<BatchCheckpointCell> checkpoint;
+    for (auto &cell : cells) {
+        checkpoint.push_back(BatchCheckpointCell{cell.num_nodes_,
+            cell.starting_seed_ < 0 ? random_starting_seed : cell.starting_seed_, 0, false,
+            BatchTestStatistics(cell.param_.travel_time_range[1], cell.paired_differences_, cell.methods_),
+            GetBatchOptionsKey(cell)});
+    }
+    auto get_statistics = [&]() {
+        std::vector<BatchTestStatistics> statistics;
+        for (auto &cell : checkpoint) {
+            statistics.push_back(cell.statistics_);
+        }
+        return statistics;
+    };
+    // a sweep runs every cell to its end, so it can't run one without end
+    for (int cell = 0; cell < cells.size(); cell++) {
+        if (cells[cell].test_count_ < 0) {
+            std::cerr << "Sweep cell " << cell << " has negative test count " << cells[cell].test_count_ << ".\n";
+            return get_statistics();
+        }
+    }
+    if (resume && !ReadBatchCheckpoint(checkpoint_file, checkpoint)) {
+        return get_statistics();
+    }
+    for (int cell = 0; resume && cell < cells.size(); cell++) {
+        if (cells[cell].record_writer_ && !cells[cell].record_writer_->Truncate(checkpoint[cell].record_position_)) {
+            return get_statistics();
+        }
+    }
+
+    struct Chunk {
+        int cell_;
+        long begin_;
+        long end_;
+    };
+    std::vector<Chunk> chunks;
+    for (int cell = 0; cell < cells.size(); cell++) {
+        long test_count = cells[cell].test_count_;
+        for (long begin = checkpoint[cell].next_sample_; begin < test_count && !checkpoint[cell].converged_;
+             begin += kSamplesPerThreadInBlock) {
+            chunks.push_back(Chunk{cell, begin, std::min(begin + kSamplesPerThreadInBlock, test_count)});
+        }
+    }
+    std::stable_sort(chunks.begin(), chunks.end(), [&](const Chunk &a, const Chunk &b) {
+        return cells[a.cell_].num_nodes_ > cells[b.cell_].num_nodes_;
+    });
+
+    // what a chunk ran, by sample
+    struct ChunkResult {
+        std::vector<std::vector<double>> depths_;
+        std::vector<std::vector<BatchTestRecord>> records_;
+    };
+    // every cell merges its chunks in sample order as they complete, and stops early once it converged. A
+    // cell only holds the chunks done ahead of the next one to merge, by their first sample, so the memory
+    // of a sweep grows with its workers and not with its samples
+    struct CellProgress {
+        std::mutex mutex_;
+        std::map<long, ChunkResult> done_chunks_;
+        std::atomic<bool> converged_{false};
+    };
+    std::vector<CellProgress> progress(cells.size());
+    for (int cell = 0; cell < cells.size(); cell++) {
+        progress[cell].converged_ = checkpoint[cell].converged_;
+    }
+    auto merge_chunks = [&](int cell) {
+        auto &cell_progress = progress[cell];
+        auto &cell_checkpoint = checkpoint[cell];
+        while (!cell_checkpoint.converged_) {
+            auto iter_chunk = cell_progress.done_chunks_.find(cell_checkpoint.next_sample_);
+            if (iter_chunk == cell_progress.done_chunks_.end()) {
+                break;
+            }
+            auto &result = iter_chunk->second;
+            for (long index = 0; index < result.depths_.size(); index++) {
+                cell_checkpoint.statistics_.AddSample(result.depths_[index]);
+                if (cells[cell].record_writer_) {
+                    cells[cell].record_writer_->Append(result.records_[index]);
+                }
+                if (cell_checkpoint.statistics_.hasConverged(cells[cell])) {
+                    cell_checkpoint.converged_ = true;
+                    cell_progress.converged_ = true;
+                    break;
+                }
+            }
+            cell_checkpoint.next_sample_ += result.depths_.size();
+            cell_progress.done_chunks_.erase(iter_chunk);
+        }
+        if (cell_checkpoint.converged_) {
+            cell_progress.done_chunks_.clear();
+        }
+    };
+    // one worker at a time writes the checkpoint, reading every cell under its lock
+    std::mutex checkpoint_mutex;
+    auto last_checkpoint = std::chrono::steady_clock::now();
+    // every cell stays locked until the records are flushed, so the record files hold the samples of the
+    // snapshot and none merged after it
+    auto save_checkpoint = [&]() {
+        std::vector<BatchCheckpointCell> snapshot;
+        std::vector<std::unique_lock<std::mutex>> locks;
+        for (int cell = 0; cell < cells.size(); cell++) {
+            locks.emplace_back(progress[cell].mutex_);
+            snapshot.push_back(checkpoint[cell]);
+        }
+        for (int cell = 0; cell < cells.size(); cell++) {
+            if (cells[cell].record_writer_) {
+                snapshot[cell].record_position_ = cells[cell].record_writer_->Flush();
             }
-            std::cout << "\n Better than Global Optimal ratio: \n";
-            for (int i = 0; i < number_of_methods; i++) {
-                std::cout << (double)better_count[i] / total_test << ", ";
+        }
+        locks.clear();
+        WriteBatchCheckpoint(checkpoint_file, snapshot);
+        last_checkpoint = std::chrono::steady_clock::now();
+    };
+
+    std::function<void(long)> run_chunk = [&](long chunk_id) {
+        if (batch_test_interrupted) {
+            return;
+        }
+        auto &chunk = chunks[chunk_id];
+        auto &cell = cells[chunk.cell_];
+        if (progress[chunk.cell_].converged_) {
+            return;
+        }
+        ChunkResult result;
+        result.depths_.resize(chunk.end_ - chunk.begin_);
+        if (cell.record_writer_) {
+            result.records_.resize(chunk.end_ - chunk.begin_);
+        }
+        for (long sample_index = chunk.begin_; sample_index < chunk.end_; sample_index++) {
+            auto sample_records = cell.record_writer_ ? &result.records_[sample_index - chunk.begin_] : nullptr;
+            getThreadWorkspace().RunCase(cell.param_, cell.num_nodes_, result.depths_[sample_index - chunk.begin_],
+                                         false, getSampleSeed(checkpoint[chunk.cell_].starting_seed_, sample_index),
+                                         cell.methods_, sample_records, cell.optimal_solution_cache_);
+            if (sample_records) {
+                for (auto &record : *sample_records) {
+                    record.geometry_ = cell.geometry_id_;
+                }
             }
-            std::cout << "\n Better than DFS ratio: \n";
-            for (int i = 0; i < number_of_methods; i++) {
-                std::cout << (double)better_dfs[i] / total_test << ", ";
+        }
+        {
+            std::lock_guard<std::mutex> lock(progress[chunk.cell_].mutex_);
+            progress[chunk.cell_].done_chunks_.emplace(chunk.begin_, std::move(result));
+            merge_chunks(chunk.cell_);
+        }
+        if (!checkpoint_file.empty()) {
+            std::unique_lock<std::mutex> lock(checkpoint_mutex, std::try_to_lock);
+            if (lock.owns_lock() &&
+                std::chrono::steady_clock::now() - last_checkpoint >= std::chrono::duration<double>(checkpoint_period)) {
+                save_checkpoint();
             }
-            std::cout << "\n";
         }
+    };
+    batch_test_interrupted = false;
+    batch_test_running = true;
+    BatchWorkerPool(num_threads).Run(0, chunks.size(), run_chunk);
+    batch_test_running = false;
+    if (batch_test_interrupted) {
+        std::cout << "Sweep interrupted.\n";
+    }
+    if (!checkpoint_file.empty()) {
+        save_checkpoint();
     }
+
+    std::vector<BatchTestStatistics> statistics;
+    for (auto &cell : checkpoint) {
+        statistics.push_back(cell.statistics_);
+    }
+    return statistics;
 }
 
+void PrintBatchSweepCell(const BatchTestOptions &cell) {
+    auto print_vector = [](const auto &vec) {
+        std::cout << "[";
+        for (int i = 0; i < vec.size(); i++) {
+            std::cout << (i ? ", " : "") << vec[i];
+        }
+        std::cout << "]\n";
+    };
+    std::cout << "\nintersection geospatial characteristic\n";
+    std::cout << "num_legs: " << cell.param_.num_legs << "\n";
+    std::cout << "num_lanes_in_vec: ";
+    print_vector(cell.param_.num_lanes_in_vec);
+    std::cout << "num_lanes_out_vec: ";
+    print_vector(cell.param_.num_lanes_out_vec);
+    std::cout << "arrival_interval_avg: " << cell.param_.arrival_interval_avg << "\n";
+    std::cout << "travel_time_range: ";
+    print_vector(cell.param_.travel_time_range);
+    std::cout << "methods:";
+    for (int method = 0; method < kNumberOfBatchTestMethods; method++) {
+        if (isMethodSelected(cell.methods_, static_cast<BatchTestMethod>(method))) {
+            std::cout << " " << kBatchTestMethodNames[method];
+        }
+    }
+    std::cout << "\n";
+}
+
+// the first ctrl+C lets a running batch stop at the next sample and save its checkpoint, the second one exits
 void SIGINT_signal_handler(int signal) {
+    if (batch_test_running && !batch_test_interrupted) {
+        batch_test_interrupted = true;
+        return;
+    }
     // ::time_profiler::TimeProfiler::print_statistics();
     exit(signal); // deconstruct profiler when ctrl+C
 }
-} // namespace intersection_management
\ No newline at end of file
+} // namespace intersection_management
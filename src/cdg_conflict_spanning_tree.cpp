@@ -109,23 +109,29 @@ void CDGConflictSpanningTree::PrintTree(bool verbose) {
 }
 
 double CDGConflictSpanningTree::CalculateFairnessIndex(CDGDepthType depth_type, CDGFairnessType fairness_type) {
-    std::vector<std::pair<int, double>> id_order_vec;
+    std::vector<double> depth_vector(nodes_.size(), 0.0);
     for (auto i = 1u; i < nodes_.size(); i++) {
         auto &node = nodes_[i];
-        double depth;
         switch (depth_type)
         {
         case Type_RegularDepth:
-            depth = node->depth_;
+            depth_vector[node->id_] = node->depth_;
             break;
         case Type_EdgeWeightedDepth:
-            depth = node->edge_weighted_depth_;
+            depth_vector[node->id_] = node->edge_weighted_depth_;
             break;
         case Type_EdgeNodeWeightedDepth:
-            depth = node->edge_node_weighted_depth_;
+            depth_vector[node->id_] = node->edge_node_weighted_depth_;
             break;
         }
-        id_order_vec.push_back(std::pair<int, double>{node->id_, depth});
+    }
+    return CalculateOrderFairnessIndex(depth_vector, fairness_type);
+}
+
+double CalculateOrderFairnessIndex(const std::vector<double> &depth_vector, CDGFairnessType fairness_type) {
+    std::vector<std::pair<int, double>> id_order_vec;
+    for (auto i = 1u; i < depth_vector.size(); i++) {
+        id_order_vec.push_back(std::pair<int, double>{(int)i, depth_vector[i]});
     }
     sort(id_order_vec.begin(), id_order_vec.end(),
          [](const std::pair<int, double> &p1, const std::pair<int, double> &p2) { return p1.second < p2.second; });
@@ -0,0 +1,272 @@
+#include "cdg_corpus.h"
+
+#include <iostream>
+
+namespace intersection_management {
+
+namespace {
+const size_t kFileHeaderSize = 16;
+const size_t kGraphHeaderSize = 16;
+const size_t kFooterSize = 24;
+
+inline size_t PaddedSize(size_t size) {
+    return (size + 7) & ~size_t(7);
+}
+
+template <typename T>
+void WritePod(std::ostream &out, const T &value) {
+    out.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+uint32_t getEdgeFlags(Edge &edge) {
+    uint32_t flags = 0;
+    flags |= edge.bidirectional_ ? kCorpusEdgeBidirectional : 0;
+    flags |= edge.conflict_type_.isDiverging() ? kCorpusEdgeDiverging : 0;
+    flags |= edge.conflict_type_.isConverging() ? kCorpusEdgeConverging : 0;
+    flags |= edge.conflict_type_.isCrossing() ? kCorpusEdgeCrossing : 0;
+    flags |= edge.conflict_type_.isCompeting() ? kCorpusEdgeCompeting : 0;
+    flags |= edge.conflict_type_.isPrecedence() ? kCorpusEdgePrecedence : 0;
+    return flags;
+}
+} // namespace
+
+CDGCorpusWriter::CDGCorpusWriter(const std::string &file) : out_(file, std::ios::binary | std::ios::trunc), offset_(0) {
+    if (!out_) {
+        std::cerr << "Corpus " << file << " could not be opened.\n";
+        return;
+    }
+    WritePod(out_, kCDGCorpusMagic);
+    WritePod(out_, kCDGCorpusVersion);
+    WritePod<uint64_t>(out_, 0);
+    offset_ = kFileHeaderSize;
+}
+
+CDGCorpusWriter::~CDGCorpusWriter() {
+    Close();
+}
+
+// every array starts 8 byte aligned, so the reader can use it in place
+template <typename T>
+void CDGCorpusWriter::WriteArray(const std::vector<T> &array) {
+    size_t size = array.size() * sizeof(T);
+    out_.write(reinterpret_cast<const char *>(array.data()), size);
+    static const char kPadding[8] = {0};
+    out_.write(kPadding, PaddedSize(size) - size);
+    offset_ += PaddedSize(size);
+}
+
+void CDGCorpusWriter::Append(const ConflictDirectedGraph &cdg) {
+    if (!out_.is_open()) {
+        return;
+    }
+    int num_nodes = cdg.num_nodes_;
+    node_doubles_.resize(2 * num_nodes);
+    node_ints_.resize(4 * num_nodes);
+    edge_offset_.assign(1, 0);
+    edge_doubles_.clear();
+    edge_ints_.clear();
+    edge_flags_.clear();
+    for (int id = 0; id < num_nodes; id++) {
+        auto &node = *cdg.nodes_[id];
+        node_doubles_[id] = node.estimate_travel_time_;
+        node_doubles_[num_nodes + id] = node.estimate_arrival_time_;
+        node_ints_[id] = node.in_lane_id_;
+        node_ints_[num_nodes + id] = node.in_leg_id_;
+        node_ints_[2 * num_nodes + id] = node.out_lane_id_;
+        node_ints_[3 * num_nodes + id] = node.out_leg_id_;
+        edge_offset_.push_back(edge_offset_.back() + node.edges_.size());
+    }
+    // per edge arrays are laid out one after another, gathered here in two passes over the edges
+    int num_edges = edge_offset_.back();
+    edge_doubles_.resize(2 * num_edges);
+    edge_ints_.resize(2 * num_edges);
+    edge_flags_.resize(num_edges);
+    int edge_index = 0;
+    for (int id = 0; id < num_nodes; id++) {
+        for (auto &edge : cdg.nodes_[id]->edges_) {
+            edge_doubles_[edge_index] = edge->edge_weight_;
+            edge_doubles_[num_edges + edge_index] = edge->estimate_offset_;
+            edge_ints_[edge_index] = edge->node2_.lock()->id_;
+            edge_ints_[num_edges + edge_index] = edge->predecessor_id_;
+            edge_flags_[edge_index] = getEdgeFlags(*edge);
+            edge_index++;
+        }
+    }
+
+    graph_offset_.push_back(offset_);
+    WritePod<uint32_t>(out_, num_nodes);
+    WritePod<uint32_t>(out_, num_edges);
+    WritePod<int32_t>(out_, cdg.fairness_order_diff_threshold_);
+    WritePod<uint32_t>(out_, 0);
+    offset_ += kGraphHeaderSize;
+    WriteArray(node_doubles_);
+    WriteArray(node_ints_);
+    WriteArray(edge_offset_);
+    WriteArray(edge_doubles_);
+    WriteArray(edge_ints_);
+    WriteArray(edge_flags_);
+}
+
+bool CDGCorpusWriter::Close() {
+    if (!out_.is_open()) {
+        return false;
+    }
+    uint64_t index_offset = offset_;
+    out_.write(reinterpret_cast<const char *>(graph_offset_.data()), graph_offset_.size() * sizeof(uint64_t));
+    WritePod(out_, index_offset);
+    WritePod<uint64_t>(out_, graph_offset_.size());
+    WritePod(out_, kCDGCorpusMagic);
+    WritePod(out_, kCDGCorpusVersion);
+    bool is_written = static_cast<bool>(out_);
+    out_.close();
+    if (!is_written) {
+        std::cerr << "Corpus could not be written.\n";
+    }
+    return is_written;
+}
+
+CDGCorpusReader::CDGCorpusReader(const std::string &file) : num_graphs_(0), graph_offset_(nullptr) {
+    if (!file_.Open(file) || file_.size() < kFileHeaderSize + kFooterSize) {
+        std::cerr << "Corpus " << file << " is missing or too short.\n";
+        file_.Close();
+        return;
+    }
+    auto header = reinterpret_cast<const uint32_t *>(file_.data());
+    auto footer = file_.data() + file_.size() - kFooterSize;
+    uint64_t index_offset = *reinterpret_cast<const uint64_t *>(footer);
+    uint64_t num_graphs = *reinterpret_cast<const uint64_t *>(footer + 8);
+    auto footer_tag = reinterpret_cast<const uint32_t *>(footer + 16);
+    // the index fills the space up to the footer exactly, compared without sums that could overflow
+    uint64_t index_end = file_.size() - kFooterSize;
+    if (header[0] != kCDGCorpusMagic || header[1] != kCDGCorpusVersion || footer_tag[0] != kCDGCorpusMagic ||
+        footer_tag[1] != kCDGCorpusVersion || index_offset < kFileHeaderSize || index_offset > index_end ||
+        index_offset % 8 != 0 || (index_end - index_offset) / sizeof(uint64_t) != num_graphs ||
+        (index_end - index_offset) % sizeof(uint64_t) != 0) {
+        std::cerr << "Corpus " << file << " has an unknown format or was not closed.\n";
+        file_.Close();
+        return;
+    }
+    graph_offset_ = reinterpret_cast<const uint64_t *>(file_.data() + index_offset);
+    for (uint64_t index = 0; index < num_graphs; index++) {
+        if (!isValidGraph(graph_offset_[index], index_offset)) {
+            std::cerr << "Corpus " << file << " is corrupt at graph " << index << ".\n";
+            file_.Close();
+            graph_offset_ = nullptr;
+            return;
+        }
+    }
+    num_graphs_ = num_graphs;
+}
+
+// the graph and its arrays lie between the file header and end, the CSR offsets ascend from 0 to the edge
+// count and every edge targets a node of the graph, so nothing read through the view leaves the mapping
+bool CDGCorpusReader::isValidGraph(uint64_t offset, uint64_t end) const {
+    if (offset < kFileHeaderSize || offset % 8 != 0 || offset > end || end - offset < kGraphHeaderSize) {
+        return false;
+    }
+    auto graph = ViewGraph(offset);
+    uint64_t n = graph.num_nodes_;
+    uint64_t m = graph.num_edges_;
+    uint64_t size = kGraphHeaderSize + PaddedSize(2 * n * sizeof(double)) + PaddedSize(4 * n * sizeof(int32_t)) +
+                    PaddedSize((n + 1) * sizeof(uint32_t)) + PaddedSize(2 * m * sizeof(double)) +
+                    PaddedSize(2 * m * sizeof(int32_t)) + PaddedSize(m * sizeof(uint32_t));
+    if (n == 0 || end - offset < size || graph.edge_offset_[0] != 0 || graph.edge_offset_[n] != m) {
+        return false;
+    }
+    for (uint64_t id = 0; id < n; id++) {
+        if (graph.edge_offset_[id] > graph.edge_offset_[id + 1]) {
+            return false;
+        }
+    }
+    for (uint64_t k = 0; k < m; k++) {
+        if (graph.edge_target_[k] < 0 || static_cast<uint64_t>(graph.edge_target_[k]) >= n) {
+            return false;
+        }
+    }
+    return true;
+}
+
+CDGCorpusGraph CDGCorpusReader::ViewGraph(uint64_t offset) const {
+    const char *data = file_.data() + offset;
+    CDGCorpusGraph graph;
+    graph.num_nodes_ = *reinterpret_cast<const uint32_t *>(data);
+    graph.num_edges_ = *reinterpret_cast<const uint32_t *>(data + 4);
+    graph.fairness_order_diff_threshold_ = *reinterpret_cast<const int32_t *>(data + 8);
+    data += kGraphHeaderSize;
+    size_t n = graph.num_nodes_;
+    size_t m = graph.num_edges_;
+    auto next_array = [&data](size_t size) {
+        const char *begin = data;
+        data += PaddedSize(size);
+        return begin;
+    };
+    auto node_doubles = reinterpret_cast<const double *>(next_array(2 * n * sizeof(double)));
+    auto node_ints = reinterpret_cast<const int32_t *>(next_array(4 * n * sizeof(int32_t)));
+    graph.edge_offset_ = reinterpret_cast<const uint32_t *>(next_array((n + 1) * sizeof(uint32_t)));
+    auto edge_doubles = reinterpret_cast<const double *>(next_array(2 * m * sizeof(double)));
+    auto edge_ints = reinterpret_cast<const int32_t *>(next_array(2 * m * sizeof(int32_t)));
+    graph.edge_flags_ = reinterpret_cast<const uint32_t *>(next_array(m * sizeof(uint32_t)));
+    graph.estimate_travel_time_ = node_doubles;
+    graph.estimate_arrival_time_ = node_doubles + n;
+    graph.in_lane_id_ = node_ints;
+    graph.in_leg_id_ = node_ints + n;
+    graph.out_lane_id_ = node_ints + 2 * n;
+    graph.out_leg_id_ = node_ints + 3 * n;
+    graph.edge_weight_ = edge_doubles;
+    graph.estimate_offset_ = edge_doubles + m;
+    graph.edge_target_ = edge_ints;
+    graph.predecessor_id_ = edge_ints + m;
+    return graph;
+}
+
+bool CDGCorpusReader::getGraph(uint64_t index, CDGCorpusGraph &graph) const {
+    if (index >= num_graphs_) {
+        std::cerr << "Graph " << index << " is not in the corpus of " << num_graphs_ << " graphs.\n";
+        return false;
+    }
+    graph = ViewGraph(graph_offset_[index]);
+    return true;
+}
+
+// edges are added in CSR order, which keeps the order of the outgoing edges of every node
+bool CDGCorpusReader::LoadGraph(uint64_t index, ConflictDirectedGraph &cdg) const {
+    CDGCorpusGraph graph;
+    if (!getGraph(index, graph)) {
+        return false;
+    }
+    cdg.reset(false);
+    cdg.nodes_.reserve(graph.num_nodes_);
+    cdg.edges_.reserve(graph.num_edges_);
+    for (uint32_t id = 0; id < graph.num_nodes_; id++) {
+        if (id > 0) {
+            cdg.AddNode(graph.estimate_travel_time_[id]);
+        }
+        auto &node = *cdg.nodes_[id];
+        node.estimate_travel_time_ = graph.estimate_travel_time_[id];
+        node.estimate_arrival_time_ = graph.estimate_arrival_time_[id];
+        node.in_lane_id_ = graph.in_lane_id_[id];
+        node.in_leg_id_ = graph.in_leg_id_[id];
+        node.out_lane_id_ = graph.out_lane_id_[id];
+        node.out_leg_id_ = graph.out_leg_id_[id];
+    }
+    for (uint32_t from = 0; from < graph.num_nodes_; from++) {
+        for (uint32_t k = graph.edge_offset_[from]; k < graph.edge_offset_[from + 1]; k++) {
+            uint32_t flags = graph.edge_flags_[k];
+            auto edge = std::make_shared<Edge>(cdg.nodes_[from], cdg.nodes_[graph.edge_target_[k]],
+                                               graph.edge_weight_[k], (flags & kCorpusEdgeBidirectional) != 0);
+            edge->estimate_offset_ = graph.estimate_offset_[k];
+            edge->predecessor_id_ = graph.predecessor_id_[k];
+            edge->conflict_type_.diverging_ = flags & kCorpusEdgeDiverging;
+            edge->conflict_type_.converging_ = flags & kCorpusEdgeConverging;
+            edge->conflict_type_.crossing_ = flags & kCorpusEdgeCrossing;
+            edge->conflict_type_.competing_ = flags & kCorpusEdgeCompeting;
+            edge->conflict_type_.precedence_ = flags & kCorpusEdgePrecedence;
+            cdg.nodes_[from]->edges_.push_back(edge);
+            cdg.edges_.push_back(edge);
+        }
+    }
+    cdg.fairness_order_diff_threshold_ = graph.fairness_order_diff_threshold_;
+    return true;
+}
+
+} // namespace intersection_management
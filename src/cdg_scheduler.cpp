@@ -1,349 +1,428 @@
 #include "cdg_scheduler.h"
 
 #include <iostream>
+#include <limits>
 
 #include "parameters.h"
 
 namespace intersection_management {
-CDGScheduler::CDGScheduler() {}
-
-CDGConflictSpanningTree CDGScheduler::ScheduleWithModifiedDfst(const ConflictDirectedGraph &cdg) {
-    PrepareForTreeSchedule(cdg);
+FairnessWindow::FairnessWindow() {
+    fairness_edge_ = std::make_shared<Edge>(nullptr, nullptr, kFairnessEdgeWeight, false);
+    reset(0, 0);
+}
 
-    std::vector<bool> added_to_tree(cdg.num_nodes_, false);
-    added_to_tree[0] = true;
+void FairnessWindow::reset(int num_nodes, int order_diff_threshold) {
+    order_diff_threshold_ = order_diff_threshold;
+    scheduled_prefix_ = 0;
+    scheduled_.assign(num_nodes, false);
+    num_leaves_ = 1;
+    while (num_leaves_ < num_nodes) {
+        num_leaves_ *= 2;
+    }
+    tree_.assign(isActive() ? 2 * num_leaves_ : 0, TreeEntry{-std::numeric_limits<double>::infinity(), -1, 0});
+}
 
-    std::vector<std::shared_ptr<Node>> unidirectional_scheduled_parent;
-    std::vector<std::shared_ptr<Node>> bidirectional_scheduled_parent;
-    int id_possible_parent;
-    int possible_depth;
-    std::shared_ptr<Edge> edge_from_possible_parent;
+void FairnessWindow::MarkScheduled(int id, double depth) {
+    if (!isActive()) {
+        return;
+    }
+    scheduled_[id] = true;
+    while (scheduled_prefix_ < scheduled_.size() && scheduled_[scheduled_prefix_]) {
+        scheduled_prefix_++;
+    }
+    if (id == 0) { // root is not part of the fairness order
+        return;
+    }
+    int index = num_leaves_ + id;
+    tree_[index] = TreeEntry{depth, id, 1};
+    for (index /= 2; index > 0; index /= 2) {
+        tree_[index] = Combine(tree_[2 * index], tree_[2 * index + 1]);
+    }
+}
 
-    for (int id = 1; id < result_tree_.num_nodes_; id++) {
-        unidirectional_scheduled_parent.clear();
-        bidirectional_scheduled_parent.clear();
-        id_possible_parent = -1;
-        possible_depth = -1;
-        edge_from_possible_parent = nullptr;
-        for (int from = 0; from < result_tree_.num_nodes_; from++) {
-            if (!added_to_tree[from]) {
-                continue;
-            }
-            if (cdg.nodes_[from]->isConnectedTo(id)) {
-                auto edge = cdg.nodes_[from]->getEdgeTo(id);
-                if (edge->bidirectional_) {
-                    bidirectional_scheduled_parent.push_back(result_tree_.nodes_[from]);
-                }
-                else {
-                    unidirectional_scheduled_parent.push_back(result_tree_.nodes_[from]);
-                    if (edge->edge_weight_ + result_tree_.nodes_[from]->edge_weighted_depth_ > possible_depth) {
-                        possible_depth = edge->edge_weight_ + result_tree_.nodes_[from]->edge_weighted_depth_;
-                        id_possible_parent = from;
-                        edge_from_possible_parent = edge;
-                    }
-                }
-            }
+FairnessWindow::TreeEntry FairnessWindow::Query(int begin, int end) const {
+    TreeEntry left{-std::numeric_limits<double>::infinity(), -1, 0}, right = left;
+    for (begin += num_leaves_, end += num_leaves_; begin < end; begin /= 2, end /= 2) {
+        if (begin & 1) {
+            left = Combine(left, tree_[begin++]);
         }
-
-        // if only connected by bidirectional edges, initiate possible depth with the smallest one
-        if (id_possible_parent == -1) {
-            int min_depth_parent_id;
-            int min_depth;
-            id_possible_parent = bidirectional_scheduled_parent.front()->id_;
-            edge_from_possible_parent = cdg.nodes_[id_possible_parent]->getEdgeTo(id);
-            possible_depth = bidirectional_scheduled_parent.front()->edge_weighted_depth_ + edge_from_possible_parent->edge_weight_;
-            for (auto parent : bidirectional_scheduled_parent) {
-                auto edge = cdg.nodes_[parent->id_]->getEdgeTo(id);
-                if (parent->edge_weighted_depth_ + edge->edge_weight_ < possible_depth) {
-                    id_possible_parent = parent->id_;
-                    possible_depth = parent->edge_weighted_depth_ + edge->edge_weight_;
-                    edge_from_possible_parent = edge;
-                }
-            }
+        if (end & 1) {
+            right = Combine(tree_[--end], right);
         }
+    }
+    return Combine(left, right);
+}
 
-        // update conflicts with other bidirectional edges
-        bool flag_still_conflict_with_bidire_scheduled_neighbor;
-        do {
-            flag_still_conflict_with_bidire_scheduled_neighbor = false;
-            for (auto parent : bidirectional_scheduled_parent) {
-                auto edge = cdg.nodes_[parent->id_]->getEdgeTo(id);
-                if (parent->edge_weighted_depth_ - edge->edge_weight_ < possible_depth && \
-                    possible_depth < parent->edge_weighted_depth_ + edge->edge_weight_) {
-                    id_possible_parent = parent->id_;
-                    possible_depth = parent->edge_weighted_depth_ + edge->edge_weight_;
-                    edge_from_possible_parent = edge;
-                    flag_still_conflict_with_bidire_scheduled_neighbor = true;
-                }
-            }
-        } while (flag_still_conflict_with_bidire_scheduled_neighbor);
+void FairnessWindow::CollectLinkedNodes(int id, const CDGScheduleWorkspace &workspace) const {
+    int last = id - order_diff_threshold_;
+    linked_.clear();
+    int parent = workspace.parent_offset_[id], parent_end = workspace.parent_offset_[id + 1];
+    int neighbor = workspace.neighbor_offset_[id], neighbor_end = workspace.neighbor_offset_[id + 1];
+    // both are sorted by source id
+    while (true) {
+        bool has_parent = parent < parent_end && workspace.parents_[parent].id_ <= last;
+        bool has_neighbor = neighbor < neighbor_end && workspace.neighbors_[neighbor].id_ <= last;
+        if (!has_parent && !has_neighbor) {
+            break;
+        }
+        int from;
+        if (!has_neighbor || (has_parent && workspace.parents_[parent].id_ < workspace.neighbors_[neighbor].id_)) {
+            from = workspace.parents_[parent++].id_;
+        }
+        else {
+            from = workspace.neighbors_[neighbor++].id_;
+        }
+        if (from > 0 && (linked_.empty() || linked_.back() != from)) {
+            linked_.push_back(from);
+        }
+    }
+}
 
-        added_to_tree[id] = true;
-        result_tree_.AddEdge(id_possible_parent, id, edge_from_possible_parent->edge_weight_);
-        result_tree_.UpdateDepth(id, possible_depth, Type_EdgeWeightedDepth);
+bool FairnessWindow::isReleased(int id, const CDGScheduleWorkspace &workspace) const {
+    if (!hasReleaseParent(id) || id - order_diff_threshold_ < scheduled_prefix_) {
+        return true;
+    }
+    int last = id - order_diff_threshold_;
+    CollectLinkedNodes(id, workspace);
+    int num_linked_unscheduled = 0;
+    for (int from : linked_) {
+        num_linked_unscheduled += !scheduled_[from];
     }
+    return last - Query(1, last + 1).num_scheduled_ == num_linked_unscheduled;
+}
 
-    return result_tree_;
+bool FairnessWindow::getReleaseParent(int id, const CDGScheduleWorkspace &workspace, int &parent,
+                                      double &depth) const {
+    if (!hasReleaseParent(id)) {
+        return false;
+    }
+    int last = id - order_diff_threshold_;
+    CollectLinkedNodes(id, workspace);
+    TreeEntry deepest{-std::numeric_limits<double>::infinity(), -1, 0};
+    int begin = 1;
+    for (int from : linked_) {
+        deepest = Combine(deepest, Query(begin, from));
+        begin = from + 1;
+    }
+    deepest = Combine(deepest, Query(begin, last + 1));
+    if (deepest.id_ < 0) {
+        return false;
+    }
+    parent = deepest.id_;
+    depth = deepest.depth_;
+    return true;
 }
 
-CDGConflictSpanningTree CDGScheduler::ScheduleWithBfstWeightedEdgeOnly(const ConflictDirectedGraph &cdg) {
-    PrepareForTreeSchedule(cdg);
+CDGScheduleResult::CDGScheduleResult() {
+    reset(0, Type_EdgeWeightedDepth);
+}
 
-    std::vector<CDGCandidate> ready_list;
-    std::vector<bool> added_to_tree(cdg.num_nodes_, false);
-    CDGCandidate initial_root(0, 0, -1, -1);
-    ready_list.push_back(initial_root);
+void CDGScheduleResult::reset(int num_nodes, CDGDepthType depth_type) {
+    depth_type_ = depth_type;
+    parent_id_.assign(num_nodes, -1);
+    parent_edge_weight_.assign(num_nodes, 0.0);
+    depth_.assign(num_nodes, -1.0);
+    order_.clear();
+    makespan_ = -1;
+}
 
-    while (!ready_list.empty()) {
-        CDGCandidate chosen_candidate = ready_list[0];
-        added_to_tree[chosen_candidate.id_] = true;
-        result_tree_.UpdateDepth(chosen_candidate.id_, chosen_candidate.possible_depth_, Type_EdgeWeightedDepth);
-        if (chosen_candidate.id_ > 0) {
-            result_tree_.AddEdge(chosen_candidate.id_possible_parent_, chosen_candidate.id_, chosen_candidate.edge_weight_);
+CDGConflictSpanningTree CDGScheduleResult::MaterializeTree(const ConflictDirectedGraph &cdg) const {
+    CDGConflictSpanningTree tree;
+    tree.AddNodesFromGraph(cdg);
+    for (int id : order_) {
+        tree.UpdateDepth(id, depth_[id], depth_type_);
+        if (id > 0) {
+            tree.AddEdge(parent_id_[id], id, parent_edge_weight_[id]);
         }
-        ready_list.erase(ready_list.begin());
+    }
+    return tree;
+}
 
-        auto iter_ready_candidate = ready_list.begin();
-        while (iter_ready_candidate != ready_list.end()) {
-            if (cdg.nodes_[chosen_candidate.id_]->isConnectedTo(iter_ready_candidate->id_)) {
-                if (chosen_candidate.possible_depth_ + cdg.nodes_[chosen_candidate.id_]->getEdgeTo(iter_ready_candidate->id_)->edge_weight_ > \
-                    iter_ready_candidate->possible_depth_) {
-                    iter_ready_candidate = ready_list.erase(iter_ready_candidate);
-                    continue;
-                }
+void CDGScheduleWorkspace::reset(const ConflictDirectedGraph &cdg) {
+    int num_nodes = cdg.num_nodes_;
+    added_to_tree_.assign(num_nodes, false);
+    in_ready_list_.assign(num_nodes, false);
+    ready_list_.clear();
+    bidirectional_scheduled_parent_.clear();
+
+    // outgoing edges come straight from the nodes, incoming ones are counted first then filled by source id
+    child_offset_.assign(num_nodes + 1, 0);
+    parent_offset_.assign(num_nodes + 1, 0);
+    neighbor_offset_.assign(num_nodes + 1, 0);
+    for (int from = 0; from < num_nodes; from++) {
+        child_offset_[from + 1] = child_offset_[from] + cdg.nodes_[from]->edges_.size();
+    }
+    children_.resize(child_offset_[num_nodes]);
+    for (int from = 0; from < num_nodes; from++) {
+        int child = child_offset_[from];
+        for (auto &edge : cdg.nodes_[from]->edges_) {
+            int to = edge->node2_.lock()->id_;
+            children_[child++] = CDGAdjacentEdge{to, edge.get()};
+            if (edge->bidirectional_) {
+                neighbor_offset_[to + 1]++;
+            }
+            else {
+                parent_offset_[to + 1]++;
             }
-            iter_ready_candidate++;
         }
-
-        for (int to = 1; to < result_tree_.num_nodes_; to++) {
-            if (added_to_tree[to] || isInList(to, ready_list) || !cdg.nodes_[chosen_candidate.id_]->isConnectedTo(to)) {
-                continue;
+    }
+    for (int id = 0; id < num_nodes; id++) {
+        parent_offset_[id + 1] += parent_offset_[id];
+        neighbor_offset_[id + 1] += neighbor_offset_[id];
+    }
+    parents_.resize(parent_offset_[num_nodes]);
+    neighbors_.resize(neighbor_offset_[num_nodes]);
+    parent_cursor_.assign(parent_offset_.begin(), parent_offset_.end());
+    neighbor_cursor_.assign(neighbor_offset_.begin(), neighbor_offset_.end());
+    for (int from = 0; from < num_nodes; from++) {
+        for (int child = child_offset_[from]; child < child_offset_[from + 1]; child++) {
+            int to = children_[child].id_;
+            if (children_[child].edge_->bidirectional_) {
+                neighbors_[neighbor_cursor_[to]++] = CDGAdjacentEdge{from, children_[child].edge_};
             }
-            if (StillHasUnscheduledPredecessor(unidirectional_parent_table_[to], added_to_tree)) {
-                continue;
+            else {
+                parents_[parent_cursor_[to]++] = CDGAdjacentEdge{from, children_[child].edge_};
             }
+        }
+        std::sort(children_.begin() + child_offset_[from], children_.begin() + child_offset_[from + 1],
+                  [](const CDGAdjacentEdge &a, const CDGAdjacentEdge &b) { return a.id_ < b.id_; });
+    }
+}
 
-            double edge_weight = cdg.nodes_[chosen_candidate.id_]->getEdgeTo(to)->edge_weight_;
-            CDGCandidate new_candidate(to, chosen_candidate.possible_depth_ + edge_weight, chosen_candidate.id_, edge_weight);
+CDGScheduler::CDGScheduler() : optimal_solution_cache_(nullptr) {
+    InitializeFromLocalParam(param);
+}
 
-            // update new_candidate and solve conflict with already scheduled nodes (both uni- and bi-directional)
-            for (auto parent : unidirectional_parent_table_[to]) {
-                edge_weight = parent->getEdgeTo(to)->edge_weight_;
-                if (result_tree_.nodes_[parent->id_]->edge_weighted_depth_ + edge_weight > new_candidate.possible_depth_) {
-                    new_candidate.possible_depth_ = result_tree_.nodes_[parent->id_]->edge_weighted_depth_ + edge_weight;
-                    new_candidate.id_possible_parent_ = parent->id_;
-                    new_candidate.edge_weight_ = edge_weight;
-                }
-            }
-            bool flag_still_conflict_with_bidire_scheduled_neighbor;
-            do {
-                flag_still_conflict_with_bidire_scheduled_neighbor = false;
-                for (auto neighbor : bidirectional_neighbor_table_[to]) {
-                    if (!added_to_tree[neighbor->id_]) {
-                        continue;
-                    }
-                    edge_weight = neighbor->getEdgeTo(to)->edge_weight_;
-                    if (new_candidate.possible_depth_ > result_tree_.nodes_[neighbor->id_]->edge_weighted_depth_ - edge_weight &&
-                        new_candidate.possible_depth_ < result_tree_.nodes_[neighbor->id_]->edge_weighted_depth_ + edge_weight) {
-                        flag_still_conflict_with_bidire_scheduled_neighbor = true;
-                        new_candidate.possible_depth_ = result_tree_.nodes_[neighbor->id_]->edge_weighted_depth_ + edge_weight;
-                        new_candidate.id_possible_parent_ = neighbor->id_;
-                        new_candidate.edge_weight_ = edge_weight;
-                    }
-                }
-            } while (flag_still_conflict_with_bidire_scheduled_neighbor);
-            ready_list.push_back(new_candidate);
+CDGScheduler::CDGScheduler(const Parameters &local_param) : optimal_solution_cache_(nullptr) {
+    InitializeFromLocalParam(local_param);
+}
 
-        }
-        SortReadyListAscendingly(ready_list);
-    }
+void CDGScheduler::InitializeFromLocalParam(const Parameters &local_param) {
+    activate_precedent_offset_ = local_param.activate_precedent_offset;
+}
 
-    return result_tree_;
+CDGConflictSpanningTree CDGScheduler::ScheduleWithModifiedDfst(const ConflictDirectedGraph &cdg) {
+    ScheduleWithModifiedDfst(cdg, result_);
+    return result_.MaterializeTree(cdg);
+}
+
+CDGConflictSpanningTree CDGScheduler::ScheduleWithBfstWeightedEdgeOnly(const ConflictDirectedGraph &cdg) {
+    ScheduleWithBfstWeightedEdgeOnly(cdg, result_);
+    return result_.MaterializeTree(cdg);
 }
 
 CDGConflictSpanningTree CDGScheduler::ScheduleWithBfstMultiWeight(const ConflictDirectedGraph &cdg) {
+    ScheduleWithBfstMultiWeight(cdg, result_);
+    return result_.MaterializeTree(cdg);
+}
+
+CDGConflictSpanningTree CDGScheduler::ScheduleWithDfstMultiWeight(const ConflictDirectedGraph &cdg) {
+    ScheduleWithDfstMultiWeight(cdg, result_);
+    return result_.MaterializeTree(cdg);
+}
+
+void CDGScheduler::ScheduleWithModifiedDfst(const ConflictDirectedGraph &cdg, CDGScheduleResult &result) {
+    ScheduleWithSpanningTree<DepthFirstTraversal, EdgeWeightedDepthPolicy, RawWeightPolicy>(cdg, result);
+}
+
+void CDGScheduler::ScheduleWithBfstWeightedEdgeOnly(const ConflictDirectedGraph &cdg, CDGScheduleResult &result) {
+    ScheduleWithSpanningTree<BreadthFirstTraversal, EdgeWeightedDepthPolicy, RawWeightPolicy>(cdg, result);
+}
+
+void CDGScheduler::ScheduleWithBfstMultiWeight(const ConflictDirectedGraph &cdg, CDGScheduleResult &result) {
+    if (activate_precedent_offset_) {
+        ScheduleWithSpanningTree<BreadthFirstTraversal, EdgeNodeWeightedDepthPolicy, MultiWeightPolicy<true>>(cdg, result);
+    }
+    else {
+        ScheduleWithSpanningTree<BreadthFirstTraversal, EdgeNodeWeightedDepthPolicy, MultiWeightPolicy<false>>(cdg, result);
+    }
+}
+
+void CDGScheduler::ScheduleWithDfstMultiWeight(const ConflictDirectedGraph &cdg, CDGScheduleResult &result) {
+    if (activate_precedent_offset_) {
+        ScheduleWithSpanningTree<DepthFirstTraversal, EdgeNodeWeightedDepthPolicy, MultiWeightPolicy<true>>(cdg, result);
+    }
+    else {
+        ScheduleWithSpanningTree<DepthFirstTraversal, EdgeNodeWeightedDepthPolicy, MultiWeightPolicy<false>>(cdg, result);
+    }
+}
+
+template <typename Traversal, typename DepthPolicy, typename WeightPolicy>
+void CDGScheduler::ScheduleWithSpanningTree(const ConflictDirectedGraph &cdg, CDGScheduleResult &result) {
     PrepareForTreeSchedule(cdg);
+    result.reset(cdg.num_nodes_, DepthPolicy::kDepthType);
+    if constexpr (Traversal::kBreadthFirst) {
+        BuildBreadthFirstTree<DepthPolicy, WeightPolicy>(cdg, result);
+    }
+    else {
+        BuildDepthFirstTree<DepthPolicy, WeightPolicy>(cdg, result);
+    }
+}
 
-    std::vector<CDGCandidate> ready_list;
-    std::vector<bool> added_to_tree(cdg.num_nodes_, false);
-    CDGCandidate initial_root(0, 0, -1, -1, -1);
-    ready_list.push_back(initial_root);
+// grow the tree from the ready list, always scheduling the candidate with the smallest possible depth
+template <typename DepthPolicy, typename WeightPolicy>
+void CDGScheduler::BuildBreadthFirstTree(const ConflictDirectedGraph &cdg, CDGScheduleResult &result) {
+    auto &ready_list = workspace_.ready_list_;
+    auto &added_to_tree = workspace_.added_to_tree_;
+    auto &in_ready_list = workspace_.in_ready_list_;
+    ready_list.push_back(CDGCandidate(0, 0, -1, -1, -1));
+    in_ready_list[0] = true;
 
     while (!ready_list.empty()) {
         CDGCandidate chosen_candidate = ready_list[0];
         added_to_tree[chosen_candidate.id_] = true;
-        result_tree_.UpdateDepth(chosen_candidate.id_, chosen_candidate.possible_depth_, Type_EdgeNodeWeightedDepth);
-        if (chosen_candidate.id_ > 0) {
-            result_tree_.AddEdge(chosen_candidate.id_possible_parent_, chosen_candidate.id_, chosen_candidate.edge_weight_);
-        }
+        in_ready_list[chosen_candidate.id_] = false;
+        fairness_window_.MarkScheduled(chosen_candidate.id_, chosen_candidate.possible_depth_);
+        result.UpdateDepth(chosen_candidate.id_, chosen_candidate.id_possible_parent_, chosen_candidate.edge_weight_,
+                           chosen_candidate.possible_depth_);
         ready_list.erase(ready_list.begin());
 
         auto iter_ready_candidate = ready_list.begin();
         while (iter_ready_candidate != ready_list.end()) {
-            if (cdg.nodes_[chosen_candidate.id_]->isConnectedTo(iter_ready_candidate->id_)) {
-                auto the_edge = cdg.nodes_[chosen_candidate.id_]->getEdgeTo(iter_ready_candidate->id_);
-                double edge_weight = the_edge->edge_weight_;
-                double edge_offset = the_edge->estimate_offset_;
-                // non-conflict edges don't delay time windows
-                if (edge_weight <= 1.0) {
-                    edge_weight = 0.0;
-                }
-                if (param.activate_precedent_offset && edge_offset < 0) {
-                    edge_weight = edge_offset;
-                }
-                if (chosen_candidate.possible_depth_ + edge_weight + cdg.nodes_[iter_ready_candidate->id_]->estimate_travel_time_ > iter_ready_candidate->possible_depth_) {
-                    iter_ready_candidate = ready_list.erase(iter_ready_candidate);
-                    continue;
-                }
+            Edge *the_edge = workspace_.getEdge(chosen_candidate.id_, iter_ready_candidate->id_);
+            if (the_edge && chosen_candidate.possible_depth_ + WeightPolicy::getWeight(*the_edge) +
+                DepthPolicy::getNodeWeight(*cdg.nodes_[iter_ready_candidate->id_]) > iter_ready_candidate->possible_depth_) {
+                in_ready_list[iter_ready_candidate->id_] = false;
+                iter_ready_candidate = ready_list.erase(iter_ready_candidate);
+                continue;
             }
             iter_ready_candidate++;
         }
 
-        for (int to = 1; to < result_tree_.num_nodes_; to++) {
-            if (added_to_tree[to] || isInList(to, ready_list) || !cdg.nodes_[chosen_candidate.id_]->isConnectedTo(to)) {
-                continue;
+        // children are sorted by id, walk them along with `to`
+        int child = workspace_.child_offset_[chosen_candidate.id_];
+        int child_end = workspace_.child_offset_[chosen_candidate.id_ + 1];
+        for (int to = 1; to < cdg.num_nodes_; to++) {
+            while (child < child_end && workspace_.children_[child].id_ < to) {
+                child++;
             }
-            if (StillHasUnscheduledPredecessor(unidirectional_parent_table_[to], added_to_tree)) {
+            if (added_to_tree[to] || in_ready_list[to]) {
                 continue;
             }
-            auto the_edge = cdg.nodes_[chosen_candidate.id_]->getEdgeTo(to);
-            double edge_weight = the_edge->edge_weight_;
-            double edge_offset = the_edge->estimate_offset_;
-            // non-conflict edges don't delay time windows
-            if (edge_weight <= 1.0) {
-                edge_weight = 0.0;
+            Edge *the_edge = nullptr;
+            if (child < child_end && workspace_.children_[child].id_ == to) {
+                the_edge = workspace_.children_[child].edge_;
+            }
+            else if (fairness_window_.isConnected(chosen_candidate.id_, to)) {
+                the_edge = fairness_window_.fairness_edge_.get();
+            }
+            else {
+                continue;
             }
-            if (param.activate_precedent_offset && edge_offset < 0) {
-                edge_weight = edge_offset;
+            if (workspace_.hasUnscheduledParent(to) || !fairness_window_.isReleased(to, workspace_)) {
+                continue;
             }
-            double estimate_travel_time = cdg.nodes_[to]->estimate_travel_time_;
+
+            double edge_weight = WeightPolicy::getWeight(*the_edge);
+            double estimate_travel_time = DepthPolicy::getNodeWeight(*cdg.nodes_[to]);
             CDGCandidate new_candidate(to, chosen_candidate.possible_depth_ + edge_weight + estimate_travel_time, chosen_candidate.id_, edge_weight, estimate_travel_time);
 
-            // update new_candidate and solve conflict with already scheduled nodes
-            for (auto parent : unidirectional_parent_table_[to]) {
-                edge_weight = parent->getEdgeTo(to)->edge_weight_;
-                edge_offset = parent->getEdgeTo(to)->estimate_offset_;
-                if (edge_weight <= 1.0) {
-                    edge_weight = 0.0;
-                }
-                if (param.activate_precedent_offset && edge_offset < 0) {
-                    edge_weight = edge_offset;
+            // update new_candidate and solve conflict with already scheduled nodes (both uni- and bi-directional)
+            for (int k = workspace_.parent_offset_[to]; k < workspace_.parent_offset_[to + 1]; k++) {
+                auto &parent = workspace_.parents_[k];
+                edge_weight = WeightPolicy::getWeight(*parent.edge_);
+                double parent_depth = result.depth_[parent.id_];
+                if (parent_depth + edge_weight + estimate_travel_time > new_candidate.possible_depth_) {
+                    new_candidate.possible_depth_ = parent_depth + edge_weight + estimate_travel_time;
+                    new_candidate.id_possible_parent_ = parent.id_;
+                    new_candidate.edge_weight_ = edge_weight;
                 }
-                if (result_tree_.nodes_[parent->id_]->edge_node_weighted_depth_ + edge_weight + new_candidate.estimate_travel_time_ > new_candidate.possible_depth_) {
-                    new_candidate.possible_depth_ = result_tree_.nodes_[parent->id_]->edge_node_weighted_depth_ + edge_weight + new_candidate.estimate_travel_time_;
-                    new_candidate.id_possible_parent_ = parent->id_;
+            }
+            int release_parent;
+            double release_depth;
+            if (fairness_window_.getReleaseParent(to, workspace_, release_parent, release_depth)) {
+                edge_weight = WeightPolicy::getWeight(*fairness_window_.fairness_edge_);
+                if (release_depth + edge_weight + estimate_travel_time > new_candidate.possible_depth_) {
+                    new_candidate.possible_depth_ = release_depth + edge_weight + estimate_travel_time;
+                    new_candidate.id_possible_parent_ = release_parent;
                     new_candidate.edge_weight_ = edge_weight;
                 }
             }
             bool flag_still_conflict_with_bidire_scheduled_neighbor;
             do {
                 flag_still_conflict_with_bidire_scheduled_neighbor = false;
-                for (auto neighbor : bidirectional_neighbor_table_[to]) {
-                    if (!added_to_tree[neighbor->id_]) {
+                for (int k = workspace_.neighbor_offset_[to]; k < workspace_.neighbor_offset_[to + 1]; k++) {
+                    auto &neighbor = workspace_.neighbors_[k];
+                    if (!added_to_tree[neighbor.id_]) {
                         continue;
                     }
-                    edge_weight = neighbor->getEdgeTo(to)->edge_weight_;
-                    edge_offset = neighbor->getEdgeTo(to)->estimate_offset_;
-                    if (edge_weight <= 1.0) {
-                        edge_weight = 0.0;
-                    }
-                    if (param.activate_precedent_offset && edge_offset < 0) {
-                        edge_weight = edge_offset;
-                    }
-                    if (new_candidate.possible_depth_ > result_tree_.nodes_[neighbor->id_]->edge_node_weighted_depth_ - neighbor->estimate_travel_time_ - edge_weight &&
-                        new_candidate.possible_depth_ - new_candidate.estimate_travel_time_ < result_tree_.nodes_[neighbor->id_]->edge_node_weighted_depth_ + edge_weight) {
+                    edge_weight = WeightPolicy::getWeight(*neighbor.edge_);
+                    double neighbor_depth = result.depth_[neighbor.id_];
+                    if (new_candidate.possible_depth_ > neighbor_depth - DepthPolicy::getNodeWeight(*cdg.nodes_[neighbor.id_]) - edge_weight &&
+                        new_candidate.possible_depth_ - estimate_travel_time < neighbor_depth + edge_weight) {
                         flag_still_conflict_with_bidire_scheduled_neighbor = true;
-                        new_candidate.possible_depth_ = result_tree_.nodes_[neighbor->id_]->edge_node_weighted_depth_ + edge_weight + new_candidate.estimate_travel_time_;
-                        new_candidate.id_possible_parent_ = neighbor->id_;
+                        new_candidate.possible_depth_ = neighbor_depth + edge_weight + estimate_travel_time;
+                        new_candidate.id_possible_parent_ = neighbor.id_;
                         new_candidate.edge_weight_ = edge_weight;
                     }
                 }
             } while (flag_still_conflict_with_bidire_scheduled_neighbor);
             ready_list.push_back(new_candidate);
+            in_ready_list[to] = true;
 
         }
         SortReadyListAscendingly(ready_list);
     }
-
-    return result_tree_;
 }
 
-CDGConflictSpanningTree CDGScheduler::ScheduleWithDfstMultiWeight(const ConflictDirectedGraph &cdg) {
-    PrepareForTreeSchedule(cdg);
-
-    std::vector<bool> added_to_tree(cdg.num_nodes_, false);
+// schedule nodes in id order, each one after its deepest scheduled unidirectional parent
+template <typename DepthPolicy, typename WeightPolicy>
+void CDGScheduler::BuildDepthFirstTree(const ConflictDirectedGraph &cdg, CDGScheduleResult &result) {
+    auto &added_to_tree = workspace_.added_to_tree_;
+    auto &bidirectional_scheduled_parent = workspace_.bidirectional_scheduled_parent_;
     added_to_tree[0] = true;
+    fairness_window_.MarkScheduled(0, 0);
+    result.UpdateDepth(0, -1, 0, 0);
 
-    std::vector<std::shared_ptr<Node>> unidirectional_scheduled_parent;
-    std::vector<std::shared_ptr<Node>> bidirectional_scheduled_parent;
     int id_possible_parent;
-    int possible_depth;
-    std::shared_ptr<Edge> edge_from_possible_parent;
+    double possible_depth;
+    Edge *edge_from_possible_parent;
 
-    for (int id = 1; id < result_tree_.num_nodes_; id++) {
-        unidirectional_scheduled_parent.clear();
+    for (int id = 1; id < cdg.num_nodes_; id++) {
         bidirectional_scheduled_parent.clear();
         id_possible_parent = -1;
         possible_depth = -1;
         edge_from_possible_parent = nullptr;
-        auto current_estimate_travel_time = result_tree_.nodes_[id]->estimate_travel_time_;
-        for (int from = 0; from < result_tree_.num_nodes_; from++) {
-            if (!added_to_tree[from]) {
+        double current_estimate_travel_time = DepthPolicy::getNodeWeight(*cdg.nodes_[id]);
+        for (int k = workspace_.parent_offset_[id]; k < workspace_.parent_offset_[id + 1]; k++) {
+            auto &parent = workspace_.parents_[k];
+            if (!added_to_tree[parent.id_]) {
                 continue;
             }
-            if (cdg.nodes_[from]->isConnectedTo(id)) {
-                auto edge = cdg.nodes_[from]->getEdgeTo(id);
-                auto edge_weight = edge->edge_weight_;
-                auto edge_offset = edge->estimate_offset_;
-                if (edge_weight <= 1.0) {
-                    edge_weight = 0.0;
-                }
-                if (param.activate_precedent_offset && edge_offset < 0) {
-                    edge_weight = edge_offset;
-                }
-                if (edge->bidirectional_) {
-                    bidirectional_scheduled_parent.push_back(result_tree_.nodes_[from]);
-                }
-                else {
-                    unidirectional_scheduled_parent.push_back(result_tree_.nodes_[from]);
-                    if (result_tree_.nodes_[from]->edge_node_weighted_depth_ + edge_weight + current_estimate_travel_time > possible_depth) {
-                        possible_depth = result_tree_.nodes_[from]->edge_node_weighted_depth_ + edge_weight + current_estimate_travel_time;
-                        id_possible_parent = from;
-                        edge_from_possible_parent = edge;
-                    }
-                }
+            double depth = result.depth_[parent.id_] + WeightPolicy::getWeight(*parent.edge_) + current_estimate_travel_time;
+            if (depth > possible_depth) {
+                possible_depth = depth;
+                id_possible_parent = parent.id_;
+                edge_from_possible_parent = parent.edge_;
+            }
+        }
+        for (int k = workspace_.neighbor_offset_[id]; k < workspace_.neighbor_offset_[id + 1]; k++) {
+            if (added_to_tree[workspace_.neighbors_[k].id_]) {
+                bidirectional_scheduled_parent.push_back(workspace_.neighbors_[k]);
+            }
+        }
+        int release_parent;
+        double release_depth;
+        if (fairness_window_.getReleaseParent(id, workspace_, release_parent, release_depth)) {
+            double depth = release_depth + WeightPolicy::getWeight(*fairness_window_.fairness_edge_) + current_estimate_travel_time;
+            if (depth > possible_depth) {
+                possible_depth = depth;
+                id_possible_parent = release_parent;
+                edge_from_possible_parent = fairness_window_.fairness_edge_.get();
             }
         }
 
         // if only connected by bidirectional edges, initiate possible depth with the smallest one
         if (id_possible_parent == -1) {
-            int min_depth_parent_id;
-            int min_depth;
-            id_possible_parent = bidirectional_scheduled_parent.front()->id_;
-            edge_from_possible_parent = cdg.nodes_[id_possible_parent]->getEdgeTo(id);
-            auto edge_weight = edge_from_possible_parent->edge_weight_;
-            auto edge_offset = edge_from_possible_parent->estimate_offset_;
-            if (edge_weight <= 1.0) {
-                edge_weight = 0.0;
-            }
-            if (param.activate_precedent_offset && edge_offset < 0) {
-                edge_weight = edge_offset;
-            }
-            possible_depth = bidirectional_scheduled_parent.front()->edge_node_weighted_depth_ + edge_weight + current_estimate_travel_time;
-            for (auto parent : bidirectional_scheduled_parent) {
-                auto edge = cdg.nodes_[parent->id_]->getEdgeTo(id);
-                auto edge_weight = edge->edge_weight_;
-                auto edge_offset = edge->estimate_offset_;
-                if (edge_weight <= 1.0) {
-                    edge_weight = 0.0;
-                }
-                if (param.activate_precedent_offset && edge_offset < 0) {
-                    edge_weight = edge_offset;
-                }
-                if (parent->edge_node_weighted_depth_ + edge_weight + current_estimate_travel_time < possible_depth) {
-                    id_possible_parent = parent->id_;
-                    possible_depth = parent->edge_node_weighted_depth_ + edge_weight + current_estimate_travel_time;
-                    edge_from_possible_parent = edge;
+            id_possible_parent = bidirectional_scheduled_parent.front().id_;
+            edge_from_possible_parent = bidirectional_scheduled_parent.front().edge_;
+            possible_depth = result.depth_[id_possible_parent] + WeightPolicy::getWeight(*edge_from_possible_parent) + current_estimate_travel_time;
+            for (auto &parent : bidirectional_scheduled_parent) {
+                double depth = result.depth_[parent.id_] + WeightPolicy::getWeight(*parent.edge_) + current_estimate_travel_time;
+                if (depth < possible_depth) {
+                    id_possible_parent = parent.id_;
+                    possible_depth = depth;
+                    edge_from_possible_parent = parent.edge_;
                 }
             }
         }
@@ -352,88 +431,68 @@ CDGConflictSpanningTree CDGScheduler::ScheduleWithDfstMultiWeight(const Conflict
         bool flag_still_conflict_with_bidire_scheduled_neighbor;
         do {
             flag_still_conflict_with_bidire_scheduled_neighbor = false;
-            for (auto parent : bidirectional_scheduled_parent) {
-                auto edge = cdg.nodes_[parent->id_]->getEdgeTo(id);
-                auto edge_weight = edge->edge_weight_;
-                auto edge_offset = edge->estimate_offset_;
-                if (edge_weight <= 1.0) {
-                    edge_weight = 0.0;
-                }
-                if (param.activate_precedent_offset && edge_offset < 0) {
-                    edge_weight = edge_offset;
-                }
-                if (parent->edge_node_weighted_depth_ - edge_weight - parent->estimate_travel_time_ < possible_depth && \
-                    possible_depth < parent->edge_node_weighted_depth_ + edge_weight + current_estimate_travel_time) {
-                    id_possible_parent = parent->id_;
-                    possible_depth = parent->edge_node_weighted_depth_ + edge_weight + current_estimate_travel_time;
-                    edge_from_possible_parent = edge;
+            for (auto &parent : bidirectional_scheduled_parent) {
+                double edge_weight = WeightPolicy::getWeight(*parent.edge_);
+                double parent_depth = result.depth_[parent.id_];
+                if (parent_depth - edge_weight - DepthPolicy::getNodeWeight(*cdg.nodes_[parent.id_]) < possible_depth &&
+                    possible_depth < parent_depth + edge_weight + current_estimate_travel_time) {
+                    id_possible_parent = parent.id_;
+                    possible_depth = parent_depth + edge_weight + current_estimate_travel_time;
+                    edge_from_possible_parent = parent.edge_;
                     flag_still_conflict_with_bidire_scheduled_neighbor = true;
                 }
             }
         } while (flag_still_conflict_with_bidire_scheduled_neighbor);
 
         added_to_tree[id] = true;
-        result_tree_.AddEdge(id_possible_parent, id, edge_from_possible_parent->edge_weight_);
-        result_tree_.UpdateDepth(id, possible_depth, Type_EdgeNodeWeightedDepth);
+        fairness_window_.MarkScheduled(id, possible_depth);
+        result.UpdateDepth(id, id_possible_parent, edge_from_possible_parent->edge_weight_, possible_depth);
     }
+}
 
-    return result_tree_;
+uint64_t CDGScheduler::getOptimalSolutionKey(const ConflictDirectedGraph &cdg) const {
+    return cdg.getCanonicalHash() ^ (activate_precedent_offset_ ? 0x5bd1e9955bd1e995ull : 0);
 }
 
+// a cached order is returned with the workspace set up as after a search, for GetDepthVectorFromOrder
 std::vector<int> CDGScheduler::ScheduleBruteForceSearch(const ConflictDirectedGraph &cdg) {
-    int num_nodes = cdg.num_nodes_;
-    double minimum_evacuation_time = -1.0;
-    std::vector<int> vehicle_order;
-    std::vector<bool> is_in_order_list(num_nodes, false);
-    vehicle_order.push_back(0);
-    is_in_order_list[0] = true;
     std::vector<int> best_order;
-
-    GenerateUniparentTable(cdg);
-    GenerateBineighborTable(cdg);
-    SearchOrderPermutationRecursively(vehicle_order, num_nodes, is_in_order_list, minimum_evacuation_time, best_order, cdg);
+    ScheduleBruteForceSearch(cdg, best_order);
     return best_order;
 }
 
-void CDGScheduler::PrepareForTreeSchedule(const ConflictDirectedGraph &cdg) {
-    result_tree_.reset(false);
-    result_tree_.AddNodesFromGraph(cdg);
-    GenerateUniparentTable(cdg);
-    GenerateBineighborTable(cdg);
-}
-
-void CDGScheduler::GenerateUniparentTable(const ConflictDirectedGraph &cdg) {
-    unidirectional_parent_table_.clear();
-    for (int id = 0; id < cdg.num_nodes_; id++) {
-        std::vector<std::shared_ptr<Node>> uni_parent;
-        for (int from = 0; from < cdg.num_nodes_; from++) {
-            if (cdg.nodes_[from]->isConnectedTo(id)) {
-                auto edge = cdg.nodes_[from]->getEdgeTo(id);
-                if (!edge->bidirectional_) {
-                    uni_parent.push_back(cdg.nodes_[from]);
-                }
-            }
+void CDGScheduler::ScheduleBruteForceSearch(const ConflictDirectedGraph &cdg, std::vector<int> &best_order) {
+    uint64_t key = 0;
+    double makespan;
+    best_order.clear();
+    if (optimal_solution_cache_) {
+        key = getOptimalSolutionKey(cdg);
+        if (optimal_solution_cache_->Lookup(key, getOptimalSolutionFingerprint(cdg), best_order, makespan)) {
+            workspace_.reset(cdg);
+            return;
         }
-        unidirectional_parent_table_.push_back(uni_parent);
     }
-}
 
-void CDGScheduler::GenerateBineighborTable(const ConflictDirectedGraph &cdg) {
-    bidirectional_neighbor_table_.clear();
-    for (int id = 0; id < cdg.num_nodes_; id++) {
-        std::vector<std::shared_ptr<Node>> neighbors;
-        for (int from = 0; from < cdg.num_nodes_; from++) {
-            if (cdg.nodes_[from]->isConnectedTo(id)) {
-                auto edge = cdg.nodes_[from]->getEdgeTo(id);
-                if (edge->bidirectional_) {
-                    neighbors.push_back(cdg.nodes_[from]);
-                }
-            }
-        }
-        bidirectional_neighbor_table_.push_back(neighbors);
+    int num_nodes = cdg.num_nodes_;
+    double minimum_evacuation_time = -1.0;
+    search_order_.assign(1, 0);
+    is_in_search_order_.assign(num_nodes, false);
+    is_in_search_order_[0] = true;
+
+    workspace_.reset(cdg);
+    SearchOrderPermutationRecursively(search_order_, num_nodes, is_in_search_order_, minimum_evacuation_time, best_order,
+                                      cdg);
+    // an infeasible search has no optimum to keep
+    if (optimal_solution_cache_ && minimum_evacuation_time >= 0) {
+        optimal_solution_cache_->Insert(key, getOptimalSolutionFingerprint(cdg), best_order, minimum_evacuation_time);
     }
 }
 
+void CDGScheduler::PrepareForTreeSchedule(const ConflictDirectedGraph &cdg) {
+    workspace_.reset(cdg);
+    fairness_window_.reset(cdg.num_nodes_, cdg.fairness_order_diff_threshold_);
+}
+
 void CDGScheduler::SearchOrderPermutationRecursively(std::vector<int> &vehicle_order, int num_nodes,
                                                      std::vector<bool> &is_in_order_list,
                                                      double &minimum_evacuation_time, std::vector<int> &best_order,
@@ -465,13 +524,13 @@ void CDGScheduler::SearchOrderPermutationRecursively(std::vector<int> &vehicle_o
 
 double CDGScheduler::GetEvacuationTimeFromOrder(const std::vector<int> &vehicle_order,
                                                 const ConflictDirectedGraph &cdg) {
-    std::vector<double> depth_of_the_order = GetDepthVectorFromOrder(vehicle_order, cdg);
-    if (depth_of_the_order.empty()) {
+    GetDepthVectorFromOrder(vehicle_order, cdg, order_depth_);
+    if (order_depth_.empty()) {
         return -1.0;
     }
 
     double evacuation_time = -1.0;
-    for (auto depth : depth_of_the_order) {
+    for (auto depth : order_depth_) {
         if (depth > evacuation_time) {
             evacuation_time = depth;
         }
@@ -479,64 +538,181 @@ double CDGScheduler::GetEvacuationTimeFromOrder(const std::vector<int> &vehicle_
     return evacuation_time;
 }
 
-std::vector<double> CDGScheduler::GetDepthVectorFromOrder(const std::vector<int> &vehicle_order,
-                                                          const ConflictDirectedGraph &cdg) {
-    std::vector<bool> vehicle_scheduled(vehicle_order.size(), false);
-    std::vector<double> depth_of_the_order(vehicle_order.size(), -1.0);
-    double cur_estimate_travel_time;
-    double edge_weight;
-    double edge_offset;
-    double possible_start_time;
-    double possible_end_time;
+std::vector<double> CDGScheduler::ScheduleFromSeedOrder(const ConflictDirectedGraph &cdg,
+                                                        const std::vector<int> &seed_order, std::vector<int> &order,
+                                                        const std::vector<double> *fixed_depth) {
+    PrepareForTreeSchedule(cdg);
+    std::vector<double> depth(cdg.num_nodes_, -1.0);
+    order_scheduled_.assign(cdg.num_nodes_, false);
+    order_fairness_window_.reset(cdg.num_nodes_, cdg.fairness_order_diff_threshold_);
+    auto isFixed = [&](int id) { return fixed_depth != nullptr && (*fixed_depth)[id] >= 0; };
+    auto place = [&](int id, double id_depth) {
+        order.push_back(id);
+        depth[id] = id_depth;
+        order_scheduled_[id] = true;
+        order_fairness_window_.MarkScheduled(id, id_depth);
+    };
+    order.clear();
+    place(0, 0.0);
+
+    // the nodes of the seed, without repeats, and the new nodes
+    auto &in_seed = workspace_.in_ready_list_;
+    auto &seed = search_order_;
+    auto &new_nodes = new_node_ids_;
+    seed.clear();
+    for (int id : seed_order) {
+        if (id > 0 && id < cdg.num_nodes_ && !in_seed[id]) {
+            in_seed[id] = true;
+            seed.push_back(id);
+        }
+    }
+    new_nodes.clear();
+    for (int id = 1; id < cdg.num_nodes_; id++) {
+        if (!in_seed[id]) {
+            new_nodes.push_back(id);
+        }
+    }
 
-    for (int cur_id : vehicle_order) {
-        cur_estimate_travel_time = cdg.nodes_[cur_id]->estimate_travel_time_;
-        possible_start_time = 0;
-        for (auto parent : unidirectional_parent_table_[cur_id]) {
-            if (!vehicle_scheduled[parent->id_]) {
-                depth_of_the_order.clear();
-                return depth_of_the_order;
+    // Like the BFST, the candidate that exits first goes next. The candidates are the next kSeedLookahead seed
+    // nodes and every new node, so a new node settles among the seed nodes it conflicts with and the seed
+    // order only bends locally. A seed node whose parents aren't placed yet waits for them
+    int first_seed = 0;
+    while (order.size() < cdg.num_nodes_) {
+        int seed_id = -1;
+        double seed_depth = 0;
+        for (int pos = first_seed; pos < seed.size(); pos++) {
+            int id = seed[pos];
+            if (order_scheduled_[id]) {
+                if (pos == first_seed) {
+                    first_seed++;
+                }
+                continue;
             }
-            edge_weight = parent->getEdgeTo(cur_id)->edge_weight_;
-            edge_offset = parent->getEdgeTo(cur_id)->estimate_offset_;
-            if (edge_weight <= 1.0) {
-                edge_weight = 0.0;
+            if (isFixed(id)) {
+                seed_id = id;
+                seed_depth = (*fixed_depth)[id];
+                break;
             }
-            if (param.activate_precedent_offset && edge_offset < 0) {
-                edge_weight = edge_offset;
+            double id_depth;
+            if (getEarliestDepth(id, cdg, depth, id_depth) && (seed_id < 0 || id_depth < seed_depth)) {
+                seed_id = id;
+                seed_depth = id_depth;
             }
-            if (depth_of_the_order[parent->id_] + edge_weight > possible_start_time) {
-                possible_start_time = depth_of_the_order[parent->id_] + edge_weight;
+            if (seed_id >= 0 && pos >= first_seed + kSeedLookahead - 1) {
+                break;
             }
         }
-        possible_end_time = possible_start_time + cur_estimate_travel_time;
-        bool flag;
-        do {
-            flag = false;
-            for (auto neighbor : bidirectional_neighbor_table_[cur_id]) {
-                if (!vehicle_scheduled[neighbor->id_]) {
+        int new_id = -1;
+        double new_depth = 0;
+        if (seed_id < 0 || !isFixed(seed_id)) {
+            for (int id : new_nodes) {
+                double id_depth;
+                if (order_scheduled_[id]) {
                     continue;
                 }
-                edge_weight = neighbor->getEdgeTo(cur_id)->edge_weight_;
-                edge_offset = neighbor->getEdgeTo(cur_id)->estimate_offset_;
-                if (edge_weight <= 1.0) {
-                    edge_weight = 0.0;
-                }
-                if (param.activate_precedent_offset && edge_offset < 0) {
-                    edge_weight = edge_offset;
+                if (isFixed(id)) {
+                    new_id = id;
+                    new_depth = (*fixed_depth)[id];
+                    break;
                 }
-                if (possible_end_time > depth_of_the_order[neighbor->id_] - neighbor->estimate_travel_time_ - edge_weight &&
-                    possible_start_time < depth_of_the_order[neighbor->id_] + edge_weight) {
-                    flag = true;
-                    possible_start_time = depth_of_the_order[neighbor->id_] + edge_weight;
-                    possible_end_time = possible_start_time + cur_estimate_travel_time;
+                if (getEarliestDepth(id, cdg, depth, id_depth) && (new_id < 0 || id_depth < new_depth)) {
+                    new_id = id;
+                    new_depth = id_depth;
                 }
             }
-        } while (flag);
-        depth_of_the_order[cur_id] = possible_end_time;
-        vehicle_scheduled[cur_id] = true;
+        }
+        if (new_id >= 0 && (seed_id < 0 || isFixed(new_id) || new_depth < seed_depth)) {
+            place(new_id, new_depth);
+        }
+        else if (seed_id >= 0) {
+            place(seed_id, seed_depth);
+        }
+        else {
+            std::cerr << "Seed order can't be completed, the unidirectional edges form a cycle.\n";
+            return std::vector<double>();
+        }
     }
+    return depth;
+}
+
+std::vector<double> CDGScheduler::GetDepthVectorFromOrder(const std::vector<int> &vehicle_order,
+                                                          const ConflictDirectedGraph &cdg,
+                                                          const std::vector<double> *fixed_depth) {
+    std::vector<double> depth_of_the_order;
+    GetDepthVectorFromOrder(vehicle_order, cdg, depth_of_the_order, fixed_depth);
     return depth_of_the_order;
 }
 
+void CDGScheduler::GetDepthVectorFromOrder(const std::vector<int> &vehicle_order, const ConflictDirectedGraph &cdg,
+                                           std::vector<double> &depth_of_the_order,
+                                           const std::vector<double> *fixed_depth) {
+    order_scheduled_.assign(vehicle_order.size(), false);
+    depth_of_the_order.assign(vehicle_order.size(), -1.0);
+    order_fairness_window_.reset(cdg.num_nodes_, cdg.fairness_order_diff_threshold_);
+    for (int cur_id : vehicle_order) {
+        double depth;
+        if (fixed_depth != nullptr && (*fixed_depth)[cur_id] >= 0) {
+            depth = (*fixed_depth)[cur_id];
+        }
+        else if (!getEarliestDepth(cur_id, cdg, depth_of_the_order, depth)) {
+            depth_of_the_order.clear();
+            return;
+        }
+        depth_of_the_order[cur_id] = depth;
+        order_scheduled_[cur_id] = true;
+        order_fairness_window_.MarkScheduled(cur_id, depth);
+    }
+}
+
+bool CDGScheduler::getEarliestDepth(int cur_id, const ConflictDirectedGraph &cdg,
+                                    const std::vector<double> &depth_of_the_order, double &earliest_depth) {
+    auto &vehicle_scheduled = order_scheduled_;
+    auto &fairness_window = order_fairness_window_;
+    double cur_estimate_travel_time = cdg.nodes_[cur_id]->estimate_travel_time_;
+    double edge_weight;
+    double possible_start_time = 0;
+    double possible_end_time;
+    for (int k = workspace_.parent_offset_[cur_id]; k < workspace_.parent_offset_[cur_id + 1]; k++) {
+        auto &parent = workspace_.parents_[k];
+        if (!vehicle_scheduled[parent.id_]) {
+            return false;
+        }
+        edge_weight = parent.edge_->getMultiWeight(activate_precedent_offset_);
+        if (depth_of_the_order[parent.id_] + edge_weight > possible_start_time) {
+            possible_start_time = depth_of_the_order[parent.id_] + edge_weight;
+        }
+    }
+    if (!fairness_window.isReleased(cur_id, workspace_)) {
+        return false;
+    }
+    int release_parent;
+    double release_depth;
+    if (fairness_window.getReleaseParent(cur_id, workspace_, release_parent, release_depth)) {
+        edge_weight = fairness_window.fairness_edge_->getMultiWeight(activate_precedent_offset_);
+        if (release_depth + edge_weight > possible_start_time) {
+            possible_start_time = release_depth + edge_weight;
+        }
+    }
+    possible_end_time = possible_start_time + cur_estimate_travel_time;
+    bool flag;
+    do {
+        flag = false;
+        for (int k = workspace_.neighbor_offset_[cur_id]; k < workspace_.neighbor_offset_[cur_id + 1]; k++) {
+            auto &neighbor = workspace_.neighbors_[k];
+            if (!vehicle_scheduled[neighbor.id_]) {
+                continue;
+            }
+            edge_weight = neighbor.edge_->getMultiWeight(activate_precedent_offset_);
+            if (possible_end_time > depth_of_the_order[neighbor.id_] - cdg.nodes_[neighbor.id_]->estimate_travel_time_ - edge_weight &&
+                possible_start_time < depth_of_the_order[neighbor.id_] + edge_weight) {
+                flag = true;
+                possible_start_time = depth_of_the_order[neighbor.id_] + edge_weight;
+                possible_end_time = possible_start_time + cur_estimate_travel_time;
+            }
+        }
+    } while (flag);
+    earliest_depth = possible_end_time;
+    return true;
+}
+
 } // namespace intersection_management
\ No newline at end of file
@@ -4,26 +4,60 @@
 #include <iostream>
 #include <cmath>
 #include <queue>
+#include <limits>
+#include <algorithm>
+#include <random>
+#include <cstring>
+#include <tuple>
+
+#include "parameters.h"
 
 namespace intersection_management {
 
-ConflictDirectedGraph::ConflictDirectedGraph() {
+ConflictDirectedGraph::ConflictDirectedGraph() : ConflictDirectedGraph(param) {}
+
+ConflictDirectedGraph::ConflictDirectedGraph(const Parameters &local_param) {
+    activate_precedent_offset_ = local_param.activate_precedent_offset;
     reset(false);
 }
 
 void ConflictDirectedGraph::reset(bool verbose) {
-    p_root_ = std::shared_ptr<Node>(new Node(0, 0.0, 0.0, 0.0, 0.0));
-    nodes_.clear();
+    // nodes shared with a copy of the graph keep their edges, see SharedObjectPool
+    p_root_.reset();
+    for (auto &node : nodes_) {
+        if (node.use_count() == 1) {
+            node->edges_.clear();
+        }
+    }
+    node_pool_.Release(nodes_);
+    edge_pool_.Release(edges_);
+    p_root_ = node_pool_.Acquire();
+    if (p_root_ == nullptr) {
+        p_root_ = std::shared_ptr<Node>(new Node(0, 0.0, 0.0, 0.0, 0.0));
+    }
+    else {
+        p_root_->Reinitialize(0, 0.0);
+        p_root_->depth_ = 0.0;
+        p_root_->edge_weighted_depth_ = 0.0;
+        p_root_->edge_node_weighted_depth_ = 0.0;
+    }
     nodes_.push_back(p_root_);
-    edges_.clear();
     num_nodes_ = 1;
+    fairness_order_diff_threshold_ = 0;
     if (verbose) {
         std::cout << "The CDG is reset to a new root-only graph!\n";
     }
 }
 
 void ConflictDirectedGraph::AddNode(double weight) {
-    auto node = std::shared_ptr<Node>(new Node(num_nodes_++, weight, -1, -1, -1));
+    auto node = node_pool_.Acquire();
+    if (node == nullptr) {
+        node = std::shared_ptr<Node>(new Node(num_nodes_, weight, -1, -1, -1));
+    }
+    else {
+        node->Reinitialize(num_nodes_, weight);
+    }
+    num_nodes_++;
     nodes_.push_back(node);
 }
 
@@ -40,9 +74,12 @@ void ConflictDirectedGraph::AddEdge(int from, int to, double weight, bool bidire
             return;
         }
     }
+    AddEdgeUnchecked(from, to, weight, bidirectional);
+}
 
+void ConflictDirectedGraph::AddEdgeUnchecked(int from, int to, double weight, bool bidirectional) {
     if (to != 0) {
-        auto edge = std::shared_ptr<Edge>(new Edge(nodes_[from], nodes_[to], weight, bidirectional));
+        auto edge = NewEdge(from, to, weight, bidirectional);
         if (from == 0) {
             edge->bidirectional_ = false;
         }
@@ -50,7 +87,7 @@ void ConflictDirectedGraph::AddEdge(int from, int to, double weight, bool bidire
         edges_.push_back(edge);
     }
     if (bidirectional && from != 0) {
-        auto edge = std::shared_ptr<Edge>(new Edge(nodes_[to], nodes_[from], weight, bidirectional));
+        auto edge = NewEdge(to, from, weight, bidirectional);
         if (to == 0) {
             edge->bidirectional_ = false;
         }
@@ -59,6 +96,15 @@ void ConflictDirectedGraph::AddEdge(int from, int to, double weight, bool bidire
     }
 }
 
+std::shared_ptr<Edge> ConflictDirectedGraph::NewEdge(int from, int to, double weight, bool bidirectional) {
+    auto edge = edge_pool_.Acquire();
+    if (edge == nullptr) {
+        return std::shared_ptr<Edge>(new Edge(nodes_[from], nodes_[to], weight, bidirectional));
+    }
+    *edge = Edge(nodes_[from], nodes_[to], weight, bidirectional);
+    return edge;
+}
+
 void ConflictDirectedGraph::GenerateRandomGraph(
     int total_nodes,
     double estimate_travel_time_range,
@@ -70,33 +116,33 @@ void ConflictDirectedGraph::GenerateRandomGraph(
     this->reset(false);
     double estimate_travel_time;
     for (int id = 1; id <= total_nodes; id++) {
-        estimate_travel_time = ((double)rand()) / RAND_MAX * estimate_travel_time_range + estimate_travel_time_offset;
+        estimate_travel_time = std::uniform_real_distribution<double>(0.0, 1.0)(mt_) * estimate_travel_time_range + estimate_travel_time_offset;
         if (int_weight_only) {
             estimate_travel_time = std::floor(estimate_travel_time);
         }
         AddNode(estimate_travel_time);
     }
 
-    int num_edges_to_add = (int)(num_nodes_ * num_nodes_ * (rand() % 100) * 0.01);
+    int num_edges_to_add = (int)(num_nodes_ * num_nodes_ * (mt_() % 100) * 0.01);
     int from, to;
     double edge_weight;
     while (num_edges_to_add > 0) {
-        edge_weight = ((double)rand()) / RAND_MAX * edge_weight_range + edge_weight_offset;
+        edge_weight = std::uniform_real_distribution<double>(0.0, 1.0)(mt_) * edge_weight_range + edge_weight_offset;
         if (int_weight_only) {
             edge_weight = std::floor(edge_weight);
         }
-        if (rand() % 2) { // add bidirectional edge
+        if (mt_() % 2) { // add bidirectional edge
             do {
-                from = rand() % num_nodes_;
-                to = rand() % num_nodes_;
+                from = mt_() % num_nodes_;
+                to = mt_() % num_nodes_;
             } while (from == to);
             AddEdge(from, to, edge_weight, true);
             num_edges_to_add -= 2;
         }
         else { // add unidirectional edge, from.id < to.id is ensured
             do {
-                from = rand() % num_nodes_;
-                to = rand() % num_nodes_;
+                from = mt_() % num_nodes_;
+                to = mt_() % num_nodes_;
             } while (from >= to);
             AddEdge(from, to, edge_weight, false);
             num_edges_to_add--;
@@ -110,6 +156,171 @@ void ConflictDirectedGraph::GenerateRandomGraph(
     }
 }
 
+// A random spanning tree over the vehicles comes first: every vehicle after the first one conflicts with a
+// random earlier vehicle, so the conflicts form one component without retrying. The remaining pairs are drawn
+// until the density is reached, rejecting drawn pairs through a pair table, or taken from a shuffle of every
+// pair when more than half of them are needed. Unidirectional edges point from the lower id to the higher one.
+void ConflictDirectedGraph::GenerateRandomConnectedGraph(int total_nodes, double density,
+                                                         double estimate_travel_time_range,
+                                                         double edge_weight_range,
+                                                         double estimate_travel_time_offset,
+                                                         double edge_weight_offset,
+                                                         bool int_weight_only,
+                                                         double bidirectional_ratio) {
+    this->reset(false);
+    nodes_.reserve(total_nodes + 1);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    double estimate_travel_time;
+    for (int id = 1; id <= total_nodes; id++) {
+        estimate_travel_time = unit(mt_) * estimate_travel_time_range + estimate_travel_time_offset;
+        if (int_weight_only) {
+            estimate_travel_time = std::floor(estimate_travel_time);
+        }
+        AddNode(estimate_travel_time);
+    }
+
+    auto add_conflict = [&](int from, int to) {
+        double edge_weight = unit(mt_) * edge_weight_range + edge_weight_offset;
+        if (int_weight_only) {
+            edge_weight = std::floor(edge_weight);
+        }
+        AddEdgeUnchecked(from, to, edge_weight, unit(mt_) < bidirectional_ratio);
+    };
+    long num_pairs = (long)total_nodes * (total_nodes - 1) / 2;
+    long num_conflicts = std::max((long)std::llround(std::min(std::max(density, 0.0), 1.0) * num_pairs),
+                                  (long)std::max(total_nodes - 1, 0));
+    std::vector<bool> is_conflicting((size_t)(total_nodes + 1) * (total_nodes + 1), false);
+    auto pair_index = [&](int from, int to) { return (size_t)from * (total_nodes + 1) + to; };
+    for (int to = 2; to <= total_nodes; to++) {
+        int from = std::uniform_int_distribution<int>(1, to - 1)(mt_);
+        is_conflicting[pair_index(from, to)] = true;
+        add_conflict(from, to);
+    }
+    long remaining = num_conflicts - std::max(total_nodes - 1, 0);
+    if (remaining * 2 <= num_pairs) {
+        std::uniform_int_distribution<int> vehicle(1, std::max(total_nodes, 1));
+        while (remaining > 0) {
+            int from = vehicle(mt_);
+            int to = vehicle(mt_);
+            if (from == to) {
+                continue;
+            }
+            if (from > to) {
+                std::swap(from, to);
+            }
+            if (is_conflicting[pair_index(from, to)]) {
+                continue;
+            }
+            is_conflicting[pair_index(from, to)] = true;
+            add_conflict(from, to);
+            remaining--;
+        }
+    }
+    else {
+        std::vector<std::pair<int, int>> free_pairs;
+        free_pairs.reserve(num_pairs - (total_nodes - 1));
+        for (int from = 1; from <= total_nodes; from++) {
+            for (int to = from + 1; to <= total_nodes; to++) {
+                if (!is_conflicting[pair_index(from, to)]) {
+                    free_pairs.emplace_back(from, to);
+                }
+            }
+        }
+        std::shuffle(free_pairs.begin(), free_pairs.end(), mt_);
+        for (long k = 0; k < remaining; k++) {
+            add_conflict(free_pairs[k].first, free_pairs[k].second);
+        }
+    }
+
+    for (int to = 1; to <= total_nodes; to++) {
+        AddEdgeUnchecked(0, to, 1.0, false);
+    }
+}
+
+bool ConflictDirectedGraph::isConflictConnected() {
+    std::vector<std::vector<int>> neighbors(num_nodes_);
+    for (auto &edge : edges_) {
+        int from = edge->node1_.lock()->id_;
+        int to = edge->node2_.lock()->id_;
+        if (from != 0 && to != 0) {
+            neighbors[from].push_back(to);
+            neighbors[to].push_back(from);
+        }
+    }
+    if (num_nodes_ <= 2) {
+        return true;
+    }
+    std::queue<int> visit_queue;
+    std::vector<bool> is_visited(num_nodes_, false);
+    visit_queue.push(1);
+    is_visited[1] = true;
+    int num_visited = 1;
+    while (!visit_queue.empty()) {
+        int from = visit_queue.front();
+        visit_queue.pop();
+        for (int to : neighbors[from]) {
+            if (!is_visited[to]) {
+                visit_queue.push(to);
+                is_visited[to] = true;
+                num_visited++;
+            }
+        }
+    }
+    return num_visited == num_nodes_ - 1;
+}
+
+namespace {
+inline uint64_t MixHash(uint64_t value) {
+    value += 0x9e3779b97f4a7c15ull;
+    value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ull;
+    value = (value ^ (value >> 27)) * 0x94d049bb133111ebull;
+    return value ^ (value >> 31);
+}
+inline void CombineHash(uint64_t &hash, uint64_t value) {
+    hash = MixHash(hash ^ MixHash(value));
+}
+inline uint64_t getDoubleBits(double value) {
+    uint64_t bits;
+    value = value == 0.0 ? 0.0 : value; // -0.0 hashes as 0.0
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+} // namespace
+
+// the outgoing edges of every node are hashed sorted by target, every other part is already in id order
+uint64_t ConflictDirectedGraph::getCanonicalHash() const {
+    struct EdgeKey {
+        int to_;
+        uint64_t weight_;
+        uint64_t estimate_offset_;
+        bool bidirectional_;
+        bool operator<(const EdgeKey &other) const {
+            return std::tie(to_, weight_, estimate_offset_, bidirectional_) <
+                   std::tie(other.to_, other.weight_, other.estimate_offset_, other.bidirectional_);
+        }
+    };
+    uint64_t hash = MixHash(num_nodes_);
+    CombineHash(hash, fairness_order_diff_threshold_);
+    std::vector<EdgeKey> edge_keys;
+    for (int id = 0; id < num_nodes_; id++) {
+        auto &node = *nodes_[id];
+        CombineHash(hash, getDoubleBits(node.estimate_travel_time_));
+        edge_keys.clear();
+        for (auto &edge : node.edges_) {
+            edge_keys.push_back(EdgeKey{edge->node2_.lock()->id_, getDoubleBits(edge->edge_weight_),
+                                        getDoubleBits(edge->estimate_offset_), edge->bidirectional_});
+        }
+        std::sort(edge_keys.begin(), edge_keys.end());
+        CombineHash(hash, edge_keys.size());
+        for (auto &key : edge_keys) {
+            CombineHash(hash, key.to_);
+            CombineHash(hash, key.weight_);
+            CombineHash(hash, key.estimate_offset_);
+            CombineHash(hash, key.bidirectional_);
+        }
+    }
+    return hash;
+}
 
 void ConflictDirectedGraph::GenerateGraphFromIntersection(Intersection &intersection) {
     // num_nodes_ = intersection.num_nodes_;
@@ -153,12 +364,17 @@ void ConflictDirectedGraph::GenerateGraphFromIntersection(Intersection &intersec
     }
 }
 
-void ConflictDirectedGraph::AddFairnessConflicts() {
+int ConflictDirectedGraph::GetFairnessOrderDiffThreshold() {
     int fairness_order_diff_threshold = 50;
     double fairness_order_diff_rate = 0.5;
     if (num_nodes_ * fairness_order_diff_rate < fairness_order_diff_threshold) {
         fairness_order_diff_threshold = std::floor(num_nodes_ * fairness_order_diff_rate);
     }
+    return fairness_order_diff_threshold;
+}
+
+void ConflictDirectedGraph::AddFairnessConflicts() {
+    int fairness_order_diff_threshold = GetFairnessOrderDiffThreshold();
 
     for (int from = 0; from < num_nodes_; from++) {
         for (int to = from + fairness_order_diff_threshold; to < num_nodes_; to++) {
@@ -167,6 +383,138 @@ void ConflictDirectedGraph::AddFairnessConflicts() {
     }
 }
 
+// Remove every unidirectional edge u->w that is implied by a longer unidirectional path u->...->w.
+// An edge is only dropped when the path dominates it under both the edge-weighted depth
+// (sum of edge weights) and the edge-node-weighted depth (multi-weights plus the travel time of
+// the intermediate nodes), so none of the schedulers can see a different time window.
+// Edges from the root are kept so that every node is still reachable in one step.
+// Returns the number of removed edges.
+int ConflictDirectedGraph::ReduceTransitiveEdges() {
+    const double kUnreachable = -std::numeric_limits<double>::infinity();
+
+    // topological order of the unidirectional edges
+    // the buffers are members, so a graph reduced over and over doesn't allocate
+    auto &in_degree = in_degree_;
+    auto &topological_order = topological_order_;
+    auto &topological_position = topological_position_;
+    in_degree.assign(num_nodes_, 0);
+    for (auto &node : nodes_) {
+        for (auto &p_edge : node->edges_) {
+            if (!p_edge->bidirectional_) {
+                in_degree[p_edge->node2_.lock()->id_]++;
+            }
+        }
+    }
+    // the order itself is the queue of Kahn's algorithm
+    topological_order.clear();
+    topological_position.assign(num_nodes_, -1);
+    for (int id = 0; id < num_nodes_; id++) {
+        if (in_degree[id] == 0) {
+            topological_order.push_back(id);
+        }
+    }
+    for (int visited = 0; visited < topological_order.size(); visited++) {
+        int from = topological_order[visited];
+        topological_position[from] = visited;
+        for (auto &p_edge : nodes_[from]->edges_) {
+            if (!p_edge->bidirectional_ && --in_degree[p_edge->node2_.lock()->id_] == 0) {
+                topological_order.push_back(p_edge->node2_.lock()->id_);
+            }
+        }
+    }
+    if (topological_order.size() < num_nodes_) {
+        std::cerr << "Transitive reduction skipped, unidirectional edges contain a cycle.\n";
+        return 0;
+    }
+
+    auto &longest_edge_weighted = longest_edge_weighted_;
+    auto &longest_multi_weighted = longest_multi_weighted_;
+    auto &indirect_edge_weighted = indirect_edge_weighted_;
+    auto &indirect_multi_weighted = indirect_multi_weighted_;
+    longest_edge_weighted.resize(num_nodes_);
+    longest_multi_weighted.resize(num_nodes_);
+    indirect_edge_weighted.resize(num_nodes_);
+    indirect_multi_weighted.resize(num_nodes_);
+    auto &removed_edges = removed_edges_;
+    removed_edges.clear();
+    for (int from = 1; from < num_nodes_; from++) {
+        int last_position = -1;
+        for (auto &p_edge : nodes_[from]->edges_) {
+            if (!p_edge->bidirectional_) {
+                last_position = std::max(last_position, topological_position[p_edge->node2_.lock()->id_]);
+            }
+        }
+        if (last_position < 0) {
+            continue;
+        }
+
+        // longest paths from `from`, nodes behind the farthest direct successor cannot help
+        int first_position = topological_position[from];
+        for (int pos = first_position; pos <= last_position; pos++) {
+            int id = topological_order[pos];
+            longest_edge_weighted[id] = kUnreachable;
+            longest_multi_weighted[id] = kUnreachable;
+            indirect_edge_weighted[id] = kUnreachable;
+            indirect_multi_weighted[id] = kUnreachable;
+        }
+        for (int pos = first_position; pos <= last_position; pos++) {
+            int via = topological_order[pos];
+            if (via != from && longest_edge_weighted[via] == kUnreachable) {
+                continue;
+            }
+            double via_edge_weighted = (via == from) ? 0.0 : longest_edge_weighted[via];
+            double via_multi_weighted = (via == from) ? 0.0 : longest_multi_weighted[via] + nodes_[via]->estimate_travel_time_;
+            for (auto &p_edge : nodes_[via]->edges_) {
+                int to = p_edge->node2_.lock()->id_;
+                if (p_edge->bidirectional_ || topological_position[to] > last_position) {
+                    continue;
+                }
+                double edge_weighted = via_edge_weighted + p_edge->edge_weight_;
+                double multi_weighted = via_multi_weighted + p_edge->getMultiWeight(activate_precedent_offset_);
+                longest_edge_weighted[to] = std::max(longest_edge_weighted[to], edge_weighted);
+                longest_multi_weighted[to] = std::max(longest_multi_weighted[to], multi_weighted);
+                if (via != from) {
+                    indirect_edge_weighted[to] = std::max(indirect_edge_weighted[to], edge_weighted);
+                    indirect_multi_weighted[to] = std::max(indirect_multi_weighted[to], multi_weighted);
+                }
+            }
+        }
+
+        auto &edges = nodes_[from]->edges_;
+        auto iter_edge = edges.begin();
+        while (iter_edge != edges.end()) {
+            auto &p_edge = *iter_edge;
+            int to = p_edge->node2_.lock()->id_;
+            if (!p_edge->bidirectional_ &&
+                indirect_edge_weighted[to] >= p_edge->edge_weight_ &&
+                indirect_multi_weighted[to] >= p_edge->getMultiWeight(activate_precedent_offset_)) {
+                removed_edges.push_back(p_edge);
+                iter_edge = edges.erase(iter_edge);
+                continue;
+            }
+            iter_edge++;
+        }
+    }
+
+    std::sort(removed_edges.begin(), removed_edges.end());
+    edges_.erase(std::remove_if(edges_.begin(), edges_.end(),
+                                [&](const std::shared_ptr<Edge> &p_edge) {
+                                    return std::binary_search(removed_edges.begin(), removed_edges.end(), p_edge);
+                                }),
+                 edges_.end());
+    int num_removed = removed_edges.size();
+    // reused by the next graph built
+    edge_pool_.Release(removed_edges);
+    return num_removed;
+}
+
+// Same order fairness as AddFairnessConflicts, but without materializing the O(n^2) edges:
+// the schedulers keep "vehicle j cannot start before every vehicle i <= j - threshold has finished"
+// through a FairnessWindow. Pairs already linked by a conflict edge keep only that edge, as in the edge form.
+void ConflictDirectedGraph::AddImplicitFairnessConflicts() {
+    fairness_order_diff_threshold_ = std::max(GetFairnessOrderDiffThreshold(), 1);
+}
+
 bool ConflictDirectedGraph::isFullyConnected() {
     std::queue<int> visit_queue;
     std::vector<bool> is_visited(num_nodes_, false);
@@ -0,0 +1,188 @@
+#include "demand_stream.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <iterator>
+
+#include "intersection_utility.h"
+#include "yaml-cpp/yaml.h"
+
+namespace intersection_management {
+
+DemandProfile getUniformDemandProfile(const Parameters &local_param) {
+    DemandProfile profile;
+    int num_lanes_in = 0;
+    for (auto num_in : local_param.num_lanes_in_vec) num_lanes_in += num_in;
+    for (int leg_id = 0; leg_id < local_param.num_legs; leg_id++) {
+        std::vector<double> turn_ratios(local_param.num_legs, 1.0);
+        turn_ratios[leg_id] = 0;
+        for (int lane_id = 0; lane_id < local_param.num_lanes_in_vec[leg_id]; lane_id++) {
+            profile.lanes_.push_back(LaneDemand{leg_id, lane_id, 1.0 / (local_param.arrival_interval_avg * num_lanes_in),
+                                                turn_ratios});
+        }
+    }
+    return profile;
+}
+
+DemandProfile ReadDemandProfile(const std::string &file) {
+    YAML::Node config = YAML::LoadFile(file);
+    DemandProfile profile;
+    for (auto lane : config["lanes"]) {
+        profile.lanes_.push_back(LaneDemand{lane["leg"].as<int>(), lane["lane"].as<int>(), lane["rate"].as<double>(),
+                                            lane["turn_ratios"].as<std::vector<double>>()});
+    }
+    if (config["time_of_day"]) {
+        profile.period_ = config["time_of_day"]["period"].as<double>(0);
+        for (auto step : config["time_of_day"]["steps"]) {
+            profile.time_of_day_.push_back(DemandProfileStep{step[0].as<double>(), step[1].as<double>()});
+        }
+    }
+    return profile;
+}
+
+DemandStream::DemandStream(const Parameters &local_param, const DemandProfile &profile, int seed) :
+    num_legs_(local_param.num_legs), num_lanes_out_vec_(local_param.num_lanes_out_vec),
+    travel_time_choice_(local_param.travel_time_choice), time_of_day_(profile.time_of_day_), period_(profile.period_),
+    peak_scale_(time_of_day_.empty() ? 1.0 : 0.0), peak_rate_(0), acceptance_dist_(0.0, 1.0), time_(0),
+    num_vehicles_(0), has_pending_(false) {
+    if (seed < 0) { std::random_device rd; mt_.seed(rd()); }
+    else { mt_.seed(seed); }
+
+    std::sort(time_of_day_.begin(), time_of_day_.end(),
+              [](const DemandProfileStep &a, const DemandProfileStep &b) { return a.start_time_ < b.start_time_; });
+    for (auto &step : time_of_day_) {
+        peak_scale_ = std::max(peak_scale_, step.rate_scale_);
+    }
+    if (std::any_of(time_of_day_.begin(), time_of_day_.end(),
+                    [](const DemandProfileStep &step) { return step.rate_scale_ < 0; })) {
+        std::cerr << "Demand profile has a negative rate scale.\n";
+        peak_scale_ = 0;
+    }
+    else if (peak_scale_ == 0) {
+        std::cerr << "Demand profile scales every rate to 0.\n";
+    }
+
+    std::vector<double> lane_rates;
+    for (auto &lane : profile.lanes_) {
+        if (lane.leg_id_ < 0 || lane.leg_id_ >= num_legs_ || lane.lane_id_ < 0 ||
+            lane.lane_id_ >= local_param.num_lanes_in_vec[lane.leg_id_] || lane.rate_ <= 0) {
+            std::cerr << "Demand of leg " << lane.leg_id_ << " lane " << lane.lane_id_ << " ignored, the lane is not in the geometry or has no rate.\n";
+            continue;
+        }
+        std::vector<double> turn_ratios(num_legs_, 0.0);
+        for (int leg_id = 0; leg_id < num_legs_ && leg_id < lane.turn_ratios_.size(); leg_id++) {
+            if (leg_id != lane.leg_id_ && num_lanes_out_vec_[leg_id] > 0) {
+                turn_ratios[leg_id] = std::max(lane.turn_ratios_[leg_id], 0.0);
+            }
+        }
+        if (std::all_of(turn_ratios.begin(), turn_ratios.end(), [](double ratio) { return ratio == 0; })) {
+            std::cerr << "Demand of leg " << lane.leg_id_ << " lane " << lane.lane_id_ << " ignored, it turns to no other leg.\n";
+            continue;
+        }
+        lanes_.push_back(lane);
+        lane_rates.push_back(lane.rate_);
+        out_leg_dist_.emplace_back(turn_ratios.begin(), turn_ratios.end());
+        peak_rate_ += lane.rate_;
+    }
+    peak_rate_ *= peak_scale_;
+    if (!hasDemand()) {
+        std::cerr << "Demand profile has no demand.\n";
+        return;
+    }
+    lane_dist_ = std::discrete_distribution<int>(lane_rates.begin(), lane_rates.end());
+    interval_dist_ = std::exponential_distribution<double>(peak_rate_);
+}
+
+double DemandStream::getRateScale(double time) const {
+    if (time_of_day_.empty()) {
+        return 1.0;
+    }
+    if (period_ > 0) {
+        time -= period_ * std::floor(time / period_);
+    }
+    auto iter_step = std::upper_bound(time_of_day_.begin(), time_of_day_.end(), time,
+                                      [](double time, const DemandProfileStep &step) { return time < step.start_time_; });
+    return iter_step == time_of_day_.begin() ? time_of_day_.back().rate_scale_ : std::prev(iter_step)->rate_scale_;
+}
+
+// the scale only changes at the step starts and, when the profile repeats, at the start of a period, so the
+// first of those in the period after time with a positive scale is the answer
+double DemandStream::getNextDemandTime(double time) const {
+    if (getRateScale(time) > 0) {
+        return time;
+    }
+    double next_time = std::numeric_limits<double>::infinity();
+    double period_start = period_ > 0 ? period_ * std::floor(time / period_) : 0;
+    for (int num_periods = 0; num_periods < (period_ > 0 ? 2 : 1); num_periods++) {
+        double offset = period_start + num_periods * period_;
+        if (num_periods > 0 && getRateScale(offset) > 0) {
+            next_time = std::min(next_time, offset);
+        }
+        for (auto &step : time_of_day_) {
+            bool is_in_period = period_ <= 0 || (step.start_time_ >= 0 && step.start_time_ < period_);
+            if (is_in_period && step.rate_scale_ > 0 && offset + step.start_time_ > time) {
+                next_time = std::min(next_time, offset + step.start_time_);
+            }
+        }
+    }
+    return next_time;
+}
+
+// candidates come at the peak rate and are kept with the ratio of the current rate to it. Steps without demand
+// are skipped, the arrivals being memoryless, and the stream ends if no demand follows
+bool DemandStream::Generate(VehicleTraceRecord &record) {
+    if (!hasDemand() || std::isinf(time_)) {
+        return false;
+    }
+    while (true) {
+        time_ += interval_dist_(mt_);
+        double rate_scale = getRateScale(time_);
+        if (rate_scale == 0) {
+            time_ = getNextDemandTime(time_);
+            if (std::isinf(time_)) {
+                return false;
+            }
+            continue;
+        }
+        if (acceptance_dist_(mt_) * peak_scale_ < rate_scale) {
+            break;
+        }
+    }
+
+    auto &lane = lanes_[lane_dist_(mt_)];
+    int out_leg_id = out_leg_dist_[&lane - lanes_.data()](mt_);
+    int out_lane_id = mt_() % num_lanes_out_vec_[out_leg_id];
+    record = VehicleTraceRecord{time_, getTurnTravelTime(travel_time_choice_, num_legs_, lane.leg_id_, out_leg_id),
+                                lane.leg_id_, lane.lane_id_, out_leg_id, out_lane_id};
+    num_vehicles_++;
+    return true;
+}
+
+bool DemandStream::Next(VehicleTraceRecord &record) {
+    if (has_pending_) {
+        record = pending_;
+        has_pending_ = false;
+        return true;
+    }
+    return Generate(record);
+}
+
+int DemandStream::NextBatch(std::vector<VehicleTraceRecord> &batch, int max_count, double end_time) {
+    int num_added = 0;
+    while (num_added < max_count) {
+        if (!has_pending_ && !Generate(pending_)) {
+            break;
+        }
+        has_pending_ = true;
+        if (pending_.arrival_time_ >= end_time) {
+            break;
+        }
+        batch.push_back(pending_);
+        has_pending_ = false;
+        num_added++;
+    }
+    return num_added;
+}
+
+} // namespace intersection_management
@@ -2,22 +2,52 @@
 
 #include <iostream>
 #include <random>
+#include <algorithm>
 #include "parameters.h"
 
 namespace intersection_management {
 
 void Intersection::reset() {
-    nodes_.clear();
-    edges_.clear();
     critical_resource_map_.clear();
     leg_map_.clear();
     lane_map_.clear();
+    has_route_class_table_ = false;
+    route_of_lane_pair_.clear();
+    ResetVehicles();
+}
+
+void Intersection::ResetVehicles() {
+    // nodes still held elsewhere keep their edges, see SharedObjectPool
+    for (auto &node : nodes_) {
+        if (node.use_count() == 1) {
+            node->edges_.clear();
+        }
+    }
+    node_pool_.Release(nodes_);
+    edge_pool_.Release(edges_);
+    arrival_order_.clear();
+    for (auto &cr_pair : critical_resource_map_) {
+        cr_pair.second->nodes_.clear();
+    }
     num_nodes_ = 0;
-    auto leading_node = std::make_shared<Node>(0); // virtual leading vehicle
-    leading_node->time_window_ = std::vector<double>({0, 0});
+    latest_arrival_time_ = 0;
+    auto leading_node = NewNode(0, 1.0, -1, -1, -1, -1, -1); // virtual leading vehicle
+    leading_node->time_window_.assign(2, 0);
     AddNode(leading_node);
 }
 
+void Intersection::Reconfigure(const Parameters &local_param) {
+    bool is_same_geometry = num_legs_ == local_param.num_legs && num_lanes_in_vec_ == local_param.num_lanes_in_vec &&
+                            num_lanes_out_vec_ == local_param.num_lanes_out_vec;
+    InitializeFromLocalParam(local_param);
+    if (is_same_geometry) {
+        ResetVehicles();
+        return;
+    }
+    reset();
+    AddIntersectionUtilitiesFromGeometry();
+}
+
 void Intersection::InitializeFromParam() {
     num_legs_ = param.num_legs;
     num_lanes_in_vec_ = param.num_lanes_in_vec;
@@ -26,7 +56,9 @@ void Intersection::InitializeFromParam() {
     for (auto num_in : num_lanes_in_vec_) num_lanes_ += num_in;
     for (auto num_out : num_lanes_in_vec_) num_lanes_ += num_out;
     arrival_interval_avg_ = param.arrival_interval_avg;
+    max_queueing_delay_ = param.max_queueing_delay;
     travel_time_range_ = param.travel_time_range;
+    activate_precedent_offset_ = param.activate_precedent_offset;
 
 
     // initialize random seed
@@ -39,7 +71,7 @@ void Intersection::InitializeFromParam() {
     }
 }
 
-void Intersection::InitializeFromLocalParam(Parameters local_param) {
+void Intersection::InitializeFromLocalParam(const Parameters &local_param) {
     num_legs_ = local_param.num_legs;
     num_lanes_in_vec_ = local_param.num_lanes_in_vec;
     num_lanes_out_vec_ = local_param.num_lanes_out_vec;
@@ -47,7 +79,9 @@ void Intersection::InitializeFromLocalParam(Parameters local_param) {
     for (auto num_in : num_lanes_in_vec_) num_lanes_ += num_in;
     for (auto num_out : num_lanes_in_vec_) num_lanes_ += num_out;
     arrival_interval_avg_ = local_param.arrival_interval_avg;
+    max_queueing_delay_ = local_param.max_queueing_delay;
     travel_time_range_ = local_param.travel_time_range;
+    activate_precedent_offset_ = local_param.activate_precedent_offset;
 
 
     // initialize random seed
@@ -79,6 +113,8 @@ void Intersection::AddCriticalResourcesFromGeometry() {
 void Intersection::AddLegsAndLanesFromGeometry() {
     leg_map_.clear();
     lane_map_.clear();
+    has_route_class_table_ = false;
+    route_of_lane_pair_.clear();
     int lane_unique_id = 0;
     for (int leg_id = 0; leg_id < num_legs_; leg_id++) {
         leg_map_[leg_id] = std::make_shared<Leg>(leg_id);
@@ -106,15 +142,83 @@ void Intersection::UpdateReferencesOfCriticalResoucesAndLegs() {
     }
 }
 
+const RouteClassTable &Intersection::getRouteClassTable() {
+    if (!has_route_class_table_) {
+        GenerateRouteClassTable();
+        has_route_class_table_ = true;
+    }
+    return route_class_table_;
+}
+
+void Intersection::GenerateRouteClassTable() {
+    auto &table = route_class_table_;
+    table.num_lanes_ = lane_map_.size();
+    table.num_route_classes_ = 0;
+    table.route_class_of_lane_pair_.assign(table.num_lanes_ * table.num_lanes_, -1);
+    std::vector<std::shared_ptr<Route>> routes;
+    for (auto &lane_in_pair : lane_map_) {
+        auto &lane_in = lane_in_pair.second;
+        if (!lane_in->isInBound()) continue;
+        for (auto &lane_out_pair : lane_map_) {
+            auto &lane_out = lane_out_pair.second;
+            if (!lane_out->isOutBound()) continue;
+            table.route_class_of_lane_pair_[lane_in->getUniqueId() * table.num_lanes_ + lane_out->getUniqueId()] =
+                table.num_route_classes_++;
+            routes.push_back(std::make_shared<Route>(lane_in, lane_out));
+        }
+    }
+
+    // same conflict types as the edges FIFO waits on, competing alone doesn't block
+    table.conflict_table_.assign(table.num_route_classes_, std::vector<int>());
+    for (int later = 0; later < table.num_route_classes_; later++) {
+        for (int earlier = 0; earlier < table.num_route_classes_; earlier++) {
+            ConflictType ct = routes[earlier]->FindConflictTypeWithRoute(routes[later]);
+            if (ct.isConverging() || ct.isCrossing() || ct.isDiverging() || ct.isPrecedence()) {
+                table.conflict_table_[later].push_back(earlier);
+            }
+        }
+    }
+}
+
 void Intersection::AddNode(std::shared_ptr<Node> node) {
     nodes_.push_back(node);
     num_nodes_++;
+    if (node->estimate_arrival_time_ > latest_arrival_time_) {
+        latest_arrival_time_ = node->estimate_arrival_time_;
+    }
+    if (node->id_ == 0) { // virtual leading vehicle is not part of the arrival order
+        return;
+    }
+    // vehicles usually come in arrival order, so this is an append
+    auto iter_position = std::upper_bound(arrival_order_.begin(), arrival_order_.end(), node->estimate_arrival_time_,
+                                          [&](double arrival_time, int id) { return arrival_time < nodes_[id]->estimate_arrival_time_; });
+    arrival_order_.insert(iter_position, node->id_);
 }
 
 void Intersection::AddEdge(std::shared_ptr<Edge> edge) {
     edges_.push_back(edge);
 }
 
+std::shared_ptr<Node> Intersection::NewNode(int id, double ett, int in_leg_id, int in_lane_id, int out_leg_id,
+                                            int out_lane_id, double eat) {
+    auto node = node_pool_.Acquire();
+    if (node == nullptr) {
+        return std::make_shared<Node>(id, ett, in_leg_id, in_lane_id, out_leg_id, out_lane_id, eat);
+    }
+    node->Reinitialize(id, ett, in_leg_id, in_lane_id, out_leg_id, out_lane_id, eat);
+    return node;
+}
+
+std::shared_ptr<Edge> Intersection::NewEdge(std::shared_ptr<Node> &node1, std::shared_ptr<Node> &node2, double offset,
+                                            ConflictType ct, int predecessor_id) {
+    auto edge = edge_pool_.Acquire();
+    if (edge == nullptr) {
+        return std::make_shared<Edge>(node1, node2, offset, ct, predecessor_id);
+    }
+    *edge = Edge(node1, node2, offset, ct, predecessor_id);
+    return edge;
+}
+
 void Intersection::AddRandomVehicleNodes(int count, bool verbose) {
     std::uniform_int_distribution<int> travel_time_dist(travel_time_range_[0], travel_time_range_[1]);
     std::poisson_distribution<int> arrival_interval_dist(arrival_interval_avg_);
@@ -122,11 +226,7 @@ void Intersection::AddRandomVehicleNodes(int count, bool verbose) {
     // for (auto num_in : num_lanes_in_vec_) num_total_lanes += num_in;
     // for (auto num_out : num_lanes_out_vec_) num_total_lanes += num_out;
 
-    int last_arrival_time = 0;
-    for (auto n : nodes_) {
-        if (n->estimate_arrival_time_ > last_arrival_time)
-            last_arrival_time = n->estimate_arrival_time_;
-    }
+    int last_arrival_time = latest_arrival_time_;
 
     for (int id = 1; id <= count; id++) { // id 0 is automatically created for the virtual leading vehicle on initialization or reset
         auto in_lane = lane_map_[mt_() % num_total_lanes];
@@ -138,8 +238,8 @@ void Intersection::AddRandomVehicleNodes(int count, bool verbose) {
         if (getNumNodes() > 1) {
             last_arrival_time += arrival_interval_dist(mt_);
         }
-        auto node = std::make_shared<Node>(id, travel_time_dist(mt_), in_lane->getLegId(), in_lane->getId(),
-                                           out_lane->getLegId(), out_lane->getId(), last_arrival_time);
+        auto node = NewNode(id, travel_time_dist(mt_), in_lane->getLegId(), in_lane->getId(), out_lane->getLegId(),
+                            out_lane->getId(), last_arrival_time);
         AddNode(node);
         if (verbose)
             node->printDetail();
@@ -154,11 +254,7 @@ void Intersection::AddRandomVehicleNodesWithTravelTime(int count, std::vector<do
     // for (auto num_in : num_lanes_in_vec_) num_total_lanes += num_in;
     // for (auto num_out : num_lanes_out_vec_) num_total_lanes += num_out;
 
-    int last_arrival_time = 0;
-    for (auto n : nodes_) {
-        if (n->estimate_arrival_time_ > last_arrival_time)
-            last_arrival_time = n->estimate_arrival_time_;
-    }
+    int last_arrival_time = latest_arrival_time_;
 
     for (int id = 1; id <= count; id++) { // id 0 is automatically created for the virtual leading vehicle on initialization or reset
         auto in_lane = lane_map_[mt_() % num_total_lanes];
@@ -180,21 +276,70 @@ void Intersection::AddRandomVehicleNodesWithTravelTime(int count, std::vector<do
         else {
             estimate_travel_time = travel_time_choice[1]; // straight
         }
-        auto node = std::make_shared<Node>(id, estimate_travel_time, in_lane->getLegId(), in_lane->getId(),
-                                           out_lane->getLegId(), out_lane->getId(), last_arrival_time);
+        auto node = NewNode(id, estimate_travel_time, in_lane->getLegId(), in_lane->getId(), out_lane->getLegId(),
+                            out_lane->getId(), last_arrival_time);
         AddNode(node);
         if (verbose)
             node->printDetail();
     }
 }
 
+int Intersection::AddVehicleNodesFromTrace(VehicleTraceReader &trace, int max_count, bool verbose) {
+    auto hasLane = [&](int leg_id, int lane_id, bool in_bound) {
+        auto iter_leg = leg_map_.find(leg_id);
+        if (iter_leg == leg_map_.end()) {
+            return false;
+        }
+        auto &lanes = in_bound ? iter_leg->second->lanes_in_map_ : iter_leg->second->lanes_out_map_;
+        return lanes.find(lane_id) != lanes.end();
+    };
+    int num_added = 0;
+    VehicleTraceRecord record;
+    while (num_added < max_count && trace.Next(record)) {
+        if (!hasLane(record.in_leg_id_, record.in_lane_id_, true) || !hasLane(record.out_leg_id_, record.out_lane_id_, false)) {
+            std::cerr << "Trace vehicle " << trace.getNumRecords() - 1 << " skipped, its lanes are not in the geometry.\n";
+            continue;
+        }
+        auto node = NewNode(getNumNodes(), record.travel_time_, record.in_leg_id_, record.in_lane_id_,
+                            record.out_leg_id_, record.out_lane_id_, record.arrival_time_);
+        AddNode(node);
+        num_added++;
+        if (verbose)
+            node->printDetail();
+    }
+    return num_added;
+}
+
+int Intersection::AddVehicleNodesFromDemand(DemandStream &demand, int count, bool verbose) {
+    int num_added = 0;
+    VehicleTraceRecord record;
+    while (num_added < count && demand.Next(record)) {
+        auto node = NewNode(getNumNodes(), record.travel_time_, record.in_leg_id_, record.in_lane_id_,
+                            record.out_leg_id_, record.out_lane_id_, record.arrival_time_);
+        AddNode(node);
+        num_added++;
+        if (verbose)
+            node->printDetail();
+    }
+    return num_added;
+}
+
 void Intersection::AssignRoutesToNodes() {
     for (int id = 1; id < nodes_.size(); id++) {
         auto &node = nodes_[id];
-        std::shared_ptr<Lane> &lane_in = leg_map_[node->in_leg_id_]->lanes_in_map_[node->in_lane_id_];
-        std::shared_ptr<Lane> &lane_out = leg_map_[node->out_leg_id_]->lanes_out_map_[node->out_lane_id_];
-        node->route_ = std::make_shared<Route>(lane_in, lane_out);
+        node->route_ = getRoute(node->in_leg_id_, node->in_lane_id_, node->out_leg_id_, node->out_lane_id_);
+    }
+}
+
+std::shared_ptr<Route> Intersection::getRoute(int in_leg_id, int in_lane_id, int out_leg_id, int out_lane_id) {
+    route_of_lane_pair_.resize(lane_map_.size() * lane_map_.size());
+    std::shared_ptr<Lane> &lane_in = leg_map_[in_leg_id]->lanes_in_map_[in_lane_id];
+    std::shared_ptr<Lane> &lane_out = leg_map_[out_leg_id]->lanes_out_map_[out_lane_id];
+    auto &route = route_of_lane_pair_[lane_in->getUniqueId() * lane_map_.size() + lane_out->getUniqueId()];
+    if (route == nullptr) {
+        route = std::make_shared<Route>(lane_in, lane_out);
     }
+    return route;
 }
 
 void Intersection::AssignCriticalResourcesToNodes() {
@@ -214,38 +359,106 @@ void Intersection::AssignEdgesWithSafetyOffsetToNodes() {
     ConflictType ct_precedence;
     ct_precedence.setPrecedence();
     for (int i = 1; i < nodes_.size(); i++) {
-        auto edge_to_virtual_leading = std::make_shared<Edge>(nodes_[0], nodes_[i], 0, ct_precedence, 0);
+        auto edge_to_virtual_leading = NewEdge(nodes_[0], nodes_[i], 0, ct_precedence, 0);
         nodes_[0]->edges_.push_back(edge_to_virtual_leading);
         nodes_[i]->edges_.push_back(edge_to_virtual_leading);
         AddEdge(edge_to_virtual_leading);
     }
 
-    for (int i = 1; i < nodes_.size(); i++) {
-        for (int j = i + 1; j < nodes_.size(); j++) {
-            ConflictType ct = nodes_[i]->route_->FindConflictTypeWithRoute(nodes_[j]->route_);
-            int predecessor_id = -1;
-            double offset = 0;
-            if (ct.isDiverging()) {
-                predecessor_id = i;
-                if (param.activate_precedent_offset) {
-                    offset = -1;
-                } else {
-                    offset = 0;
-                }
-                
+    if (max_queueing_delay_ < 0) {
+        for (int i = 1; i < nodes_.size(); i++) {
+            for (int j = i + 1; j < nodes_.size(); j++) {
+                AssignEdgeWithSafetyOffset(i, j);
+            }
+        }
+        return;
+    }
+
+    // horizon-bounded mode: vehicle i leaves the intersection no later than its arrival plus the
+    // maximum queueing delay plus its travel time, so a sweep over the arrival order only needs to
+    // pair it with vehicles arriving inside that window. Schedules that delay a vehicle beyond
+    // max_queueing_delay_ get the pairs left out back from AddConflictsMissedByHorizon. That only sees
+    // windows that overlap, so a vehicle is linked to the one ahead of it in its lane whatever the horizon,
+    // or it could pass a vehicle delayed past its exit
+    last_in_lane_.assign(lane_map_.size(), -1);
+    for (int pos_i = 0; pos_i < arrival_order_.size(); pos_i++) {
+        auto &node_i = nodes_[arrival_order_[pos_i]];
+        int &id_ahead = last_in_lane_[node_i->route_->getLaneIn()->getUniqueId()];
+        if (id_ahead >= 0) {
+            auto &node_ahead = nodes_[id_ahead];
+            double latest_departure_ahead =
+                node_ahead->estimate_arrival_time_ + max_queueing_delay_ + node_ahead->estimate_travel_time_;
+            // pairs within the horizon are linked by the sweep from the vehicle ahead
+            if (node_i->estimate_arrival_time_ > latest_departure_ahead) {
+                AssignEdgeWithSafetyOffset(std::min(id_ahead, node_i->id_), std::max(id_ahead, node_i->id_));
             }
-            else if (!ct.isNotConflicting()) {
-                offset = 0;
+        }
+        id_ahead = node_i->id_;
+        double latest_departure = node_i->estimate_arrival_time_ + max_queueing_delay_ + node_i->estimate_travel_time_;
+        for (int pos_j = pos_i + 1; pos_j < arrival_order_.size(); pos_j++) {
+            auto &node_j = nodes_[arrival_order_[pos_j]];
+            if (node_j->estimate_arrival_time_ > latest_departure) {
+                break;
             }
-            else {
-                continue; // non-conflict relation don't need edges
+            AssignEdgeWithSafetyOffset(std::min(node_i->id_, node_j->id_), std::max(node_i->id_, node_j->id_));
+        }
+    }
+}
+
+int Intersection::AddConflictsMissedByHorizon(const std::vector<double> &exit_time) {
+    if (max_queueing_delay_ < 0) {
+        return 0;
+    }
+    auto getEntryTime = [&](int id) { return exit_time[id] - nodes_[id]->estimate_travel_time_; };
+    entry_order_ = arrival_order_;
+    auto &entry_order = entry_order_;
+    std::sort(entry_order.begin(), entry_order.end(), [&](int a, int b) { return getEntryTime(a) < getEntryTime(b); });
+    int num_edges = edges_.size();
+    for (int pos_a = 0; pos_a < entry_order.size(); pos_a++) {
+        int a = entry_order[pos_a];
+        for (int pos_b = pos_a + 1; pos_b < entry_order.size() && getEntryTime(entry_order[pos_b]) < exit_time[a];
+             pos_b++) {
+            int b = entry_order[pos_b];
+            auto &front = nodes_[a]->estimate_arrival_time_ <= nodes_[b]->estimate_arrival_time_ ? nodes_[a] : nodes_[b];
+            auto &back = front == nodes_[a] ? nodes_[b] : nodes_[a];
+            // pairs within the horizon already have their edge if they conflict
+            if (back->estimate_arrival_time_ <=
+                front->estimate_arrival_time_ + max_queueing_delay_ + front->estimate_travel_time_ ||
+                nodes_[a]->isConnectedWith(b, true)) {
+                continue;
             }
-            auto edge = std::make_shared<Edge>(nodes_[i], nodes_[j], offset, ct, predecessor_id);
-            nodes_[i]->edges_.push_back(edge);
-            nodes_[j]->edges_.push_back(edge);
-            AddEdge(edge);
+            AssignEdgeWithSafetyOffset(std::min(a, b), std::max(a, b));
         }
     }
+    return edges_.size() - num_edges;
+}
+
+// add the conflict edge between two vehicles, id_front is the one ahead in the lane when diverging
+void Intersection::AssignEdgeWithSafetyOffset(int id_front, int id_back) {
+    int i = id_front;
+    int j = id_back;
+    ConflictType ct = nodes_[i]->route_->FindConflictTypeWithRoute(nodes_[j]->route_);
+    int predecessor_id = -1;
+    double offset = 0;
+    if (ct.isDiverging()) {
+        predecessor_id = i;
+        if (activate_precedent_offset_) {
+            offset = -1;
+        } else {
+            offset = 0;
+        }
+
+    }
+    else if (!ct.isNotConflicting()) {
+        offset = 0;
+    }
+    else {
+        return; // non-conflict relation don't need edges
+    }
+    auto edge = NewEdge(nodes_[i], nodes_[j], offset, ct, predecessor_id);
+    nodes_[i]->edges_.push_back(edge);
+    nodes_[j]->edges_.push_back(edge);
+    AddEdge(edge);
 }
 
 bool Intersection::isRightmostTurningRoute(std::shared_ptr<Route> route) {
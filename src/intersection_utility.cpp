@@ -4,6 +4,7 @@
 #include <iomanip>
 #include <vector>
 #include <algorithm>
+#include <array>
 
 namespace intersection_management {
 
@@ -50,6 +51,44 @@ Node::Node(const Node &node) {
     route_ = node.route_;
 }
 
+void Node::Reinitialize(int id, double ett, int in_leg_id, int in_lane_id, int out_leg_id, int out_lane_id,
+                        double eat) {
+    id_ = id;
+    estimate_travel_time_ = ett;
+    depth_ = -1;
+    edge_weighted_depth_ = -1;
+    edge_node_weighted_depth_ = -1;
+    edges_.clear();
+    time_window_.assign(2, -1);
+    estimate_arrival_time_ = eat;
+    in_lane_id_ = in_lane_id;
+    in_leg_id_ = in_leg_id;
+    out_lane_id_ = out_lane_id;
+    out_leg_id_ = out_leg_id;
+    assigned_lane_id_ = -1;
+    possible_lane_id_.clear();
+    critical_resource_ = nullptr;
+    route_ = nullptr;
+}
+void Node::Reinitialize(const Node &node) {
+    id_ = node.id_;
+    estimate_travel_time_ = node.estimate_travel_time_;
+    depth_ = node.depth_;
+    edge_weighted_depth_ = node.edge_weighted_depth_;
+    edge_node_weighted_depth_ = node.edge_node_weighted_depth_;
+    edges_.clear();
+    time_window_ = node.time_window_;
+    estimate_arrival_time_ = node.estimate_arrival_time_;
+    in_lane_id_ = node.in_lane_id_;
+    in_leg_id_ = node.in_leg_id_;
+    out_lane_id_ = node.out_lane_id_;
+    out_leg_id_ = node.out_leg_id_;
+    assigned_lane_id_ = node.assigned_lane_id_;
+    possible_lane_id_.clear();
+    critical_resource_ = node.critical_resource_;
+    route_ = node.route_;
+}
+
 void Node::printWeightAndEdge() {
     std::cout << "Node " << id_ << " has weight: " << estimate_travel_time_;
     std::cout << ". Connects with: ";
@@ -100,7 +139,7 @@ std::shared_ptr<Edge> Node::getEdgeTo(std::shared_ptr<Node> &p_n) {
 
 // bidirectional, any edge connect with node with id, bidirectional has a default value of true
 bool Node::isConnectedWith(int id, bool bidirectional) {
-    for (auto p_edge : edges_) {
+    for (auto &p_edge : edges_) {
         if ((p_edge->node2_.lock()->id_ == id) || (bidirectional && p_edge->node1_.lock()->id_ == id)) {
             return true;
         }
@@ -116,7 +155,7 @@ bool Node::isConnectedWith(std::shared_ptr<Node> &p_n) {
 
 // bidirectional, any edge connect with node with id
 std::shared_ptr<Edge> Node::getEdgeWith(int id, bool bidirectional) {
-    for (auto p_edge : edges_) {
+    for (auto &p_edge : edges_) {
         if ((p_edge->node2_.lock()->id_ == id) || (bidirectional && p_edge->node1_.lock()->id_ == id)) {
             return p_edge;
         }
@@ -158,11 +197,11 @@ ConflictType Route::FindConflictTypeWithRoute(std::shared_ptr<Route> other_route
 
     // Crossing relationship only when not diverging nor converging
     if (!(ct.isDiverging() || ct.isConverging())) {
-        std::vector<std::pair<int, char>> lane_id_route_pair; // 's' for self, 'o' for other
-        lane_id_route_pair.push_back(std::make_pair(getLaneIn()->getUniqueId(), 's'));
-        lane_id_route_pair.push_back(std::make_pair(getLaneOut()->getUniqueId(), 's'));
-        lane_id_route_pair.push_back(std::make_pair(other_route->getLaneIn()->getUniqueId(), 'o'));
-        lane_id_route_pair.push_back(std::make_pair(other_route->getLaneOut()->getUniqueId(), 'o'));
+        std::array<std::pair<int, char>, 4> lane_id_route_pair = {{ // 's' for self, 'o' for other
+            {getLaneIn()->getUniqueId(), 's'},
+            {getLaneOut()->getUniqueId(), 's'},
+            {other_route->getLaneIn()->getUniqueId(), 'o'},
+            {other_route->getLaneOut()->getUniqueId(), 'o'}}};
         std::sort(lane_id_route_pair.begin(), lane_id_route_pair.end(),
                   [](std::pair<int, char> a, std::pair<int, char> b) {return a.first < b.first; });
         char route_code_minimum_id = lane_id_route_pair[0].second;
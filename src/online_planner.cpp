@@ -0,0 +1,394 @@
+#include "online_planner.h"
+
+#include <algorithm>
+#include <chrono>
+#include <numeric>
+
+#include "plan_delta.h"
+
+namespace intersection_management {
+
+PlanningWindow::PlanningWindow(const Parameters &local_param) :
+    num_entered_(0), local_param_(local_param), intersection_(local_param), first_vehicle_id_(0),
+    last_in_lane_(intersection_.getNumLanes(), -1), next_vehicle_id_(0) {}
+
+void PlanningWindow::Classify(const std::vector<VehicleTraceRecord> &batch) {
+    arrivals_.clear();
+    arrival_vehicles_.clear();
+    ConflictType conflict_type;
+    for (auto &record : batch) {
+        arrivals_.push_back(OnlineVehicle{next_vehicle_id_++, record});
+        arrival_vehicles_.push_back(WindowVehicle{intersection_.getRoute(record.in_leg_id_, record.in_lane_id_,
+                                                                         record.out_leg_id_, record.out_lane_id_),
+                                                  -1, {}});
+        auto &vehicle = arrivals_.back();
+        auto &window_vehicle = arrival_vehicles_.back();
+        // the vehicle ahead in the lane is paired whatever the horizon, see
+        // Intersection::AssignEdgesWithSafetyOffsetToNodes
+        long &id_ahead = last_in_lane_[window_vehicle.route_->getLaneIn()->getUniqueId()];
+        for (auto *vehicles : {&entered_, &waiting_}) {
+            for (auto &other : *vehicles) {
+                if (other.vehicle_id_ != id_ahead && !isWithinHorizon(other.record_, vehicle.record_)) {
+                    continue;
+                }
+                auto &other_route = getWindowVehicle(other.vehicle_id_).route_;
+                conflict_type = window_vehicle.route_->FindConflictTypeWithRoute(other_route);
+                if (!conflict_type.isNotConflicting()) {
+                    window_vehicle.conflicts_.push_back(VehicleConflict{other.vehicle_id_, conflict_type});
+                }
+            }
+        }
+        for (int index = 0; index + 1 < arrivals_.size(); index++) {
+            auto &other = arrivals_[index];
+            if (other.vehicle_id_ != id_ahead && !isWithinHorizon(other.record_, vehicle.record_)) {
+                continue;
+            }
+            conflict_type = window_vehicle.route_->FindConflictTypeWithRoute(arrival_vehicles_[index].route_);
+            if (!conflict_type.isNotConflicting()) {
+                window_vehicle.conflicts_.push_back(VehicleConflict{other.vehicle_id_, conflict_type});
+                arrival_vehicles_[index].conflicts_.push_back(VehicleConflict{vehicle.vehicle_id_, conflict_type});
+            }
+        }
+        id_ahead = vehicle.vehicle_id_;
+    }
+}
+
+void PlanningWindow::Admit(double now, const IntersectionPlan &plan) {
+    int num_inside = 0;
+    for (int index = 0; index < entered_.size(); index++) {
+        if (entered_windows_[index].exit_time_ > now) {
+            entered_[num_inside] = entered_[index];
+            entered_windows_[num_inside++] = entered_windows_[index];
+        }
+        else {
+            Retire(entered_[index].vehicle_id_);
+        }
+    }
+    entered_.resize(num_inside);
+    entered_windows_.resize(num_inside);
+
+    // both are by ascending vehicle id
+    int num_waiting = 0;
+    auto iter_planned = plan.vehicles_.begin();
+    for (int index = 0; index < waiting_.size(); index++) {
+        while (iter_planned != plan.vehicles_.end() && iter_planned->vehicle_id_ < waiting_[index].vehicle_id_) {
+            iter_planned++;
+        }
+        if (iter_planned != plan.vehicles_.end() && iter_planned->vehicle_id_ == waiting_[index].vehicle_id_ &&
+            iter_planned->entry_time_ <= now) {
+            entry_delay_.Add(iter_planned->entry_time_ - waiting_[index].record_.arrival_time_);
+            num_entered_++;
+            if (iter_planned->exit_time_ > now) {
+                entered_.push_back(waiting_[index]);
+                entered_windows_.push_back(*iter_planned);
+            }
+            else {
+                Retire(waiting_[index].vehicle_id_);
+            }
+        }
+        else {
+            waiting_[num_waiting++] = waiting_[index];
+        }
+    }
+    waiting_.resize(num_waiting);
+    while (!vehicles_.empty() && vehicles_.front().route_ == nullptr) {
+        vehicles_.pop_front();
+        first_vehicle_id_++;
+    }
+
+    // the conflicts with vehicles retired since Classify are dropped, the others are kept by both vehicles
+    for (int index = 0; index < arrivals_.size(); index++) {
+        auto &conflicts = arrival_vehicles_[index].conflicts_;
+        int num_kept = 0;
+        for (auto &conflict : conflicts) {
+            if (conflict.vehicle_id_ < arrivals_.front().vehicle_id_) {
+                if (conflict.vehicle_id_ < first_vehicle_id_ || getWindowVehicle(conflict.vehicle_id_).route_ == nullptr) {
+                    continue;
+                }
+                getWindowVehicle(conflict.vehicle_id_).conflicts_.push_back(
+                    VehicleConflict{arrivals_[index].vehicle_id_, conflict.conflict_type_});
+            }
+            conflicts[num_kept++] = conflict;
+        }
+        conflicts.resize(num_kept);
+        waiting_.push_back(arrivals_[index]);
+        vehicles_.push_back(std::move(arrival_vehicles_[index]));
+    }
+    arrivals_.clear();
+    arrival_vehicles_.clear();
+}
+
+void PlanningWindow::BuildJob(double now, PlanningJob &job) {
+    job.now_ = now;
+    job.num_inside_ = entered_.size();
+    job.waiting_ = waiting_;
+    job.cdg_.reset(false);
+    if (waiting_.empty()) {
+        return;
+    }
+
+    // nodes like GenerateGraphFromIntersection, every vehicle after the virtual leading one
+    auto &cdg = job.cdg_;
+    for (auto *vehicles : {&entered_, &waiting_}) {
+        for (auto &vehicle : *vehicles) {
+            auto &record = vehicle.record_;
+            getWindowVehicle(vehicle.vehicle_id_).node_id_ = cdg.num_nodes_;
+            cdg.AddNode(record.travel_time_);
+            auto &node = cdg.nodes_.back();
+            node->in_leg_id_ = record.in_leg_id_;
+            node->in_lane_id_ = record.in_lane_id_;
+            node->out_leg_id_ = record.out_leg_id_;
+            node->out_lane_id_ = record.out_lane_id_;
+            node->estimate_arrival_time_ = record.arrival_time_;
+            cdg.AddEdgeUnchecked(0, node->id_, 1.0, false);
+            cdg.edges_.back()->conflict_type_.setPrecedence();
+            cdg.edges_.back()->estimate_offset_ = 0;
+        }
+    }
+    // every pair from its lower node, by node ids, dropping the conflicts with vehicles that have left
+    for (int id = 1; id < cdg.num_nodes_; id++) {
+        auto &conflicts = getWindowVehicle(getVehicleOfNode(job, id).vehicle_id_).conflicts_;
+        conflicts.erase(std::remove_if(conflicts.begin(), conflicts.end(),
+                                       [&](const VehicleConflict &conflict) { return getNodeId(conflict.vehicle_id_) < 0; }),
+                        conflicts.end());
+        back_conflicts_.clear();
+        for (auto &conflict : conflicts) {
+            int other_id = getNodeId(conflict.vehicle_id_);
+            if (other_id > id) {
+                back_conflicts_.emplace_back(other_id, conflict.conflict_type_);
+            }
+        }
+        std::sort(back_conflicts_.begin(), back_conflicts_.end(),
+                  [](const std::pair<int, ConflictType> &a, const std::pair<int, ConflictType> &b) { return a.first < b.first; });
+        for (auto &back_conflict : back_conflicts_) {
+            AddConflictEdge(job, id, back_conflict.first, back_conflict.second);
+        }
+    }
+    if (local_param_.activate_transitive_reduction) {
+        cdg.ReduceTransitiveEdges();
+    }
+
+    job.fixed_depth_.assign(cdg.num_nodes_, -1.0);
+    for (int id = 1; id <= job.num_inside_; id++) {
+        job.fixed_depth_[id] = entered_windows_[id - 1].exit_time_ - now;
+    }
+}
+
+bool PlanningWindow::AddMissedConflicts(const IntersectionPlan &plan, PlanningJob &job) {
+    if (local_param_.max_queueing_delay < 0 || job.waiting_.empty()) {
+        return false;
+    }
+    // node ids as in BuildJob, the plan has the waiting vehicles at the same index
+    exit_time_.assign(job.cdg_.num_nodes_, 0);
+    for (int id = 1; id <= job.num_inside_; id++) {
+        exit_time_[id] = entered_windows_[id - 1].exit_time_;
+    }
+    for (int index = 0; index < plan.vehicles_.size(); index++) {
+        exit_time_[job.num_inside_ + 1 + index] = plan.vehicles_[index].exit_time_;
+    }
+    auto getEntryTime = [&](int id) { return exit_time_[id] - getVehicleOfNode(job, id).record_.travel_time_; };
+    entry_order_.resize(job.cdg_.num_nodes_ - 1);
+    std::iota(entry_order_.begin(), entry_order_.end(), 1);
+    std::sort(entry_order_.begin(), entry_order_.end(), [&](int a, int b) { return getEntryTime(a) < getEntryTime(b); });
+    int num_added = 0;
+    ConflictType conflict_type;
+    for (int pos_a = 0; pos_a < entry_order_.size(); pos_a++) {
+        int a = entry_order_[pos_a];
+        auto &vehicle_a = getVehicleOfNode(job, a);
+        auto &conflicts_a = getWindowVehicle(vehicle_a.vehicle_id_).conflicts_;
+        for (int pos_b = pos_a + 1; pos_b < entry_order_.size() && getEntryTime(entry_order_[pos_b]) < exit_time_[a];
+             pos_b++) {
+            int b = entry_order_[pos_b];
+            auto &vehicle_b = getVehicleOfNode(job, b);
+            // pairs within the horizon got their conflict on admission, the others once they were missed
+            if (isWithinHorizon(vehicle_a.record_, vehicle_b.record_) ||
+                std::any_of(conflicts_a.begin(), conflicts_a.end(),
+                            [&](const VehicleConflict &conflict) { return conflict.vehicle_id_ == vehicle_b.vehicle_id_; })) {
+                continue;
+            }
+            if (AddConflict(vehicle_a, vehicle_b, conflict_type)) {
+                AddConflictEdge(job, a, b, conflict_type);
+                num_added++;
+            }
+        }
+    }
+    if (num_added == 0) {
+        return false;
+    }
+    if (local_param_.activate_transitive_reduction) {
+        job.cdg_.ReduceTransitiveEdges();
+    }
+    return true;
+}
+
+int PlanningWindow::getNodeId(long vehicle_id) {
+    if (vehicle_id < first_vehicle_id_) {
+        return -1;
+    }
+    auto &vehicle = getWindowVehicle(vehicle_id);
+    return vehicle.route_ == nullptr ? -1 : vehicle.node_id_;
+}
+
+const OnlineVehicle &PlanningWindow::getVehicleOfNode(const PlanningJob &job, int node_id) const {
+    return node_id <= job.num_inside_ ? entered_[node_id - 1] : waiting_[node_id - job.num_inside_ - 1];
+}
+
+bool PlanningWindow::isWithinHorizon(const VehicleTraceRecord &record_a, const VehicleTraceRecord &record_b) const {
+    if (local_param_.max_queueing_delay < 0) {
+        return true;
+    }
+    auto &front = record_a.arrival_time_ <= record_b.arrival_time_ ? record_a : record_b;
+    auto &back = &front == &record_a ? record_b : record_a;
+    return back.arrival_time_ <= front.arrival_time_ + local_param_.max_queueing_delay + front.travel_time_;
+}
+
+bool PlanningWindow::AddConflict(const OnlineVehicle &vehicle_a, const OnlineVehicle &vehicle_b,
+                                 ConflictType &conflict_type) {
+    auto &window_a = getWindowVehicle(vehicle_a.vehicle_id_);
+    auto &window_b = getWindowVehicle(vehicle_b.vehicle_id_);
+    conflict_type = window_a.route_->FindConflictTypeWithRoute(window_b.route_);
+    if (conflict_type.isNotConflicting()) {
+        return false;
+    }
+    window_a.conflicts_.push_back(VehicleConflict{vehicle_b.vehicle_id_, conflict_type});
+    window_b.conflicts_.push_back(VehicleConflict{vehicle_a.vehicle_id_, conflict_type});
+    return true;
+}
+
+// the edge Intersection::AssignEdgeWithSafetyOffset gives the pair with the lower node in front, as
+// GenerateGraphFromIntersection turns it into edges of the graph
+void PlanningWindow::AddConflictEdge(PlanningJob &job, int node_a, int node_b, ConflictType conflict_type) {
+    auto &cdg = job.cdg_;
+    double offset = conflict_type.isDiverging() && intersection_.activate_precedent_offset_ ? -1 : 0;
+    cdg.AddEdgeUnchecked(std::min(node_a, node_b), std::max(node_a, node_b), std::max(offset, 1.0),
+                         !conflict_type.isPrecedence());
+    for (auto iter_edge = cdg.edges_.end() - (conflict_type.isPrecedence() ? 1 : 2); iter_edge != cdg.edges_.end();
+         iter_edge++) {
+        (*iter_edge)->conflict_type_ = conflict_type;
+        (*iter_edge)->estimate_offset_ = offset;
+    }
+}
+
+void PlanningWindow::Retire(long vehicle_id) {
+    auto &vehicle = getWindowVehicle(vehicle_id);
+    vehicle.route_ = nullptr;
+    vehicle.conflicts_.clear();
+    vehicle.conflicts_.shrink_to_fit();
+}
+
+// vehicles of the previous plan go by their entries in it, after the vehicles inside
+bool PlanningScheduler::BuildSeedOrder(const PlanningJob &job, const IntersectionPlan &previous) {
+    if (num_plans_since_cold_start_ + 1 >= warm_start_.cold_start_period_ || previous.vehicles_.empty()) {
+        return false;
+    }
+    previous_entries_.clear();
+    auto iter_planned = previous.vehicles_.begin();
+    for (int index = 0; index < job.waiting_.size(); index++) {
+        while (iter_planned != previous.vehicles_.end() && iter_planned->vehicle_id_ < job.waiting_[index].vehicle_id_) {
+            iter_planned++;
+        }
+        if (iter_planned != previous.vehicles_.end() && iter_planned->vehicle_id_ == job.waiting_[index].vehicle_id_) {
+            previous_entries_.emplace_back(iter_planned->entry_time_, job.num_inside_ + 1 + index);
+        }
+    }
+    if (job.waiting_.size() - previous_entries_.size() > warm_start_.max_new_fraction_ * job.waiting_.size()) {
+        return false;
+    }
+    std::sort(previous_entries_.begin(), previous_entries_.end());
+    seed_order_.clear();
+    for (int id = 1; id <= job.num_inside_; id++) {
+        seed_order_.push_back(id);
+    }
+    for (auto &entry : previous_entries_) {
+        seed_order_.push_back(entry.second);
+    }
+    return true;
+}
+
+void PlanningScheduler::Schedule(const PlanningJob &job, const IntersectionPlan &previous, IntersectionPlan &plan) {
+    plan.plan_time_ = job.now_;
+    plan.vehicles_.clear();
+    if (job.waiting_.empty()) {
+        return;
+    }
+
+    std::vector<double> depth;
+    if (BuildSeedOrder(job, previous)) {
+        depth = scheduler_.ScheduleFromSeedOrder(job.cdg_, seed_order_, order_, &job.fixed_depth_);
+    }
+    if (!depth.empty()) {
+        num_warm_starts_++;
+        num_plans_since_cold_start_++;
+    }
+    else {
+        scheduler_.ScheduleWithBfstMultiWeight(job.cdg_, result_);
+        // depths count from now, the vehicles inside go first with the depths of their exits
+        order_.assign(1, 0);
+        for (int id = 1; id <= job.num_inside_; id++) {
+            order_.push_back(id);
+        }
+        for (int id : result_.order_) {
+            if (id > job.num_inside_) {
+                order_.push_back(id);
+            }
+        }
+        depth = scheduler_.GetDepthVectorFromOrder(order_, job.cdg_, &job.fixed_depth_);
+        num_plans_since_cold_start_ = 0;
+    }
+    for (int index = 0; index < job.waiting_.size(); index++) {
+        double exit_time = job.now_ + depth[job.num_inside_ + 1 + index];
+        plan.vehicles_.push_back(PlannedVehicle{job.waiting_[index].vehicle_id_,
+                                                exit_time - job.waiting_[index].record_.travel_time_, exit_time});
+    }
+}
+
+OnlinePlanner::OnlinePlanner(const Parameters &local_param, const WarmStartOptions &warm_start,
+                             PlanPublisher *publisher) :
+    window_(local_param), publisher_(publisher), job_(local_param), scheduler_(local_param, warm_start) {}
+
+const IntersectionPlan &OnlinePlanner::Plan(const std::vector<VehicleTraceRecord> &batch, double now) {
+    auto planning_start = std::chrono::steady_clock::now();
+    window_.Admit(batch, now, plan_);
+    window_.BuildJob(now, job_);
+    std::swap(plan_, previous_plan_);
+    scheduler_.Schedule(job_, previous_plan_, plan_);
+    while (window_.AddMissedConflicts(plan_, job_)) {
+        scheduler_.Schedule(job_, previous_plan_, plan_);
+    }
+    plan_.sequence_ = previous_plan_.sequence_ + 1;
+    window_size_.Add(job_.waiting_.size());
+    planning_time_.Add(std::chrono::duration<double>(std::chrono::steady_clock::now() - planning_start).count());
+    if (publisher_ != nullptr) {
+        publisher_->Publish(plan_);
+    }
+    return plan_;
+}
+
+long RunOnlinePlanning(DemandStream &demand, ArrivalAdmission &admission, OnlinePlanner &planner, double horizon) {
+    std::vector<VehicleTraceRecord> batch, arrival;
+    long num_admitted = 0;
+    // arrivals at or past the horizon stay in the demand stream
+    while (demand.NextBatch(arrival, 1, horizon) > 0) {
+        auto &record = arrival.back();
+        // a batch whose deadline passes before this arrival closes on its own
+        if (admission.getDeadline() <= record.arrival_time_) {
+            double deadline = admission.getDeadline();
+            admission.CloseBatch(deadline, batch);
+            planner.Plan(batch, deadline);
+        }
+        num_admitted++;
+        if (admission.Add(record)) {
+            admission.CloseBatch(record.arrival_time_, batch);
+            planner.Plan(batch, record.arrival_time_);
+        }
+        arrival.clear();
+    }
+    if (!admission.isEmpty()) {
+        double deadline = admission.getDeadline();
+        admission.CloseBatch(deadline, batch);
+        planner.Plan(batch, deadline);
+    }
+    return num_admitted;
+}
+
+} // namespace intersection_management
@@ -0,0 +1,112 @@
+#include "optimal_solution_cache.h"
+
+#include <iostream>
+
+#include <unistd.h>
+
+namespace intersection_management {
+
+namespace {
+template <typename T>
+void WritePod(std::ostream &out, const T &value) {
+    out.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+template <typename T>
+bool ReadPod(std::istream &in, T &value) {
+    return static_cast<bool>(in.read(reinterpret_cast<char *>(&value), sizeof(T)));
+}
+const std::streamoff kHeaderSize = 16;
+} // namespace
+
+// entries are read up to the last complete one, and new entries are written from there on
+OptimalSolutionCache::OptimalSolutionCache(const std::string &file) : hits_(0), misses_(0), collisions_(0) {
+    std::streamoff valid_size = 0;
+    {
+        std::ifstream in(file, std::ios::binary);
+        uint32_t magic, version;
+        uint64_t reserved;
+        if (ReadPod(in, magic) && ReadPod(in, version) && ReadPod(in, reserved)) {
+            if (magic != kOptimalSolutionCacheMagic || version != kOptimalSolutionCacheVersion) {
+                std::cerr << "Optimal solution cache " << file << " has an unknown format.\n";
+                return;
+            }
+            valid_size = kHeaderSize;
+            uint64_t key;
+            uint32_t order_size;
+            Solution solution;
+            while (ReadPod(in, key) && ReadPod(in, solution.fingerprint_) && ReadPod(in, solution.makespan_) &&
+                   ReadPod(in, order_size)) {
+                solution.order_.resize(order_size);
+                if (!in.read(reinterpret_cast<char *>(solution.order_.data()), order_size * sizeof(int32_t))) {
+                    break;
+                }
+                solutions_.emplace(key, solution);
+                valid_size = in.tellg();
+            }
+        }
+    }
+
+    if (valid_size == 0) {
+        out_.open(file, std::ios::binary | std::ios::trunc);
+        WritePod(out_, kOptimalSolutionCacheMagic);
+        WritePod(out_, kOptimalSolutionCacheVersion);
+        WritePod<uint64_t>(out_, 0);
+    }
+    else {
+        if (truncate(file.c_str(), valid_size) != 0) {
+            std::cerr << "Optimal solution cache " << file << " could not drop its incomplete tail.\n";
+        }
+        out_.open(file, std::ios::binary | std::ios::app);
+    }
+    if (!out_) {
+        std::cerr << "Optimal solution cache " << file << " could not be opened.\n";
+        out_.close();
+    }
+}
+
+OptimalSolutionCache::~OptimalSolutionCache() {
+    Flush();
+}
+
+bool OptimalSolutionCache::Lookup(uint64_t key, uint64_t fingerprint, std::vector<int> &order, double &makespan) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto iter = solutions_.find(key);
+    if (iter == solutions_.end() || iter->second.fingerprint_ != fingerprint) {
+        misses_++;
+        collisions_ += iter != solutions_.end();
+        return false;
+    }
+    hits_++;
+    order = iter->second.order_;
+    makespan = iter->second.makespan_;
+    return true;
+}
+
+void OptimalSolutionCache::Insert(uint64_t key, uint64_t fingerprint, const std::vector<int> &order,
+                                  double makespan) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!solutions_.emplace(key, Solution{fingerprint, order, makespan}).second || !out_.is_open()) {
+        return;
+    }
+    WritePod(out_, key);
+    WritePod(out_, fingerprint);
+    WritePod(out_, makespan);
+    WritePod<uint32_t>(out_, order.size());
+    for (int id : order) {
+        WritePod<int32_t>(out_, id);
+    }
+}
+
+void OptimalSolutionCache::Flush() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (out_.is_open()) {
+        out_.flush();
+    }
+}
+
+size_t OptimalSolutionCache::size() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return solutions_.size();
+}
+
+} // namespace intersection_management
@@ -1,7 +1,10 @@
 #include "parameters.h"
 
+#include <cmath>
 #include <iostream>
+#include <stdexcept>
 #include <string>
+#include <type_traits>
 #include "yaml-cpp/yaml.h"
 
 namespace intersection_management {
@@ -18,35 +21,84 @@ const std::string PROJECT_DIR = "/home/dong/workspace/intersection_CDG";
 const std::string CONFIG_FILE = "/configs/config.yaml";
 // static const std::string CONFIG_FILE = "\\src\\config.yaml";
 
-void Parameters::readParametersFromYaml() {
-    YAML::Node config = YAML::LoadFile(PROJECT_DIR + CONFIG_FILE);
+namespace {
+// sets the fields whose keys are in config, required_keys makes every key mandatory
+void ReadParameters(const YAML::Node &config, Parameters &parameters, bool required_keys) {
+    auto read = [&](const char *key, auto &field) {
+        if (required_keys || config[key]) {
+            field = config[key].as<std::decay_t<decltype(field)>>();
+        }
+    };
+    read("num_legs", parameters.num_legs);
+    read("num_lanes_in_vec", parameters.num_lanes_in_vec);
+    read("num_lanes_out_vec", parameters.num_lanes_out_vec);
+    read("arrival_interval_avg", parameters.arrival_interval_avg);
+    read("travel_time_range", parameters.travel_time_range);
+
+    read("activate_precedent_offset", parameters.activate_precedent_offset);
+    read("activate_arrival_time", parameters.activate_arrival_time);
+    read("activate_transitive_reduction", parameters.activate_transitive_reduction);
+    read("max_queueing_delay", parameters.max_queueing_delay);
+
+    read("tie_minimum_resource_waste_first", parameters.tie_minimum_resource_waste_first);
+    read("tie_high_demand_first", parameters.tie_high_demand_first);
+    read("tie_consider_splitting_resource", parameters.tie_consider_splitting_resource);
+    read("tie_more_splitted_resource_first", parameters.tie_more_splitted_resource_first);
+
+    read("random_seed", parameters.random_seed);
+    read("test_one_instance", parameters.test_one_instance);
+    read("test_vehicle_number", parameters.test_vehicle_number);
+
+    read("sumo_config_file", parameters.sumo_config_file);
+    read("travel_time_choice", parameters.travel_time_choice);
+    read("kTimeWindowOffset", parameters.kTimeWindowOffset);
+}
 
-    num_legs = config["num_legs"].as<int>();
-    num_lanes_in_vec = config["num_lanes_in_vec"].as<std::vector<int>>();
-    num_lanes_out_vec = config["num_lanes_out_vec"].as<std::vector<int>>();
-    arrival_interval_avg = config["arrival_interval_avg"].as<double>();
-    travel_time_range = config["travel_time_range"].as<std::vector<int>>();
+// the values a file can hold that no code path accepts
+void ValidateParameters(const Parameters &parameters, const std::string &file) {
+    if (parameters.max_queueing_delay != -1 &&
+        !(std::isfinite(parameters.max_queueing_delay) && parameters.max_queueing_delay > 0)) {
+        throw std::invalid_argument(file + ": max_queueing_delay is " +
+                                    std::to_string(parameters.max_queueing_delay) +
+                                    ", it has to be -1 for every pair or a positive number of seconds");
+    }
+}
+} // namespace
+
+Parameters::Parameters() : Parameters(ConfigurationRegistry::getInstance().getParameters()) {}
 
-    activate_precedent_offset = config["activate_precedent_offset"].as<bool>();
-    activate_arrival_time = config["activate_arrival_time"].as<bool>();
+void Parameters::readParametersFromYaml() {
+    readParametersFromYaml(PROJECT_DIR + CONFIG_FILE);
+}
 
-    tie_minimum_resource_waste_first = config["tie_minimum_resource_waste_first"].as<bool>();
-    tie_high_demand_first = config["tie_high_demand_first"].as<bool>();
-    tie_consider_splitting_resource = config["tie_consider_splitting_resource"].as<bool>();
-    tie_more_splitted_resource_first = config["tie_more_splitted_resource_first"].as<bool>();
+void Parameters::readParametersFromYaml(const std::string &file) {
+    ReadParameters(YAML::LoadFile(file), *this, true);
+    ValidateParameters(*this, file);
+}
 
-    random_seed = config["random_seed"].as<int>();
-    test_one_instance = config["test_one_instance"].as<bool>();
-    test_vehicle_number = config["test_vehicle_number"].as<int>();
+ConfigurationRegistry::ConfigurationRegistry(const std::string &file) :
+    parameters_(UnconfiguredParametersTag{}) {
+    YAML::Node config = YAML::LoadFile(file);
+    ReadParameters(config, parameters_, true);
+    ValidateParameters(parameters_, file);
+    for (auto profile : config["geometry_profiles"]) {
+        geometry_profiles_.push_back(parameters_);
+        ReadParameters(profile, geometry_profiles_.back(), false);
+        ValidateParameters(geometry_profiles_.back(), file);
+    }
+}
 
-    sumo_config_file = config["sumo_config_file"].as<std::string>();
-    travel_time_choice = config["travel_time_choice"].as<std::vector<double>>();
-    kTimeWindowOffset = config["kTimeWindowOffset"].as<double>();
+// a function local static, so the file is parsed once even if other globals need it first
+const ConfigurationRegistry &ConfigurationRegistry::getInstance() {
+    static const ConfigurationRegistry instance(PROJECT_DIR + CONFIG_FILE);
+    return instance;
 }
 
 Parameters param;
-std::vector<Parameters> geometryParamVec = {
-    param,
-    Parameters(4, {3, 3, 3, 3}, {3, 3, 3, 3}, "/configs/sumo_intersection1/intersection_unregulated.sumocfg", {6, 7, 8}, 5.15),
-    Parameters(4, {1, 2, 1, 2}, {1, 2, 1, 2}, "/configs/sumo_intersection2/intersection_unregulated.sumocfg", {5, 6, 7}, 5.45)};
+std::vector<Parameters> geometryParamVec = [] {
+    std::vector<Parameters> geometries = {param};
+    auto &profiles = ConfigurationRegistry::getInstance().getGeometryProfiles();
+    geometries.insert(geometries.end(), profiles.begin(), profiles.end());
+    return geometries;
+}();
 } // namespace intersection_management
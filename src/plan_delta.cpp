@@ -0,0 +1,299 @@
+#include "plan_delta.h"
+
+#include <cmath>
+#include <iostream>
+#include <utility>
+
+namespace intersection_management {
+
+namespace {
+inline int64_t getTicks(double time) { return std::llround(time / kPlanTimeResolution); }
+
+void WriteVarint(std::vector<uint8_t> &message, uint64_t value) {
+    while (value >= 0x80) {
+        message.push_back(static_cast<uint8_t>(value) | 0x80);
+        value >>= 7;
+    }
+    message.push_back(static_cast<uint8_t>(value));
+}
+// zigzag, so that small negative values stay short
+inline void WriteSignedVarint(std::vector<uint8_t> &message, int64_t value) {
+    WriteVarint(message, (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+}
+
+// list of vehicles with their times, ids as gaps to the previous id
+void WriteVehicles(std::vector<uint8_t> &message, const std::vector<PlannedVehicle> &vehicles, int64_t plan_ticks) {
+    WriteVarint(message, vehicles.size());
+    long previous_id = 0;
+    for (auto &vehicle : vehicles) {
+        int64_t entry_ticks = getTicks(vehicle.entry_time_);
+        WriteVarint(message, vehicle.vehicle_id_ - previous_id);
+        WriteSignedVarint(message, entry_ticks - plan_ticks);
+        WriteSignedVarint(message, getTicks(vehicle.exit_time_) - entry_ticks);
+        previous_id = vehicle.vehicle_id_;
+    }
+}
+
+class MessageReader {
+public:
+    MessageReader(const uint8_t *data, size_t size) : data_(data), end_(data + size) {}
+
+    bool ReadByte(uint8_t &value) {
+        if (data_ == end_) {
+            return false;
+        }
+        value = *data_++;
+        return true;
+    }
+    bool ReadVarint(uint64_t &value) {
+        value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            uint8_t byte;
+            if (!ReadByte(byte)) {
+                return false;
+            }
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) {
+                return true;
+            }
+        }
+        return false;
+    }
+    bool ReadSignedVarint(int64_t &value) {
+        uint64_t zigzag;
+        if (!ReadVarint(zigzag)) {
+            return false;
+        }
+        value = static_cast<int64_t>(zigzag >> 1) ^ -static_cast<int64_t>(zigzag & 1);
+        return true;
+    }
+    // every entry takes a byte at least, so a count past the end of the message is malformed
+    bool ReadCount(uint64_t &count) { return ReadVarint(count) && count <= static_cast<uint64_t>(end_ - data_); }
+    // ids have to ascend strictly, the first one may be 0
+    bool ReadId(long &id, bool is_first) {
+        uint64_t gap;
+        if (!ReadVarint(gap) || (!is_first && gap == 0)) {
+            return false;
+        }
+        id += gap;
+        return true;
+    }
+    bool ReadVehicles(std::vector<PlannedVehicle> &vehicles, int64_t plan_ticks) {
+        uint64_t count;
+        if (!ReadCount(count)) {
+            return false;
+        }
+        vehicles.resize(count);
+        long id = 0;
+        for (uint64_t index = 0; index < count; index++) {
+            int64_t entry_ticks, duration_ticks;
+            if (!ReadId(id, index == 0) || !ReadSignedVarint(entry_ticks) || !ReadSignedVarint(duration_ticks)) {
+                return false;
+            }
+            entry_ticks += plan_ticks;
+            vehicles[index] = PlannedVehicle{id, entry_ticks * kPlanTimeResolution,
+                                             (entry_ticks + duration_ticks) * kPlanTimeResolution};
+        }
+        return true;
+    }
+    inline bool isAtEnd() const { return data_ == end_; }
+
+private:
+    const uint8_t *data_;
+    const uint8_t *end_;
+};
+} // namespace
+
+double RoundPlanTime(double time) { return getTicks(time) * kPlanTimeResolution; }
+
+void ComputePlanDelta(const IntersectionPlan &previous, const IntersectionPlan &plan, PlanDelta &delta) {
+    delta.sequence_ = plan.sequence_;
+    delta.base_sequence_ = previous.sequence_;
+    delta.plan_time_ = plan.plan_time_;
+    delta.removed_.clear();
+    delta.added_.clear();
+    delta.retimed_.clear();
+    auto iter_previous = previous.vehicles_.begin();
+    for (auto &vehicle : plan.vehicles_) {
+        while (iter_previous != previous.vehicles_.end() && iter_previous->vehicle_id_ < vehicle.vehicle_id_) {
+            delta.removed_.push_back(iter_previous->vehicle_id_);
+            iter_previous++;
+        }
+        if (iter_previous == previous.vehicles_.end() || iter_previous->vehicle_id_ != vehicle.vehicle_id_) {
+            delta.added_.push_back(vehicle);
+            continue;
+        }
+        // consumers only see the rounded times
+        if (getTicks(iter_previous->entry_time_) != getTicks(vehicle.entry_time_) ||
+            getTicks(iter_previous->exit_time_) != getTicks(vehicle.exit_time_)) {
+            delta.retimed_.push_back(vehicle);
+        }
+        iter_previous++;
+    }
+    for (; iter_previous != previous.vehicles_.end(); iter_previous++) {
+        delta.removed_.push_back(iter_previous->vehicle_id_);
+    }
+}
+
+void EncodePlanDelta(const PlanDelta &delta, std::vector<uint8_t> &message) {
+    int64_t plan_ticks = getTicks(delta.plan_time_);
+    message.clear();
+    message.push_back(kPlanMessageVersion);
+    message.push_back(PlanMessage_Delta);
+    WriteVarint(message, delta.sequence_);
+    WriteVarint(message, delta.base_sequence_);
+    WriteSignedVarint(message, plan_ticks);
+    WriteVarint(message, delta.removed_.size());
+    long previous_id = 0;
+    for (long id : delta.removed_) {
+        WriteVarint(message, id - previous_id);
+        previous_id = id;
+    }
+    WriteVehicles(message, delta.added_, plan_ticks);
+    WriteVehicles(message, delta.retimed_, plan_ticks);
+}
+
+void EncodePlanSnapshot(const IntersectionPlan &plan, std::vector<uint8_t> &message) {
+    int64_t plan_ticks = getTicks(plan.plan_time_);
+    message.clear();
+    message.push_back(kPlanMessageVersion);
+    message.push_back(PlanMessage_Snapshot);
+    WriteVarint(message, plan.sequence_);
+    WriteSignedVarint(message, plan_ticks);
+    WriteVehicles(message, plan.vehicles_, plan_ticks);
+}
+
+bool DecodePlanMessage(const uint8_t *data, size_t size, PlanMessageType &type, PlanDelta &delta) {
+    MessageReader reader(data, size);
+    uint8_t version, type_byte;
+    if (!reader.ReadByte(version) || version != kPlanMessageVersion || !reader.ReadByte(type_byte) ||
+        type_byte > PlanMessage_Snapshot) {
+        return false;
+    }
+    type = static_cast<PlanMessageType>(type_byte);
+    uint64_t sequence, base_sequence = 0;
+    int64_t plan_ticks;
+    if (!reader.ReadVarint(sequence) || (type == PlanMessage_Delta && !reader.ReadVarint(base_sequence)) ||
+        !reader.ReadSignedVarint(plan_ticks)) {
+        return false;
+    }
+    delta.sequence_ = sequence;
+    delta.base_sequence_ = type == PlanMessage_Delta ? static_cast<long>(base_sequence) : -1;
+    delta.plan_time_ = plan_ticks * kPlanTimeResolution;
+    delta.removed_.clear();
+    delta.retimed_.clear();
+    if (type == PlanMessage_Delta) {
+        uint64_t num_removed;
+        if (!reader.ReadCount(num_removed)) {
+            return false;
+        }
+        delta.removed_.resize(num_removed);
+        long id = 0;
+        for (uint64_t index = 0; index < num_removed; index++) {
+            if (!reader.ReadId(id, index == 0)) {
+                return false;
+            }
+            delta.removed_[index] = id;
+        }
+    }
+    if (!reader.ReadVehicles(delta.added_, plan_ticks) ||
+        (type == PlanMessage_Delta && !reader.ReadVehicles(delta.retimed_, plan_ticks))) {
+        return false;
+    }
+    return reader.isAtEnd();
+}
+
+PlanPublisher::PlanPublisher(std::function<void(const std::vector<uint8_t> &)> send) : send_(std::move(send)) {}
+
+void PlanPublisher::Publish(const IntersectionPlan &plan) {
+    ComputePlanDelta(published_, plan, delta_);
+    EncodePlanDelta(delta_, message_);
+    message_size_.Add(message_.size());
+    num_changes_.Add(delta_.getNumChanges());
+    published_ = plan;
+    if (send_) {
+        send_(message_);
+    }
+}
+
+const std::vector<uint8_t> &PlanPublisher::EncodeSnapshot() {
+    EncodePlanSnapshot(published_, snapshot_);
+    return snapshot_;
+}
+
+PlanReplica::PlanReplica() : num_gaps_(0), needs_snapshot_(false) {}
+
+bool PlanReplica::Apply(const uint8_t *data, size_t size) {
+    PlanMessageType type;
+    if (!DecodePlanMessage(data, size, type, delta_)) {
+        std::cerr << "Plan message of " << size << " bytes is malformed.\n";
+        needs_snapshot_ = true;
+        return false;
+    }
+    if (type == PlanMessage_Snapshot) {
+        // a snapshot older than the plan held is stale
+        if (!needs_snapshot_ && delta_.sequence_ <= plan_.sequence_) {
+            return true;
+        }
+        plan_.sequence_ = delta_.sequence_;
+        plan_.plan_time_ = delta_.plan_time_;
+        std::swap(plan_.vehicles_, delta_.added_);
+        needs_snapshot_ = false;
+        return true;
+    }
+    // repeated deltas are already in the plan held
+    if (!needs_snapshot_ && delta_.sequence_ <= plan_.sequence_) {
+        return true;
+    }
+    if (needs_snapshot_ || delta_.base_sequence_ != plan_.sequence_) {
+        if (!needs_snapshot_) {
+            num_gaps_++;
+        }
+        needs_snapshot_ = true;
+        return false;
+    }
+    if (!ApplyDelta()) {
+        std::cerr << "Plan delta " << delta_.sequence_ << " changes vehicles plan " << plan_.sequence_
+                  << " doesn't have.\n";
+        needs_snapshot_ = true;
+        return false;
+    }
+    return true;
+}
+
+bool PlanReplica::ApplyDelta() {
+    next_.vehicles_.clear();
+    auto iter_removed = delta_.removed_.begin();
+    auto iter_added = delta_.added_.begin();
+    auto iter_retimed = delta_.retimed_.begin();
+    for (auto &vehicle : plan_.vehicles_) {
+        while (iter_added != delta_.added_.end() && iter_added->vehicle_id_ < vehicle.vehicle_id_) {
+            next_.vehicles_.push_back(*iter_added++);
+        }
+        // every list ascends, so an id passed over is not in the plan
+        if ((iter_added != delta_.added_.end() && iter_added->vehicle_id_ == vehicle.vehicle_id_) ||
+            (iter_removed != delta_.removed_.end() && *iter_removed < vehicle.vehicle_id_) ||
+            (iter_retimed != delta_.retimed_.end() && iter_retimed->vehicle_id_ < vehicle.vehicle_id_)) {
+            return false;
+        }
+        if (iter_removed != delta_.removed_.end() && *iter_removed == vehicle.vehicle_id_) {
+            iter_removed++;
+        }
+        else if (iter_retimed != delta_.retimed_.end() && iter_retimed->vehicle_id_ == vehicle.vehicle_id_) {
+            next_.vehicles_.push_back(*iter_retimed++);
+        }
+        else {
+            next_.vehicles_.push_back(vehicle);
+        }
+    }
+    if (iter_removed != delta_.removed_.end() || iter_retimed != delta_.retimed_.end()) {
+        return false;
+    }
+    next_.vehicles_.insert(next_.vehicles_.end(), iter_added, delta_.added_.end());
+    next_.sequence_ = delta_.sequence_;
+    next_.plan_time_ = delta_.plan_time_;
+    std::swap(plan_, next_);
+    return true;
+}
+
+} // namespace intersection_management
@@ -0,0 +1,140 @@
+#include "planning_pipeline.h"
+
+#include <chrono>
+
+#include "plan_delta.h"
+
+namespace intersection_management {
+
+namespace {
+// the stages spin on full and empty queues, yielding so they share a core gracefully
+template <typename T>
+void Push(SpscQueue<T> &queue, T &item) {
+    while (!queue.TryPush(item)) {
+        std::this_thread::yield();
+    }
+}
+
+template <typename T>
+void Pop(SpscQueue<T> &queue, T &item) {
+    while (!queue.TryPop(item)) {
+        std::this_thread::yield();
+    }
+}
+} // namespace
+
+PlanningPipeline::PlanningPipeline(const Parameters &local_param, const ArrivalAdmissionOptions &admission_options,
+                                   int queue_capacity, const WarmStartOptions &warm_start,
+                                   PlanPublisher *publisher) :
+    admission_(admission_options), window_(local_param), local_param_(local_param), batch_queue_(queue_capacity),
+    job_queue_(queue_capacity), free_job_queue_(queue_capacity), scheduler_(local_param, warm_start),
+    publisher_(publisher), num_plans_(0) {}
+
+PlanningPipeline::~PlanningPipeline() {
+    Join();
+}
+
+void PlanningPipeline::Start(std::function<bool(VehicleTraceRecord &)> next_vehicle) {
+    stages_.emplace_back(&PlanningPipeline::Ingest, this, std::move(next_vehicle));
+    stages_.emplace_back(&PlanningPipeline::Build, this);
+    stages_.emplace_back(&PlanningPipeline::Schedule, this);
+}
+
+void PlanningPipeline::Join() {
+    for (auto &stage : stages_) {
+        stage.join();
+    }
+    stages_.clear();
+}
+
+void PlanningPipeline::Ingest(std::function<bool(VehicleTraceRecord &)> next_vehicle) {
+    AdmittedBatch batch;
+    auto close_batch = [&](double now) {
+        admission_.CloseBatch(now, batch.vehicles_);
+        batch.now_ = now;
+        Push(batch_queue_, batch);
+        batch = AdmittedBatch();
+    };
+    VehicleTraceRecord record;
+    while (next_vehicle(record)) {
+        if (admission_.getDeadline() <= record.arrival_time_) {
+            close_batch(admission_.getDeadline());
+        }
+        if (admission_.Add(record)) {
+            close_batch(record.arrival_time_);
+        }
+    }
+    if (!admission_.isEmpty()) {
+        close_batch(admission_.getDeadline());
+    }
+    batch.is_last_ = true;
+    Push(batch_queue_, batch);
+}
+
+void PlanningPipeline::Build() {
+    AdmittedBatch batch;
+    std::unique_ptr<PlanningJob> job;
+    long num_jobs = 0;
+    while (true) {
+        Pop(batch_queue_, batch);
+        if (batch.is_last_) {
+            break;
+        }
+        // classifying the batch only reads the window, so it overlaps schedule adding the conflicts the plan of
+        // the previous job missed. Retirement is against that plan, as OnlinePlanner does, so it waits for it
+        auto build_start = std::chrono::steady_clock::now();
+        window_.Classify(batch.vehicles_);
+        double build_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - build_start).count();
+        {
+            std::unique_lock<std::mutex> lock(plans_mutex_);
+            plan_published_.wait(lock, [&]() { return num_plans_.load() >= num_jobs; });
+        }
+        build_start = std::chrono::steady_clock::now();
+        plan_.Read([&](const IntersectionPlan &plan) { window_.Admit(batch.now_, plan); });
+        if (!free_job_queue_.TryPop(job)) {
+            job.reset(new PlanningJob(local_param_));
+        }
+        window_.BuildJob(batch.now_, *job);
+        build_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - build_start).count();
+        build_time_.Add(build_seconds);
+        Push(job_queue_, job);
+        num_jobs++;
+    }
+    job.reset();
+    Push(job_queue_, job);
+}
+
+void PlanningPipeline::Schedule() {
+    std::unique_ptr<PlanningJob> job;
+    while (true) {
+        Pop(job_queue_, job);
+        if (job == nullptr) {
+            break;
+        }
+        auto schedule_start = std::chrono::steady_clock::now();
+        // the plan being served is the previous one of the plan written
+        auto &plan = plan_.BeginWrite();
+        plan_.Read([&](const IntersectionPlan &previous) {
+            scheduler_.Schedule(*job, previous, plan);
+            while (window_.AddMissedConflicts(plan, *job)) {
+                scheduler_.Schedule(*job, previous, plan);
+            }
+        });
+        plan.sequence_ = num_plans_.load() + 1;
+        plan_.Publish();
+        {
+            std::lock_guard<std::mutex> lock(plans_mutex_);
+            num_plans_++;
+        }
+        plan_published_.notify_one();
+        // only this stage writes the buffer, so it stays as published until the next plan
+        if (publisher_ != nullptr) {
+            publisher_->Publish(plan);
+        }
+        schedule_time_.Add(std::chrono::duration<double>(std::chrono::steady_clock::now() - schedule_start).count());
+        // dropped if build has enough spare jobs
+        free_job_queue_.TryPush(job);
+    }
+}
+
+} // namespace intersection_management
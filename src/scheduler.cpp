@@ -13,27 +13,44 @@ namespace intersection_management {
 Scheduler::Scheduler()
 {
     result_tree_.reset();
+    InitializeFromLocalParam(param);
 }
 
-SpanningTree Scheduler::ScheduleWithFIFO(Intersection &intersection) {
-    PrepareForTreeSchedule(intersection);
-    std::vector<bool> added_to_tree(intersection.num_nodes_, false);
+Scheduler::Scheduler(const Parameters &local_param)
+{
+    result_tree_.reset();
+    InitializeFromLocalParam(local_param);
+}
+
+void Scheduler::InitializeFromLocalParam(const Parameters &local_param)
+{
+    activate_arrival_time_ = local_param.activate_arrival_time;
+    tie_minimum_resource_waste_first_ = local_param.tie_minimum_resource_waste_first;
+    tie_high_demand_first_ = local_param.tie_high_demand_first;
+    tie_consider_splitting_resource_ = local_param.tie_consider_splitting_resource;
+    tie_more_splitted_resource_first_ = local_param.tie_more_splitted_resource_first;
+}
+
+// vehicles are served in id order, the start is bounded by the latest window end of each conflicting route class,
+// so no backward scan over earlier vehicles is needed. The route classes come from the intersection, which builds
+// them once for its geometry. Precedence always points from the smaller id on the same
+// lane in, so it can never be violated here and the parent tables are not generated
+const SpanningTree &Scheduler::ScheduleWithFIFO(Intersection &intersection) {
+    result_tree_.reset(false);
+    result_tree_.AddNodesFromIntersection(intersection);
+    auto &route_class_table = intersection.getRouteClassTable();
+    latest_end_per_route_class_.assign(route_class_table.num_route_classes_, -1);
 
     result_tree_.UpdateTimeWindow(0, 0, 0, 0);
-    added_to_tree[0] = true;
 
     for (int id = 1; id < intersection.num_nodes_; id++)
     {
         auto &chosen_node = result_tree_.nodes_[id];
-        if (StillHasUnscheduledPredecessor(unidirectional_parent_table_[id], added_to_tree)) {
-            std::cerr << Color::red << "Error in FIFO, precendence vehicle arrives later than following vehicle.\n" << Color::def;
-            throw;
-        }
 
         double estimate_travel_time = chosen_node->estimate_travel_time_;
         double estimate_arrival_time = chosen_node->estimate_arrival_time_;
         double earliest_start_time;
-        if (param.activate_arrival_time) {
+        if (activate_arrival_time_) {
             earliest_start_time = chosen_node->estimate_arrival_time_;
         }
         else {
@@ -43,21 +60,19 @@ SpanningTree Scheduler::ScheduleWithFIFO(Intersection &intersection) {
             earliest_start_time = result_tree_.nodes_[id - 1]->time_window_[0];
         }
 
-        for (int pre_id = id - 1; pre_id > 0; pre_id--) {
-            if (intersection.nodes_[id]->isConnectedWith(pre_id)) {
-                auto edge = intersection.nodes_[id]->getEdgeWith(pre_id);
-                if (edge->conflict_type_.isConverging() || edge->conflict_type_.isCrossing() || edge->conflict_type_.isDiverging() || edge->conflict_type_.isPrecedence()) {
-                    if (earliest_start_time < result_tree_.nodes_[pre_id]->time_window_[1]) {
-                        earliest_start_time = result_tree_.nodes_[pre_id]->time_window_[1];
-                    }
-                }
+        int route_class = route_class_table.getRouteClass(intersection.nodes_[id]->route_);
+        for (int conflicting_class : route_class_table.conflict_table_[route_class]) {
+            if (earliest_start_time < latest_end_per_route_class_[conflicting_class]) {
+                earliest_start_time = latest_end_per_route_class_[conflicting_class];
             }
         }
 
-        added_to_tree[id] = true;
         result_tree_.nodes_[id]->possible_lane_id_.clear();
         result_tree_.nodes_[id]->possible_lane_id_.push_back(intersection.nodes_[id]->out_lane_id_);
         result_tree_.UpdateTimeWindow(id, earliest_start_time + estimate_travel_time, 0, estimate_travel_time);
+        if (latest_end_per_route_class_[route_class] < result_tree_.nodes_[id]->time_window_[1]) {
+            latest_end_per_route_class_[route_class] = result_tree_.nodes_[id]->time_window_[1];
+        }
     }
     return result_tree_;
 }
@@ -120,65 +135,68 @@ void Scheduler::GenerateBineighborTable(Intersection &intersection)
     }
 }
 
-void Scheduler::SortReadyListAscendingly(std::vector<Candidate> &ready_list, Intersection &intersection)
+Candidate Scheduler::MakeCandidate(int id, double depth, int parent, Intersection &intersection,
+                                   double estimate_offset, bool split_flexible_critical_resource,
+                                   int num_critical_resource_splitted)
+{
+    auto &node = intersection.nodes_[id];
+    Candidate candidate(id, depth, parent, estimate_offset, node->out_leg_id_, node->out_lane_id_,
+                        node->estimate_travel_time_);
+    candidate.split_flexible_critical_resource_ = split_flexible_critical_resource;
+    candidate.num_critical_resource_splitted_ = num_critical_resource_splitted;
+    AssignPriorityKey(candidate, intersection);
+    return candidate;
+}
+
+// pack the enabled tie-break strategies into one integer, from the most significant field:
+// [demand complement: 20 bits][not rightmost resource waste: 1][not splitting: 1][split count: 10][id: 32]
+// disabled strategies leave their field 0. Demand per lane is fixed for the whole schedule, so the key
+// can be computed once when the candidate is created instead of on every comparison
+void Scheduler::AssignPriorityKey(Candidate &candidate, Intersection &intersection)
+{
+    const uint64_t kMaxDemand = (1 << 20) - 1;
+    const uint64_t kMaxSplitCount = (1 << 10) - 1;
+    uint64_t demand_field = 0, waste_field = 0, split_field = 0, split_count_field = 0;
+    if (candidate.id_ == 0) { // virtual leading vehicle always comes first
+        candidate.priority_key_ = 0;
+        return;
+    }
+
+    if (tie_high_demand_first_)
+    {
+        uint64_t demand = remaining_demand_per_lane_[intersection.nodes_[candidate.id_]->route_->getLaneIn()->getUniqueId()];
+        demand_field = kMaxDemand - std::min(demand, kMaxDemand);
+    }
+    if (tie_minimum_resource_waste_first_)
+    {
+        bool isCompetingRightmost = intersection.isRightmostTurningRoute(intersection.nodes_[candidate.id_]->route_) &&
+            intersection.critical_resource_map_.find(candidate.out_leg_id_) != intersection.critical_resource_map_.end();
+        waste_field = isCompetingRightmost ? 0 : 1;
+    }
+    if (tie_consider_splitting_resource_)
+    {
+        split_field = candidate.split_flexible_critical_resource_ ? 0 : 1;
+        if (candidate.split_flexible_critical_resource_)
+        {
+            uint64_t split_count = std::min<uint64_t>(candidate.num_critical_resource_splitted_, kMaxSplitCount);
+            split_count_field = tie_more_splitted_resource_first_ ? kMaxSplitCount - split_count : split_count;
+        }
+    }
+    candidate.priority_key_ = (demand_field << 44) | (waste_field << 43) | (split_field << 42) |
+        (split_count_field << 32) | static_cast<uint32_t>(candidate.id_);
+}
+
+// candidates from MakeCandidate carry their tie-break key, others fall back to id order on equal depths
+void Scheduler::SortReadyListAscendingly(std::vector<Candidate> &ready_list)
 {
     std::sort(ready_list.begin(), ready_list.end(),
-              [&](const Candidate &candidate1, const Candidate &candidate2)
+              [](const Candidate &candidate1, const Candidate &candidate2)
               {
                   if (candidate1.possible_depth_ != candidate2.possible_depth_)
                   {
                       return candidate1.possible_depth_ < candidate2.possible_depth_;
                   }
-
-                  // Break the tie
-                  if (param.tie_high_demand_first)
-                  {
-                      if (candidate1.id_ != 0 && candidate2.id_ != 0)
-                      {
-                          int demand1 = remaining_demand_per_lane_[intersection.nodes_[candidate1.id_]->route_->getLaneIn()->getUniqueId()];
-                          int demand2 = remaining_demand_per_lane_[intersection.nodes_[candidate2.id_]->route_->getLaneIn()->getUniqueId()];
-                          if (demand1 != demand2)
-                          {
-                              return demand1 > demand2;
-                          }
-                      }
-                  }
-                  if (param.tie_minimum_resource_waste_first)
-                  {
-                      bool isCompetingRightmost1 = intersection.isRightmostTurningRoute(intersection.nodes_[candidate1.id_]->route_);
-                      bool isCompetingRightmost2 = intersection.isRightmostTurningRoute(intersection.nodes_[candidate2.id_]->route_);
-                      if (isCompetingRightmost1 && intersection.critical_resource_map_.find(candidate1.out_leg_id_) == intersection.critical_resource_map_.end())
-                          isCompetingRightmost1 = false;
-                      if (isCompetingRightmost2 && intersection.critical_resource_map_.find(candidate2.out_leg_id_) == intersection.critical_resource_map_.end())
-                          isCompetingRightmost2 = false;
-
-                      if (isCompetingRightmost1 && !isCompetingRightmost2)
-                      {
-                          return true;
-                      }
-                      if (!isCompetingRightmost1 && isCompetingRightmost2)
-                      {
-                          return false;
-                      }
-                  }
-                  if (param.tie_consider_splitting_resource)
-                  {
-                      if (candidate1.split_flexible_critical_resource_ && !candidate2.split_flexible_critical_resource_)
-                          return true;
-                      if (!candidate1.split_flexible_critical_resource_ && candidate2.split_flexible_critical_resource_)
-                          return false;
-                      if (candidate1.split_flexible_critical_resource_ && candidate2.split_flexible_critical_resource_ &&
-                          (candidate1.num_critical_resource_splitted_ != candidate2.num_critical_resource_splitted_))
-                          if (param.tie_more_splitted_resource_first)
-                          {
-                              return candidate1.num_critical_resource_splitted_ > candidate2.num_critical_resource_splitted_;
-                          }
-                          else
-                          {
-                              return candidate1.num_critical_resource_splitted_ < candidate2.num_critical_resource_splitted_;
-                          }
-                  }
-                  return candidate1.id_ < candidate2.id_;
+                  return candidate1.priority_key_ < candidate2.priority_key_;
               });
 }
 
@@ -10,8 +10,13 @@ SpanningTree::SpanningTree() {
 
 void SpanningTree::reset(bool verbose) {
     p_root_ = nullptr;
-    nodes_.clear();
-    edges_.clear();
+    for (auto &node : nodes_) {
+        if (node.use_count() == 1) {
+            node->edges_.clear();
+        }
+    }
+    node_pool_.Release(nodes_);
+    edge_pool_.Release(edges_);
     num_nodes_ = 0;
     depth_ = -1;
     edge_weighted_depth_ = -1;
@@ -22,7 +27,7 @@ void SpanningTree::reset(bool verbose) {
 }
 
 void SpanningTree::AddNodesFromIntersection(const Intersection &intersection) {
-    for (auto node : intersection.nodes_) {
+    for (auto &node : intersection.nodes_) {
         AddNode(node);
     }
     num_nodes_ = intersection.num_nodes_;
@@ -33,7 +38,13 @@ void SpanningTree::AddNodesFromIntersection(const Intersection &intersection) {
 }
 
 void SpanningTree::AddNode(std::shared_ptr<Node> node) {
-    auto node_copy = std::make_shared<Node>(node);
+    auto node_copy = node_pool_.Acquire();
+    if (node_copy == nullptr) {
+        node_copy = std::make_shared<Node>(node);
+    }
+    else {
+        node_copy->Reinitialize(*node);
+    }
     nodes_.push_back(node_copy);
 }
 
@@ -51,7 +62,13 @@ void SpanningTree::AddEdge(int from, int to, double weight) {
     }
 
     if (to != 0) {
-        auto edge = std::shared_ptr<Edge>(new Edge(nodes_[from], nodes_[to], weight, false));
+        auto edge = edge_pool_.Acquire();
+        if (edge == nullptr) {
+            edge = std::shared_ptr<Edge>(new Edge(nodes_[from], nodes_[to], weight, false));
+        }
+        else {
+            *edge = Edge(nodes_[from], nodes_[to], weight, false);
+        }
         nodes_[from]->edges_.push_back(edge);
         edges_.push_back(edge);
     }
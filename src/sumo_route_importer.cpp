@@ -0,0 +1,285 @@
+#include "sumo_route_importer.h"
+
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+
+#include "intersection_utility.h"
+#include "yaml-cpp/yaml.h"
+
+namespace intersection_management {
+
+namespace {
+// consumes the stream up to and including the terminator, false at the end of the stream
+bool SkipPast(std::istream &in, const std::string &terminator) {
+    size_t matched = 0;
+    int c;
+    while ((c = in.get()) != EOF) {
+        if (c == terminator[matched]) {
+            if (++matched == terminator.size()) {
+                return true;
+            }
+        }
+        else {
+            matched = (c == terminator[0]) ? 1 : 0;
+        }
+    }
+    return false;
+}
+
+void SkipSpaces(std::istream &in) {
+    while (std::isspace(in.peek())) {
+        in.get();
+    }
+}
+
+// the predefined entities and character references below 128, others are kept as written
+void AppendDecoded(std::string &value, const std::string &entity) {
+    if (entity == "amp") value += '&';
+    else if (entity == "lt") value += '<';
+    else if (entity == "gt") value += '>';
+    else if (entity == "quot") value += '"';
+    else if (entity == "apos") value += '\'';
+    else if (entity.size() > 1 && entity[0] == '#') {
+        long code = entity[1] == 'x' ? std::strtol(entity.c_str() + 2, nullptr, 16) : std::strtol(entity.c_str() + 1, nullptr, 10);
+        if (code > 0 && code < 128) {
+            value += static_cast<char>(code);
+        }
+    }
+    else {
+        value += '&' + entity + ';';
+    }
+}
+
+bool isNameCharacter(int c) {
+    return c != EOF && !std::isspace(c) && c != '/' && c != '>' && c != '=';
+}
+
+void ReadName(std::istream &in, std::string &name) {
+    name.clear();
+    while (isNameCharacter(in.peek())) {
+        name += static_cast<char>(in.get());
+    }
+}
+
+std::string getAttribute(const XmlAttributes &attributes, const char *name) {
+    for (auto &attribute : attributes) {
+        if (attribute.first == name) {
+            return attribute.second;
+        }
+    }
+    return "";
+}
+
+// first and last edge of a space separated edge list
+std::pair<std::string, std::string> getRouteEnds(const std::string &edges) {
+    size_t first_begin = edges.find_first_not_of(' ');
+    if (first_begin == std::string::npos) {
+        return {"", ""};
+    }
+    size_t first_end = edges.find(' ', first_begin);
+    size_t last_end = edges.find_last_not_of(' ') + 1;
+    size_t last_begin = edges.rfind(' ', last_end - 1);
+    last_begin = last_begin == std::string::npos ? 0 : last_begin + 1;
+    return {edges.substr(first_begin, first_end == std::string::npos ? std::string::npos : first_end - first_begin),
+            edges.substr(last_begin, last_end - last_begin)};
+}
+} // namespace
+
+bool ParseXmlStream(std::istream &in,
+                    const std::function<void(const std::string &, const XmlAttributes &)> &start_element,
+                    const std::function<void(const std::string &)> &end_element) {
+    std::string name, entity;
+    XmlAttributes attributes;
+    int c;
+    while ((c = in.get()) != EOF) {
+        if (c != '<') {
+            continue;
+        }
+        c = in.peek();
+        if (c == '?') {
+            if (!SkipPast(in, "?>")) return false;
+            continue;
+        }
+        if (c == '!') {
+            in.get();
+            bool is_comment = in.peek() == '-';
+            if (!SkipPast(in, is_comment ? "-->" : ">")) return false;
+            continue;
+        }
+        if (c == '/') {
+            in.get();
+            ReadName(in, name);
+            if (!SkipPast(in, ">")) return false;
+            end_element(name);
+            continue;
+        }
+
+        ReadName(in, name);
+        attributes.clear();
+        while (true) {
+            SkipSpaces(in);
+            c = in.get();
+            if (c == '>') {
+                start_element(name, attributes);
+                break;
+            }
+            if (c == '/') {
+                if (in.get() != '>') return false;
+                start_element(name, attributes);
+                end_element(name);
+                break;
+            }
+            if (c == EOF) {
+                return false;
+            }
+            in.unget();
+            attributes.emplace_back();
+            ReadName(in, attributes.back().first);
+            SkipSpaces(in);
+            if (in.get() != '=') return false;
+            SkipSpaces(in);
+            int quote = in.get();
+            if (quote != '"' && quote != '\'') return false;
+            auto &value = attributes.back().second;
+            while ((c = in.get()) != quote) {
+                if (c == EOF) return false;
+                if (c == '&') {
+                    entity.clear();
+                    while ((c = in.get()) != ';') {
+                        if (c == EOF) return false;
+                        entity += static_cast<char>(c);
+                    }
+                    AppendDecoded(value, entity);
+                }
+                else {
+                    value += static_cast<char>(c);
+                }
+            }
+        }
+    }
+    return true;
+}
+
+SumoEdgeMap ReadSumoEdgeMap(const std::string &file) {
+    YAML::Node config = YAML::LoadFile(file);
+    SumoEdgeMap edge_map;
+    for (auto edge : config["incoming"]) {
+        edge_map[edge.first.as<std::string>()] = SumoEdgeLeg{edge.second.as<int>(), true};
+    }
+    for (auto edge : config["outgoing"]) {
+        edge_map[edge.first.as<std::string>()] = SumoEdgeLeg{edge.second.as<int>(), false};
+    }
+    return edge_map;
+}
+
+SumoRouteImporter::SumoRouteImporter(const Parameters &local_param, const SumoEdgeMap &edge_map) :
+    num_imported_(0), num_skipped_(0), num_legs_(local_param.num_legs), num_lanes_in_vec_(local_param.num_lanes_in_vec),
+    num_lanes_out_vec_(local_param.num_lanes_out_vec), travel_time_choice_(local_param.travel_time_choice),
+    edge_map_(edge_map), next_lane_in_(local_param.num_legs, 0), next_lane_out_(local_param.num_legs, 0) {}
+
+double SumoRouteImporter::getTravelTime(int in_leg_id, int out_leg_id) const {
+    return getTurnTravelTime(travel_time_choice_, num_legs_, in_leg_id, out_leg_id);
+}
+
+int SumoRouteImporter::getLane(const std::string &lane, int leg_id, bool in_bound) {
+    int num_lanes = in_bound ? num_lanes_in_vec_[leg_id] : num_lanes_out_vec_[leg_id];
+    char *end;
+    long lane_id = std::strtol(lane.c_str(), &end, 10);
+    if (!lane.empty() && *end == '\0' && lane_id >= 0 && lane_id < num_lanes) {
+        return lane_id;
+    }
+    auto &next_lane = in_bound ? next_lane_in_[leg_id] : next_lane_out_[leg_id];
+    return next_lane++ % num_lanes;
+}
+
+bool SumoRouteImporter::EmitVehicle(const std::string &from_edge, const std::string &to_edge, const std::string &depart,
+                                    const std::string &depart_lane, const std::string &arrival_lane,
+                                    const std::function<void(const VehicleTraceRecord &)> &emit_vehicle) {
+    char *end;
+    double arrival_time = std::strtod(depart.c_str(), &end);
+    auto from = edge_map_.find(from_edge);
+    auto to = edge_map_.find(to_edge);
+    if (depart.empty() || *end != '\0' || from == edge_map_.end() || to == edge_map_.end() ||
+        !from->second.in_bound_ || to->second.in_bound_ || from->second.leg_id_ == to->second.leg_id_ ||
+        from->second.leg_id_ < 0 || from->second.leg_id_ >= num_legs_ || to->second.leg_id_ < 0 ||
+        to->second.leg_id_ >= num_legs_) {
+        return false;
+    }
+    int in_leg_id = from->second.leg_id_;
+    int out_leg_id = to->second.leg_id_;
+    emit_vehicle(VehicleTraceRecord{arrival_time, getTravelTime(in_leg_id, out_leg_id), in_leg_id,
+                                    getLane(depart_lane, in_leg_id, true), out_leg_id,
+                                    getLane(arrival_lane, out_leg_id, false)});
+    return true;
+}
+
+// a vehicle or trip is emitted at its closing tag, once a nested route has been seen
+bool SumoRouteImporter::Import(std::istream &in, const std::function<void(const VehicleTraceRecord &)> &emit_vehicle) {
+    bool in_vehicle = false;
+    std::string depart, depart_lane, arrival_lane;
+    std::pair<std::string, std::string> route;
+    auto start_element = [&](const std::string &name, const XmlAttributes &attributes) {
+        if (name == "vehicle" || name == "trip") {
+            in_vehicle = true;
+            depart = getAttribute(attributes, "depart");
+            depart_lane = getAttribute(attributes, "departLane");
+            arrival_lane = getAttribute(attributes, "arrivalLane");
+            route = {getAttribute(attributes, "from"), getAttribute(attributes, "to")};
+            auto named_route = named_routes_.find(getAttribute(attributes, "route"));
+            if (named_route != named_routes_.end()) {
+                route = named_route->second;
+            }
+        }
+        else if (name == "route") {
+            auto ends = getRouteEnds(getAttribute(attributes, "edges"));
+            if (in_vehicle) {
+                route = ends;
+            }
+            else {
+                named_routes_[getAttribute(attributes, "id")] = ends;
+            }
+        }
+        else if (name == "flow" || name == "personFlow" || name == "person") {
+            num_skipped_++;
+        }
+    };
+    auto end_element = [&](const std::string &name) {
+        if ((name == "vehicle" || name == "trip") && in_vehicle) {
+            in_vehicle = false;
+            if (EmitVehicle(route.first, route.second, depart, depart_lane, arrival_lane, emit_vehicle)) {
+                num_imported_++;
+            }
+            else {
+                num_skipped_++;
+            }
+        }
+    };
+    return ParseXmlStream(in, start_element, end_element);
+}
+
+bool SumoRouteImporter::Import(const std::string &route_file,
+                               const std::function<void(const VehicleTraceRecord &)> &emit_vehicle) {
+    std::ifstream in(route_file);
+    if (!in) {
+        std::cerr << "Route file " << route_file << " could not be opened.\n";
+        return false;
+    }
+    if (!Import(in, emit_vehicle)) {
+        std::cerr << "Route file " << route_file << " is not well-formed XML.\n";
+        return false;
+    }
+    return true;
+}
+
+bool SumoRouteImporter::ImportToTrace(const std::string &route_file, const std::string &trace_file) {
+    VehicleTraceWriter writer(trace_file);
+    if (!writer.isOpen()) {
+        return false;
+    }
+    bool is_imported = Import(route_file, [&](const VehicleTraceRecord &record) { writer.Append(record); });
+    return writer.Close() && is_imported;
+}
+
+} // namespace intersection_management
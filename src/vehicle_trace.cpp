@@ -0,0 +1,157 @@
+#include "vehicle_trace.h"
+
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+
+namespace intersection_management {
+
+namespace {
+template <typename T>
+void WritePod(std::ostream &out, const T &value) {
+    out.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+const char *kVehicleTraceCsvHeader = "arrival_time,travel_time,in_leg_id,in_lane_id,out_leg_id,out_lane_id";
+} // namespace
+
+VehicleTraceFormat getVehicleTraceFormat(const std::string &file) {
+    const std::string csv_extension = ".csv";
+    if (file.size() >= csv_extension.size() &&
+        file.compare(file.size() - csv_extension.size(), csv_extension.size(), csv_extension) == 0) {
+        return Format_Csv;
+    }
+    return Format_Binary;
+}
+
+VehicleTraceWriter::VehicleTraceWriter(const std::string &file, VehicleTraceFormat format) :
+    out_(file, format == Format_Binary ? std::ios::binary | std::ios::trunc : std::ios::trunc), format_(format) {
+    if (!out_) {
+        std::cerr << "Vehicle trace " << file << " could not be opened.\n";
+        out_.close();
+        return;
+    }
+    if (format_ == Format_Binary) {
+        WritePod(out_, kVehicleTraceMagic);
+        WritePod(out_, kVehicleTraceVersion);
+        WritePod<uint64_t>(out_, 0);
+    }
+    else {
+        out_.precision(std::numeric_limits<double>::max_digits10);
+        out_ << kVehicleTraceCsvHeader << "\n";
+    }
+}
+
+void VehicleTraceWriter::Append(const VehicleTraceRecord &record) {
+    if (format_ == Format_Binary) {
+        WritePod(out_, record);
+    }
+    else {
+        out_ << record.arrival_time_ << "," << record.travel_time_ << "," << record.in_leg_id_ << ","
+             << record.in_lane_id_ << "," << record.out_leg_id_ << "," << record.out_lane_id_ << "\n";
+    }
+}
+
+bool VehicleTraceWriter::Close() {
+    if (!out_.is_open()) {
+        return false;
+    }
+    bool is_written = static_cast<bool>(out_.flush());
+    out_.close();
+    return is_written;
+}
+
+VehicleTraceReader::VehicleTraceReader(const std::string &file) :
+    file_(file), in_(file, std::ios::binary), format_(Format_Csv), has_error_(false), is_truncated_(false), num_records_(0),
+    last_arrival_time_(-std::numeric_limits<double>::infinity()), buffer_position_(0), line_number_(0) {
+    if (!in_) {
+        std::cerr << "Vehicle trace " << file << " could not be opened.\n";
+        in_.close();
+        has_error_ = true;
+        return;
+    }
+    uint32_t magic = 0, version = 0;
+    uint64_t reserved;
+    in_.read(reinterpret_cast<char *>(&magic), sizeof(magic));
+    if (in_ && magic == kVehicleTraceMagic) {
+        in_.read(reinterpret_cast<char *>(&version), sizeof(version));
+        in_.read(reinterpret_cast<char *>(&reserved), sizeof(reserved));
+        if (!in_ || version != kVehicleTraceVersion) {
+            std::cerr << "Vehicle trace " << file << " has an unknown version.\n";
+            has_error_ = true;
+            return;
+        }
+        format_ = Format_Binary;
+        buffer_.reserve(kVehicleTraceBufferSize);
+    }
+    else {
+        in_.clear();
+        in_.seekg(0);
+    }
+}
+
+bool VehicleTraceReader::Next(VehicleTraceRecord &record) {
+    if (has_error_ || !(format_ == Format_Binary ? ReadBinary(record) : ReadCsv(record))) {
+        return false;
+    }
+    if (record.arrival_time_ < last_arrival_time_) {
+        std::cerr << "Vehicle trace " << file_ << ": vehicle " << num_records_ << " arrives at "
+                  << record.arrival_time_ << ", before the vehicle ahead of it.\n";
+        has_error_ = true;
+        return false;
+    }
+    last_arrival_time_ = record.arrival_time_;
+    num_records_++;
+    return true;
+}
+
+// a record cut short is reported once the complete records read with it are handed out
+bool VehicleTraceReader::ReadBinary(VehicleTraceRecord &record) {
+    if (buffer_position_ == buffer_.size() && !is_truncated_) {
+        buffer_.resize(kVehicleTraceBufferSize);
+        in_.read(reinterpret_cast<char *>(buffer_.data()), kVehicleTraceBufferSize * sizeof(VehicleTraceRecord));
+        size_t bytes_read = in_.gcount();
+        is_truncated_ = bytes_read % sizeof(VehicleTraceRecord) != 0;
+        buffer_.resize(bytes_read / sizeof(VehicleTraceRecord));
+        buffer_position_ = 0;
+    }
+    if (buffer_position_ == buffer_.size()) {
+        if (is_truncated_) {
+            std::cerr << "Vehicle trace " << file_ << " ends in the middle of a record.\n";
+            has_error_ = true;
+        }
+        return false;
+    }
+    record = buffer_[buffer_position_++];
+    return true;
+}
+
+// fields are parsed in place with strtod, the line buffer is reused
+bool VehicleTraceReader::ReadCsv(VehicleTraceRecord &record) {
+    while (std::getline(in_, line_)) {
+        line_number_++;
+        if (line_.empty() || line_ == "\r" || (line_number_ == 1 && line_.compare(0, 12, "arrival_time") == 0)) {
+            continue;
+        }
+        const char *begin = line_.c_str();
+        char *end;
+        double fields[6];
+        bool is_valid = true;
+        for (int field = 0; field < 6 && is_valid; field++) {
+            fields[field] = std::strtod(begin, &end);
+            is_valid = end != begin && (field == 5 ? (*end == '\0' || *end == '\r') : *end == ',');
+            begin = end + 1;
+        }
+        if (!is_valid) {
+            std::cerr << "Vehicle trace " << file_ << ": line " << line_number_ << " is not "
+                      << kVehicleTraceCsvHeader << ".\n";
+            has_error_ = true;
+            return false;
+        }
+        record = VehicleTraceRecord{fields[0], fields[1], (int32_t)fields[2], (int32_t)fields[3],
+                                    (int32_t)fields[4], (int32_t)fields[5]};
+        return true;
+    }
+    return false;
+}
+
+} // namespace intersection_management
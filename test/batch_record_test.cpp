@@ -0,0 +1,246 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+
+#include "batch_record.h"
+#include "batch_test_utility.h"
+#include "test_utility.h"
+
+using namespace intersection_management;
+using namespace ::testing;
+
+class TestBatchRecord : public Test {
+public:
+    void SetUp() override {
+        record_file_ = temp_files_.NewFile(".imbr");
+        csv_file_ = temp_files_.NewFile(".csv");
+    }
+    // every field is derived from the seed, so a row can be checked on its own
+    static BatchTestRecord MakeRecord(int seed) {
+        return BatchTestRecord{seed, seed % 200, seed % 3, seed % kNumberOfBatchTestMethods, seed * 0.5,
+                               seed * 0.25, 1.0 / (seed + 1), seed * 1e-6};
+    }
+
+    static BatchTestRecord ReadRecord(const BatchRecordReader &reader, uint64_t row) {
+        BatchTestRecord record{};
+        EXPECT_THAT(reader.getRecord(row, record), IsTrue());
+        return record;
+    }
+
+    TestTempFiles temp_files_;
+    std::string record_file_;
+    std::string csv_file_;
+};
+
+TEST_F(TestBatchRecord, ReadsBackRowsAppendedFromManyThreads) {
+    const int kNumThreads = 4;
+    const int kRowsPerThread = 20000;
+    {
+        BatchRecordWriter writer(record_file_, csv_file_);
+        ASSERT_THAT(writer.isOpen(), IsTrue());
+        std::vector<std::thread> threads;
+        for (int thread_id = 0; thread_id < kNumThreads; thread_id++) {
+            threads.emplace_back([&, thread_id]() {
+                for (int row = 0; row < kRowsPerThread; row += 10) {
+                    std::vector<BatchTestRecord> records;
+                    for (int i = row; i < row + 10; i++) {
+                        records.push_back(MakeRecord(thread_id * kRowsPerThread + i));
+                    }
+                    writer.Append(records);
+                }
+            });
+        }
+        for (auto &thread : threads) {
+            thread.join();
+        }
+    }
+
+    BatchRecordReader reader(record_file_);
+    ASSERT_THAT(reader.isOpen(), IsTrue());
+    ASSERT_THAT(reader.getNumRows(), Eq(kNumThreads * kRowsPerThread));
+    EXPECT_THAT(reader.getRowGroups().size(), Eq(2));
+    std::vector<bool> seen(kNumThreads * kRowsPerThread, false);
+    for (uint64_t row = 0; row < reader.getNumRows(); row++) {
+        auto record = ReadRecord(reader, row);
+        auto expected = MakeRecord(record.seed_);
+        EXPECT_THAT(seen[record.seed_], IsFalse());
+        seen[record.seed_] = true;
+        EXPECT_THAT(record.num_nodes_, Eq(expected.num_nodes_));
+        EXPECT_THAT(record.geometry_, Eq(expected.geometry_));
+        EXPECT_THAT(record.method_, Eq(expected.method_));
+        EXPECT_THAT(record.makespan_, Eq(expected.makespan_));
+        EXPECT_THAT(record.jain_index_, Eq(expected.jain_index_));
+        EXPECT_THAT(record.wall_time_, Eq(expected.wall_time_));
+    }
+
+    BatchTestRecord record;
+    EXPECT_THAT(reader.getRecord(reader.getNumRows(), record), IsFalse());
+
+    // the mirror reads back to the doubles of the binary file
+    std::ifstream csv(csv_file_);
+    std::string line;
+    int num_lines = 0;
+    while (std::getline(csv, line)) {
+        if (num_lines++ == 0) {
+            continue;
+        }
+        int seed;
+        double makespan, order_standard_deviation, jain_index, wall_time;
+        char method[16];
+        ASSERT_THAT(std::sscanf(line.c_str(), "%d,%*d,%*d,%15[^,],%lf,%lf,%lf,%lf", &seed, method, &makespan,
+                                &order_standard_deviation, &jain_index, &wall_time),
+                    Eq(6));
+        auto expected = MakeRecord(seed);
+        EXPECT_THAT(makespan, Eq(expected.makespan_));
+        EXPECT_THAT(order_standard_deviation, Eq(expected.order_standard_deviation_));
+        EXPECT_THAT(jain_index, Eq(expected.jain_index_));
+        EXPECT_THAT(wall_time, Eq(expected.wall_time_));
+    }
+    EXPECT_THAT(num_lines, Eq(kNumThreads * kRowsPerThread + 1));
+}
+
+TEST_F(TestBatchRecord, SkipsRowGroupCutShort) {
+    {
+        BatchRecordWriter writer(record_file_);
+        writer.Append({MakeRecord(1), MakeRecord(2), MakeRecord(3)});
+    }
+    {
+        std::ofstream out(record_file_, std::ios::binary | std::ios::app);
+        uint32_t row_group_header[2] = {100, 0};
+        out.write(reinterpret_cast<const char *>(row_group_header), sizeof(row_group_header));
+        out << "cut short";
+    }
+    BatchRecordReader reader(record_file_);
+    ASSERT_THAT(reader.isOpen(), IsTrue());
+    EXPECT_THAT(reader.getNumRows(), Eq(3));
+    EXPECT_THAT(reader.getRowGroups()[0].makespan_[2], Eq(MakeRecord(3).makespan_));
+}
+
+// the sweep writes each cell in sample order, one row per method that ran
+TEST_F(TestBatchRecord, SweepWritesEverySampleAndMethod) {
+    BatchRecordWriter writer(record_file_);
+    std::vector<BatchTestOptions> cells(2);
+    unsigned methods = (1u << Method_MultiWeightBfst) | (1u << Method_Fifo);
+    for (int cell = 0; cell < cells.size(); cell++) {
+        cells[cell].num_nodes_ = 6 + cell;
+        cells[cell].test_count_ = 100;
+        cells[cell].starting_seed_ = 11;
+        cells[cell].methods_ = methods;
+        cells[cell].record_writer_ = &writer;
+        cells[cell].geometry_id_ = 2;
+    }
+    BatchSweep(cells, 3);
+    writer.Close();
+
+    BatchRecordReader reader(record_file_);
+    ASSERT_THAT(reader.getNumRows(), Eq(2 * 100 * 2));
+    std::vector<int> rows_per_cell(2, 0);
+    for (uint64_t row = 0; row < reader.getNumRows(); row += 2) {
+        auto mdbfs = ReadRecord(reader, row);
+        auto fifo = ReadRecord(reader, row + 1);
+        int cell = mdbfs.num_nodes_ - 6;
+        int sample_index = rows_per_cell[cell]++;
+        EXPECT_THAT(mdbfs.seed_, Eq(getSampleSeed(11, sample_index)));
+        EXPECT_THAT(mdbfs.geometry_, Eq(2));
+        EXPECT_THAT(mdbfs.method_, Eq(Method_MultiWeightBfst));
+        EXPECT_THAT(fifo.method_, Eq(Method_Fifo));
+        EXPECT_THAT(fifo.seed_, Eq(mdbfs.seed_));
+        auto depths = BatchTestOneCase(cells[cell].param_, mdbfs.num_nodes_, false, mdbfs.seed_, methods);
+        EXPECT_THAT(mdbfs.makespan_, Eq(depths[Method_MultiWeightBfst]));
+        EXPECT_THAT(fifo.makespan_, Eq(depths[Method_Fifo]));
+        EXPECT_THAT(mdbfs.wall_time_, Ge(0));
+    }
+    EXPECT_THAT(rows_per_cell, ElementsAre(100, 100));
+}
+
+TEST_F(TestBatchRecord, TruncatesToFlushedPosition) {
+    BatchRecordPosition position;
+    {
+        BatchRecordWriter writer(record_file_, csv_file_);
+        writer.Append({MakeRecord(1), MakeRecord(2), MakeRecord(3)});
+        position = writer.Flush();
+        writer.Append({MakeRecord(4), MakeRecord(5)});
+    }
+    {
+        BatchRecordWriter writer(record_file_, csv_file_, true);
+        EXPECT_THAT(writer.Truncate(BatchRecordPosition{position.size_ + 1000, position.csv_size_}), IsFalse());
+        ASSERT_THAT(writer.Truncate(position), IsTrue());
+        writer.Append({MakeRecord(6)});
+    }
+    BatchRecordReader reader(record_file_);
+    ASSERT_THAT(reader.getNumRows(), Eq(4));
+    EXPECT_THAT(ReadRecord(reader, 2).seed_, Eq(3));
+    EXPECT_THAT(ReadRecord(reader, 3).seed_, Eq(6));
+    std::ifstream csv(csv_file_);
+    std::string line;
+    int num_lines = 0;
+    while (std::getline(csv, line)) {
+        num_lines++;
+    }
+    EXPECT_THAT(num_lines, Eq(1 + 4));
+}
+
+// a run killed after its checkpoint leaves records of samples the resumed run repeats
+TEST_F(TestBatchRecord, ResumedBatchWritesEverySampleOnce) {
+    std::string checkpoint_file = temp_files_.NewFile(".bin");
+    auto options = MakeQuietBatchOptions(7, 100, 4, 2);
+    options.methods_ = (1u << Method_MultiWeightBfst) | (1u << Method_Fifo);
+    options.checkpoint_file_ = checkpoint_file;
+    {
+        BatchRecordWriter writer(record_file_, csv_file_);
+        options.record_writer_ = &writer;
+        BatchTest(options);
+        writer.Append({MakeRecord(1), MakeRecord(2), MakeRecord(3)});
+    }
+    {
+        BatchRecordWriter writer(record_file_, csv_file_, true);
+        options.record_writer_ = &writer;
+        options.test_count_ = 250;
+        options.resume_ = true;
+        EXPECT_THAT(BatchTest(options).total_test_, Eq(250));
+    }
+
+    BatchRecordReader reader(record_file_);
+    ASSERT_THAT(reader.getNumRows(), Eq(2 * 250));
+    for (uint64_t row = 0; row < reader.getNumRows(); row++) {
+        EXPECT_THAT(ReadRecord(reader, row).seed_, Eq(getSampleSeed(4, row / 2)));
+    }
+}
+TEST_F(TestBatchRecord, ResumedSweepWritesEverySampleOnce) {
+    std::string checkpoint_file = temp_files_.NewFile(".bin");
+    std::vector<BatchTestOptions> cells{MakeQuietBatchOptions(6, 150, 2, 1), MakeQuietBatchOptions(9, 90, 5, 1)};
+    for (auto &cell : cells) {
+        cell.methods_ = 1u << Method_Fifo;
+    }
+    auto short_cells = cells;
+    short_cells[0].test_count_ = 40;
+    {
+        BatchRecordWriter writer(record_file_);
+        for (auto &cell : short_cells) {
+            cell.record_writer_ = &writer;
+        }
+        BatchSweep(short_cells, 2, checkpoint_file);
+        writer.Append({MakeRecord(1)});
+    }
+    {
+        BatchRecordWriter writer(record_file_, "", true);
+        for (auto &cell : cells) {
+            cell.record_writer_ = &writer;
+        }
+        BatchSweep(cells, 3, checkpoint_file, true);
+    }
+
+    BatchRecordReader reader(record_file_);
+    ASSERT_THAT(reader.getNumRows(), Eq(150 + 90));
+    std::vector<int> rows_per_cell(2, 0);
+    for (uint64_t row = 0; row < reader.getNumRows(); row++) {
+        auto record = ReadRecord(reader, row);
+        int cell = record.num_nodes_ == 6 ? 0 : 1;
+        EXPECT_THAT(record.seed_, Eq(getSampleSeed(cells[cell].starting_seed_, rows_per_cell[cell]++)));
+    }
+    EXPECT_THAT(rows_per_cell, ElementsAre(150, 90));
+}
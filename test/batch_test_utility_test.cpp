@@ -0,0 +1,260 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <functional>
+#include <set>
+
+#include "batch_test_utility.h"
+#include "test_utility.h"
+
+using namespace intersection_management;
+using namespace ::testing;
+
+class TestParallelBatchTest : public Test {
+public:
+    BatchTestStatistics RunBatch(int num_threads, int test_count) {
+        return BatchTest(MakeQuietBatchOptions(12, test_count, 3, num_threads));
+    }
+};
+
+TEST_F(TestParallelBatchTest, MatchesSequentialStatistics) {
+    // not a multiple of the block size, so the last block is partial
+    int test_count = 3 * kSamplesPerThreadInBlock + 17;
+    auto sequential = RunBatch(1, test_count);
+    EXPECT_THAT(sequential.total_test_, Eq(test_count));
+    for (int num_threads : {2, 3, 8}) {
+        auto parallel = RunBatch(num_threads, test_count);
+        EXPECT_THAT(parallel.total_test_, Eq(sequential.total_test_));
+        EXPECT_THAT(parallel.sum_, Eq(sequential.sum_)); // bit-identical, not only close
+        EXPECT_THAT(parallel.better_count_, Eq(sequential.better_count_));
+        EXPECT_THAT(parallel.better_dfs_, Eq(sequential.better_dfs_));
+    }
+}
+TEST_F(TestParallelBatchTest, SeedsSamplesByIndex) {
+    auto statistics = RunBatch(1, 5);
+    BatchTestStatistics expected(param.travel_time_range[1]);
+    for (int sample_index = 0; sample_index < 5; sample_index++) {
+        expected.AddSample(BatchTestOneCase(12, false, getSampleSeed(3, sample_index)));
+    }
+    EXPECT_THAT(getSampleSeed(3, 4), Eq(7));
+    EXPECT_THAT(statistics.sum_, Eq(expected.sum_));
+}
+
+// every range is run on the threads started with the pool, each index once
+TEST(TestBatchWorkerPool, KeepsItsThreadsForEveryRange) {
+    BatchWorkerPool pool(4);
+    EXPECT_THAT(pool.getNumThreads(), Eq(4));
+    std::mutex mutex;
+    std::set<std::thread::id> thread_ids;
+    std::vector<int> num_runs(1000, 0);
+    std::function<void(long)> task = [&](long index) {
+        std::lock_guard<std::mutex> lock(mutex);
+        thread_ids.insert(std::this_thread::get_id());
+        num_runs[index]++;
+    };
+    for (long begin = 0; begin < num_runs.size(); begin += 10) {
+        pool.Run(begin, begin + 10, task);
+    }
+    pool.Run(5, 5, task);
+    EXPECT_THAT(num_runs, Each(Eq(1)));
+    EXPECT_THAT(thread_ids.size(), Le(4));
+}
+
+TEST(TestBatchSweep, MatchesBatchTestOfEveryCell) {
+    std::vector<BatchTestOptions> cells;
+    for (int num_nodes : {5, 12, 20}) {
+        auto cell = MakeQuietBatchOptions(num_nodes, kSamplesPerThreadInBlock + 9, num_nodes, 1);
+        cell.param_ = geometryParamVec[num_nodes % geometryParamVec.size()];
+        cells.push_back(cell);
+    }
+    cells[1].methods_ = (1u << Method_MultiWeightBfst) | (1u << Method_Fifo);
+
+    auto statistics = BatchSweep(cells, 3);
+    ASSERT_THAT(statistics.size(), Eq(cells.size()));
+    for (int cell = 0; cell < cells.size(); cell++) {
+        auto expected = BatchTest(cells[cell]);
+        EXPECT_THAT(statistics[cell].total_test_, Eq(expected.total_test_));
+        EXPECT_THAT(statistics[cell].sum_, Eq(expected.sum_));
+        EXPECT_THAT(statistics[cell].better_dfs_, Eq(expected.better_dfs_));
+    }
+    EXPECT_THAT(statistics[1].sum_[Method_ModifiedDfst], Eq(0));
+    EXPECT_THAT(statistics[1].sum_[Method_MultiWeightBfst], Gt(0));
+}
+TEST(TestBatchSweep, RunsOnlySelectedMethods) {
+    unsigned methods = 1u << Method_Bfst;
+    auto depths = BatchTestOneCase(param, 8, false, 1, methods);
+    auto all_depths = BatchTestOneCase(param, 8, false, 1);
+    for (int method = 0; method < kNumberOfBatchTestMethods; method++) {
+        EXPECT_THAT(depths[method], Eq(method == Method_Bfst ? all_depths[method] : 0));
+    }
+}
+
+TEST(TestBatchSweep, ExcludesMaskedMethodsFromTheRatios) {
+    BatchTestStatistics statistics(10, {}, (1u << Method_Bfst) | (1u << Method_Fifo));
+    // fifo would be better than the global optimum and dfs that report 0
+    statistics.AddSample({0, 0, 1, 0, 0, 12, 0});
+    EXPECT_THAT(statistics.sum_[Method_Bfst], Eq(10));
+    EXPECT_THAT(statistics.better_count_, Each(Eq(0)));
+    EXPECT_THAT(statistics.better_dfs_, Each(Eq(0)));
+    EXPECT_THAT(statistics.depth_statistics_[Method_ModifiedDfst].count_, Eq(0));
+
+    testing::internal::CaptureStdout();
+    statistics.Print(8);
+    EXPECT_THAT(testing::internal::GetCapturedStdout(),
+                HasSubstr("N/A, N/A, 10, N/A, N/A, 12, N/A, \n Better than Global Optimal ratio: \n"
+                          "N/A, N/A, N/A, N/A, N/A, N/A, N/A, "));
+}
+TEST(TestBatchSweep, DropsPairsWithMaskedMethods) {
+    BatchTestStatistics statistics(10, {{Method_MultiWeightBfst, Method_ModifiedDfst}, {Method_Bfst, Method_Fifo}},
+                                   (1u << Method_Bfst) | (1u << Method_Fifo));
+    ASSERT_THAT(statistics.paired_differences_.size(), Eq(1));
+    EXPECT_THAT(statistics.paired_differences_[0].first, Eq(Method_Bfst));
+    statistics.AddSample({0, 0, 1, 0, 0, 12, 0});
+    ASSERT_THAT(statistics.difference_statistics_.size(), Eq(1));
+    EXPECT_THAT(statistics.difference_statistics_[0].mean_, Eq(10 - 12));
+
+    testing::internal::CaptureStdout();
+    statistics.PrintConfidenceIntervals(1.96);
+    EXPECT_THAT(testing::internal::GetCapturedStdout(), AllOf(HasSubstr(" bfs - fifo"), Not(HasSubstr("mdbfs - dfs"))));
+}
+TEST(TestBatchSweep, RejectsNegativeTestCount) {
+    BatchTestOptions cell;
+    cell.num_nodes_ = 5;
+    cell.test_count_ = -1;
+    auto statistics = BatchSweep({cell}, 1);
+    ASSERT_THAT(statistics.size(), Eq(1));
+    EXPECT_THAT(statistics[0].total_test_, Eq(0));
+}
+
+class TestEarlyStopping : public Test {
+public:
+    BatchTestOptions GetOptions(int num_threads) {
+        auto options = MakeQuietBatchOptions(10, 5000, 0, num_threads);
+        options.methods_ = (1u << Method_ModifiedDfst) | (1u << Method_MultiWeightBfst);
+        options.ci_width_ = 2.0;
+        options.min_test_count_ = 50;
+        return options;
+    }
+};
+
+TEST_F(TestEarlyStopping, StopsOnceIntervalsAreNarrow) {
+    auto options = GetOptions(1);
+    auto statistics = BatchTest(options);
+    EXPECT_THAT(statistics.total_test_, AllOf(Ge(options.min_test_count_), Lt(options.test_count_)));
+    EXPECT_THAT(statistics.hasConverged(options), IsTrue());
+    for (auto method : {Method_ModifiedDfst, Method_MultiWeightBfst}) {
+        EXPECT_THAT(statistics.depth_statistics_[method].getConfidenceIntervalWidth(options.confidence_z_),
+                    Lt(options.ci_width_));
+    }
+    // the methods left out have no samples
+    EXPECT_THAT(statistics.depth_statistics_[Method_Fifo].count_, Eq(0));
+    ASSERT_THAT(statistics.difference_statistics_.size(), Eq(1));
+    EXPECT_THAT(statistics.difference_statistics_[0].mean_,
+                DoubleEq((statistics.sum_[Method_MultiWeightBfst] - statistics.sum_[Method_ModifiedDfst]) / statistics.total_test_));
+
+    // one sample less must not have converged
+    BatchTestStatistics shorter(options.param_.travel_time_range[1], options.paired_differences_);
+    for (long sample_index = 0; sample_index + 1 < statistics.total_test_; sample_index++) {
+        shorter.AddSample(BatchTestOneCase(options.param_, options.num_nodes_, false, getSampleSeed(0, sample_index), options.methods_));
+    }
+    EXPECT_THAT(shorter.hasConverged(options), IsFalse());
+}
+TEST_F(TestEarlyStopping, StopsAtTheSameSampleForAnyThreadCount) {
+    auto sequential = BatchTest(GetOptions(1));
+    auto parallel = BatchTest(GetOptions(3));
+    EXPECT_THAT(parallel.total_test_, Eq(sequential.total_test_));
+    EXPECT_THAT(parallel.sum_, Eq(sequential.sum_));
+
+    auto sweep = BatchSweep({GetOptions(1), GetOptions(1)}, 3);
+    for (auto &cell : sweep) {
+        EXPECT_THAT(cell.total_test_, Eq(sequential.total_test_));
+        EXPECT_THAT(cell.sum_, Eq(sequential.sum_));
+    }
+}
+
+class TestBatchCheckpoint : public Test {
+public:
+    BatchTestOptions GetOptions(int test_count) {
+        // the starting seed is drawn once, the checkpoint must keep it
+        auto options = MakeQuietBatchOptions(8, test_count, -1, 2);
+        options.checkpoint_file_ = checkpoint_file_;
+        return options;
+    }
+    void SetUp() override {
+        checkpoint_file_ = temp_files_.NewFile(".bin");
+    }
+
+    TestTempFiles temp_files_;
+    std::string checkpoint_file_;
+};
+
+TEST_F(TestBatchCheckpoint, ResumedRunMatchesUninterruptedRun) {
+    auto first_part = BatchTest(GetOptions(150));
+    EXPECT_THAT(first_part.total_test_, Eq(150));
+
+    auto options = GetOptions(400);
+    options.resume_ = true;
+    auto resumed = BatchTest(options);
+    EXPECT_THAT(resumed.total_test_, Eq(400));
+
+    std::vector<BatchCheckpointCell> checkpoint{BatchCheckpointCell{8, -1, 0, false,
+        BatchTestStatistics(options.param_.travel_time_range[1], options.paired_differences_),
+        GetBatchOptionsKey(options)}};
+    ASSERT_THAT(ReadBatchCheckpoint(checkpoint_file_, checkpoint), IsTrue());
+    EXPECT_THAT(checkpoint[0].next_sample_, Eq(400));
+
+    auto uninterrupted_options = GetOptions(400);
+    uninterrupted_options.starting_seed_ = checkpoint[0].starting_seed_;
+    uninterrupted_options.checkpoint_file_.clear();
+    auto uninterrupted = BatchTest(uninterrupted_options);
+    EXPECT_THAT(resumed.sum_, Eq(uninterrupted.sum_));
+    EXPECT_THAT(resumed.better_dfs_, Eq(uninterrupted.better_dfs_));
+    EXPECT_THAT(resumed.depth_statistics_[Method_MultiWeightBfst].m2_,
+                Eq(uninterrupted.depth_statistics_[Method_MultiWeightBfst].m2_));
+}
+TEST_F(TestBatchCheckpoint, ResumedSweepMatchesUninterruptedSweep) {
+    std::vector<BatchTestOptions> cells{GetOptions(100), GetOptions(200)};
+    cells[0].starting_seed_ = 5;
+    cells[1].num_nodes_ = 14;
+    cells[1].starting_seed_ = 9;
+    auto uninterrupted = BatchSweep(cells, 2);
+
+    auto short_cells = cells;
+    short_cells[1].test_count_ = 70;
+    BatchSweep(short_cells, 2, checkpoint_file_);
+    auto resumed = BatchSweep(cells, 3, checkpoint_file_, true);
+    for (int cell = 0; cell < cells.size(); cell++) {
+        EXPECT_THAT(resumed[cell].total_test_, Eq(cells[cell].test_count_));
+        EXPECT_THAT(resumed[cell].sum_, Eq(uninterrupted[cell].sum_));
+    }
+}
+TEST_F(TestBatchCheckpoint, RejectsCheckpointOfAnotherBatch) {
+    BatchTest(GetOptions(20));
+    auto options = GetOptions(40);
+    options.num_nodes_ = 9;
+    options.resume_ = true;
+    EXPECT_THAT(BatchTest(options).total_test_, Eq(0));
+}
+TEST_F(TestBatchCheckpoint, RejectsCheckpointOfOtherOptions) {
+    BatchTest(GetOptions(20));
+    std::vector<std::function<void(BatchTestOptions &)>> changes = {
+        [](BatchTestOptions &options) { options.methods_ &= ~(1u << Method_Fifo); },
+        [](BatchTestOptions &options) { options.param_.num_lanes_in_vec[0]++; },
+        [](BatchTestOptions &options) { options.param_.travel_time_range = {4, 7}; },
+        [](BatchTestOptions &options) { options.param_.travel_time_range = {6, 9}; },
+        [](BatchTestOptions &options) { options.param_.max_queueing_delay = 30; },
+        [](BatchTestOptions &options) { options.param_.activate_precedent_offset ^= true; },
+        [](BatchTestOptions &options) { options.starting_seed_ = 7; },
+        [](BatchTestOptions &options) { options.ci_width_ = 3; },
+    };
+    for (auto &change : changes) {
+        auto options = GetOptions(40);
+        options.resume_ = true;
+        change(options);
+        EXPECT_THAT(BatchTest(options).total_test_, Eq(0));
+    }
+    // more samples of the same batch are fine
+    auto options = GetOptions(40);
+    options.resume_ = true;
+    EXPECT_THAT(BatchTest(options).total_test_, Eq(40));
+}
@@ -0,0 +1,167 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <cstring>
+#include <iterator>
+
+#include "cdg_corpus.h"
+#include "cdg_scheduler.h"
+#include "test_utility.h"
+
+using namespace intersection_management;
+using namespace ::testing;
+
+class TestCDGCorpus : public Test {
+public:
+    void SetUp() override {
+        corpus_file_ = temp_files_.NewFile(".imcg");
+    }
+    // every other graph with its implicit fairness conflicts
+    static ConflictDirectedGraph GenerateGraph(int num_nodes, int seed) {
+        auto cdg = GenerateIntersectionGraph(num_nodes, seed);
+        if (seed % 2) {
+            cdg.AddImplicitFairnessConflicts();
+        }
+        return cdg;
+    }
+
+    TestTempFiles temp_files_;
+    std::string corpus_file_;
+};
+
+TEST_F(TestCDGCorpus, LoadedGraphsScheduleLikeTheOriginals) {
+    std::vector<ConflictDirectedGraph> graphs;
+    for (int seed = 0; seed < 10; seed++) {
+        graphs.push_back(GenerateGraph(5 + 5 * seed, seed));
+    }
+    ConflictDirectedGraph random_graph;
+    random_graph.setSeed(1);
+    random_graph.GenerateRandomConnectedGraph(25, 0.3);
+    graphs.push_back(random_graph);
+    {
+        CDGCorpusWriter writer(corpus_file_);
+        for (auto &cdg : graphs) {
+            writer.Append(cdg);
+        }
+        ASSERT_THAT(writer.Close(), IsTrue());
+    }
+
+    CDGCorpusReader reader(corpus_file_);
+    ASSERT_THAT(reader.isOpen(), IsTrue());
+    ASSERT_THAT(reader.getNumGraphs(), Eq(graphs.size()));
+    CDGScheduler scheduler;
+    CDGScheduleResult original, loaded;
+    ConflictDirectedGraph cdg;
+    for (int index = 0; index < graphs.size(); index++) {
+        auto &graph = graphs[index];
+        ASSERT_THAT(reader.LoadGraph(index, cdg), IsTrue());
+        ASSERT_THAT(cdg.num_nodes_, Eq(graph.num_nodes_));
+        EXPECT_THAT(cdg.edges_.size(), Eq(graph.edges_.size()));
+        EXPECT_THAT(cdg.fairness_order_diff_threshold_, Eq(graph.fairness_order_diff_threshold_));
+        for (int id = 0; id < cdg.num_nodes_; id++) {
+            EXPECT_THAT(cdg.nodes_[id]->estimate_arrival_time_, Eq(graph.nodes_[id]->estimate_arrival_time_));
+            EXPECT_THAT(cdg.nodes_[id]->out_lane_id_, Eq(graph.nodes_[id]->out_lane_id_));
+            ASSERT_THAT(cdg.nodes_[id]->edges_.size(), Eq(graph.nodes_[id]->edges_.size()));
+            for (int k = 0; k < cdg.nodes_[id]->edges_.size(); k++) {
+                auto &edge = *cdg.nodes_[id]->edges_[k];
+                auto &original_edge = *graph.nodes_[id]->edges_[k];
+                EXPECT_THAT(edge.node2_.lock()->id_, Eq(original_edge.node2_.lock()->id_));
+                EXPECT_THAT(edge.estimate_offset_, Eq(original_edge.estimate_offset_));
+                EXPECT_THAT(edge.bidirectional_, Eq(original_edge.bidirectional_));
+                EXPECT_THAT(edge.conflict_type_.isPrecedence(), Eq(original_edge.conflict_type_.isPrecedence()));
+                EXPECT_THAT(edge.conflict_type_.isCrossing(), Eq(original_edge.conflict_type_.isCrossing()));
+            }
+        }
+        scheduler.ScheduleWithBfstMultiWeight(graph, original);
+        scheduler.ScheduleWithBfstMultiWeight(cdg, loaded);
+        EXPECT_THAT(loaded.depth_, Eq(original.depth_));
+        scheduler.ScheduleWithModifiedDfst(graph, original);
+        scheduler.ScheduleWithModifiedDfst(cdg, loaded);
+        EXPECT_THAT(loaded.depth_, Eq(original.depth_));
+    }
+}
+TEST_F(TestCDGCorpus, ViewPointsIntoTheFile) {
+    auto graph = GenerateGraph(12, 4);
+    {
+        CDGCorpusWriter writer(corpus_file_);
+        writer.Append(graph);
+        writer.Append(graph);
+    }
+    CDGCorpusReader reader(corpus_file_);
+    ASSERT_THAT(reader.getNumGraphs(), Eq(2));
+    CDGCorpusGraph view;
+    ASSERT_THAT(reader.getGraph(1, view), IsTrue());
+    EXPECT_THAT(view.num_nodes_, Eq(graph.num_nodes_));
+    EXPECT_THAT(view.num_edges_, Eq(graph.edges_.size()));
+    EXPECT_THAT(reinterpret_cast<uintptr_t>(view.edge_weight_) % alignof(double), Eq(0));
+    for (int id = 0; id < graph.num_nodes_; id++) {
+        EXPECT_THAT(view.estimate_travel_time_[id], Eq(graph.nodes_[id]->estimate_travel_time_));
+        EXPECT_THAT(view.edge_offset_[id + 1] - view.edge_offset_[id], Eq(graph.nodes_[id]->edges_.size()));
+    }
+}
+TEST_F(TestCDGCorpus, RejectsUnclosedCorpus) {
+    std::ofstream(corpus_file_, std::ios::binary) << "IMCG not a corpus";
+    CDGCorpusReader reader(corpus_file_);
+    EXPECT_THAT(reader.isOpen(), IsFalse());
+    EXPECT_THAT(reader.getNumGraphs(), Eq(0));
+}
+TEST_F(TestCDGCorpus, RejectsIndexBeyondTheCorpus) {
+    {
+        CDGCorpusWriter writer(corpus_file_);
+        writer.Append(GenerateGraph(6, 1));
+    }
+    CDGCorpusReader reader(corpus_file_);
+    ASSERT_THAT(reader.getNumGraphs(), Eq(1));
+    CDGCorpusGraph view;
+    ConflictDirectedGraph cdg;
+    EXPECT_THAT(reader.getGraph(1, view), IsFalse());
+    EXPECT_THAT(reader.LoadGraph(1, cdg), IsFalse());
+    EXPECT_THAT(reader.LoadGraph(0, cdg), IsTrue());
+}
+// a corpus whose index or graphs point outside the file is not opened
+TEST_F(TestCDGCorpus, RejectsCorruptCorpus) {
+    auto graph = GenerateGraph(8, 2);
+    {
+        CDGCorpusWriter writer(corpus_file_);
+        writer.Append(graph);
+        writer.Append(graph);
+    }
+    std::string corpus;
+    {
+        std::ifstream in(corpus_file_, std::ios::binary);
+        corpus.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    uint64_t index_offset;
+    std::memcpy(&index_offset, corpus.data() + corpus.size() - 24, sizeof(index_offset));
+    uint64_t second_offset;
+    std::memcpy(&second_offset, corpus.data() + index_offset + 8, sizeof(second_offset));
+    // node count, edge count, first CSR offset and first edge target of the second graph
+    size_t n = graph.num_nodes_;
+    size_t csr_offset = second_offset + 16 + 16 * n + 16 * n;
+    size_t target_offset = csr_offset + (((n + 1) * 4 + 7) & ~size_t(7)) + 16 * graph.edges_.size();
+    struct Corruption {
+        size_t position_;
+        uint64_t value_;
+        size_t size_;
+    };
+    std::vector<Corruption> corruptions = {
+        {index_offset + 8, index_offset, 8}, // second graph at the index
+        {index_offset + 8, 12, 8}, // unaligned graph
+        {corpus.size() - 24, index_offset + 8, 8}, // index offset
+        {corpus.size() - 16, 3, 8}, // graph count
+        {second_offset, 1u << 30, 4}, // node count
+        {second_offset + 4, 1u << 20, 4}, // edge count
+        {csr_offset, 1, 4},
+        {target_offset, n, 4},
+    };
+    for (auto &corruption : corruptions) {
+        std::string corrupt = corpus;
+        std::memcpy(&corrupt[corruption.position_], &corruption.value_, corruption.size_);
+        std::ofstream(corpus_file_, std::ios::binary | std::ios::trunc) << corrupt;
+        CDGCorpusReader reader(corpus_file_);
+        EXPECT_THAT(reader.isOpen(), IsFalse()) << "corruption at byte " << corruption.position_;
+        EXPECT_THAT(reader.getNumGraphs(), Eq(0));
+    }
+    std::ofstream(corpus_file_, std::ios::binary | std::ios::trunc) << corpus;
+    EXPECT_THAT(CDGCorpusReader(corpus_file_).getNumGraphs(), Eq(2));
+}
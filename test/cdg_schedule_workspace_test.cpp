@@ -0,0 +1,142 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "batch_test_utility.h"
+#include "cdg_scheduler.h"
+#include "test_utility.h"
+
+using namespace intersection_management;
+using namespace ::testing;
+
+// every test file is its own executable, so replacing the global allocator only affects this file
+namespace {
+std::atomic<bool> count_allocations(false);
+std::atomic<long> num_allocations(0);
+} // namespace
+
+void *operator new(std::size_t size) {
+    if (count_allocations) {
+        num_allocations++;
+    }
+    if (void *ptr = std::malloc(size == 0 ? 1 : size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::size_t) noexcept { std::free(ptr); }
+
+class TestScheduleWorkspace : public Test {
+public:
+    void SetUp() override {
+        for (int seed = 0; seed < 8; seed++) {
+            graphs_.push_back(GenerateIntersectionGraph(10 + 5 * seed, seed));
+            if (seed % 2) {
+                graphs_.back().AddImplicitFairnessConflicts();
+            }
+        }
+    }
+
+    double ScheduleAll() {
+        double sum = 0;
+        for (auto &cdg : graphs_) {
+            scheduler_.ScheduleWithModifiedDfst(cdg, result_);
+            sum += result_.makespan_;
+            scheduler_.ScheduleWithBfstWeightedEdgeOnly(cdg, result_);
+            sum += result_.makespan_;
+            scheduler_.ScheduleWithBfstMultiWeight(cdg, result_);
+            sum += result_.makespan_;
+            scheduler_.ScheduleWithDfstMultiWeight(cdg, result_);
+            sum += result_.makespan_;
+        }
+        return sum;
+    }
+
+    std::vector<ConflictDirectedGraph> graphs_;
+    CDGScheduler scheduler_;
+    CDGScheduleResult result_;
+};
+
+TEST_F(TestScheduleWorkspace, SteadyStateIsAllocationFree) {
+    double warm_up = ScheduleAll();
+
+    num_allocations = 0;
+    count_allocations = true;
+    double steady_state = ScheduleAll();
+    count_allocations = false;
+
+    EXPECT_THAT(num_allocations.load(), Eq(0));
+    EXPECT_THAT(steady_state, Eq(warm_up));
+}
+TEST_F(TestScheduleWorkspace, MatchesFreshScheduler) {
+    ScheduleAll();
+    for (auto &cdg : graphs_) {
+        CDGScheduler fresh_scheduler;
+        CDGScheduleResult fresh_result;
+        fresh_scheduler.ScheduleWithBfstMultiWeight(cdg, fresh_result);
+        scheduler_.ScheduleWithBfstMultiWeight(cdg, result_);
+        EXPECT_THAT(result_.depth_, Eq(fresh_result.depth_));
+        EXPECT_THAT(result_.parent_id_, Eq(fresh_result.parent_id_));
+        EXPECT_THAT(result_.order_, Eq(fresh_result.order_));
+    }
+}
+
+// per-sample path of BatchTest: intersection, graph, FIFO and every CDG method
+class TestBatchTestWorkspace : public Test {
+public:
+    TestBatchTestWorkspace() : local_param_(param), other_geometry_param_(param) {
+        local_param_.max_queueing_delay = 20;
+        other_geometry_param_.num_legs = 3;
+        other_geometry_param_.num_lanes_in_vec = {2, 1, 1};
+        other_geometry_param_.num_lanes_out_vec = {1, 2, 1};
+    }
+
+    // the global optimum only on the small cases, it is a search over every order. A geometry other than the
+    // one of the case before is rebuilt, so all the cases share one
+    double RunAll() {
+        double sum = 0;
+        for (int seed = 0; seed < 8; seed++) {
+            bool is_small = seed % 2 == 0;
+            workspace_.RunCase(local_param_, is_small ? 4 : 20, depth_, false, seed,
+                               is_small ? kAllBatchTestMethods : kAllBatchTestMethods & ~(1u << Method_GlobalOptimal));
+            for (double value : depth_) {
+                sum += value;
+            }
+        }
+        return sum;
+    }
+
+    Parameters local_param_;
+    Parameters other_geometry_param_;
+    BatchTestWorkspace workspace_;
+    std::vector<double> depth_;
+};
+
+TEST_F(TestBatchTestWorkspace, SteadyStateIsAllocationFree) {
+    double warm_up = RunAll();
+
+    num_allocations = 0;
+    count_allocations = true;
+    double steady_state = RunAll();
+    count_allocations = false;
+
+    EXPECT_THAT(num_allocations.load(), Eq(0));
+    EXPECT_THAT(steady_state, Eq(warm_up));
+}
+TEST_F(TestBatchTestWorkspace, MatchesFreshCase) {
+    RunAll();
+    for (int seed = 0; seed < 4; seed++) {
+        auto &case_param = seed % 2 ? other_geometry_param_ : local_param_;
+        int num_nodes = 4 + 3 * seed;
+        workspace_.RunCase(case_param, num_nodes, depth_, false, seed);
+        EXPECT_THAT(depth_, Eq(BatchTestOneCase(case_param, num_nodes, false, seed)));
+        BatchTestWorkspace fresh_workspace;
+        std::vector<double> fresh_depth;
+        fresh_workspace.RunCase(case_param, num_nodes, fresh_depth, false, seed);
+        EXPECT_THAT(depth_, Eq(fresh_depth));
+    }
+}
@@ -0,0 +1,296 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <random>
+#include <set>
+#include <thread>
+
+#include "cdg_scheduler.h"
+#include "batch_test_utility.h"
+#include "test_utility.h"
+
+using namespace intersection_management;
+using namespace ::testing;
+
+class TestImplicitFairness : public Test {
+public:
+    // random graph whose conflict edges span the fairness threshold only if overlap_window, pairs in conflict
+    // then keep their conflict edge in both forms
+    void GenerateGraph(ConflictDirectedGraph &cdg, int total_nodes, int seed, bool overlap_window = false) {
+        std::mt19937 mt(seed);
+        cdg.reset(false);
+        for (int id = 1; id <= total_nodes; id++) {
+            cdg.AddNode(mt() % 4 + 2);
+        }
+        int threshold = overlap_window ? total_nodes : cdg.GetFairnessOrderDiffThreshold();
+        for (int from = 1; from <= total_nodes; from++) {
+            for (int to = from + 1; to <= total_nodes && to - from < threshold; to++) {
+                if (mt() % 10 < 3) {
+                    cdg.AddEdge(from, to, mt() % 3 + 1, mt() % 2);
+                }
+            }
+        }
+        for (int to = 1; to <= total_nodes; to++) {
+            cdg.AddEdge(0, to, 1.0, false);
+        }
+    }
+};
+
+TEST_F(TestImplicitFairness, MatchesFairnessEdges) {
+    CDGScheduler scheduler;
+    for (int seed = 0; seed < 30; seed++) {
+        ConflictDirectedGraph edge_form, implicit_form;
+        GenerateGraph(edge_form, 24, seed);
+        GenerateGraph(implicit_form, 24, seed);
+        edge_form.AddFairnessConflicts();
+        implicit_form.AddImplicitFairnessConflicts();
+        EXPECT_THAT(implicit_form.edges_.size(), Lt(edge_form.edges_.size()));
+
+        EXPECT_THAT(scheduler.ScheduleWithModifiedDfst(implicit_form).edge_weighted_depth_,
+                    Eq(scheduler.ScheduleWithModifiedDfst(edge_form).edge_weighted_depth_));
+        EXPECT_THAT(scheduler.ScheduleWithBfstWeightedEdgeOnly(implicit_form).edge_weighted_depth_,
+                    Eq(scheduler.ScheduleWithBfstWeightedEdgeOnly(edge_form).edge_weighted_depth_));
+        EXPECT_THAT(scheduler.ScheduleWithBfstMultiWeight(implicit_form).edge_node_weighted_depth_,
+                    Eq(scheduler.ScheduleWithBfstMultiWeight(edge_form).edge_node_weighted_depth_));
+        EXPECT_THAT(scheduler.ScheduleWithDfstMultiWeight(implicit_form).edge_node_weighted_depth_,
+                    Eq(scheduler.ScheduleWithDfstMultiWeight(edge_form).edge_node_weighted_depth_));
+    }
+}
+TEST_F(TestImplicitFairness, MatchesFairnessEdgesInBruteForceSearch) {
+    CDGScheduler scheduler;
+    for (int seed = 0; seed < 10; seed++) {
+        ConflictDirectedGraph edge_form, implicit_form;
+        GenerateGraph(edge_form, 6, seed);
+        GenerateGraph(implicit_form, 6, seed);
+        edge_form.AddFairnessConflicts();
+        implicit_form.AddImplicitFairnessConflicts();
+
+        auto edge_form_order = scheduler.ScheduleBruteForceSearch(edge_form);
+        double edge_form_optimal = scheduler.GetEvacuationTimeFromOrder(edge_form_order, edge_form);
+        auto implicit_form_order = scheduler.ScheduleBruteForceSearch(implicit_form);
+        EXPECT_THAT(scheduler.GetEvacuationTimeFromOrder(implicit_form_order, implicit_form), Eq(edge_form_optimal));
+    }
+}
+TEST_F(TestImplicitFairness, MatchesFairnessEdgesOverlappingConflicts) {
+    CDGScheduler scheduler;
+    for (int seed = 0; seed < 30; seed++) {
+        ConflictDirectedGraph edge_form, implicit_form;
+        GenerateGraph(edge_form, 24, seed, true);
+        GenerateGraph(implicit_form, 24, seed, true);
+        edge_form.AddFairnessConflicts();
+        implicit_form.AddImplicitFairnessConflicts();
+
+        CDGScheduleResult edge_result, implicit_result;
+        scheduler.ScheduleWithBfstMultiWeight(edge_form, edge_result);
+        scheduler.ScheduleWithBfstMultiWeight(implicit_form, implicit_result);
+        EXPECT_THAT(implicit_result.depth_, Eq(edge_result.depth_));
+        scheduler.ScheduleWithModifiedDfst(edge_form, edge_result);
+        scheduler.ScheduleWithModifiedDfst(implicit_form, implicit_result);
+        EXPECT_THAT(implicit_result.depth_, Eq(edge_result.depth_));
+        EXPECT_THAT(scheduler.ScheduleWithBfstWeightedEdgeOnly(implicit_form).edge_weighted_depth_,
+                    Eq(scheduler.ScheduleWithBfstWeightedEdgeOnly(edge_form).edge_weighted_depth_));
+        EXPECT_THAT(scheduler.ScheduleWithDfstMultiWeight(implicit_form).edge_node_weighted_depth_,
+                    Eq(scheduler.ScheduleWithDfstMultiWeight(edge_form).edge_node_weighted_depth_));
+    }
+    for (int seed = 0; seed < 10; seed++) {
+        ConflictDirectedGraph edge_form, implicit_form;
+        GenerateGraph(edge_form, 6, seed, true);
+        GenerateGraph(implicit_form, 6, seed, true);
+        edge_form.AddFairnessConflicts();
+        implicit_form.AddImplicitFairnessConflicts();
+        auto edge_form_order = scheduler.ScheduleBruteForceSearch(edge_form);
+        double edge_form_optimal = scheduler.GetEvacuationTimeFromOrder(edge_form_order, edge_form);
+        auto implicit_form_order = scheduler.ScheduleBruteForceSearch(implicit_form);
+        EXPECT_THAT(scheduler.GetEvacuationTimeFromOrder(implicit_form_order, implicit_form), Eq(edge_form_optimal));
+    }
+}
+TEST_F(TestImplicitFairness, HoldsLateVehicleUntilEarlyVehiclesFinish) {
+    ConflictDirectedGraph cdg;
+    CDGScheduler scheduler;
+    GenerateGraph(cdg, 10, 0);
+    cdg.AddImplicitFairnessConflicts();
+    auto tree = scheduler.ScheduleWithBfstMultiWeight(cdg);
+    int threshold = cdg.fairness_order_diff_threshold_;
+    for (int to = threshold + 1; to < cdg.num_nodes_; to++) {
+        double start = tree.nodes_[to]->edge_node_weighted_depth_ - cdg.nodes_[to]->estimate_travel_time_;
+        for (int from = 1; from <= to - threshold; from++) {
+            EXPECT_THAT(start, Ge(tree.nodes_[from]->edge_node_weighted_depth_));
+        }
+    }
+}
+
+// depth sums recorded from the four hand-written schedulers before they became one template
+TEST(TestSpanningTreeSchedulers, KeepsReferenceDepths) {
+    CDGScheduler scheduler;
+    double dfst_sum = 0, bfst_sum = 0, mdbfst_sum = 0, mddfst_sum = 0;
+    for (int seed = 0; seed < 20; seed++) {
+        auto cdg = GenerateIntersectionGraph(30, seed);
+        dfst_sum += scheduler.ScheduleWithModifiedDfst(cdg).edge_weighted_depth_;
+        bfst_sum += scheduler.ScheduleWithBfstWeightedEdgeOnly(cdg).edge_weighted_depth_;
+        mdbfst_sum += scheduler.ScheduleWithBfstMultiWeight(cdg).edge_node_weighted_depth_;
+        mddfst_sum += scheduler.ScheduleWithDfstMultiWeight(cdg).edge_node_weighted_depth_;
+    }
+    EXPECT_THAT(dfst_sum, Eq(309));
+    EXPECT_THAT(bfst_sum, Eq(309));
+    EXPECT_THAT(mdbfst_sum, Eq(1845));
+    EXPECT_THAT(mddfst_sum, Eq(1931));
+}
+TEST(TestSpanningTreeSchedulers, KeepsParentsConsistentWithDepths) {
+    CDGScheduler scheduler;
+    for (int seed = 0; seed < 10; seed++) {
+        auto cdg = GenerateIntersectionGraph(40, seed);
+        auto mdbfst = scheduler.ScheduleWithBfstMultiWeight(cdg);
+        EXPECT_THAT(mdbfst.edges_.size(), Eq(cdg.num_nodes_ - 1));
+        for (auto &edge : mdbfst.edges_) {
+            auto parent = edge->node1_.lock();
+            auto child = edge->node2_.lock();
+            EXPECT_THAT(child->edge_node_weighted_depth_,
+                        Ge(parent->edge_node_weighted_depth_ + edge->edge_weight_ + child->estimate_travel_time_));
+        }
+    }
+}
+TEST(TestSpanningTreeSchedulers, ResultMatchesMaterializedTree) {
+    CDGScheduler scheduler;
+    CDGScheduleResult result;
+    for (int seed = 0; seed < 10; seed++) {
+        auto cdg = GenerateIntersectionGraph(30, seed);
+        cdg.AddImplicitFairnessConflicts();
+        auto mdbfst = scheduler.ScheduleWithBfstMultiWeight(cdg);
+        scheduler.ScheduleWithBfstMultiWeight(cdg, result);
+        EXPECT_THAT(result.makespan_, Eq(mdbfst.edge_node_weighted_depth_));
+        EXPECT_THAT(result.CalculateFairnessIndex(Type_JainIndex),
+                    Eq(mdbfst.CalculateFairnessIndex(Type_EdgeNodeWeightedDepth, Type_JainIndex)));
+        for (int id = 1; id < cdg.num_nodes_; id++) {
+            EXPECT_THAT(result.depth_[id], Eq(mdbfst.nodes_[id]->edge_node_weighted_depth_));
+            EXPECT_THAT(mdbfst.nodes_[result.parent_id_[id]]->isConnectedTo(id), IsTrue());
+        }
+
+        auto modified_dfst = scheduler.ScheduleWithModifiedDfst(cdg);
+        scheduler.ScheduleWithModifiedDfst(cdg, result);
+        EXPECT_THAT(result.makespan_, Eq(modified_dfst.edge_weighted_depth_));
+        for (int id = 1; id < cdg.num_nodes_; id++) {
+            EXPECT_THAT(result.depth_[id], Eq(modified_dfst.nodes_[id]->edge_weighted_depth_));
+        }
+    }
+}
+
+// the order of a cold schedule as seed gives back that order and its depths
+TEST(TestSpanningTreeSchedulers, SeedOrderReplaysPreviousOrder) {
+    CDGScheduler scheduler;
+    CDGScheduleResult result;
+    std::vector<int> order;
+    for (int seed = 0; seed < 10; seed++) {
+        auto cdg = GenerateIntersectionGraph(30, seed);
+        scheduler.ScheduleWithBfstMultiWeight(cdg, result);
+        std::vector<int> cold_order = result.order_;
+        auto cold_depth = scheduler.GetDepthVectorFromOrder(cold_order, cdg);
+        auto warm_depth = scheduler.ScheduleFromSeedOrder(cdg, cold_order, order);
+        EXPECT_THAT(order, Eq(cold_order));
+        EXPECT_THAT(warm_depth, Eq(cold_depth));
+    }
+}
+// the newest vehicles left out of the seed settle among the others by their conflicts, which beats putting
+// them last and comes close to scheduling from scratch
+TEST(TestSpanningTreeSchedulers, SeedOrderInsertsNewNodesByConflicts) {
+    CDGScheduler scheduler;
+    CDGScheduleResult result;
+    std::vector<int> order;
+    const int kNumSeeded = 25;
+    double warm_sum = 0, appended_sum = 0, cold_sum = 0;
+    for (int seed = 0; seed < 20; seed++) {
+        auto cdg = GenerateIntersectionGraph(30, seed);
+        scheduler.ScheduleWithBfstMultiWeight(cdg, result);
+        auto cold_depth = scheduler.GetDepthVectorFromOrder(result.order_, cdg);
+        std::vector<int> seed_order;
+        for (int id : result.order_) {
+            if (id > 0 && id <= kNumSeeded) {
+                seed_order.push_back(id);
+            }
+        }
+        std::vector<int> appended_order(1, 0);
+        appended_order.insert(appended_order.end(), seed_order.begin(), seed_order.end());
+        for (int id = kNumSeeded + 1; id < cdg.num_nodes_; id++) {
+            appended_order.push_back(id);
+        }
+        auto appended_depth = scheduler.GetDepthVectorFromOrder(appended_order, cdg);
+        auto warm_depth = scheduler.ScheduleFromSeedOrder(cdg, seed_order, order);
+        ASSERT_THAT(warm_depth.size(), Eq(cdg.num_nodes_));
+
+        // the seeded nodes keep their order
+        std::vector<int> seeded_in_order;
+        for (int id : order) {
+            if (id > 0 && id <= kNumSeeded) {
+                seeded_in_order.push_back(id);
+            }
+        }
+        EXPECT_THAT(seeded_in_order, Eq(seed_order));
+        EXPECT_THAT(warm_depth, Eq(scheduler.GetDepthVectorFromOrder(order, cdg)));
+        for (int id = 1; id < cdg.num_nodes_; id++) {
+            warm_sum += warm_depth[id];
+            appended_sum += appended_depth[id];
+            cold_sum += cold_depth[id];
+        }
+    }
+    EXPECT_THAT(warm_sum, Lt(appended_sum));
+    EXPECT_THAT(warm_sum, Lt(cold_sum * 1.05));
+}
+// nodes seeded before their parents wait for them
+TEST(TestSpanningTreeSchedulers, SeedOrderKeepsParentsFirst) {
+    CDGScheduler scheduler;
+    std::vector<int> order;
+    for (int seed = 0; seed < 10; seed++) {
+        auto cdg = GenerateIntersectionGraph(30, seed);
+        std::vector<int> seed_order;
+        for (int id = 20; id >= 1; id--) {
+            seed_order.push_back(id);
+        }
+        auto depth = scheduler.ScheduleFromSeedOrder(cdg, seed_order, order);
+        ASSERT_THAT(depth.size(), Eq(cdg.num_nodes_));
+        ASSERT_THAT(order.size(), Eq(cdg.num_nodes_));
+        std::vector<int> position(cdg.num_nodes_);
+        for (int k = 0; k < order.size(); k++) {
+            position[order[k]] = k;
+        }
+        EXPECT_THAT(std::set<int>(order.begin(), order.end()).size(), Eq(cdg.num_nodes_));
+        for (auto &edge : cdg.edges_) {
+            if (!edge->bidirectional_) {
+                int from = edge->node1_.lock()->id_;
+                int to = edge->node2_.lock()->id_;
+                EXPECT_THAT(position[from], Lt(position[to]));
+                EXPECT_THAT(depth[to] - cdg.nodes_[to]->estimate_travel_time_,
+                            Ge(depth[from] + edge->getMultiWeight(scheduler.activate_precedent_offset_)));
+            }
+        }
+    }
+}
+
+// every worker owns its configuration and generators, so running cases concurrently gives the sequential results
+TEST(TestConcurrentScheduling, MatchesSequentialResults) {
+    const int kNumWorkers = 4;
+    std::vector<Parameters> worker_param(kNumWorkers, param);
+    for (int worker = 0; worker < kNumWorkers; worker++) {
+        worker_param[worker].activate_precedent_offset = worker % 2;
+        worker_param[worker].activate_transitive_reduction = worker / 2;
+    }
+    std::vector<std::vector<std::vector<double>>> sequential(kNumWorkers), concurrent(kNumWorkers);
+    for (int worker = 0; worker < kNumWorkers; worker++) {
+        for (int seed = 0; seed < 20; seed++) {
+            sequential[worker].push_back(BatchTestOneCase(worker_param[worker], 20, false, seed));
+        }
+    }
+
+    std::vector<std::thread> workers;
+    for (int worker = 0; worker < kNumWorkers; worker++) {
+        workers.emplace_back([&, worker]() {
+            for (int seed = 0; seed < 20; seed++) {
+                concurrent[worker].push_back(BatchTestOneCase(worker_param[worker], 20, false, seed));
+            }
+        });
+    }
+    for (auto &thread : workers) {
+        thread.join();
+    }
+    for (int worker = 0; worker < kNumWorkers; worker++) {
+        EXPECT_THAT(concurrent[worker], Eq(sequential[worker]));
+    }
+}
@@ -0,0 +1,200 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <set>
+#include <tuple>
+
+#include "conflict_directed_graph.h"
+#include "cdg_scheduler.h"
+#include "test_utility.h"
+
+using namespace intersection_management;
+using namespace ::testing;
+
+class TestTransitiveReduction : public Test {
+public:
+    ConflictDirectedGraph cdg_;
+    void SetUp() override {
+        cdg_.AddNode(2);
+        cdg_.AddNode(3);
+        cdg_.AddNode(4);
+        cdg_.AddEdge(0, 1, 1);
+        cdg_.AddEdge(0, 2, 1);
+        cdg_.AddEdge(0, 3, 1);
+        cdg_.AddEdge(1, 2, 1);
+        cdg_.AddEdge(2, 3, 1);
+    }
+};
+
+TEST_F(TestTransitiveReduction, RemovesEdgeImpliedByLongerPath) {
+    cdg_.AddEdge(1, 3, 1);
+    EXPECT_THAT(cdg_.ReduceTransitiveEdges(), Eq(1));
+    EXPECT_THAT(cdg_.nodes_[1]->isConnectedTo(3), IsFalse());
+    EXPECT_THAT(cdg_.edges_.size(), Eq(5));
+}
+TEST_F(TestTransitiveReduction, KeepsEdgesFromRoot) {
+    cdg_.ReduceTransitiveEdges();
+    EXPECT_THAT(cdg_.nodes_[0]->isConnectedTo(2), IsTrue());
+    EXPECT_THAT(cdg_.nodes_[0]->isConnectedTo(3), IsTrue());
+}
+TEST_F(TestTransitiveReduction, KeepsEdgeHeavierThanAlternativePath) {
+    cdg_.AddEdge(1, 3, 8);
+    EXPECT_THAT(cdg_.ReduceTransitiveEdges(), Eq(0));
+    EXPECT_THAT(cdg_.nodes_[1]->isConnectedTo(3), IsTrue());
+}
+TEST_F(TestTransitiveReduction, KeepsBidirectionalEdges) {
+    cdg_.AddEdge(1, 3, 1, true);
+    EXPECT_THAT(cdg_.ReduceTransitiveEdges(), Eq(0));
+    EXPECT_THAT(cdg_.nodes_[3]->isConnectedTo(1), IsTrue());
+}
+
+TEST(TestTransitiveReductionOnIntersection, KeepsScheduleDepths) {
+    CDGScheduler scheduler;
+    for (int seed = 0; seed < 20; seed++) {
+        auto cdg = GenerateIntersectionGraph(30, seed);
+        auto dfst = scheduler.ScheduleWithModifiedDfst(cdg);
+        auto bfst = scheduler.ScheduleWithBfstWeightedEdgeOnly(cdg);
+        auto mdbfst = scheduler.ScheduleWithBfstMultiWeight(cdg);
+        auto mddfst = scheduler.ScheduleWithDfstMultiWeight(cdg);
+
+        int num_edges = cdg.edges_.size();
+        EXPECT_THAT(cdg.ReduceTransitiveEdges(), Gt(0));
+        EXPECT_THAT(cdg.edges_.size(), Lt(num_edges));
+        EXPECT_THAT(cdg.isFullyConnected(), IsTrue());
+
+        EXPECT_THAT(scheduler.ScheduleWithModifiedDfst(cdg).edge_weighted_depth_, Eq(dfst.edge_weighted_depth_));
+        EXPECT_THAT(scheduler.ScheduleWithBfstWeightedEdgeOnly(cdg).edge_weighted_depth_, Eq(bfst.edge_weighted_depth_));
+        EXPECT_THAT(scheduler.ScheduleWithBfstMultiWeight(cdg).edge_node_weighted_depth_, Eq(mdbfst.edge_node_weighted_depth_));
+        EXPECT_THAT(scheduler.ScheduleWithDfstMultiWeight(cdg).edge_node_weighted_depth_, Eq(mddfst.edge_node_weighted_depth_));
+    }
+}
+TEST(TestTransitiveReductionOnIntersection, KeepsScheduleDepthsWithFairnessConflicts) {
+    CDGScheduler scheduler;
+    for (int seed = 0; seed < 20; seed++) {
+        auto cdg = GenerateIntersectionGraph(40, seed);
+        cdg.AddFairnessConflicts();
+        auto mdbfst = scheduler.ScheduleWithBfstMultiWeight(cdg);
+        auto bfst = scheduler.ScheduleWithBfstWeightedEdgeOnly(cdg);
+
+        cdg.ReduceTransitiveEdges();
+        EXPECT_THAT(scheduler.ScheduleWithBfstMultiWeight(cdg).edge_node_weighted_depth_, Eq(mdbfst.edge_node_weighted_depth_));
+        EXPECT_THAT(scheduler.ScheduleWithBfstWeightedEdgeOnly(cdg).edge_weighted_depth_, Eq(bfst.edge_weighted_depth_));
+    }
+}
+
+TEST(TestRandomGraph, DependsOnlyOnItsOwnSeed) {
+    ConflictDirectedGraph cdg1, cdg2;
+    cdg1.setSeed(7);
+    cdg2.setSeed(7);
+    cdg1.GenerateRandomGraph(12);
+    srand(1234); // the process-global generator must not matter
+    cdg2.GenerateRandomGraph(12);
+    ASSERT_THAT(cdg2.edges_.size(), Eq(cdg1.edges_.size()));
+    for (int i = 0; i < cdg1.edges_.size(); i++) {
+        EXPECT_THAT(cdg2.edges_[i]->node1_.lock()->id_, Eq(cdg1.edges_[i]->node1_.lock()->id_));
+        EXPECT_THAT(cdg2.edges_[i]->node2_.lock()->id_, Eq(cdg1.edges_[i]->node2_.lock()->id_));
+        EXPECT_THAT(cdg2.edges_[i]->edge_weight_, Eq(cdg1.edges_[i]->edge_weight_));
+    }
+    for (int id = 0; id < cdg1.num_nodes_; id++) {
+        EXPECT_THAT(cdg2.nodes_[id]->estimate_travel_time_, Eq(cdg1.nodes_[id]->estimate_travel_time_));
+    }
+}
+
+class TestRandomConnectedGraph : public Test {
+public:
+    // vehicle pairs with at least one edge, every pair must be counted once
+    static int CountConflictingPairs(ConflictDirectedGraph &cdg) {
+        int num_pairs = 0;
+        for (int from = 1; from < cdg.num_nodes_; from++) {
+            for (int to = from + 1; to < cdg.num_nodes_; to++) {
+                num_pairs += cdg.nodes_[from]->isConnectedTo(to) || cdg.nodes_[to]->isConnectedTo(from);
+            }
+        }
+        return num_pairs;
+    }
+};
+
+TEST_F(TestRandomConnectedGraph, ConnectsEveryVehicle) {
+    ConflictDirectedGraph cdg;
+    cdg.setSeed(3);
+    for (double density : {0.0, 0.05, 0.3, 0.7, 1.0}) {
+        for (int total_nodes : {1, 2, 10, 60}) {
+            cdg.GenerateRandomConnectedGraph(total_nodes, density);
+            EXPECT_THAT(cdg.num_nodes_, Eq(total_nodes + 1));
+            EXPECT_THAT(cdg.isConflictConnected(), IsTrue());
+            EXPECT_THAT(cdg.isFullyConnected(), IsTrue());
+        }
+    }
+}
+TEST_F(TestRandomConnectedGraph, ReachesTargetDensityWithoutDuplicates) {
+    ConflictDirectedGraph cdg;
+    cdg.setSeed(5);
+    for (double density : {0.0, 0.2, 0.5, 0.8, 1.0}) {
+        cdg.GenerateRandomConnectedGraph(40, density);
+        int expected = std::max(39, (int)std::llround(density * 40 * 39 / 2));
+        EXPECT_THAT(CountConflictingPairs(cdg), Eq(expected));
+
+        int num_edges = 40; // from the root
+        for (auto &edge : cdg.edges_) {
+            int from = edge->node1_.lock()->id_;
+            int to = edge->node2_.lock()->id_;
+            if (!edge->bidirectional_) {
+                EXPECT_THAT(from, Lt(to));
+            }
+        }
+        for (int from = 1; from < cdg.num_nodes_; from++) {
+            for (int to = from + 1; to < cdg.num_nodes_; to++) {
+                num_edges += cdg.nodes_[from]->isConnectedTo(to) + cdg.nodes_[to]->isConnectedTo(from);
+            }
+        }
+        EXPECT_THAT(cdg.edges_.size(), Eq(num_edges));
+    }
+}
+TEST_F(TestRandomConnectedGraph, DependsOnlyOnItsOwnSeed) {
+    ConflictDirectedGraph cdg1, cdg2;
+    cdg1.setSeed(11);
+    cdg2.setSeed(11);
+    cdg1.GenerateRandomConnectedGraph(30, 0.4);
+    cdg2.GenerateRandomConnectedGraph(30, 0.4);
+    ASSERT_THAT(cdg2.edges_.size(), Eq(cdg1.edges_.size()));
+    for (int i = 0; i < cdg1.edges_.size(); i++) {
+        EXPECT_THAT(cdg2.edges_[i]->node1_.lock()->id_, Eq(cdg1.edges_[i]->node1_.lock()->id_));
+        EXPECT_THAT(cdg2.edges_[i]->node2_.lock()->id_, Eq(cdg1.edges_[i]->node2_.lock()->id_));
+        EXPECT_THAT(cdg2.edges_[i]->edge_weight_, Eq(cdg1.edges_[i]->edge_weight_));
+    }
+}
+
+TEST(TestCanonicalHash, IgnoresTheOrderEdgesWereAddedIn) {
+    ConflictDirectedGraph forward, backward;
+    std::vector<std::tuple<int, int, double, bool>> conflicts = {{1, 2, 2, false}, {1, 3, 1, true}, {2, 4, 3, false},
+                                                                 {3, 4, 2, true}, {0, 1, 1, false}, {0, 2, 1, false},
+                                                                 {0, 3, 1, false}, {0, 4, 1, false}};
+    for (auto cdg : {&forward, &backward}) {
+        for (double travel_time : {2, 3, 4, 2}) {
+            cdg->AddNode(travel_time);
+        }
+    }
+    for (auto &conflict : conflicts) {
+        forward.AddEdge(std::get<0>(conflict), std::get<1>(conflict), std::get<2>(conflict), std::get<3>(conflict));
+    }
+    for (auto conflict = conflicts.rbegin(); conflict != conflicts.rend(); conflict++) {
+        backward.AddEdge(std::get<0>(*conflict), std::get<1>(*conflict), std::get<2>(*conflict), std::get<3>(*conflict));
+    }
+    EXPECT_THAT(backward.getCanonicalHash(), Eq(forward.getCanonicalHash()));
+
+    backward.nodes_[2]->edges_[0]->edge_weight_ += 1;
+    EXPECT_THAT(backward.getCanonicalHash(), Ne(forward.getCanonicalHash()));
+    backward.nodes_[2]->edges_[0]->edge_weight_ -= 1;
+    backward.nodes_[3]->estimate_travel_time_ = 5;
+    EXPECT_THAT(backward.getCanonicalHash(), Ne(forward.getCanonicalHash()));
+}
+TEST(TestCanonicalHash, SeparatesRandomInstances) {
+    ConflictDirectedGraph cdg;
+    cdg.setSeed(2);
+    std::set<uint64_t> hashes;
+    for (int i = 0; i < 500; i++) {
+        cdg.GenerateRandomConnectedGraph(8, 0.5);
+        hashes.insert(cdg.getCanonicalHash());
+    }
+    EXPECT_THAT(hashes.size(), Eq(500));
+}
@@ -0,0 +1,197 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <cmath>
+#include <fstream>
+
+#include "demand_stream.h"
+#include "intersection.h"
+#include "test_utility.h"
+
+using namespace intersection_management;
+using namespace ::testing;
+
+class TestDemandStream : public Test {
+public:
+    TestDemandStream() : local_param_(param) {
+        local_param_.num_legs = 4;
+        local_param_.num_lanes_in_vec = {1, 2, 1, 2};
+        local_param_.num_lanes_out_vec = {1, 2, 1, 2};
+        local_param_.arrival_interval_avg = 2.0;
+        local_param_.travel_time_choice = {5, 6, 7};
+    }
+
+    Parameters local_param_;
+};
+
+TEST_F(TestDemandStream, DrawsUniformDemandAtTheAverageInterval) {
+    DemandStream demand(local_param_, 7);
+    VehicleTraceRecord record;
+    double last_arrival_time = 0;
+    std::vector<int> in_lane_count(2, 0);
+    const int kNumVehicles = 40000;
+    for (int i = 0; i < kNumVehicles; i++) {
+        ASSERT_THAT(demand.Next(record), IsTrue());
+        EXPECT_THAT(record.arrival_time_, Ge(last_arrival_time));
+        EXPECT_THAT(record.out_leg_id_, Ne(record.in_leg_id_));
+        EXPECT_THAT(record.out_lane_id_, Lt(local_param_.num_lanes_out_vec[record.out_leg_id_]));
+        EXPECT_THAT(record.travel_time_, Eq(getTurnTravelTime(local_param_.travel_time_choice, 4, record.in_leg_id_,
+                                                              record.out_leg_id_)));
+        if (record.in_leg_id_ == 1) {
+            in_lane_count[record.in_lane_id_]++;
+        }
+        last_arrival_time = record.arrival_time_;
+    }
+    EXPECT_THAT(last_arrival_time / kNumVehicles, DoubleNear(2.0, 0.05));
+    // every in lane carries a sixth of the demand
+    EXPECT_THAT(in_lane_count[0], AllOf(Gt(kNumVehicles / 6 * 0.95), Lt(kNumVehicles / 6 * 1.05)));
+    EXPECT_THAT(in_lane_count[1], AllOf(Gt(kNumVehicles / 6 * 0.95), Lt(kNumVehicles / 6 * 1.05)));
+}
+
+TEST_F(TestDemandStream, FollowsTheTimeOfDayProfile) {
+    DemandProfile profile;
+    profile.lanes_ = {LaneDemand{0, 0, 0.5, {0, 0, 1, 0}}, LaneDemand{3, 1, 0.5, {0, 1, 3, 0}}};
+    profile.time_of_day_ = {{50, 0.0}, {0, 2.0}, {75, 1.0}};
+    profile.period_ = 100;
+    DemandStream demand(local_param_, profile, 3);
+
+    std::vector<int> count_in_phase(3, 0);
+    std::vector<int> out_leg_count(4, 0);
+    VehicleTraceRecord record;
+    while (demand.Next(record) && record.arrival_time_ < 100000) {
+        double time_of_day = std::fmod(record.arrival_time_, 100);
+        count_in_phase[time_of_day < 50 ? 0 : (time_of_day < 75 ? 1 : 2)]++;
+        if (record.in_leg_id_ == 0) {
+            EXPECT_THAT(record.out_leg_id_, Eq(2));
+        }
+        else {
+            out_leg_count[record.out_leg_id_]++;
+        }
+    }
+    EXPECT_THAT(count_in_phase[1], Eq(0));
+    // 1000 days of 50 s at rate 2 and 25 s at rate 1
+    EXPECT_THAT(count_in_phase[0], AllOf(Gt(95000), Lt(105000)));
+    EXPECT_THAT(count_in_phase[2], AllOf(Gt(23750), Lt(26250)));
+    EXPECT_THAT(out_leg_count[0] + out_leg_count[3], Eq(0));
+    EXPECT_THAT(out_leg_count[2] / double(out_leg_count[1]), DoubleNear(3.0, 0.1));
+}
+
+TEST_F(TestDemandStream, EndsAfterTheLastStepWithDemand) {
+    DemandProfile profile;
+    profile.lanes_ = {LaneDemand{0, 0, 0.5, {0, 1, 1, 1}}};
+    profile.time_of_day_ = {{0, 1.0}, {100, 0.0}};
+    DemandStream demand(local_param_, profile, 5);
+    VehicleTraceRecord record;
+    int num_vehicles = 0;
+    while (demand.Next(record)) {
+        EXPECT_THAT(record.arrival_time_, Lt(100));
+        num_vehicles++;
+    }
+    EXPECT_THAT(num_vehicles, AllOf(Gt(25), Lt(75)));
+    EXPECT_THAT(demand.Next(record), IsFalse());
+    std::vector<VehicleTraceRecord> batch;
+    EXPECT_THAT(demand.NextBatch(batch, 10), Eq(0));
+}
+
+// a step without demand is jumped over, also when it starts the period or spans its end
+TEST_F(TestDemandStream, SkipsStepsWithoutDemand) {
+    DemandProfile profile;
+    profile.lanes_ = {LaneDemand{0, 0, 0.5, {0, 1, 1, 1}}};
+    profile.time_of_day_ = {{90, 0.0}, {40, 1.0}, {60, 0.0}};
+    profile.period_ = 100;
+    DemandStream demand(local_param_, profile, 9);
+    VehicleTraceRecord record;
+    int num_vehicles = 0;
+    while (demand.Next(record) && record.arrival_time_ < 100000) {
+        double time_of_day = std::fmod(record.arrival_time_, 100);
+        EXPECT_THAT(time_of_day, AllOf(Ge(40), Lt(60)));
+        num_vehicles++;
+    }
+    // 1000 days of 20 s at rate 0.5
+    EXPECT_THAT(num_vehicles, AllOf(Gt(9500), Lt(10500)));
+}
+
+TEST_F(TestDemandStream, RejectsNegativeOrZeroScales) {
+    DemandProfile profile;
+    profile.lanes_ = {LaneDemand{0, 0, 0.5, {0, 1, 1, 1}}};
+    profile.time_of_day_ = {{0, 1.0}, {50, -1.0}};
+    profile.period_ = 100;
+    VehicleTraceRecord record;
+    DemandStream negative_demand(local_param_, profile, 1);
+    EXPECT_THAT(negative_demand.hasDemand(), IsFalse());
+    EXPECT_THAT(negative_demand.Next(record), IsFalse());
+
+    profile.time_of_day_ = {{0, 0.0}, {50, 0.0}};
+    DemandStream zero_demand(local_param_, profile, 1);
+    EXPECT_THAT(zero_demand.hasDemand(), IsFalse());
+    EXPECT_THAT(zero_demand.Next(record), IsFalse());
+}
+
+// batches are the vehicles of the one by one stream cut at the batch ends
+TEST_F(TestDemandStream, BatchesMatchTheVehicleStream) {
+    DemandStream single(local_param_, 11), batched(local_param_, 11);
+    std::vector<VehicleTraceRecord> batch;
+    VehicleTraceRecord record;
+    for (double end_time = 10; end_time <= 1000; end_time += 10) {
+        batch.clear();
+        batched.NextBatch(batch, 4, end_time);
+        EXPECT_THAT(batch.size(), Le(4));
+        for (auto &vehicle : batch) {
+            EXPECT_THAT(vehicle.arrival_time_, Lt(end_time));
+            ASSERT_THAT(single.Next(record), IsTrue());
+            EXPECT_THAT(vehicle.arrival_time_, Eq(record.arrival_time_));
+            EXPECT_THAT(vehicle.out_lane_id_, Eq(record.out_lane_id_));
+        }
+        // the stream falls behind if the batches are too small, so catch up
+        while (batched.NextBatch(batch, 1, end_time) > 0) {
+            ASSERT_THAT(single.Next(record), IsTrue());
+            EXPECT_THAT(batch.back().arrival_time_, Eq(record.arrival_time_));
+        }
+    }
+}
+
+TEST_F(TestDemandStream, ReadsProfileFromYaml) {
+    TestTempFiles temp_files;
+    std::string file = temp_files.NewFile(".yaml");
+    {
+        std::ofstream out(file);
+        out << "lanes:\n"
+               "  - {leg: 1, lane: 1, rate: 0.25, turn_ratios: [1, 0, 0, 0]}\n"
+               "  - {leg: 5, lane: 0, rate: 1.0, turn_ratios: [1, 1, 1, 1]}\n"
+               "time_of_day:\n"
+               "  period: 86400\n"
+               "  steps: [[0, 0.5], [25200, 1.5]]\n";
+    }
+    auto profile = ReadDemandProfile(file);
+    ASSERT_THAT(profile.lanes_.size(), Eq(2));
+    EXPECT_THAT(profile.lanes_[0].turn_ratios_, ElementsAre(1, 0, 0, 0));
+    EXPECT_THAT(profile.period_, Eq(86400));
+
+    // the lane on leg 5 is not in the geometry and is dropped
+    DemandStream demand(local_param_, profile, 0);
+    EXPECT_THAT(demand.getRateScale(86400 + 3600), Eq(0.5));
+    EXPECT_THAT(demand.getRateScale(-3600), Eq(1.5));
+    VehicleTraceRecord record;
+    for (int i = 0; i < 100; i++) {
+        ASSERT_THAT(demand.Next(record), IsTrue());
+        EXPECT_THAT(record.in_leg_id_, Eq(1));
+        EXPECT_THAT(record.out_leg_id_, Eq(0));
+    }
+
+    DemandStream no_demand(local_param_, DemandProfile(), 0);
+    EXPECT_THAT(no_demand.hasDemand(), IsFalse());
+    EXPECT_THAT(no_demand.Next(record), IsFalse());
+}
+
+TEST_F(TestDemandStream, FeedsTheIntersection) {
+    Intersection intersection(local_param_);
+    DemandStream demand(local_param_, 5);
+    EXPECT_THAT(intersection.AddVehicleNodesFromDemand(demand, 50), Eq(50));
+    EXPECT_THAT(intersection.AddVehicleNodesFromDemand(demand, 50), Eq(50));
+    ASSERT_THAT(intersection.getNumNodes(), Eq(101));
+    EXPECT_THAT(intersection.latest_arrival_time_, Eq(intersection.nodes_[100]->estimate_arrival_time_));
+    for (int id = 1; id < intersection.getNumNodes(); id++) {
+        EXPECT_THAT(intersection.arrival_order_[id - 1], Eq(id));
+    }
+    intersection.AssignRoutesToNodes();
+}
@@ -41,14 +41,14 @@ void cdg_main_test1() {
 
     for (int repeat = 0; repeat < total_test; repeat++) {
         // seed = std::time(NULL);
-        srand(seed++);
+        cdg.setSeed(seed++);
         // std::cout << seed << std::endl;
         // srand(28745);
         // srand(100);
         do {
-            // cdg.GenerateRandomGraph(std::rand() % max_node + 1);
+            // cdg.GenerateRandomGraph(cdg.mt_() % max_node + 1);
             // cdg.GenerateRandomGraph(5, 4.0, 2.0, 2.0, 1.0, true);
-            cdg.GenerateRandomGraph(std::rand() % max_node + 5, max_estimate_travel_time - min_estimate_travel_time + 1.0, 2.0, min_estimate_travel_time, 1.0, true);
+            cdg.GenerateRandomGraph(cdg.mt_() % max_node + 5, max_estimate_travel_time - min_estimate_travel_time + 1.0, 2.0, min_estimate_travel_time, 1.0, true);
         } while (!cdg.isFullyConnected());
         // cdg.PrintGraph();
         // std::cout << "The CDG fully connected status is: " << cdg.isFullyConnected() << std::endl;
@@ -156,7 +156,7 @@ void cdg_main_test2() {
         total_test++;
         seed = std::time(NULL);
         do {
-            cdg.GenerateRandomGraph(std::rand() % max_node + 5);
+            cdg.GenerateRandomGraph(cdg.mt_() % max_node + 5);
         } while (!cdg.isFullyConnected());
 
         // std::cout << "The CDG fully connected status is: " << cdg.isFullyConnected() << std::endl;
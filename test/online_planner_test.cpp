@@ -0,0 +1,229 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <algorithm>
+#include <tuple>
+#include <utility>
+
+#include "online_planner.h"
+
+using namespace intersection_management;
+using namespace ::testing;
+
+TEST(TestArrivalAdmission, ClosesBatchOnSizeOrDeadline) {
+    ArrivalAdmission admission(ArrivalAdmissionOptions{3, 2.0});
+    std::vector<VehicleTraceRecord> batch;
+    EXPECT_THAT(admission.isEmpty(), IsTrue());
+    EXPECT_THAT(admission.getDeadline(), Eq(std::numeric_limits<double>::infinity()));
+
+    EXPECT_THAT(admission.Add(VehicleTraceRecord{1.0, 6, 0, 0, 2, 0}), IsFalse());
+    EXPECT_THAT(admission.getDeadline(), Eq(3.0));
+    EXPECT_THAT(admission.Add(VehicleTraceRecord{1.5, 6, 1, 0, 3, 0}), IsFalse());
+    EXPECT_THAT(admission.Add(VehicleTraceRecord{2.0, 6, 2, 0, 0, 0}), IsTrue());
+    admission.CloseBatch(2.0, batch);
+    EXPECT_THAT(batch.size(), Eq(3));
+    EXPECT_THAT(admission.isEmpty(), IsTrue());
+
+    admission.Add(VehicleTraceRecord{4.0, 6, 0, 0, 2, 0});
+    admission.CloseBatch(admission.getDeadline(), batch);
+    ASSERT_THAT(batch.size(), Eq(1));
+    EXPECT_THAT(batch[0].arrival_time_, Eq(4.0));
+
+    EXPECT_THAT(admission.batch_size_.count_, Eq(2));
+    EXPECT_THAT(admission.batch_size_.mean_, Eq(2.0));
+    // latencies 1, 0.5, 0 and 2
+    EXPECT_THAT(admission.latency_.mean_, DoubleEq(0.875));
+}
+
+// edges of the graph with their conflicts, by node ids
+std::vector<std::tuple<int, int, bool, double, bool, bool, bool, bool>> GetConflictEdges(ConflictDirectedGraph &cdg) {
+    std::vector<std::tuple<int, int, bool, double, bool, bool, bool, bool>> edges;
+    for (auto &edge : cdg.edges_) {
+        auto &ct = edge->conflict_type_;
+        edges.emplace_back(edge->node1_.lock()->id_, edge->node2_.lock()->id_, edge->bidirectional_,
+                           edge->estimate_offset_, ct.diverging_, ct.converging_, ct.crossing_, ct.competing_);
+    }
+    return edges;
+}
+
+// graph of the vehicles of the window generated from scratch, the way the window built it every cycle before
+ConflictDirectedGraph GenerateWindowGraph(const Parameters &local_param, const PlanningWindow &window) {
+    Intersection intersection(local_param);
+    intersection.ResetVehicles();
+    for (auto *vehicles : {&window.getEnteredVehicles(), &window.getWaitingVehicles()}) {
+        for (auto &vehicle : *vehicles) {
+            auto &record = vehicle.record_;
+            intersection.AddNode(intersection.NewNode(intersection.getNumNodes(), record.travel_time_,
+                                                      record.in_leg_id_, record.in_lane_id_, record.out_leg_id_,
+                                                      record.out_lane_id_, record.arrival_time_));
+        }
+    }
+    intersection.AssignCriticalResourcesToNodes();
+    intersection.AssignRoutesToNodes();
+    intersection.AssignEdgesWithSafetyOffsetToNodes();
+    ConflictDirectedGraph cdg(local_param);
+    cdg.reset(false);
+    cdg.GenerateGraphFromIntersection(intersection);
+    return cdg;
+}
+
+// the graph put together from the conflicts the window keeps is the graph generated from scratch, and with
+// the horizon it has the pairs of the horizon and only conflicts of the whole window besides
+TEST(TestPlanningWindow, KeepsTheConflictsOfTheGraph) {
+    Parameters local_param(param);
+    local_param.travel_time_choice = {5, 6, 7};
+    local_param.arrival_interval_avg = 2.0;
+    local_param.activate_transitive_reduction = false;
+    for (double max_queueing_delay : {-1.0, 10.0}) {
+        local_param.max_queueing_delay = max_queueing_delay;
+        Parameters all_pairs_param(local_param);
+        all_pairs_param.max_queueing_delay = -1;
+        DemandStream demand(local_param, 4);
+        PlanningWindow window(local_param);
+        PlanningScheduler scheduler(local_param);
+        PlanningJob job(local_param);
+        IntersectionPlan plan, previous;
+        std::vector<VehicleTraceRecord> batch;
+        double now = 0;
+        for (int cycle = 0; cycle < 100; cycle++) {
+            now += 5;
+            batch.clear();
+            demand.NextBatch(batch, 100, now);
+            window.Admit(batch, now, plan);
+            window.BuildJob(now, job);
+            std::swap(plan, previous);
+            scheduler.Schedule(job, previous, plan);
+            while (window.AddMissedConflicts(plan, job)) {
+                scheduler.Schedule(job, previous, plan);
+            }
+            if (job.waiting_.empty()) {
+                continue;
+            }
+            auto edges = GetConflictEdges(job.cdg_);
+            auto all_pair_cdg = GenerateWindowGraph(all_pairs_param, window);
+            auto all_pair_edges = GetConflictEdges(all_pair_cdg);
+            ASSERT_THAT(job.cdg_.num_nodes_, Eq(all_pair_cdg.num_nodes_));
+            if (max_queueing_delay < 0) {
+                ASSERT_THAT(edges, ElementsAreArray(all_pair_edges));
+                continue;
+            }
+            auto horizon_cdg = GenerateWindowGraph(local_param, window);
+            auto horizon_edges = GetConflictEdges(horizon_cdg);
+            std::sort(edges.begin(), edges.end());
+            std::sort(all_pair_edges.begin(), all_pair_edges.end());
+            std::sort(horizon_edges.begin(), horizon_edges.end());
+            EXPECT_THAT(std::includes(edges.begin(), edges.end(), horizon_edges.begin(), horizon_edges.end()), IsTrue());
+            EXPECT_THAT(std::includes(all_pair_edges.begin(), all_pair_edges.end(), edges.begin(), edges.end()),
+                        IsTrue());
+        }
+        EXPECT_THAT(window.num_entered_, Gt(100));
+    }
+}
+
+// a vehicle held in the window past the horizon keeps the one behind it in its lane from passing it
+TEST(TestPlanningWindow, LinksVehiclesInLaneBeyondHorizon) {
+    Parameters local_param(param);
+    local_param.max_queueing_delay = 5;
+    PlanningWindow window(local_param);
+    PlanningJob job(local_param);
+    IntersectionPlan plan; // has no vehicle, so the first one keeps waiting
+    window.Admit({VehicleTraceRecord{0.0, 6, 0, 0, 2, 0}}, 0.0, plan);
+    window.Admit({VehicleTraceRecord{100.0, 6, 0, 0, 1, 0}, VehicleTraceRecord{100.0, 6, 1, 0, 3, 0}}, 100.0, plan);
+    window.BuildJob(100.0, job);
+    ASSERT_THAT(job.waiting_.size(), Eq(3));
+    std::vector<std::pair<int, int>> linked;
+    for (auto &edge : GetConflictEdges(job.cdg_)) {
+        linked.emplace_back(std::get<0>(edge), std::get<1>(edge));
+    }
+    EXPECT_THAT(linked, Contains(Pair(1, 2)));
+    EXPECT_THAT(linked, Not(Contains(Pair(1, 3))));
+}
+
+class TestOnlinePlanner : public TestWithParam<int> {
+public:
+    TestOnlinePlanner() : local_param_(param) {
+        local_param_.travel_time_choice = {5, 6, 7};
+        local_param_.arrival_interval_avg = 3.0;
+    }
+
+    Parameters local_param_;
+};
+
+class TestOnlinePlannerAdmission : public TestOnlinePlanner {};
+
+// vehicles from different legs merging into the same lane conflict, so their windows must not overlap
+TEST_P(TestOnlinePlanner, PlansWaitingVehiclesAroundTheEnteredOnes) {
+    DemandStream demand(local_param_, 1);
+    WarmStartOptions warm_start;
+    warm_start.cold_start_period_ = GetParam();
+    OnlinePlanner planner(local_param_, warm_start);
+    std::vector<VehicleTraceRecord> batch;
+    long num_admitted = 0;
+    double now = 0;
+    for (int cycle = 0; cycle < 200; cycle++) {
+        now += 10;
+        batch.clear();
+        num_admitted += demand.NextBatch(batch, 100, now);
+        auto &plan = planner.Plan(batch, now);
+
+        auto &waiting = planner.window_.getWaitingVehicles();
+        auto &entered = planner.window_.getEnteredVehicles();
+        EXPECT_THAT(plan.sequence_, Eq(cycle + 1));
+        ASSERT_THAT(plan.vehicles_.size(), Eq(waiting.size()));
+        EXPECT_THAT(planner.window_.num_entered_ + static_cast<long>(plan.vehicles_.size()), Eq(num_admitted));
+        for (int index = 0; index < plan.vehicles_.size(); index++) {
+            auto &vehicle = plan.vehicles_[index];
+            EXPECT_THAT(vehicle.vehicle_id_, Eq(waiting[index].vehicle_id_));
+            EXPECT_THAT(vehicle.entry_time_, Ge(now));
+            EXPECT_THAT(vehicle.exit_time_, Gt(vehicle.entry_time_));
+            for (int inside = 0; inside < entered.size(); inside++) {
+                auto &window = planner.window_.getEnteredWindows()[inside];
+                EXPECT_THAT(window.exit_time_, Gt(now));
+                if (entered[inside].record_.out_leg_id_ == waiting[index].record_.out_leg_id_ &&
+                    entered[inside].record_.out_lane_id_ == waiting[index].record_.out_lane_id_ &&
+                    entered[inside].record_.in_leg_id_ != waiting[index].record_.in_leg_id_) {
+                    EXPECT_THAT(vehicle.entry_time_, Ge(window.exit_time_));
+                }
+            }
+        }
+    }
+    EXPECT_THAT(planner.window_.num_entered_, Gt(num_admitted * 9 / 10));
+    EXPECT_THAT(planner.window_.entry_delay_.mean_, Ge(0));
+    if (GetParam() == 1) {
+        EXPECT_THAT(planner.getNumWarmStarts(), Eq(0));
+    }
+    else {
+        EXPECT_THAT(planner.getNumWarmStarts(), Gt(0));
+        EXPECT_THAT(planner.getNumWarmStarts(), Le(200 - 200 / GetParam()));
+    }
+}
+// cold start periods, 1 schedules every plan from scratch
+INSTANTIATE_TEST_SUITE_P(ColdStartPeriods, TestOnlinePlanner, Values(1, 4));
+
+TEST_F(TestOnlinePlannerAdmission, LargerBatchesPlanLessOften) {
+    std::vector<long> num_plans;
+    for (int batch_size : {1, 4, 16}) {
+        DemandStream demand(local_param_, 2);
+        ArrivalAdmission admission(ArrivalAdmissionOptions{batch_size, 1000.0});
+        OnlinePlanner planner(local_param_);
+        long num_admitted = RunOnlinePlanning(demand, admission, planner, 600);
+        EXPECT_THAT(admission.batch_size_.mean_ * admission.batch_size_.count_, DoubleEq(num_admitted));
+        EXPECT_THAT(planner.planning_time_.count_, Eq(admission.batch_size_.count_));
+        num_plans.push_back(planner.planning_time_.count_);
+        if (batch_size == 1) {
+            EXPECT_THAT(num_plans.back(), Eq(num_admitted));
+            EXPECT_THAT(admission.latency_.mean_, Eq(0));
+        }
+    }
+    EXPECT_THAT(num_plans[1], Lt(num_plans[0]));
+    EXPECT_THAT(num_plans[2], Lt(num_plans[1]));
+}
+
+TEST_F(TestOnlinePlannerAdmission, DeadlineBoundsAdmissionLatency) {
+    DemandStream demand(local_param_, 3);
+    ArrivalAdmission admission(ArrivalAdmissionOptions{1000, 2.0});
+    OnlinePlanner planner(local_param_);
+    RunOnlinePlanning(demand, admission, planner, 600);
+    EXPECT_THAT(admission.latency_.mean_, AllOf(Gt(0), Le(2.0)));
+    EXPECT_THAT(admission.batch_size_.mean_, Lt(1000));
+}
@@ -0,0 +1,125 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <fstream>
+
+#include "optimal_solution_cache.h"
+#include "cdg_scheduler.h"
+#include "batch_test_utility.h"
+#include "test_utility.h"
+
+using namespace intersection_management;
+using namespace ::testing;
+
+class TestOptimalSolutionCache : public Test {
+public:
+    void SetUp() override {
+        cache_file_ = temp_files_.NewFile(".bin");
+    }
+
+    TestTempFiles temp_files_;
+    std::string cache_file_;
+};
+
+TEST_F(TestOptimalSolutionCache, ReturnsTheSearchedOptimum) {
+    ConflictDirectedGraph cdg;
+    CDGScheduler searching, cached;
+    OptimalSolutionCache cache(cache_file_);
+    ASSERT_THAT(cache.isOpen(), IsTrue());
+    cached.optimal_solution_cache_ = &cache;
+    cdg.setSeed(4);
+    for (int i = 0; i < 20; i++) {
+        cdg.GenerateRandomConnectedGraph(5, 0.5);
+        auto order = searching.ScheduleBruteForceSearch(cdg);
+        auto depth_vector = searching.GetDepthVectorFromOrder(order, cdg);
+        EXPECT_THAT(cached.ScheduleBruteForceSearch(cdg), Eq(order));
+        EXPECT_THAT(cached.ScheduleBruteForceSearch(cdg), Eq(order));
+        EXPECT_THAT(cached.GetDepthVectorFromOrder(order, cdg), Eq(depth_vector));
+    }
+    EXPECT_THAT(cache.misses_, Eq(20));
+    EXPECT_THAT(cache.hits_, Eq(20));
+}
+TEST_F(TestOptimalSolutionCache, KeepsOptimaAcrossRuns) {
+    ConflictDirectedGraph cdg;
+    cdg.setSeed(8);
+    std::vector<std::vector<int>> orders;
+    std::vector<double> makespans;
+    {
+        OptimalSolutionCache cache(cache_file_);
+        CDGScheduler scheduler;
+        scheduler.optimal_solution_cache_ = &cache;
+        for (int i = 0; i < 10; i++) {
+            cdg.GenerateRandomConnectedGraph(4, 0.6);
+            orders.push_back(scheduler.ScheduleBruteForceSearch(cdg));
+            makespans.push_back(scheduler.GetEvacuationTimeFromOrder(orders.back(), cdg));
+        }
+    }
+    {
+        // a crash while appending leaves part of an entry behind
+        std::ofstream out(cache_file_, std::ios::binary | std::ios::app);
+        out << "partial";
+    }
+
+    OptimalSolutionCache cache(cache_file_);
+    EXPECT_THAT(cache.size(), Eq(10));
+    cdg.setSeed(8);
+    CDGScheduler scheduler;
+    for (int i = 0; i < 10; i++) {
+        cdg.GenerateRandomConnectedGraph(4, 0.6);
+        std::vector<int> order;
+        double makespan;
+        ASSERT_THAT(cache.Lookup(scheduler.getOptimalSolutionKey(cdg), CDGScheduler::getOptimalSolutionFingerprint(cdg),
+                                 order, makespan),
+                    IsTrue());
+        EXPECT_THAT(order, Eq(orders[i]));
+        EXPECT_THAT(makespan, Eq(makespans[i]));
+    }
+    cache.Insert(1, 2, {0, 1}, 2.0);
+    cache.Flush();
+    EXPECT_THAT(OptimalSolutionCache(cache_file_).size(), Eq(11));
+}
+// an entry of another instance under the same key is a miss, not its optimum
+TEST_F(TestOptimalSolutionCache, MissesOnKeyOfAnotherInstance) {
+    ConflictDirectedGraph cdg;
+    cdg.setSeed(3);
+    cdg.GenerateRandomConnectedGraph(5, 0.5);
+    CDGScheduler searching, cached;
+    auto order = searching.ScheduleBruteForceSearch(cdg);
+    OptimalSolutionCache cache(cache_file_);
+    cached.optimal_solution_cache_ = &cache;
+    cache.Insert(cached.getOptimalSolutionKey(cdg), CDGScheduler::getOptimalSolutionFingerprint(cdg) + 1, {0, 1},
+                 1.0);
+    EXPECT_THAT(cached.ScheduleBruteForceSearch(cdg), Eq(order));
+    EXPECT_THAT(cache.collisions_, Eq(1));
+    EXPECT_THAT(cache.hits_, Eq(0));
+
+    std::vector<int> cached_order;
+    double makespan;
+    EXPECT_THAT(cache.Lookup(cached.getOptimalSolutionKey(cdg), CDGScheduler::getOptimalSolutionFingerprint(cdg),
+                             cached_order, makespan),
+                IsFalse());
+}
+// the optimum depends on how the scheduler weighs precedence offsets, so it is part of the key
+TEST_F(TestOptimalSolutionCache, KeysOnPrecedentOffsetSetting) {
+    ConflictDirectedGraph cdg;
+    cdg.setSeed(1);
+    cdg.GenerateRandomConnectedGraph(4, 0.5);
+    Parameters local_param = param;
+    local_param.activate_precedent_offset = !param.activate_precedent_offset;
+    EXPECT_THAT(CDGScheduler(local_param).getOptimalSolutionKey(cdg), Ne(CDGScheduler().getOptimalSolutionKey(cdg)));
+}
+TEST_F(TestOptimalSolutionCache, BatchTestReusesOptima) {
+    OptimalSolutionCache cache(cache_file_);
+    std::vector<std::vector<double>> uncached;
+    for (int seed = 0; seed < 30; seed++) {
+        uncached.push_back(BatchTestOneCase(param, 4, false, seed));
+    }
+    for (int run = 0; run < 2; run++) {
+        for (int seed = 0; seed < 30; seed++) {
+            EXPECT_THAT(BatchTestOneCase(param, 4, false, seed, kAllBatchTestMethods, nullptr, &cache),
+                        Eq(uncached[seed]));
+        }
+    }
+    EXPECT_THAT(cache.hits_, Ge(30));
+    EXPECT_THAT(cache.misses_, Le(30));
+}
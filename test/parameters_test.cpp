@@ -0,0 +1,94 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <fstream>
+
+#include "parameters.h"
+#include "test_utility.h"
+
+using namespace intersection_management;
+using namespace ::testing;
+
+class TestConfigurationRegistry : public Test {
+public:
+    void SetUp() override {
+        config_file_ = temp_files_.NewFile(".yaml");
+        std::ifstream in(PROJECT_DIR + CONFIG_FILE);
+        std::ofstream out(config_file_);
+        std::string line;
+        // the keys of the project configuration without its profiles
+        while (std::getline(in, line) && line.find("geometry_profiles") == std::string::npos) {
+            out << line << "\n";
+        }
+    }
+
+    TestTempFiles temp_files_;
+    std::string config_file_;
+};
+
+TEST_F(TestConfigurationRegistry, ProfilesOverrideOnlyTheirKeys) {
+    {
+        std::ofstream out(config_file_, std::ios::app);
+        out << "geometry_profiles:\n"
+               "  - num_lanes_in_vec: [2, 2, 2, 2]\n"
+               "    kTimeWindowOffset: 4.5\n"
+               "  - activate_arrival_time: false\n";
+    }
+    ConfigurationRegistry registry(config_file_);
+    auto &profiles = registry.getGeometryProfiles();
+    ASSERT_THAT(profiles.size(), Eq(2));
+    EXPECT_THAT(profiles[0].num_lanes_in_vec, ElementsAre(2, 2, 2, 2));
+    EXPECT_THAT(profiles[0].kTimeWindowOffset, Eq(4.5));
+    EXPECT_THAT(profiles[0].num_lanes_out_vec, Eq(registry.getParameters().num_lanes_out_vec));
+    EXPECT_THAT(profiles[1].activate_arrival_time, IsFalse());
+    EXPECT_THAT(profiles[1].kTimeWindowOffset, Eq(registry.getParameters().kTimeWindowOffset));
+}
+// profiles with the max_queueing_delay of the parameter, which is out of range
+class TestQueueingDelayOutOfRange : public TestConfigurationRegistry, public WithParamInterface<std::string> {};
+
+TEST_P(TestQueueingDelayOutOfRange, IsRejected) {
+    {
+        std::ofstream out(config_file_, std::ios::app);
+        out << "geometry_profiles:\n"
+               "  - max_queueing_delay: " << GetParam() << "\n";
+    }
+    EXPECT_THROW(ConfigurationRegistry registry(config_file_), std::invalid_argument);
+}
+INSTANTIATE_TEST_SUITE_P(QueueingDelays, TestQueueingDelayOutOfRange, Values("0", "-2", ".nan"));
+
+TEST_F(TestConfigurationRegistry, AcceptsQueueingDelayInRange) {
+    {
+        std::ofstream out(config_file_, std::ios::app);
+        out << "geometry_profiles:\n"
+               "  - max_queueing_delay: 30\n";
+    }
+    ConfigurationRegistry registry(config_file_);
+    EXPECT_THAT(registry.getGeometryProfiles()[0].max_queueing_delay, Eq(30));
+}
+TEST_F(TestConfigurationRegistry, FileWithoutProfilesHasNone) {
+    ConfigurationRegistry registry(config_file_);
+    EXPECT_THAT(registry.getGeometryProfiles(), IsEmpty());
+    EXPECT_THAT(registry.getParameters().num_legs, Eq(param.num_legs));
+}
+TEST(TestParameters, CopiesTheParsedConfiguration) {
+    Parameters parameters;
+    Parameters reread(UnconfiguredParametersTag{});
+    reread.readParametersFromYaml();
+    for (auto *copy : {&parameters, &param}) {
+        EXPECT_THAT(copy->num_lanes_in_vec, Eq(reread.num_lanes_in_vec));
+        EXPECT_THAT(copy->travel_time_range, Eq(reread.travel_time_range));
+        EXPECT_THAT(copy->activate_precedent_offset, Eq(reread.activate_precedent_offset));
+        EXPECT_THAT(copy->sumo_config_file, Eq(reread.sumo_config_file));
+    }
+}
+// the geometries that used to be written out in parameters.cpp
+TEST(TestParameters, KeepsTheExperimentGeometries) {
+    ASSERT_THAT(geometryParamVec.size(), Eq(3));
+    EXPECT_THAT(geometryParamVec[0].num_lanes_in_vec, Eq(param.num_lanes_in_vec));
+    EXPECT_THAT(geometryParamVec[1].num_lanes_in_vec, ElementsAre(3, 3, 3, 3));
+    EXPECT_THAT(geometryParamVec[1].travel_time_choice, ElementsAre(6, 7, 8));
+    EXPECT_THAT(geometryParamVec[1].kTimeWindowOffset, Eq(5.15));
+    EXPECT_THAT(geometryParamVec[2].num_lanes_out_vec, ElementsAre(1, 2, 1, 2));
+    EXPECT_THAT(geometryParamVec[2].travel_time_range, ElementsAre(6, 7));
+    EXPECT_THAT(geometryParamVec[2].activate_transitive_reduction, Eq(param.activate_transitive_reduction));
+}
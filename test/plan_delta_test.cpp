@@ -0,0 +1,154 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include "plan_delta.h"
+
+using namespace intersection_management;
+using namespace ::testing;
+
+MATCHER_P(HasWindowsOf, plan, "") {
+    if (arg.sequence_ != plan.sequence_ || arg.plan_time_ != RoundPlanTime(plan.plan_time_) ||
+        arg.vehicles_.size() != plan.vehicles_.size()) {
+        return false;
+    }
+    for (int index = 0; index < plan.vehicles_.size(); index++) {
+        auto &vehicle = arg.vehicles_[index];
+        auto &expected = plan.vehicles_[index];
+        if (vehicle.vehicle_id_ != expected.vehicle_id_ || vehicle.entry_time_ != RoundPlanTime(expected.entry_time_) ||
+            vehicle.exit_time_ != RoundPlanTime(expected.exit_time_)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+IntersectionPlan MakePlan(long sequence, double plan_time, const std::vector<PlannedVehicle> &vehicles) {
+    IntersectionPlan plan;
+    plan.sequence_ = sequence;
+    plan.plan_time_ = plan_time;
+    plan.vehicles_ = vehicles;
+    return plan;
+}
+
+TEST(TestPlanDelta, ListsAddedRemovedAndRetimedVehicles) {
+    auto previous = MakePlan(4, 10.0, {{1, 12, 18}, {2, 14, 20}, {5, 20, 26}, {7, 22, 29}});
+    auto plan = MakePlan(5, 11.0, {{2, 14, 20}, {5, 21, 27}, {6, 24, 30}, {7, 22.0001, 29}, {9, 30, 36}});
+    PlanDelta delta;
+    ComputePlanDelta(previous, plan, delta);
+    EXPECT_THAT(delta.sequence_, Eq(5));
+    EXPECT_THAT(delta.base_sequence_, Eq(4));
+    EXPECT_THAT(delta.removed_, ElementsAre(1));
+    ASSERT_THAT(delta.added_.size(), Eq(2));
+    EXPECT_THAT(delta.added_[0].vehicle_id_, Eq(6));
+    EXPECT_THAT(delta.added_[1].vehicle_id_, Eq(9));
+    // the change of vehicle 7 is below the resolution of the messages
+    ASSERT_THAT(delta.retimed_.size(), Eq(1));
+    EXPECT_THAT(delta.retimed_[0].vehicle_id_, Eq(5));
+    EXPECT_THAT(delta.getNumChanges(), Eq(4));
+}
+
+TEST(TestPlanDelta, DecodesWhatItEncodes) {
+    auto plan = MakePlan(3, 100.25, {{0, 100.25, 106.25}, {3, 99.5, 104.5}, {1000, 1234.5678, 1241.2}});
+    std::vector<uint8_t> message;
+    EncodePlanSnapshot(plan, message);
+    PlanMessageType type;
+    PlanDelta delta;
+    ASSERT_THAT(DecodePlanMessage(message.data(), message.size(), type, delta), IsTrue());
+    EXPECT_THAT(type, Eq(PlanMessage_Snapshot));
+    EXPECT_THAT(delta.base_sequence_, Eq(-1));
+    IntersectionPlan decoded = MakePlan(delta.sequence_, delta.plan_time_, delta.added_);
+    EXPECT_THAT(decoded, HasWindowsOf(plan));
+
+    ComputePlanDelta(IntersectionPlan(), plan, delta);
+    EncodePlanDelta(delta, message);
+    // every vehicle in a few bytes, the plan time in 3
+    EXPECT_THAT(message.size(), Le(2 + 1 + 1 + 3 + 1 + 1 + 3 * 8 + 1));
+    PlanDelta decoded_delta;
+    ASSERT_THAT(DecodePlanMessage(message.data(), message.size(), type, decoded_delta), IsTrue());
+    EXPECT_THAT(type, Eq(PlanMessage_Delta));
+    EXPECT_THAT(decoded_delta.base_sequence_, Eq(0));
+    EXPECT_THAT(MakePlan(decoded_delta.sequence_, decoded_delta.plan_time_, decoded_delta.added_), HasWindowsOf(plan));
+
+    for (int size = 0; size < message.size(); size++) {
+        EXPECT_THAT(DecodePlanMessage(message.data(), size, type, decoded_delta), IsFalse());
+    }
+    message.push_back(0);
+    EXPECT_THAT(DecodePlanMessage(message.data(), message.size(), type, decoded_delta), IsFalse());
+}
+
+TEST(TestPlanReplica, NeedsSnapshotAfterGap) {
+    std::vector<IntersectionPlan> plans = {
+        MakePlan(1, 1.0, {{0, 2, 8}, {1, 3, 9}}),
+        MakePlan(2, 2.0, {{0, 2, 8}, {1, 4, 10}, {2, 6, 12}}),
+        MakePlan(3, 3.0, {{1, 4, 10}, {2, 6, 12}, {3, 8, 13}}),
+        MakePlan(4, 4.5, {{2, 6.5, 12.5}, {3, 8, 13}}),
+    };
+    std::vector<std::vector<uint8_t>> messages;
+    PlanPublisher publisher([&](const std::vector<uint8_t> &message) { messages.push_back(message); });
+    for (auto &plan : plans) {
+        publisher.Publish(plan);
+    }
+    ASSERT_THAT(messages.size(), Eq(plans.size()));
+    EXPECT_THAT(publisher.message_size_.count_, Eq(plans.size()));
+
+    PlanReplica replica;
+    EXPECT_THAT(replica.Apply(messages[0]), IsTrue());
+    EXPECT_THAT(replica.getPlan(), HasWindowsOf(plans[0]));
+    // a repeated message changes nothing
+    EXPECT_THAT(replica.Apply(messages[0]), IsTrue());
+    // plan 2 is lost
+    EXPECT_THAT(replica.Apply(messages[2]), IsFalse());
+    EXPECT_THAT(replica.needsSnapshot(), IsTrue());
+    EXPECT_THAT(replica.getPlan(), HasWindowsOf(plans[0]));
+    EXPECT_THAT(replica.Apply(messages[3]), IsFalse());
+    EXPECT_THAT(replica.num_gaps_, Eq(1));
+
+    EXPECT_THAT(replica.Apply(publisher.EncodeSnapshot()), IsTrue());
+    EXPECT_THAT(replica.needsSnapshot(), IsFalse());
+    EXPECT_THAT(replica.getPlan(), HasWindowsOf(plans[3]));
+}
+
+TEST(TestPlanReplica, RejectsDeltaOfVehiclesNotInThePlan) {
+    PlanReplica replica;
+    std::vector<uint8_t> message;
+    EncodePlanSnapshot(MakePlan(1, 0, {{0, 1, 5}, {2, 2, 6}}), message);
+    ASSERT_THAT(replica.Apply(message), IsTrue());
+
+    PlanDelta delta;
+    delta.sequence_ = 2;
+    delta.base_sequence_ = 1;
+    delta.retimed_ = {{1, 3, 7}};
+    EncodePlanDelta(delta, message);
+    EXPECT_THAT(replica.Apply(message), IsFalse());
+    EXPECT_THAT(replica.needsSnapshot(), IsTrue());
+    EXPECT_THAT(replica.getPlan().sequence_, Eq(1));
+}
+
+// a replica fed the deltas of an online run holds every plan of it
+TEST(TestPlanReplica, FollowsOnlinePlanner) {
+    Parameters local_param(param);
+    local_param.travel_time_choice = {5, 6, 7};
+    local_param.arrival_interval_avg = 3.0;
+    PlanReplica replica;
+    bool is_consistent = true;
+    long num_delta_bytes = 0, num_snapshot_bytes = 0;
+    std::vector<uint8_t> snapshot;
+    OnlinePlanner *planner_in_use = nullptr;
+    PlanPublisher publisher([&](const std::vector<uint8_t> &message) {
+        is_consistent = is_consistent && replica.Apply(message) &&
+                        Matches(HasWindowsOf(planner_in_use->getPlan()))(replica.getPlan());
+        EncodePlanSnapshot(planner_in_use->getPlan(), snapshot);
+        num_delta_bytes += message.size();
+        num_snapshot_bytes += snapshot.size();
+    });
+    OnlinePlanner planner(local_param, WarmStartOptions(), &publisher);
+    planner_in_use = &planner;
+    DemandStream demand(local_param, 3);
+    ArrivalAdmission admission(ArrivalAdmissionOptions{2, 1.0});
+    RunOnlinePlanning(demand, admission, planner, 600);
+
+    EXPECT_THAT(is_consistent, IsTrue());
+    EXPECT_THAT(replica.needsSnapshot(), IsFalse());
+    EXPECT_THAT(publisher.message_size_.count_, Eq(planner.planning_time_.count_));
+    EXPECT_THAT(num_delta_bytes, Lt(num_snapshot_bytes));
+}
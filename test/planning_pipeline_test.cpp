@@ -0,0 +1,182 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <atomic>
+#include <thread>
+
+#include "plan_delta.h"
+#include "planning_pipeline.h"
+
+using namespace intersection_management;
+using namespace ::testing;
+
+TEST(TestSpscQueue, HandsItemsOverInOrder) {
+    SpscQueue<long> queue(5);
+    long item = 0;
+    for (long i = 0; i < 8; i++) {
+        EXPECT_THAT(queue.TryPush(i), IsTrue());
+    }
+    EXPECT_THAT(queue.TryPush(item), IsFalse()); // rounded up to 8 slots
+    for (long i = 0; i < 8; i++) {
+        ASSERT_THAT(queue.TryPop(item), IsTrue());
+        EXPECT_THAT(item, Eq(i));
+    }
+    EXPECT_THAT(queue.TryPop(item), IsFalse());
+    EXPECT_THAT(queue.isEmpty(), IsTrue());
+
+    const long kNumItems = 200000;
+    std::thread producer([&]() {
+        for (long i = 0; i < kNumItems; i++) {
+            while (!queue.TryPush(i)) std::this_thread::yield();
+        }
+    });
+    long expected = 0;
+    while (expected < kNumItems) {
+        if (queue.TryPop(item)) {
+            ASSERT_THAT(item, Eq(expected++));
+        }
+        else {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+}
+
+// every vehicle of plan n has id n, so a reader seeing mixed ids saw a plan being written
+TEST(TestDoubleBufferedPlan, ReadersNeverSeePartialPlans) {
+    DoubleBufferedPlan plans;
+    std::atomic<bool> is_done(false);
+    std::atomic<long> num_torn(0), num_reads(0);
+    std::vector<std::thread> readers;
+    for (int reader = 0; reader < 2; reader++) {
+        readers.emplace_back([&]() {
+            long last_sequence = 0;
+            while (!is_done.load()) {
+                plans.Read([&](const IntersectionPlan &plan) {
+                    for (auto &vehicle : plan.vehicles_) {
+                        if (vehicle.vehicle_id_ != plan.sequence_) num_torn++;
+                    }
+                    if (plan.sequence_ < last_sequence) num_torn++;
+                    last_sequence = plan.sequence_;
+                });
+                num_reads++;
+            }
+        });
+    }
+    for (long sequence = 1; sequence <= 20000; sequence++) {
+        auto &plan = plans.BeginWrite();
+        plan.sequence_ = sequence;
+        plan.vehicles_.assign(sequence % 17 + 1, PlannedVehicle{sequence, 0, 1});
+        plans.Publish();
+    }
+    is_done = true;
+    for (auto &reader : readers) {
+        reader.join();
+    }
+    EXPECT_THAT(num_torn.load(), Eq(0));
+    EXPECT_THAT(plans.getSnapshot().sequence_, Eq(20000));
+}
+
+TEST(TestPlanningPipeline, PlansEveryBatchWhileServingConsistentPlans) {
+    Parameters local_param = param;
+    local_param.arrival_interval_avg = 4.0;
+    local_param.travel_time_choice = {5, 6, 7};
+    DemandStream demand(local_param, 4);
+    std::vector<VehicleTraceRecord> arrival;
+    long num_admitted = 0;
+    PlanningPipeline pipeline(local_param, ArrivalAdmissionOptions{4, 2.0}, 4);
+    pipeline.Start([&](VehicleTraceRecord &record) {
+        arrival.clear();
+        if (demand.NextBatch(arrival, 1, 3600) == 0) {
+            return false;
+        }
+        record = arrival[0];
+        num_admitted++;
+        return true;
+    });
+
+    long last_sequence = 0, num_reads = 0;
+    while (pipeline.getNumPlans() < 100) {
+        pipeline.getPlan().Read([&](const IntersectionPlan &plan) {
+            EXPECT_THAT(plan.sequence_, Ge(last_sequence));
+            last_sequence = plan.sequence_;
+            for (int index = 0; index < plan.vehicles_.size(); index++) {
+                EXPECT_THAT(plan.vehicles_[index].entry_time_, Ge(plan.plan_time_));
+                if (index > 0) {
+                    EXPECT_THAT(plan.vehicles_[index].vehicle_id_, Gt(plan.vehicles_[index - 1].vehicle_id_));
+                }
+            }
+        });
+        num_reads++;
+        std::this_thread::yield();
+    }
+    pipeline.Join();
+
+    EXPECT_THAT(num_reads, Gt(0));
+    EXPECT_THAT(pipeline.getNumPlans(), Eq(pipeline.admission_.batch_size_.count_));
+    EXPECT_THAT(pipeline.build_time_.count_, Eq(pipeline.getNumPlans()));
+    auto plan = pipeline.getPlan().getSnapshot();
+    EXPECT_THAT(plan.sequence_, Eq(pipeline.getNumPlans()));
+    // the last plan still holds the vehicles that hadn't entered when it was built
+    EXPECT_THAT(pipeline.window_.num_entered_ + static_cast<long>(pipeline.window_.getWaitingVehicles().size()),
+                Eq(num_admitted));
+    EXPECT_THAT(plan.vehicles_.size(), Eq(pipeline.window_.getWaitingVehicles().size()));
+}
+
+// cold start period and max_queueing_delay
+class TestPlanningPipelineMatchesOnlinePlanner : public TestWithParam<std::tuple<int, double>> {};
+
+// build waits for the plan of the previous batch, so the pipeline plans every batch exactly as OnlinePlanner
+TEST_P(TestPlanningPipelineMatchesOnlinePlanner, PlanForPlan) {
+    Parameters local_param = param;
+    local_param.arrival_interval_avg = 4.0;
+    local_param.travel_time_choice = {5, 6, 7};
+    local_param.max_queueing_delay = std::get<1>(GetParam());
+    WarmStartOptions warm_start;
+    warm_start.cold_start_period_ = std::get<0>(GetParam());
+    const ArrivalAdmissionOptions kAdmission{3, 1.0};
+    const double kHorizon = 600;
+
+    std::vector<IntersectionPlan> online_plans;
+    PlanPublisher online_publisher(
+        [&](const std::vector<uint8_t> &) { online_plans.push_back(online_publisher.getPublishedPlan()); });
+    OnlinePlanner planner(local_param, warm_start, &online_publisher);
+    DemandStream demand(local_param, 6);
+    ArrivalAdmission admission(kAdmission);
+    RunOnlinePlanning(demand, admission, planner, kHorizon);
+
+    std::vector<IntersectionPlan> pipeline_plans;
+    PlanPublisher pipeline_publisher(
+        [&](const std::vector<uint8_t> &) { pipeline_plans.push_back(pipeline_publisher.getPublishedPlan()); });
+    PlanningPipeline pipeline(local_param, kAdmission, 16, warm_start, &pipeline_publisher);
+    DemandStream pipeline_demand(local_param, 6);
+    std::vector<VehicleTraceRecord> arrival;
+    pipeline.Start([&](VehicleTraceRecord &record) {
+        arrival.clear();
+        if (pipeline_demand.NextBatch(arrival, 1, kHorizon) == 0) {
+            return false;
+        }
+        record = arrival[0];
+        return true;
+    });
+    pipeline.Join();
+
+    ASSERT_THAT(pipeline_plans.size(), Eq(online_plans.size()));
+    for (int index = 0; index < online_plans.size(); index++) {
+        auto &plan = pipeline_plans[index];
+        auto &expected = online_plans[index];
+        EXPECT_THAT(plan.sequence_, Eq(expected.sequence_));
+        EXPECT_THAT(plan.plan_time_, Eq(expected.plan_time_));
+        ASSERT_THAT(plan.vehicles_.size(), Eq(expected.vehicles_.size())) << "plan " << expected.sequence_;
+        for (int vehicle = 0; vehicle < expected.vehicles_.size(); vehicle++) {
+            EXPECT_THAT(plan.vehicles_[vehicle].vehicle_id_, Eq(expected.vehicles_[vehicle].vehicle_id_));
+            EXPECT_THAT(plan.vehicles_[vehicle].entry_time_, Eq(expected.vehicles_[vehicle].entry_time_));
+            EXPECT_THAT(plan.vehicles_[vehicle].exit_time_, Eq(expected.vehicles_[vehicle].exit_time_));
+        }
+    }
+    EXPECT_THAT(pipeline.window_.num_entered_, Eq(planner.window_.num_entered_));
+    EXPECT_THAT(pipeline.window_.entry_delay_.mean_, Eq(planner.window_.entry_delay_.mean_));
+    EXPECT_THAT(pipeline.getNumWarmStarts(), Eq(planner.getNumWarmStarts()));
+}
+INSTANTIATE_TEST_SUITE_P(ColdStartPeriodsAndHorizons, TestPlanningPipelineMatchesOnlinePlanner,
+                         Combine(Values(1, 4), Values(-1.0, 10.0)));
@@ -0,0 +1,41 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <random>
+#include <vector>
+
+#include "running_statistics.h"
+
+using namespace intersection_management;
+using namespace ::testing;
+
+TEST(TestRunningStatistics, MatchesTwoPassMeanAndVariance) {
+    std::mt19937 mt(0);
+    std::normal_distribution<double> dist(1e6, 3.0); // large offset, where the sum of squares loses precision
+    std::vector<double> values;
+    RunningStatistics statistics;
+    for (int i = 0; i < 5000; i++) {
+        values.push_back(dist(mt));
+        statistics.Add(values.back());
+    }
+    double mean = 0;
+    for (double value : values) mean += value;
+    mean /= values.size();
+    double variance = 0;
+    for (double value : values) variance += (value - mean) * (value - mean);
+    variance /= values.size() - 1;
+
+    EXPECT_THAT(statistics.count_, Eq(5000));
+    EXPECT_THAT(statistics.mean_, DoubleNear(mean, 1e-6));
+    EXPECT_THAT(statistics.getVariance(), DoubleNear(variance, 1e-6));
+    EXPECT_THAT(statistics.getConfidenceIntervalWidth(1.96), DoubleNear(2 * 1.96 * std::sqrt(variance / 5000), 1e-9));
+}
+TEST(TestRunningStatistics, IntervalIsUnboundedBeforeTwoSamples) {
+    RunningStatistics statistics;
+    EXPECT_THAT(statistics.getConfidenceIntervalWidth(1.96), Eq(std::numeric_limits<double>::infinity()));
+    statistics.Add(4.0);
+    EXPECT_THAT(statistics.getVariance(), Eq(0.0));
+    EXPECT_THAT(statistics.getConfidenceIntervalWidth(1.96), Eq(std::numeric_limits<double>::infinity()));
+    statistics.Add(4.0);
+    EXPECT_THAT(statistics.getConfidenceIntervalWidth(1.96), Eq(0.0));
+}
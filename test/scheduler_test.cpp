@@ -0,0 +1,151 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <random>
+
+#include "scheduler.h"
+#include "parameters.h"
+
+using namespace intersection_management;
+using namespace ::testing;
+
+class TestFIFO : public Test {
+public:
+    void GenerateEdges(Intersection &intersection, int num_nodes, int seed) {
+        intersection.setSeed(seed);
+        intersection.AddRandomVehicleNodes(num_nodes);
+        intersection.AssignCriticalResourcesToNodes();
+        intersection.AssignRoutesToNodes();
+        intersection.AssignEdgesWithSafetyOffsetToNodes();
+    }
+
+    // FIFO by scanning every earlier vehicle through the conflict edges
+    std::vector<double> ScheduleWithEdgeScan(Intersection &intersection) {
+        std::vector<double> start_time(intersection.num_nodes_, 0), end_time(intersection.num_nodes_, 0);
+        for (int id = 1; id < intersection.num_nodes_; id++) {
+            double earliest_start_time = param.activate_arrival_time ? intersection.nodes_[id]->estimate_arrival_time_ : -1;
+            earliest_start_time = std::max(earliest_start_time, start_time[id - 1]);
+            for (int pre_id = id - 1; pre_id > 0; pre_id--) {
+                if (intersection.nodes_[id]->isConnectedWith(pre_id)) {
+                    auto &ct = intersection.nodes_[id]->getEdgeWith(pre_id)->conflict_type_;
+                    if (ct.isConverging() || ct.isCrossing() || ct.isDiverging() || ct.isPrecedence()) {
+                        earliest_start_time = std::max(earliest_start_time, end_time[pre_id]);
+                    }
+                }
+            }
+            start_time[id] = earliest_start_time;
+            end_time[id] = earliest_start_time + intersection.nodes_[id]->estimate_travel_time_;
+        }
+        return end_time;
+    }
+};
+
+TEST_F(TestFIFO, MatchesEdgeScan) {
+    Scheduler scheduler;
+    for (int seed = 0; seed < 20; seed++) {
+        Intersection intersection;
+        GenerateEdges(intersection, 50, seed);
+        auto fifo_tree = scheduler.ScheduleWithFIFO(intersection);
+        auto end_time = ScheduleWithEdgeScan(intersection);
+        for (int id = 1; id < intersection.num_nodes_; id++) {
+            EXPECT_THAT(fifo_tree.nodes_[id]->time_window_[1], DoubleEq(end_time[id]));
+        }
+    }
+}
+TEST_F(TestFIFO, MatchesEdgeScanOnOtherGeometries) {
+    Scheduler scheduler;
+    for (auto &local_param : geometryParamVec) {
+        for (int seed = 0; seed < 5; seed++) {
+            Intersection intersection(local_param);
+            GenerateEdges(intersection, 30, seed);
+            auto fifo_tree = scheduler.ScheduleWithFIFO(intersection);
+            auto end_time = ScheduleWithEdgeScan(intersection);
+            for (int id = 1; id < intersection.num_nodes_; id++) {
+                EXPECT_THAT(fifo_tree.nodes_[id]->time_window_[1], DoubleEq(end_time[id]));
+            }
+        }
+    }
+}
+TEST_F(TestFIFO, KeepsRouteClassesOfTheGeometry) {
+    Scheduler scheduler;
+    Intersection intersection;
+    GenerateEdges(intersection, 20, 0);
+    auto *conflicts = intersection.getRouteClassTable().conflict_table_.data();
+    scheduler.ScheduleWithFIFO(intersection);
+    scheduler.ScheduleWithFIFO(intersection);
+    EXPECT_THAT(intersection.getRouteClassTable().conflict_table_.data(), Eq(conflicts));
+
+    // a new geometry has its own classes
+    intersection.InitializeFromLocalParam(geometryParamVec[1]);
+    intersection.reset();
+    intersection.AddIntersectionUtilitiesFromGeometry();
+    GenerateEdges(intersection, 20, 0);
+    auto fifo_tree = scheduler.ScheduleWithFIFO(intersection);
+    auto end_time = ScheduleWithEdgeScan(intersection);
+    EXPECT_THAT(intersection.getRouteClassTable().num_lanes_, Eq(intersection.getNumLanes()));
+    for (int id = 1; id < intersection.num_nodes_; id++) {
+        EXPECT_THAT(fifo_tree.nodes_[id]->time_window_[1], DoubleEq(end_time[id]));
+    }
+}
+
+class TestReadyListPriority : public TestFIFO {
+public:
+    // tie-break rules evaluated on every comparison, as the key must reproduce them
+    bool ComesBefore(const Candidate &candidate1, const Candidate &candidate2, Scheduler &scheduler, Intersection &intersection) {
+        if (candidate1.possible_depth_ != candidate2.possible_depth_)
+            return candidate1.possible_depth_ < candidate2.possible_depth_;
+        if (local_param_.tie_high_demand_first) {
+            int demand1 = scheduler.remaining_demand_per_lane_[intersection.nodes_[candidate1.id_]->route_->getLaneIn()->getUniqueId()];
+            int demand2 = scheduler.remaining_demand_per_lane_[intersection.nodes_[candidate2.id_]->route_->getLaneIn()->getUniqueId()];
+            if (demand1 != demand2)
+                return demand1 > demand2;
+        }
+        if (local_param_.tie_minimum_resource_waste_first) {
+            bool rightmost1 = intersection.isRightmostTurningRoute(intersection.nodes_[candidate1.id_]->route_) &&
+                intersection.critical_resource_map_.count(candidate1.out_leg_id_);
+            bool rightmost2 = intersection.isRightmostTurningRoute(intersection.nodes_[candidate2.id_]->route_) &&
+                intersection.critical_resource_map_.count(candidate2.out_leg_id_);
+            if (rightmost1 != rightmost2)
+                return rightmost1;
+        }
+        if (local_param_.tie_consider_splitting_resource) {
+            if (candidate1.split_flexible_critical_resource_ != candidate2.split_flexible_critical_resource_)
+                return candidate1.split_flexible_critical_resource_;
+            if (candidate1.split_flexible_critical_resource_ &&
+                candidate1.num_critical_resource_splitted_ != candidate2.num_critical_resource_splitted_)
+                return local_param_.tie_more_splitted_resource_first ?
+                    candidate1.num_critical_resource_splitted_ > candidate2.num_critical_resource_splitted_ :
+                    candidate1.num_critical_resource_splitted_ < candidate2.num_critical_resource_splitted_;
+        }
+        return candidate1.id_ < candidate2.id_;
+    }
+
+    Parameters local_param_;
+};
+
+TEST_F(TestReadyListPriority, MatchesTieBreakRules) {
+    Intersection intersection;
+    GenerateEdges(intersection, 60, 0);
+    std::mt19937 mt(0);
+    for (int strategy = 0; strategy < 16; strategy++) {
+        local_param_.tie_high_demand_first = strategy & 1;
+        local_param_.tie_minimum_resource_waste_first = strategy & 2;
+        local_param_.tie_consider_splitting_resource = strategy & 4;
+        local_param_.tie_more_splitted_resource_first = strategy & 8;
+        Scheduler scheduler(local_param_);
+        scheduler.PrepareForTreeSchedule(intersection);
+
+        std::vector<Candidate> ready_list;
+        for (int id = 1; id < intersection.num_nodes_; id++) {
+            double depth = mt() % 3;
+            bool split_flexible_critical_resource = mt() % 2;
+            int num_critical_resource_splitted = split_flexible_critical_resource ? mt() % 3 + 1 : 0;
+            ready_list.push_back(scheduler.MakeCandidate(id, depth, 0, intersection, 0, split_flexible_critical_resource,
+                                                         num_critical_resource_splitted));
+        }
+        scheduler.SortReadyListAscendingly(ready_list);
+        for (int i = 0; i + 1 < ready_list.size(); i++) {
+            EXPECT_THAT(ComesBefore(ready_list[i], ready_list[i + 1], scheduler, intersection), IsTrue());
+        }
+    }
+}
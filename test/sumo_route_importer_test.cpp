@@ -0,0 +1,111 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <fstream>
+#include <sstream>
+
+#include "sumo_route_importer.h"
+#include "test_utility.h"
+
+using namespace intersection_management;
+using namespace ::testing;
+
+TEST(TestXmlStream, ReportsElementsWithDecodedAttributes) {
+    std::istringstream in("<?xml version=\"1.0\"?>\n<!-- a <comment> -->\n<a x='1 &amp; 2'><b y=\"&lt;&#65;&gt;\"/>"
+                          "text</a>");
+    std::vector<std::string> events;
+    auto start_element = [&](const std::string &name, const XmlAttributes &attributes) {
+        std::string event = "+" + name;
+        for (auto &attribute : attributes) {
+            event += " " + attribute.first + "=" + attribute.second;
+        }
+        events.push_back(event);
+    };
+    auto end_element = [&](const std::string &name) { events.push_back("-" + name); };
+    ASSERT_THAT(ParseXmlStream(in, start_element, end_element), IsTrue());
+    EXPECT_THAT(events, ElementsAre("+a x=1 & 2", "+b y=<A>", "-b", "-a"));
+
+    std::istringstream truncated("<routes><vehicle id=\"0");
+    EXPECT_THAT(ParseXmlStream(truncated, start_element, end_element), IsFalse());
+}
+
+class TestSumoRouteImporter : public Test {
+public:
+    TestSumoRouteImporter() : local_param_(UnconfiguredParametersTag{}) {
+        local_param_.num_legs = 4;
+        local_param_.num_lanes_in_vec = {1, 2, 1, 2};
+        local_param_.num_lanes_out_vec = {1, 2, 1, 2};
+        local_param_.travel_time_choice = {5, 6, 7};
+        edge_map_ = {{"north_in", {0, true}}, {"east_in", {1, true}}, {"south_in", {2, true}},
+                     {"west_in", {3, true}}, {"north_out", {0, false}}, {"east_out", {1, false}},
+                     {"south_out", {2, false}}, {"west_out", {3, false}}};
+    }
+
+    Parameters local_param_;
+    SumoEdgeMap edge_map_;
+};
+
+const char *kRouteFile = R"(<?xml version="1.0" encoding="UTF-8"?>
+<routes>
+    <vType id="car" accel="2.6"/>
+    <route id="north_south" edges="north_in junction_link south_out"/>
+    <vehicle id="0" type="car" depart="1.5" route="north_south" departLane="0"/>
+    <vehicle id="1" depart="2.00" departLane="best" arrivalLane="1">
+        <route edges="east_in west_out"/>
+    </vehicle>
+    <!-- <vehicle id="commented" depart="2.5" route="north_south"/> -->
+    <trip id="2" depart="3" from="east_in" to="north_out" departLane="1"/>
+    <trip id="3" depart="4" from="east_in" to="south_out"><stop lane="x" duration="1"/></trip>
+    <flow id="4" begin="0" end="100" number="10" route="north_south"/>
+    <vehicle id="5" depart="triggered" route="north_south"/>
+    <trip id="6" depart="5" from="unknown_in" to="south_out"/>
+    <trip id="7" depart="6" from="north_in" to="north_out"/>
+</routes>
+)";
+
+TEST_F(TestSumoRouteImporter, MapsRoutesOntoLegsAndLanes) {
+    SumoRouteImporter importer(local_param_, edge_map_);
+    std::istringstream in(kRouteFile);
+    std::vector<VehicleTraceRecord> records;
+    ASSERT_THAT(importer.Import(in, [&](const VehicleTraceRecord &record) { records.push_back(record); }), IsTrue());
+    EXPECT_THAT(importer.num_imported_, Eq(4));
+    EXPECT_THAT(importer.num_skipped_, Eq(4)); // the flow, the triggered departure, the unknown edge, the u-turn
+    ASSERT_THAT(records.size(), Eq(4));
+
+    EXPECT_THAT(records[0].arrival_time_, Eq(1.5));
+    EXPECT_THAT(records[0].in_leg_id_, Eq(0));
+    EXPECT_THAT(records[0].out_leg_id_, Eq(2));
+    EXPECT_THAT(records[0].travel_time_, Eq(6));
+
+    // lanes that aren't numbers go round the lanes of the leg
+    EXPECT_THAT(records[1].in_leg_id_, Eq(1));
+    EXPECT_THAT(records[1].in_lane_id_, Eq(0));
+    EXPECT_THAT(records[1].out_leg_id_, Eq(3));
+    EXPECT_THAT(records[1].out_lane_id_, Eq(1));
+    EXPECT_THAT(records[2].in_lane_id_, Eq(1));
+    EXPECT_THAT(records[2].out_leg_id_, Eq(0));
+    EXPECT_THAT(records[2].travel_time_, Eq(5));
+    EXPECT_THAT(records[3].in_lane_id_, Eq(1));
+    EXPECT_THAT(records[3].travel_time_, Eq(7));
+}
+
+TEST_F(TestSumoRouteImporter, WritesReadableTrace) {
+    TestTempFiles temp_files;
+    std::string route_file = temp_files.NewFile(".rou.xml");
+    std::string trace_file = temp_files.NewFile(".imvt");
+    {
+        std::ofstream out(route_file);
+        out << kRouteFile;
+    }
+    SumoRouteImporter importer(local_param_, edge_map_);
+    ASSERT_THAT(importer.ImportToTrace(route_file, trace_file), IsTrue());
+
+    VehicleTraceReader trace(trace_file);
+    VehicleTraceRecord record;
+    std::vector<double> arrival_times;
+    while (trace.Next(record)) {
+        arrival_times.push_back(record.arrival_time_);
+    }
+    EXPECT_THAT(trace.hasError(), IsFalse());
+    EXPECT_THAT(arrival_times, ElementsAre(1.5, 2, 3, 4));
+}
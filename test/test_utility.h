@@ -0,0 +1,73 @@
+#ifndef INTERSECTION_MANAGEMENT_TEST_UTILITY_H_
+#define INTERSECTION_MANAGEMENT_TEST_UTILITY_H_
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <cctype>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "batch_test_utility.h"
+#include "conflict_directed_graph.h"
+#include "intersection.h"
+
+namespace intersection_management {
+
+// Files of the running test, named after the test and the process so that tests running at the same time,
+// in one executable or in several, never share one. They are removed with the object
+class TestTempFiles {
+public:
+    ~TestTempFiles() {
+        for (auto &file : files_) {
+            std::remove(file.c_str());
+        }
+    }
+
+    // path in the temporary directory ending in suffix, which doesn't exist yet
+    std::string NewFile(const std::string &suffix) {
+        auto test_info = ::testing::UnitTest::GetInstance()->current_test_info();
+        std::string name = std::string(test_info->test_suite_name()) + "." + test_info->name();
+        for (auto &c : name) {
+            if (!std::isalnum(static_cast<unsigned char>(c)) && c != '.') {
+                c = '_';
+            }
+        }
+        files_.push_back(::testing::TempDir() + name + "." + std::to_string(getpid()) + "." +
+                         std::to_string(files_.size()) + suffix);
+        std::remove(files_.back().c_str());
+        return files_.back();
+    }
+
+private:
+    std::vector<std::string> files_;
+};
+
+// graph of num_nodes random vehicles on the intersection of the global parameters, unlike
+// ConflictDirectedGraph::GenerateRandomGraph which draws the conflicts themselves
+inline ConflictDirectedGraph GenerateIntersectionGraph(int num_nodes, int seed) {
+    Intersection intersection;
+    ConflictDirectedGraph cdg;
+    intersection.setSeed(seed);
+    intersection.AddRandomVehicleNodes(num_nodes);
+    intersection.AssignCriticalResourcesToNodes();
+    intersection.AssignRoutesToNodes();
+    intersection.AssignEdgesWithSafetyOffsetToNodes();
+    cdg.GenerateGraphFromIntersection(intersection);
+    return cdg;
+}
+
+// batch of the global parameters that prints nothing
+inline BatchTestOptions MakeQuietBatchOptions(int num_nodes, int test_count, int starting_seed, int num_threads) {
+    BatchTestOptions options;
+    options.num_nodes_ = num_nodes;
+    options.test_count_ = test_count;
+    options.print_interval_ = -1;
+    options.starting_seed_ = starting_seed;
+    options.num_threads_ = num_threads;
+    return options;
+}
+
+} // namespace intersection_management
+#endif // INTERSECTION_MANAGEMENT_TEST_UTILITY_H_